@@ -0,0 +1,237 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "stdafx.h"
+#include <cmath>
+#include "CadencePlanner.h"
+
+void CCadencePlanner::Reset()
+{
+	m_vsyncPeriod = 0;
+	m_frameDuration = 0;
+	m_cycleSize = 0;
+	m_cyclePos = 0;
+	m_bPhaseValid = false;
+	m_vsyncPhase = 0;
+	m_period = 0;
+	Unlock();
+
+	m_repeats = 0;
+	m_drops = 0;
+	m_late = 0;
+}
+
+void CCadencePlanner::Unlock()
+{
+	m_bLocked = false;
+	m_errorCount = 0;
+	m_plannedVsyncs = 0;
+}
+
+void CCadencePlanner::UpdateCadence()
+{
+	m_cycleSize = 0;
+	m_cyclePos = 0;
+	m_cycleBias[0] = 0;
+
+	const double ratio = (double)m_frameDuration / m_vsyncPeriod;
+	if (ratio < 0.998) {
+		return; // more frames than vsyncs, the planner is not used
+	}
+
+	// the smallest cycle that differs from the ratio by no more than 0.2%,
+	// 23.976 fps on 60 Hz is 2:3 with a repeat every 1000 vsyncs
+	for (unsigned q = 1; q <= kMaxCycle; q++) {
+		const unsigned p = (unsigned)std::lround(ratio * q);
+		if (p >= q && std::abs((double)p / q - ratio) <= ratio * 0.002) {
+			for (unsigned k = 0; k < q; k++) {
+				m_cycle[k] = (uint8_t)std::min((k + 1) * p / q - k * p / q, 255u);
+			}
+			m_cycleSize = q;
+			// "2:3", the statistics read it on every frame
+			wchar_t* str = m_cycleString;
+			for (unsigned k = 0; k < q; k++) {
+				const unsigned n = m_cycle[k];
+				if (k) {
+					*str++ = L':';
+				}
+				if (n >= 100) {
+					*str++ = L'0' + n / 100;
+				}
+				if (n >= 10) {
+					*str++ = L'0' + n / 10 % 10;
+				}
+				*str++ = L'0' + n % 10;
+			}
+			*str = 0;
+			// average of the vsyncs from the start of the cycle minus k*p/q,
+			// 2:3 is -0.25 from the first position and +0.25 from the second
+			for (unsigned start = 0; start < q; start++) {
+				double bias = 0;
+				unsigned vsyncs = 0;
+				for (unsigned k = 0; k < q; k++) {
+					bias += vsyncs - (double)k * p / q;
+					vsyncs += m_cycle[(start + k) % q];
+				}
+				m_cycleBias[start] = bias / q;
+			}
+			break;
+		}
+	}
+}
+
+void CCadencePlanner::SetRates(const REFERENCE_TIME vsyncPeriod, const REFERENCE_TIME frameDuration)
+{
+	if (vsyncPeriod <= 0 || frameDuration <= 0) {
+		return;
+	}
+
+	const bool bVsyncChanged = std::abs(vsyncPeriod - m_vsyncPeriod) * 1000 > vsyncPeriod;
+	const bool bFrameChanged = std::abs(frameDuration - m_frameDuration) * 500 > frameDuration;
+
+	if (bVsyncChanged || bFrameChanged) {
+		if (bVsyncChanged) {
+			m_vsyncPeriod = vsyncPeriod;
+			m_period = (double)vsyncPeriod;
+			m_bPhaseValid = false;
+		}
+		m_frameDuration = frameDuration;
+		UpdateCadence();
+		Unlock();
+
+		m_repeats = 0;
+		m_drops = 0;
+		m_late = 0;
+	}
+}
+
+void CCadencePlanner::AddVsync(const REFERENCE_TIME vsyncTime)
+{
+	if (m_period <= 0) {
+		return;
+	}
+
+	if (!m_bPhaseValid) {
+		m_vsyncPhase = (double)vsyncTime;
+		m_bPhaseValid = true;
+		Unlock();
+		return;
+	}
+
+	const double pos = (vsyncTime - m_vsyncPhase) / m_period;
+	const int64_t n = std::llround(pos);
+	const double err = (pos - n) * m_period;
+
+	if (std::abs(err) > m_period / 4) {
+		// the display was changed or the clock jumped
+		m_vsyncPhase = (double)vsyncTime;
+		Unlock();
+		return;
+	}
+
+	// move the phase to the last vsync, the planned vsync index moves with it
+	m_vsyncPhase += n * m_period + err / 8;
+	m_lastVsync -= n;
+}
+
+CCadencePlanner::Plan_t CCadencePlanner::PlanFrame(const REFERENCE_TIME frameStart, const REFERENCE_TIME now, REFERENCE_TIME& presentTime)
+{
+	if (!m_bPhaseValid || m_vsyncPeriod <= 0 || m_frameDuration * 1000 < m_vsyncPeriod * 998) {
+		Unlock();
+		return Plan_None;
+	}
+
+	const double framePos = (frameStart - m_vsyncPhase) / m_period; // in vsyncs
+
+	int64_t target;
+	if (m_bLocked) {
+		if (m_cycleSize) {
+			target = m_lastVsync + m_cycle[m_cyclePos];
+			m_cyclePos = (m_cyclePos + 1) % m_cycleSize;
+		} else {
+			target = std::max<int64_t>(m_lastVsync + 1, std::llround(framePos));
+		}
+
+		const double error = target - framePos;
+		if (std::abs(error) > 2.0) {
+			// seek or a long stall
+			Unlock();
+		}
+		else if (m_cycleSize) {
+			m_errors[m_errorCount++ % m_cycleSize] = error;
+			if (m_errorCount >= m_cycleSize) {
+				double mean = 0;
+				for (unsigned k = 0; k < m_cycleSize; k++) {
+					mean += m_errors[k];
+				}
+				mean /= m_cycleSize;
+
+				if (mean > kCorrectionThreshold) {
+					target--; // the display is slower than the content
+					m_drops++;
+					m_errorCount = 0;
+				}
+				else if (mean < -kCorrectionThreshold) {
+					target++; // the display is faster than the content
+					m_repeats++;
+					m_errorCount = 0;
+				}
+			}
+		}
+	}
+
+	const bool bContinued = m_bLocked;
+	if (!m_bLocked) {
+		// the start of the cycle with the smallest average error of the following cycle,
+		// it is no more than 0.25 vsync for 2:3
+		const unsigned positions = std::max(m_cycleSize, 1u);
+		double minError = 1.0;
+		for (unsigned start = 0; start < positions; start++) {
+			const int64_t t = std::llround(framePos - m_cycleBias[start]);
+			const double error = t - framePos + m_cycleBias[start];
+			if (std::abs(error) < minError) {
+				minError = std::abs(error);
+				target = t;
+				m_cyclePos = start;
+			}
+		}
+		m_errorCount = 0;
+		m_bLocked = true;
+	}
+	else if (target <= m_lastVsync) {
+		return Plan_Skip; // the previous frame takes this vsync
+	}
+
+	// present in the middle of the previous vsync interval
+	const double vsyncTime = m_vsyncPhase + target * m_period;
+	if (now > vsyncTime - m_period / 8) {
+		// too late for the planned vsync, the previous frame is shown longer
+		target = (int64_t)std::ceil((now - m_vsyncPhase) / m_period + 0.125);
+		m_late++;
+		m_errorCount = 0;
+		presentTime = now;
+	} else {
+		presentTime = (REFERENCE_TIME)std::max(vsyncTime - m_period / 2, (double)now);
+	}
+	m_plannedVsyncs = bContinued ? (unsigned)(target - m_lastVsync) : 0;
+	m_lastVsync = target;
+
+	return Plan_Present;
+}
@@ -0,0 +1,100 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+//
+// Plans the vsync on which each frame is shown.
+// The ratio of the frame duration to the vsync period is approximated by a small fraction
+// that gives a fixed cadence (2:3 for 23.976 on 59.94 Hz, 5 for 24 on 120 Hz, 2:2:3:2:3 for 25 on 60 Hz).
+// The difference between the content and display clocks is absorbed by rare single
+// vsync repeats or drops when the average error of the cadence cycle exceeds 0.6 vsync.
+// It is more than half a vsync, so the error after a correction (0.4 vsync with
+// the opposite sign) does not trigger the opposite correction.
+// All times are stream times in 100 ns units, no Windows API is used.
+//
+
+class CCadencePlanner
+{
+public:
+	enum Plan_t {
+		Plan_None,    // not locked to the vsync, present as usual
+		Plan_Present, // present at presentTime
+		Plan_Skip,    // do not present the frame, it is dropped to keep the cadence
+	};
+
+	static constexpr unsigned kMaxCycle = 8; // max frames in a cadence cycle
+	static constexpr double kCorrectionThreshold = 0.6; // average error of the cycle in vsyncs
+
+private:
+	REFERENCE_TIME m_vsyncPeriod = 0;
+	REFERENCE_TIME m_frameDuration = 0;
+
+	// cadence: number of vsyncs for each frame of the cycle
+	uint8_t m_cycle[kMaxCycle] = {};
+	unsigned m_cycleSize = 0; // 0 - no clean cadence, frames go to the nearest vsync
+	wchar_t m_cycleString[kMaxCycle * 4] = {};
+	unsigned m_cyclePos = 0;
+
+	// vsync grid
+	bool m_bPhaseValid = false;
+	double m_vsyncPhase = 0; // stream time of a vsync
+	double m_period = 0;
+
+	// plan
+	bool m_bLocked = false;
+	int64_t m_lastVsync = 0;
+	double m_errors[kMaxCycle] = {}; // errors of the last cadence cycle in vsyncs
+	unsigned m_errorCount = 0;
+	double m_cycleBias[kMaxCycle] = {}; // average error of the cadence cycle with exact rates for each start position
+	unsigned m_plannedVsyncs = 0; // vsyncs between the last two planned frames
+
+	unsigned m_repeats = 0;
+	unsigned m_drops = 0;
+	unsigned m_late = 0;
+
+	void UpdateCadence();
+	void Unlock();
+
+public:
+	// Forgets the rates, the vsync phase and the counters, call it on seek, stop and run
+	void Reset();
+
+	// The vsync period and the content frame duration, small changes are ignored
+	void SetRates(const REFERENCE_TIME vsyncPeriod, const REFERENCE_TIME frameDuration);
+
+	// A measured vsync time, the vsync phase follows it
+	void AddVsync(const REFERENCE_TIME vsyncTime);
+
+	// Plans the vsync of the frame, now is the current stream time
+	Plan_t PlanFrame(const REFERENCE_TIME frameStart, const REFERENCE_TIME now, REFERENCE_TIME& presentTime);
+
+	bool IsLocked() const { return m_bLocked; }
+	REFERENCE_TIME GetVsyncPeriod() const { return m_vsyncPeriod; }
+	// The planned interval between the last two presented frames in vsyncs, 0 if the plan was just (re)started
+	unsigned GetPlannedVsyncs() const { return m_plannedVsyncs; }
+
+	// "2:3", "5", "2:2:3:2:3" or "free"
+	const wchar_t* GetCadenceString() const { return m_cycleSize ? m_cycleString : L"free"; }
+	// Counters since Reset() or the last change of the cadence
+	unsigned GetRepeats() const { return m_repeats; } // vsyncs added to absorb the clock difference
+	unsigned GetDrops() const { return m_drops; }     // vsyncs removed to absorb the clock difference
+	unsigned GetLate() const { return m_late; }       // frames that came too late for the planned vsync
+};
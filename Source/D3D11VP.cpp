@@ -459,6 +459,12 @@ ID3D11Texture2D* CD3D11VP::GetNextInputTexture(const D3D11_VIDEO_FRAME_FORMAT vf
 	return *m_VideoTextures.GetTexture();
 }
 
+ID3D11Texture2D* CD3D11VP::GetInputTexture()
+{
+	ID3D11Texture2D** ppTexture = m_VideoTextures.GetTexture();
+	return ppTexture ? *ppTexture : nullptr;
+}
+
 void CD3D11VP::SetInputVideoData(ID3D11Texture2D* pTexture, IMediaSample* pSample, UINT ArraySlice, const D3D11_VIDEO_FRAME_FORMAT vframeFormat)
 {
 	if (m_VideoTextures.Size()) {
@@ -253,6 +253,7 @@ public:
 	BOOL IsPqSupported() { return m_bConvSupportedG2084; }
 
 	ID3D11Texture2D* GetNextInputTexture(const D3D11_VIDEO_FRAME_FORMAT vframeFormat);
+	ID3D11Texture2D* GetInputTexture();
 	void SetInputVideoData(ID3D11Texture2D* pTexture, IMediaSample* pSample, UINT ArraySlice, const D3D11_VIDEO_FRAME_FORMAT vframeFormat);
 	void ResetFrameOrder();
 
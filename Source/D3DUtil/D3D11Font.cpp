@@ -23,6 +23,7 @@
 #include "DX11Helper.h"
 #include "resource.h"
 #include "FontBitmap.h"
+#include "StatsText.h"
 #include "D3D11Font.h"
 
 #define MAX_NUM_VERTICES 400*6
@@ -190,6 +191,8 @@ void CD3D11Font::InvalidateDeviceObjects()
 	SAFE_RELEASE(m_pPixelBuffer);
 	SAFE_RELEASE(m_pVertexBuffer);
 	//SAFE_RELEASE(m_pIndexBuffer);
+	SAFE_RELEASE(m_pLinesVertexBuffer);
+	m_bLinesLayoutValid = false;
 
 	SAFE_RELEASE(m_pDeviceContext);
 	SAFE_RELEASE(m_pDevice);
@@ -223,6 +226,7 @@ HRESULT CD3D11Font::CreateFontBitmap(const WCHAR* strFontName, const UINT fontHe
 
 	SAFE_RELEASE(m_pShaderResource);
 	SAFE_RELEASE(m_pTexture);
+	m_bLinesLayoutValid = false;
 
 	D3D11_TEXTURE2D_DESC texDesc;
 	texDesc.Width = m_uTexWidth;
@@ -304,14 +308,8 @@ HRESULT CD3D11Font::GetTextExtent(const WCHAR* strText, SIZE* pSize)
 	return S_OK;
 }
 
-HRESULT CD3D11Font::Draw2DText(ID3D11RenderTargetView* pRenderTargetView, const SIZE& rtSize, float sx, float sy, D3DCOLOR color, const WCHAR* strText)
+void CD3D11Font::SetDrawState(ID3D11RenderTargetView* pRenderTargetView, const SIZE& rtSize, D3DCOLOR color, ID3D11Buffer* pVertexBuffer)
 {
-	if (!m_pDevice || !m_pDeviceContext) {
-		return E_ABORT;
-	}
-	ASSERT(pRenderTargetView);
-
-	HRESULT hr = S_OK;
 	UINT Stride = sizeof(Font11Vertex);
 	UINT Offset = 0;
 
@@ -334,13 +332,25 @@ HRESULT CD3D11Font::Draw2DText(ID3D11RenderTargetView* pRenderTargetView, const
 	m_pDeviceContext->IASetInputLayout(m_pInputLayout);
 	m_pDeviceContext->VSSetShader(m_pVertexShader, nullptr, 0);
 	m_pDeviceContext->PSSetShader(m_pPixelShader, nullptr, 0);
-	m_pDeviceContext->IASetVertexBuffers(0, 1, &m_pVertexBuffer, &Stride, &Offset);
+	m_pDeviceContext->IASetVertexBuffers(0, 1, &pVertexBuffer, &Stride, &Offset);
 	m_pDeviceContext->PSSetConstantBuffers(0, 1, &m_pPixelBuffer);
 	m_pDeviceContext->PSSetSamplers(0, 1, &m_pSamplerState);
 	m_pDeviceContext->OMSetBlendState(m_pBlendState, nullptr, D3D11_DEFAULT_SAMPLE_MASK);
 	m_pDeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
 	m_pDeviceContext->OMSetRenderTargets(1, &pRenderTargetView, nullptr);
+}
+
+HRESULT CD3D11Font::Draw2DText(ID3D11RenderTargetView* pRenderTargetView, const SIZE& rtSize, float sx, float sy, D3DCOLOR color, const WCHAR* strText)
+{
+	if (!m_pDevice || !m_pDeviceContext) {
+		return E_ABORT;
+	}
+	ASSERT(pRenderTargetView);
+
+	HRESULT hr = S_OK;
+
+	SetDrawState(pRenderTargetView, rtSize, color, m_pVertexBuffer);
 
 	// Adjust for character spacing
 	const float fStartX = (float)(sx * 2) / rtSize.cx - 1;
@@ -403,3 +413,113 @@ HRESULT CD3D11Font::Draw2DText(ID3D11RenderTargetView* pRenderTargetView, const
 
 	return hr;
 }
+
+UINT CD3D11Font::LayoutLine(Font11Vertex* pVertices, const WCHAR* strText, UINT len, float drawX, float drawY, const SIZE& rtSize)
+{
+	UINT nVertices = 0;
+
+	for (UINT i = 0; i < len; i++) {
+		const WCHAR c = strText[i];
+		const auto tex = m_fTexCoords[Char2Index(c)];
+
+		const float Width = (tex.right - tex.left) * m_uTexWidth * 2 / rtSize.cx;
+		const float Height = (tex.bottom - tex.top) * m_uTexHeight * 2 / rtSize.cy;
+
+		if (c != 0x0020 && c != 0x00A0) { // Space and No-Break Space
+			const float left = drawX;
+			const float right = drawX + Width;
+			const float top = drawY;
+			const float bottom = drawY - Height;
+
+			*pVertices++ = { {left,  top,    0.0f}, {tex.left,  tex.top}    };
+			*pVertices++ = { {right, bottom, 0.0f}, {tex.right, tex.bottom} };
+			*pVertices++ = { {left,  bottom, 0.0f}, {tex.left,  tex.bottom} };
+			*pVertices++ = { {left,  top,    0.0f}, {tex.left,  tex.top}    };
+			*pVertices++ = { {right, top,    0.0f}, {tex.right, tex.top}    };
+			*pVertices++ = { {right, bottom, 0.0f}, {tex.right, tex.bottom} };
+			nVertices += 6;
+		}
+
+		drawX += Width;
+	}
+
+	return nVertices;
+}
+
+HRESULT CD3D11Font::Draw2DLines(ID3D11RenderTargetView* pRenderTargetView, const SIZE& rtSize, int sx, int sy, D3DCOLOR color, const CStatsText& text)
+{
+	if (!m_pDevice || !m_pDeviceContext) {
+		return E_ABORT;
+	}
+	ASSERT(pRenderTargetView);
+
+	constexpr UINT lineVertices = CStatsText::kLineSize * 6;
+	constexpr UINT maxVertices = CStatsText::kMaxLines * lineVertices;
+
+	if (!m_pLinesVertexBuffer) {
+		D3D11_BUFFER_DESC vertexBufferDesc = {};
+		vertexBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+		vertexBufferDesc.ByteWidth = sizeof(Font11Vertex) * maxVertices;
+		vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		vertexBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+		HRESULT hr = m_pDevice->CreateBuffer(&vertexBufferDesc, nullptr, &m_pLinesVertexBuffer);
+		if (FAILED(hr)) {
+			return hr;
+		}
+		m_LinesVertices.resize(maxVertices);
+		m_LineVersions.resize(CStatsText::kMaxLines);
+		m_LineVertexCounts.resize(CStatsText::kMaxLines);
+		m_bLinesLayoutValid = false;
+	}
+
+	if (!m_bLinesLayoutValid || rtSize.cx != m_linesRtSize.cx || rtSize.cy != m_linesRtSize.cy || sx != m_linesPos.x || sy != m_linesPos.y) {
+		std::fill(m_LineVersions.begin(), m_LineVersions.end(), 0);
+		m_linesRtSize = rtSize;
+		m_linesPos = { sx, sy };
+		m_bLinesLayoutValid = true;
+		m_nLines = 0;
+	}
+
+	bool bChanged = (text.GetLineCount() != m_nLines);
+	m_nLines = text.GetLineCount();
+
+	const float fStartX = (float)(sx * 2) / rtSize.cx - 1;
+	const float fStartY = (float)(-sy * 2) / rtSize.cy + 1;
+	const float fLineHeight = (m_fTexCoords[0].bottom - m_fTexCoords[0].top) * m_uTexHeight * 2 / rtSize.cy;
+
+	for (UINT i = 0; i < m_nLines; i++) {
+		if (text.GetLineVersion(i) != m_LineVersions[i]) {
+			UINT len;
+			const WCHAR* str = text.GetLine(i, len);
+			m_LineVertexCounts[i] = LayoutLine(&m_LinesVertices[i * lineVertices], str, len, fStartX, fStartY - i * fLineHeight, rtSize);
+			m_LineVersions[i] = text.GetLineVersion(i);
+			bChanged = true;
+		}
+	}
+
+	HRESULT hr = S_OK;
+
+	if (bChanged) {
+		D3D11_MAPPED_SUBRESOURCE mappedResource;
+		hr = m_pDeviceContext->Map(m_pLinesVertexBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
+		if (FAILED(hr)) {
+			m_bLinesLayoutValid = false;
+			return hr;
+		}
+		Font11Vertex* pVertices = static_cast<Font11Vertex*>(mappedResource.pData);
+		m_nLinesVertices = 0;
+		for (UINT i = 0; i < m_nLines; i++) {
+			memcpy(pVertices + m_nLinesVertices, &m_LinesVertices[i * lineVertices], m_LineVertexCounts[i] * sizeof(Font11Vertex));
+			m_nLinesVertices += m_LineVertexCounts[i];
+		}
+		m_pDeviceContext->Unmap(m_pLinesVertexBuffer, 0);
+	}
+
+	SetDrawState(pRenderTargetView, rtSize, color, m_pLinesVertexBuffer);
+	if (m_nLinesVertices) {
+		m_pDeviceContext->Draw(m_nLinesVertices, 0);
+	}
+
+	return hr;
+}
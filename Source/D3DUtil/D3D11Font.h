@@ -23,6 +23,9 @@
 #include <d3d11.h>
 #include "D3DCommon.h"
 
+struct Font11Vertex;
+class CStatsText;
+
 class CD3D11Font
 {
 	// Font properties
@@ -53,6 +56,20 @@ class CD3D11Font
 	UINT  m_uTexWidth = 0;                   // Texture dimensions
 	UINT  m_uTexHeight = 0;
 
+	// Draw2DLines() keeps the vertices of each line and lays out only the changed lines
+	ID3D11Buffer* m_pLinesVertexBuffer = nullptr;
+	std::vector<Font11Vertex> m_LinesVertices; // CStatsText::kLineSize * 6 vertices for each line
+	std::vector<uint32_t> m_LineVersions;
+	std::vector<UINT> m_LineVertexCounts;
+	UINT  m_nLines = 0;
+	UINT  m_nLinesVertices = 0;
+	bool  m_bLinesLayoutValid = false;
+	SIZE  m_linesRtSize = {};
+	POINT m_linesPos = {};
+
+	void SetDrawState(ID3D11RenderTargetView* pRenderTargetView, const SIZE& rtSize, D3DCOLOR color, ID3D11Buffer* pVertexBuffer);
+	UINT LayoutLine(Font11Vertex* pVertices, const WCHAR* strText, UINT len, float drawX, float drawY, const SIZE& rtSize);
+
 public:
 	// Constructor / destructor
 	CD3D11Font();
@@ -71,4 +88,7 @@ public:
 
 	// 2D text drawing function
 	HRESULT Draw2DText(ID3D11RenderTargetView* pRenderTargetView, const SIZE& rtSize, float sx, float sy, D3DCOLOR color, const WCHAR* strText);
+
+	// Draws the lines of CStatsText, the vertex buffer is updated only when a line has changed
+	HRESULT Draw2DLines(ID3D11RenderTargetView* pRenderTargetView, const SIZE& rtSize, int sx, int sy, D3DCOLOR color, const CStatsText& text);
 };
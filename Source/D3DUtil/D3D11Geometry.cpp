@@ -267,7 +267,7 @@ bool CD3D11Dots::AddPoints(POINT* poins, const UINT size, const D3DCOLOR color)
 bool CD3D11Dots::AddGFPoints(
 	int Xstart, int Xstep,
 	int Yaxis, int Yscale,
-	int* Ydata, UINT Yoffset,
+	const int* Ydata, UINT Yoffset,
 	const UINT size, const D3DCOLOR color)
 {
 	if (!CheckNumPoints(size)) {
@@ -115,7 +115,7 @@ public:
 	bool AddGFPoints(
 		int Xstart, int Xstep,
 		int Yaxis, int Yscale,
-		int* Ydata, UINT Yoffset,
+		const int* Ydata, UINT Yoffset,
 		const UINT size, const D3DCOLOR color);
 
 	HRESULT UpdateVertexBuffer();
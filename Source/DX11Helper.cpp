@@ -78,6 +78,126 @@ D3D11_TEXTURE2D_DESC CreateTex2DDesc(const DXGI_FORMAT format, const UINT width,
 	return desc;
 }
 
+UINT GetTexFmtBytesPerPixel(const DXGI_FORMAT format)
+{
+	switch (format) {
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+	case DXGI_FORMAT_R16G16B16A16_UNORM:
+		return 8;
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+		return 16;
+	default:
+		return 4;
+	}
+}
+
+//
+// CTex2DPool
+//
+
+bool CTex2DPool::IsSuitable(const Item_t& item, const DXGI_FORMAT format, const UINT width, const UINT height, const Tex2DType type, const bool bExactWidth, const bool bExactHeight)
+{
+	const auto& desc = item.tex.desc;
+	if (desc.Format != format || item.type != type || desc.Width < width || desc.Height < height) {
+		return false;
+	}
+	if (bExactWidth && desc.Width != width || bExactHeight && desc.Height != height) {
+		return false;
+	}
+	// do not waste too much memory on a texture that is much larger than needed
+	return (UINT64)desc.Width * desc.Height <= 2ull * BucketSize(width) * BucketSize(height);
+}
+
+HRESULT CTex2DPool::Acquire(Tex2D_t& tex, ID3D11Device* pDevice, const DXGI_FORMAT format, const UINT width, const UINT height, const Tex2DType type,
+	const bool bExactWidth, const bool bExactHeight)
+{
+	if (!width || !height) {
+		return E_FAIL;
+	}
+
+	if (tex.pTexture) {
+		auto it = std::find_if(m_Items.begin(), m_Items.end(), [&](const Item_t& item) { return item.tex.pTexture == tex.pTexture; });
+		if (it != m_Items.end() && IsSuitable(*it, format, width, height, type, bExactWidth, bExactHeight)) {
+			it->lastUsed = m_TrimCounter;
+			return S_OK;
+		}
+		Release(tex);
+	}
+
+	Item_t* pItem = nullptr;
+	for (auto& item : m_Items) {
+		if (!item.bInUse && IsSuitable(item, format, width, height, type, bExactWidth, bExactHeight)
+				&& (!pItem || item.tex.desc.Width * item.tex.desc.Height < pItem->tex.desc.Width * pItem->tex.desc.Height)) {
+			pItem = &item;
+		}
+	}
+
+	if (pItem) {
+		m_Stats.reused++;
+	} else {
+		Item_t item;
+		item.type = type;
+		HRESULT hr = item.tex.Create(pDevice, format, bExactWidth ? width : BucketSize(width), bExactHeight ? height : BucketSize(height), type);
+		if (FAILED(hr)) {
+			// the rounded size can exceed the maximum texture size
+			hr = item.tex.Create(pDevice, format, width, height, type);
+			if (FAILED(hr)) {
+				DLog(L"CTex2DPool::Acquire() : failed to create {}x{} texture with error {}", width, height, HR2Str(hr));
+				return hr;
+			}
+		}
+		m_Stats.created++;
+		m_Stats.count++;
+		m_Stats.bytes += (UINT64)item.tex.desc.Width * item.tex.desc.Height * GetTexFmtBytesPerPixel(format);
+
+		pItem = &m_Items.emplace_back(std::move(item));
+	}
+
+	pItem->bInUse = true;
+	pItem->lastUsed = m_TrimCounter;
+	tex = pItem->tex;
+
+	return S_OK;
+}
+
+void CTex2DPool::Release(Tex2D_t& tex)
+{
+	if (!tex.pTexture) {
+		return;
+	}
+
+	for (auto& item : m_Items) {
+		if (item.tex.pTexture == tex.pTexture) {
+			item.bInUse = false;
+			item.lastUsed = m_TrimCounter;
+			break;
+		}
+	}
+	tex.Release();
+}
+
+void CTex2DPool::Trim()
+{
+	m_TrimCounter++;
+
+	std::erase_if(m_Items, [&](const Item_t& item) {
+		if (item.bInUse || m_TrimCounter - item.lastUsed <= kTrimDelay) {
+			return false;
+		}
+		m_Stats.released++;
+		m_Stats.count--;
+		m_Stats.bytes -= (UINT64)item.tex.desc.Width * item.tex.desc.Height * GetTexFmtBytesPerPixel(item.tex.desc.Format);
+		return true;
+	});
+}
+
+void CTex2DPool::Clear()
+{
+	m_Items.clear();
+	m_Stats.count = 0;
+	m_Stats.bytes = 0;
+}
+
 UINT GetAdapter(HWND hWnd, IDXGIFactory1* pDXGIFactory, IDXGIAdapter** ppDXGIAdapter)
 {
 	*ppDXGIAdapter = nullptr;
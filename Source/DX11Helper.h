@@ -21,6 +21,7 @@
 #pragma once
 
 #include <d3d11_1.h>
+#include "ShaderFusion.h"
 
 enum Tex2DType {
 	Tex2D_Default,
@@ -34,6 +35,8 @@ enum Tex2DType {
 
 D3D11_TEXTURE2D_DESC CreateTex2DDesc(const DXGI_FORMAT format, const UINT width, const UINT height, const Tex2DType type);
 
+UINT GetTexFmtBytesPerPixel(const DXGI_FORMAT format);
+
 struct Tex2D_t
 {
 	CComPtr<ID3D11Texture2D> pTexture;
@@ -175,74 +178,58 @@ struct Tex11Video_t : Tex2D_t
 	}
 };
 
-class CTex2DRing
+// Pool of textures for intermediate results.
+// Textures are created with the size rounded up to a multiple of 128, a free texture that is a bit larger
+// than requested is reused and only its top-left part is rendered to. Unused textures are released lazily by Trim().
+class CTex2DPool
 {
-	Tex2D_t Texs[2];
-	int index = 0;
-	UINT size = 0;
-
 public:
-	HRESULT CheckCreate(ID3D11Device* pDevice, const DXGI_FORMAT format, const UINT width, const UINT height, const UINT num) {
-		HRESULT hr = S_FALSE;
-		if (num == 0) {
-			Release();
-			return hr;
-		}
-
-		index = 0;
-		size = 0;
-		hr = Texs[0].CheckCreate(pDevice, format, width, height, Tex2D_DefaultShaderRTarget);
-		size++;
-		if (S_OK == hr && num >= 2) {
-			hr = Texs[1].CheckCreate(pDevice, format, width, height, Tex2D_DefaultShaderRTarget);
-			size++;
-		}
-		else {
-			Texs[1].Release();
-		}
-		return hr;
-	}
-
-	HRESULT Create(ID3D11Device* pDevice, const DXGI_FORMAT format, const UINT width, const UINT height, const UINT num) {
-		Release();
-		HRESULT hr = S_FALSE;
-		if (num >= 1) {
-			hr = Texs[0].Create(pDevice, format, width, height, Tex2D_DefaultShaderRTarget);
-			size++;
-			if (S_OK == hr && num >= 2) {
-				hr = Texs[1].Create(pDevice, format, width, height, Tex2D_DefaultShaderRTarget);
-				size++;
-			}
-		}
-		return hr;
-	}
+	struct Stats_t {
+		UINT64 created  = 0; // textures created by the pool
+		UINT64 reused   = 0; // requests served by an existing free texture
+		UINT64 released = 0; // textures released by Trim()
+		UINT   count    = 0; // textures in the pool
+		UINT64 bytes    = 0; // memory of the textures in the pool
+	};
 
-	UINT Size() {
-		return size;
-	}
+private:
+	struct Item_t {
+		Tex2D_t tex;
+		Tex2DType type = Tex2D_Default;
+		bool bInUse = false;
+		UINT lastUsed = 0;
+	};
+	std::vector<Item_t> m_Items;
+	UINT m_TrimCounter = 0;
+	Stats_t m_Stats;
 
-	void Release() {
-		Texs[0].Release();
-		Texs[1].Release();
-		index = 0;
-		size = 0;
-	}
+	static constexpr UINT kSizeBucket = 128;
+	static constexpr UINT kTrimDelay  = 120; // number of Trim() calls
 
-	Tex2D_t* GetFirstTex() {
-		index = 0;
-		return &Texs[0];
-	}
+	static UINT BucketSize(const UINT size) { return (size + kSizeBucket - 1) & ~(kSizeBucket - 1); }
+	static bool IsSuitable(const Item_t& item, const DXGI_FORMAT format, const UINT width, const UINT height, const Tex2DType type, const bool bExactWidth, const bool bExactHeight);
 
-	Tex2D_t* GetNextTex() {
-		index = (index + 1) & 1;
-		return &Texs[index];
-	}
+public:
+	// Puts a texture with a size of at least width x height into tex.
+	// A suitable texture in tex is kept, otherwise it is returned to the pool.
+	// Use the exact size if shaders read pixels outside the rendered rectangle, the sampler clamps only at the texture edges.
+	HRESULT Acquire(Tex2D_t& tex, ID3D11Device* pDevice, const DXGI_FORMAT format, const UINT width, const UINT height, const Tex2DType type,
+		const bool bExactWidth = false, const bool bExactHeight = false);
+	// Returns the texture to the pool
+	void Release(Tex2D_t& tex);
+	// Releases the textures that have not been used for a while, call it once per frame
+	void Trim();
+	void Clear();
+
+	const Stats_t& GetStats() const { return m_Stats; }
 };
 
 struct ExternalPixelShader11_t
 {
 	std::wstring name;
 	CComPtr<ID3D11PixelShader> shader;
+	bool bPointwise = false; // can be fused with the neighboring pointwise shaders
+	PointwiseShader_t pointwise;
 };
 
 inline constexpr DirectX::XMFLOAT4 D3DCOLORtoXMFLOAT4(const D3DCOLOR color)
@@ -23,14 +23,17 @@
 #include <Mferror.h>
 #include <Mfidl.h>
 #include <optional>
+#include <DirectXPackedVector.h>
 #include "Helper.h"
 #include "Times.h"
 #include "resource.h"
 #include "VideoRenderer.h"
 #include "../Include/Version.h"
 #include "DX11VideoProcessor.h"
+#include "SubPic/SubPicQueueStats.h"
 #include "../Include/ID3DVideoMemoryConfiguration.h"
 #include "Shaders.h"
+#include "GamutLut.h"
 #include "Utils/CPUInfo.h"
 
 #include <dxgi1_6.h>
@@ -109,6 +112,20 @@ static const ScalingShaderResId s_Downscaling11ResIDs[DOWNSCALE_COUNT] = {
 	{IDF_PS_11_CONVOL_LANCZOS_X,   IDF_PS_11_CONVOL_LANCZOS_Y,   L"Lanczos"      }
 };
 
+// operations of the passes in m_RenderGraph
+enum RenderPassOp {
+	RenderPass_D3D11VP = 0,
+	RenderPass_ConvertColor,
+	RenderPass_ResizeWidth,
+	RenderPass_ResizeHeight,
+	RenderPass_Resize,
+	RenderPass_Correction,
+	RenderPass_HDR10ToneMapping,
+	RenderPass_HalfOUtoInterlace,
+	RenderPass_FinalPass,
+	RenderPass_PostScale, // + index in m_PostScalePasses
+};
+
 const UINT dither_size = 32;
 
 struct VERTEX {
@@ -303,6 +320,7 @@ HRESULT CDX11VideoProcessor::TextureCopyRect(
 	ID3D11PixelShader* pPixelShader, ID3D11Buffer* pConstantBuffer,
 	const int iRotation, const bool bFlip)
 {
+	FRAMETRACE_SCOPE("TextureCopyRect");
 	CComPtr<ID3D11RenderTargetView> pRenderTargetView;
 
 	HRESULT hr = m_pDevice->CreateRenderTargetView(pRenderTarget, nullptr, &pRenderTargetView);
@@ -463,6 +481,8 @@ CDX11VideoProcessor::~CDX11VideoProcessor()
 	}
 
 	m_pFilter->m_pSubPicQueue.Release();
+	m_pBlendedSubPic.Release();
+	m_pFrameSubPic.Release();
 	m_pSubPicAllocator.Release();
 
 	ReleaseSwapChain();
@@ -655,6 +675,7 @@ void CDX11VideoProcessor::ReleaseVP()
 
 	m_pFilter->ResetStreamingTimes2();
 	m_RenderStats.Reset();
+	ResetPresentStats();
 
 	if (m_pDeviceContext) {
 		m_pDeviceContext->ClearState();
@@ -662,8 +683,9 @@ void CDX11VideoProcessor::ReleaseVP()
 
 	m_TexSrcVideo.Release();
 	m_TexConvertOutput.Release();
-	m_TexResize.Release();
-	m_TexsPostScale.Release();
+	m_RenderGraph.Reset();
+	m_RenderGraphTexs.clear();
+	m_TexPool.Clear();
 
 	m_PSConvColorData.Release();
 	m_pDoviCurvesConstantBuffer.Release();
@@ -700,9 +722,13 @@ void CDX11VideoProcessor::ReleaseDevice()
 
 	ClearPreScaleShaders();
 	ClearPostScaleShaders();
+	m_FusedShaders.clear();
 	m_pPSCorrection.Release();
 	m_pPSConvertColor.Release();
 	m_pPSConvertColorDeint.Release();
+	m_pGamutLutSRV.Release();
+	m_pGamutLutTexture.Release();
+	m_GamutLutPrim = MP_CSP_PRIM_AUTO;
 
 	m_pPSHDR10ToneMapping.Release();
 
@@ -778,7 +804,7 @@ void CDX11VideoProcessor::ReleaseSwapChain()
 
 UINT CDX11VideoProcessor::GetPostScaleSteps()
 {
-	UINT nSteps = m_pPostScaleShaders.size();
+	UINT nSteps = m_PostScalePasses.size();
 	if (m_pPSCorrection) {
 		nSteps++;
 	}
@@ -812,6 +838,7 @@ HRESULT CDX11VideoProcessor::CreatePShaderFromResource(ID3D11PixelShader** ppPix
 
 void CDX11VideoProcessor::SetShaderConvertColorParams()
 {
+	const bool bWasEnabled = m_PSConvColorData.bEnable;
 	mp_cmat cmatrix;
 
 	if (m_Dovi.bValid) {
@@ -884,6 +911,10 @@ void CDX11VideoProcessor::SetShaderConvertColorParams()
 		D3D11_SUBRESOURCE_DATA InitData = { &cbuffer, 0, 0 };
 		EXECUTE_ASSERT(S_OK == m_pDevice->CreateBuffer(&BufferDesc, &InitData, &m_PSConvColorData.pConstants));
 	}
+
+	if (m_PSConvColorData.bEnable != bWasEnabled) {
+		UpdateRenderGraph();
+	}
 }
 
 void CDX11VideoProcessor::SetShaderLuminanceParams()
@@ -1142,6 +1173,8 @@ HRESULT CDX11VideoProcessor::SetShaderDoviCurves()
 
 void CDX11VideoProcessor::UpdateTexParams(int cdepth)
 {
+	const DXGI_FORMAT prevTexFmt = m_InternalTexFmt;
+
 	switch (m_iTexFormat) {
 	case TEXFMT_AUTOINT:
 		m_InternalTexFmt = (cdepth > 8 || m_bVPUseRTXVideoHDR) ? DXGI_FORMAT_R10G10B10A2_UNORM : DXGI_FORMAT_B8G8R8A8_UNORM;
@@ -1152,6 +1185,10 @@ void CDX11VideoProcessor::UpdateTexParams(int cdepth)
 	default:
 		ASSERT(FALSE);
 	}
+
+	if (m_InternalTexFmt != prevTexFmt && m_pPostScaleShaders.size()) {
+		UpdatePostScalePasses(); // the fused passes depend on the clamping of the format
+	}
 }
 
 void CDX11VideoProcessor::UpdateRenderRect()
@@ -1188,10 +1225,10 @@ void CDX11VideoProcessor::CalcStatsParams()
 	if (m_pDeviceContext && !m_windowRect.IsRectEmpty()) {
 		SIZE rtSize = m_windowRect.Size();
 
-		if (S_OK == m_Font3D.CreateFontBitmap(L"Consolas", m_StatsFontH, 0)) {
+		if (SUCCEEDED(m_Font3D.CreateFontBitmap(L"Consolas", m_StatsFontH, 0))) {
 			SIZE charSize = m_Font3D.GetMaxCharMetric();
 			m_StatsRect.right  = m_StatsRect.left + 61 * charSize.cx + 5 + 3;
-			m_StatsRect.bottom = m_StatsRect.top + 19 * charSize.cy + 5 + 3;
+			m_StatsRect.bottom = m_StatsRect.top + m_StatsLines * charSize.cy + 5 + 3;
 		}
 		m_StatsBackground.Set(m_StatsRect, rtSize, D3DCOLOR_ARGB(80, 0, 0, 0));
 
@@ -1210,15 +1247,183 @@ void CDX11VideoProcessor::CalcStatsParams()
 	}
 }
 
+// Only an unscaled progressive SDR frame gets the subtitles, the subpic must not be stretched and must be inside of the video.
+// When the filter is paused, the subtitles are drawn as usual, so a changed subpic does not leave the old one in the frame.
+// The subpic is looked up once for the frame, Render() uses the same subpic.
+void CDX11VideoProcessor::PrepareSubtitleBlend()
+{
+	m_pBlendedSubPic.Release();
+	m_pFrameSubPic.Release();
+	m_bFrameSubPic = false;
+
+	const ColorFormat_t cformat = m_srcParams.cformat;
+	const bool bSemiPlanar = cformat == CF_NV12 || cformat == CF_P010 || cformat == CF_P016;
+	bool bLayout;
+	if (m_TexSrcVideo.pTexture3) {
+		bLayout = cformat == CF_YV12 || cformat == CF_YUV420P8;
+	} else if (m_TexSrcVideo.pTexture2) {
+		bLayout = bSemiPlanar;
+	} else {
+		bLayout = bSemiPlanar || cformat == CF_XRGB32 || cformat == CF_ARGB32;
+	}
+
+	if (!m_bSubsBlendInCopy) {
+		m_SubBlender.Reset();
+		return;
+	}
+	if (!bLayout || !m_pSubPicAllocator || m_pFilter->m_filterState != State_Running
+			|| m_SampleFormat != D3D11_VIDEO_FRAME_FORMAT_PROGRESSIVE
+			|| m_iRotation || m_bFlip || m_iStereo3dTransform || m_pPSHalfOUtoInterlace || m_Dovi.bValid
+			|| m_srcExFmt.VideoTransferFunction == MFVideoTransFunc_2084 || m_srcExFmt.VideoTransferFunction == MFVideoTransFunc_HLG
+			|| (m_srcParams.CSType == CS_YUV && m_srcExFmt.VideoTransferMatrix > DXVA2_VideoTransferMatrix_SMPTE240M)
+			|| m_srcRect.Width() != m_videoRect.Width() || m_srcRect.Height() != m_videoRect.Height()) {
+		return;
+	}
+
+	m_pFrameSubPic = m_pFilter->GetSubPic(m_rtStart);
+	m_bFrameSubPic = true;
+	ISubPic* pSubPic = m_pFrameSubPic;
+	if (!pSubPic) {
+		return;
+	}
+
+	CRect rcSource, rcDest, rcDirty;
+	if (FAILED(pSubPic->GetSourceAndDest(m_windowRect, m_videoRect, &rcSource, &rcDest, FALSE, {}, 0, FALSE))
+			|| rcSource.Size() != rcDest.Size() || FAILED(pSubPic->GetDirtyRect(&rcDirty))) {
+		return;
+	}
+
+	const auto pMemPic = reinterpret_cast<const MemPic_t*>(pSubPic->GetObject());
+	m_blendedVersion = pMemPic->version;
+	m_blendedSource = rcSource;
+	m_blendedDest = rcDest;
+	m_blendedSrcRect = m_srcRect;
+	m_blendedVideoRect = m_videoRect;
+
+	CRect rcPic;
+	if (!rcPic.IntersectRect(rcSource, rcDirty)) {
+		// nothing to draw
+		m_SubBlender.Reset();
+		m_pBlendedSubPic = pSubPic;
+		return;
+	}
+
+	CRect rcFrame(rcPic);
+	rcFrame.OffsetRect(rcDest.left - rcSource.left - m_videoRect.left + m_srcRect.left, rcDest.top - rcSource.top - m_videoRect.top + m_srcRect.top);
+	CRect rcVisible;
+	rcVisible.IntersectRect(rcFrame, m_srcRect);
+	if (rcVisible != rcFrame) {
+		// a part of the subtitles is outside of the video
+		return;
+	}
+
+	const bool bInvAlpha = m_pSubPicAllocator->GetInverseAlpha();
+	if (!m_SubBlender.IsPrepared(pMemPic, pMemPic->version, cformat, m_srcExFmt, bInvAlpha, rcFrame)) {
+		m_subsBlendPixels.resize((size_t)rcPic.Width() * rcPic.Height());
+		pMemPic->CopyRect(rcPic, (BYTE*)m_subsBlendPixels.data(), rcPic.Width() * 4, bInvAlpha ? 0x00000000 : 0xFF000000);
+		m_SubBlender.Prepare(pMemPic, pMemPic->version, cformat, m_srcExFmt, bInvAlpha, m_subsBlendPixels.data(), rcPic.Width(), rcFrame);
+	}
+
+	m_pBlendedSubPic = pSubPic;
+	m_subsBlendedFrames++;
+}
+
+CComPtr<ISubPic> CDX11VideoProcessor::TakeFrameSubPic()
+{
+	if (m_bFrameSubPic) {
+		m_bFrameSubPic = false;
+		CComPtr<ISubPic> pSubPic;
+		pSubPic.Attach(m_pFrameSubPic.Detach());
+		return pSubPic;
+	}
+
+	return m_pFilter->GetSubPic(m_rtStart);
+}
+
+// The subtitles in the frame are right while the subpic, its data and its place are the same.
+bool CDX11VideoProcessor::IsBlendedSubPic(ISubPic* pSubPic)
+{
+	if (!pSubPic || pSubPic != m_pBlendedSubPic.p
+			|| reinterpret_cast<const MemPic_t*>(pSubPic->GetObject())->version != m_blendedVersion
+			|| m_srcRect != m_blendedSrcRect || m_videoRect != m_blendedVideoRect
+			|| m_iRotation || m_bFlip || m_iStereo3dTransform || m_pPSHalfOUtoInterlace) {
+		return false;
+	}
+
+	CRect rcSource, rcDest;
+	return SUCCEEDED(pSubPic->GetSourceAndDest(m_windowRect, m_videoRect, &rcSource, &rcDest, FALSE, {}, 0, FALSE))
+		&& rcSource == m_blendedSource && rcDest == m_blendedDest;
+}
+
+// Writes the frame again without the blended subtitles. The dynamic texture cannot be read,
+// so it is copied to a staging texture first. Only a redraw with other subtitles gets here.
+HRESULT CDX11VideoProcessor::RestoreTexSrcVideo()
+{
+	if (m_SubBlender.IsEmpty()) {
+		return S_FALSE;
+	}
+
+	ID3D11Texture2D* pTextures[] = { m_TexSrcVideo.pTexture, m_TexSrcVideo.pTexture2, m_TexSrcVideo.pTexture3 };
+	HRESULT hr = S_OK;
+
+	for (UINT plane = 0; plane < std::size(pTextures) && pTextures[plane] && SUCCEEDED(hr); plane++) {
+		D3D11_TEXTURE2D_DESC desc;
+		pTextures[plane]->GetDesc(&desc);
+		desc.Usage = D3D11_USAGE_STAGING;
+		desc.BindFlags = 0;
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+		CComPtr<ID3D11Texture2D> pTexStaging;
+		hr = m_pDevice->CreateTexture2D(&desc, nullptr, &pTexStaging);
+		if (FAILED(hr)) {
+			break;
+		}
+		m_pDeviceContext->CopyResource(pTexStaging, pTextures[plane]);
+
+		D3D11_MAPPED_SUBRESOURCE mappedStaging = {};
+		hr = m_pDeviceContext->Map(pTexStaging, 0, D3D11_MAP_READ, 0, &mappedStaging);
+		if (SUCCEEDED(hr)) {
+			D3D11_MAPPED_SUBRESOURCE mappedResource = {};
+			hr = m_pDeviceContext->Map(pTextures[plane], 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
+			if (SUCCEEDED(hr)) {
+				BYTE* dst = (BYTE*)mappedResource.pData;
+				if (m_TexSrcVideo.pTexture2) {
+					CopyPlaneAsIs(desc.Height, dst, mappedResource.RowPitch, (const BYTE*)mappedStaging.pData, mappedStaging.RowPitch);
+					m_SubBlender.RestorePlane(plane, dst, mappedResource.RowPitch);
+				} else {
+					// the chroma of NV12 and P01x follows the luma in the same texture
+					CopyPlaneAsIs(m_srcLines, dst, mappedResource.RowPitch, (const BYTE*)mappedStaging.pData, mappedStaging.RowPitch);
+					m_SubBlender.RestorePlane(0, dst, mappedResource.RowPitch);
+					m_SubBlender.RestorePlane(1, dst + mappedResource.RowPitch * m_srcHeight, mappedResource.RowPitch);
+				}
+				m_pDeviceContext->Unmap(pTextures[plane], 0);
+			}
+			m_pDeviceContext->Unmap(pTexStaging, 0);
+		}
+	}
+
+	if (SUCCEEDED(hr) && m_D3D11VP.IsReady()) {
+		if (ID3D11Texture2D* pInputTexture = m_D3D11VP.GetInputTexture()) {
+			m_pDeviceContext->CopyResource(pInputTexture, m_TexSrcVideo.pTexture);
+		}
+	}
+
+	return hr;
+}
+
 HRESULT CDX11VideoProcessor::MemCopyToTexSrcVideo(const BYTE* srcData, const int srcPitch)
 {
 	HRESULT hr = S_FALSE;
 	D3D11_MAPPED_SUBRESOURCE mappedResource = {};
+	const bool bBlendSubs = m_pBlendedSubPic;
 
 	if (m_TexSrcVideo.pTexture2) {
 		hr = m_pDeviceContext->Map(m_TexSrcVideo.pTexture, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
 		if (SUCCEEDED(hr)) {
 			m_pCopyPlaneFn(m_srcHeight, (BYTE*)mappedResource.pData, mappedResource.RowPitch, srcData, srcPitch);
+			if (bBlendSubs) {
+				m_SubBlender.BlendPlane(0, (BYTE*)mappedResource.pData, mappedResource.RowPitch, srcData, srcPitch);
+			}
 			m_pDeviceContext->Unmap(m_TexSrcVideo.pTexture, 0);
 
 			hr = m_pDeviceContext->Map(m_TexSrcVideo.pTexture2, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
@@ -1227,6 +1432,9 @@ HRESULT CDX11VideoProcessor::MemCopyToTexSrcVideo(const BYTE* srcData, const int
 				const int cromaPitch = (m_TexSrcVideo.pTexture3) ? srcPitch / m_srcParams.pDX11Planes->div_chroma_w : srcPitch;
 				srcData += srcPitch * m_srcHeight;
 				m_pCopyPlaneFn(cromaH, (BYTE*)mappedResource.pData, mappedResource.RowPitch, srcData, cromaPitch);
+				if (bBlendSubs) {
+					m_SubBlender.BlendPlane(1, (BYTE*)mappedResource.pData, mappedResource.RowPitch, srcData, cromaPitch);
+				}
 				m_pDeviceContext->Unmap(m_TexSrcVideo.pTexture2, 0);
 
 				if (m_TexSrcVideo.pTexture3) {
@@ -1234,6 +1442,9 @@ HRESULT CDX11VideoProcessor::MemCopyToTexSrcVideo(const BYTE* srcData, const int
 					if (SUCCEEDED(hr)) {
 						srcData += cromaPitch * cromaH;
 						m_pCopyPlaneFn(cromaH, (BYTE*)mappedResource.pData, mappedResource.RowPitch, srcData, cromaPitch);
+						if (bBlendSubs) {
+							m_SubBlender.BlendPlane(2, (BYTE*)mappedResource.pData, mappedResource.RowPitch, srcData, cromaPitch);
+						}
 						m_pDeviceContext->Unmap(m_TexSrcVideo.pTexture3, 0);
 					}
 				}
@@ -1244,6 +1455,12 @@ HRESULT CDX11VideoProcessor::MemCopyToTexSrcVideo(const BYTE* srcData, const int
 		if (SUCCEEDED(hr)) {
 			const BYTE* src = (srcPitch < 0) ? srcData + srcPitch * (1 - (int)m_srcLines) : srcData;
 			m_pCopyPlaneFn(m_srcLines, (BYTE*)mappedResource.pData, mappedResource.RowPitch, src, srcPitch);
+			if (bBlendSubs) {
+				// the chroma of NV12 and P01x follows the luma in the same texture
+				BYTE* dst = (BYTE*)mappedResource.pData;
+				m_SubBlender.BlendPlane(0, dst, mappedResource.RowPitch, src, srcPitch);
+				m_SubBlender.BlendPlane(1, dst + mappedResource.RowPitch * m_srcHeight, mappedResource.RowPitch, src + srcPitch * (int)m_srcHeight, srcPitch);
+			}
 			m_pDeviceContext->Unmap(m_TexSrcVideo.pTexture, 0);
 		}
 	}
@@ -2160,18 +2377,21 @@ HRESULT CDX11VideoProcessor::ProcessSample(IMediaSample* pSample)
 
 	// always Render(1) a frame after CopySample()
 	hr = Render(1, rtStart);
-	m_pFilter->m_DrawStats.Add(GetPreciseTick());
+	const uint64_t tick = GetPreciseTick();
 	if (m_pFilter->m_filterState == State_Running) {
 		m_pFilter->StreamTime(rtClock);
 	}
 
-	m_RenderStats.syncoffset = rtClock - rtStart;
-
-	int so = (int)std::clamp(m_RenderStats.syncoffset, -UNITS, UNITS);
-#if SYNC_OFFSET_EX
-	m_SyncDevs.Add(so - m_Syncs.Last());
-#endif
-	m_Syncs.Add(so);
+	// S_FALSE - the cadence planner skipped the frame, it was not presented
+	if (hr != S_FALSE) {
+		m_pFilter->m_DrawStats.Add(tick);
+		if (m_pFilter->m_ReceiveTick) {
+			m_LatencyHists[LATENCY_ReceiveToPresent].Add(tick - m_pFilter->m_ReceiveTick);
+		}
+		m_RenderStats.syncoffset = rtClock - rtStart;
+		AddSyncOffset(m_RenderStats.syncoffset, tick);
+	}
+	m_pFilter->m_ReceiveTick = 0;
 
 	if (m_bDoubleFrames) {
 		if (rtEnd < rtClock) {
@@ -2182,18 +2402,16 @@ HRESULT CDX11VideoProcessor::ProcessSample(IMediaSample* pSample)
 		rtStart += rtFrameDur / 2;
 
 		hr = Render(2, rtStart);
-		m_pFilter->m_DrawStats.Add(GetPreciseTick());
-		if (m_pFilter->m_filterState == State_Running) {
-			m_pFilter->StreamTime(rtClock);
-		}
-
-		m_RenderStats.syncoffset = rtClock - rtStart;
+		if (hr != S_FALSE) {
+			const uint64_t tick2 = GetPreciseTick();
+			m_pFilter->m_DrawStats.Add(tick2);
+			if (m_pFilter->m_filterState == State_Running) {
+				m_pFilter->StreamTime(rtClock);
+			}
 
-		so = (int)std::clamp(m_RenderStats.syncoffset, -UNITS, UNITS);
-#if SYNC_OFFSET_EX
-		m_SyncDevs.Add(so - m_Syncs.Last());
-#endif
-		m_Syncs.Add(so);
+			m_RenderStats.syncoffset = rtClock - rtStart;
+			AddSyncOffset(m_RenderStats.syncoffset, tick2);
+		}
 	}
 
 	return hr;
@@ -2201,9 +2419,10 @@ HRESULT CDX11VideoProcessor::ProcessSample(IMediaSample* pSample)
 
 HRESULT CDX11VideoProcessor::CopySample(IMediaSample* pSample)
 {
+	FRAMETRACE_SCOPE("CopySample");
 	CheckPointer(m_pDXGISwapChain1, E_FAIL);
 
-	uint64_t tick = GetPreciseTick();
+	CStageScope<STAGE_CopySample> copyScope(m_StageTimers);
 
 	// Get frame type
 	m_SampleFormat = D3D11_VIDEO_FRAME_FORMAT_PROGRESSIVE; // Progressive
@@ -2277,6 +2496,8 @@ HRESULT CDX11VideoProcessor::CopySample(IMediaSample* pSample)
 			MediaSideDataDOVIMetadata* pDOVIMetadata = nullptr;
 			hr = pMediaSideData->GetSideData(IID_MediaSideDataDOVIMetadataV2, (const BYTE**)&pDOVIMetadata, &size);
 			if (SUCCEEDED(hr) && size == sizeof(MediaSideDataDOVIMetadata) && CheckDoviMetadata(pDOVIMetadata, 1)) {
+				FRAMETRACE_SCOPE("DoVi metadata");
+				STAGE_SCOPE(STAGE_DoviParse);
 				const bool bYCCtoRGBChanged = !m_PSConvColorData.bEnable ||
 					(memcmp(
 						&m_Dovi.msd.ColorMetadata.ycc_to_rgb_matrix,
@@ -2530,6 +2751,9 @@ HRESULT CDX11VideoProcessor::CopySample(IMediaSample* pSample)
 			m_iSrcFromGPU = 11;
 			updateStats = true;
 		}
+		m_pBlendedSubPic.Release();
+		m_pFrameSubPic.Release();
+		m_bFrameSubPic = false;
 
 		CComQIPtr<ID3D11Texture2D> pD3D11Texture2D;
 		UINT ArraySlice = 0;
@@ -2573,6 +2797,7 @@ HRESULT CDX11VideoProcessor::CopySample(IMediaSample* pSample)
 			m_iSrcFromGPU = 0;
 			updateStats = true;
 		}
+		PrepareSubtitleBlend();
 
 		BYTE* data = nullptr;
 		const int size = pSample->GetActualDataLength();
@@ -2591,7 +2816,8 @@ HRESULT CDX11VideoProcessor::CopySample(IMediaSample* pSample)
 		UpdateStatsStatic();
 	}
 
-	m_RenderStats.copyticks = GetPreciseTick() - tick;
+	m_RenderStats.copyticks = copyScope.Stop();
+	m_LatencyHists[LATENCY_Copy].Add(m_RenderStats.copyticks);
 
 	return hr;
 }
@@ -2726,12 +2952,24 @@ HRESULT CDX11VideoProcessor::Render(int field, const REFERENCE_TIME frameStartTi
 		}
 	}
 
+	CComPtr<ISubPic> pSubPic;
+	if (!m_pPSHalfOUtoInterlace) {
+		pSubPic = TakeFrameSubPic();
+	}
+	if (m_pBlendedSubPic && !IsBlendedSubPic(pSubPic)) {
+		// a redraw has other subtitles than the frame
+		hr = RestoreTexSrcVideo();
+		DLogIf(FAILED(hr), L"CDX11VideoProcessor::Render() : RestoreTexSrcVideo() failed with error {}", HR2Str(hr));
+		m_pBlendedSubPic.Release();
+	}
+
 	if (!m_renderRect.IsRectEmpty()) {
 		hr = Process(pBackBuffer, m_srcRect, m_videoRect, m_FieldDrawn == 2);
 	}
+	m_TexPool.Trim();
 
 	if (!m_pPSHalfOUtoInterlace) {
-		DrawSubtitles(pBackBuffer);
+		DrawSubtitles(pBackBuffer, pSubPic);
 	}
 
 	if (m_bShowStats) {
@@ -2786,8 +3024,9 @@ HRESULT CDX11VideoProcessor::Render(int field, const REFERENCE_TIME frameStartTi
 	}
 #endif
 
-	uint64_t tick3 = GetPreciseTick();
-	m_RenderStats.paintticks = tick3 - tick1;
+	m_RenderStats.paintticks = GetPreciseTick() - tick1;
+	m_LatencyHists[LATENCY_Paint].Add(m_RenderStats.paintticks);
+	CStageScope<STAGE_Present> presentScope(m_StageTimers);
 
 	if (m_bVBlankBeforePresent && m_pDXGIOutput) {
 		hr = m_pDXGIOutput->WaitForVBlank();
@@ -2795,15 +3034,28 @@ HRESULT CDX11VideoProcessor::Render(int field, const REFERENCE_TIME frameStartTi
 	}
 
 	if (m_bAdjustPresentTime) {
-		SyncFrameToStreamTime(frameStartTime);
+		if (!SyncFrameToStreamTime(frameStartTime)) {
+			presentScope.Cancel();
+			return S_FALSE; // the cadence planner drops the frame to absorb the clock difference
+		}
 	}
 
+	g_FrameTrace.Add("Present", 'B');
 	g_bPresent = true;
 	hr = m_pDXGISwapChain1->Present(1, 0);
 	g_bPresent = false;
+	g_FrameTrace.Add("Present", 'E');
 	DLogIf(FAILED(hr), L"CDX11VideoProcessor::Render() : Present() failed with error {}", HR2Str(hr));
 
-	m_RenderStats.presentticks = GetPreciseTick() - tick3;
+	m_RenderStats.presentticks = presentScope.Stop();
+	m_LatencyHists[LATENCY_Present].Add(m_RenderStats.presentticks);
+
+	if (SUCCEEDED(hr)) {
+		DXGI_FRAME_STATISTICS frameStats;
+		if (SUCCEEDED(m_pDXGISwapChain1->GetFrameStatistics(&frameStats)) && frameStats.SyncQPCTime.QuadPart) {
+			AddVsyncObservation(frameStats.SyncQPCTime.QuadPart, frameStats.SyncRefreshCount);
+		}
+	}
 
 	if (hr == DXGI_ERROR_INVALID_CALL && m_pFilter->m_bIsD3DFullscreen) {
 		InitSwapChain(false);
@@ -2889,6 +3141,8 @@ void CDX11VideoProcessor::UpdateTexures()
 	else {
 		hr = m_TexConvertOutput.CheckCreate(m_pDevice, m_InternalTexFmt, m_srcRectWidth, m_srcRectHeight, Tex2D_DefaultShaderRTarget);
 	}
+
+	UpdateRenderGraph();
 }
 
 void CDX11VideoProcessor::UpdatePostScaleTexures()
@@ -2906,11 +3160,147 @@ void CDX11VideoProcessor::UpdatePostScaleTexures()
 		));
 	}
 
-	const UINT numPostScaleSteps = GetPostScaleSteps();
-	HRESULT hr = m_TexsPostScale.CheckCreate(m_pDevice, m_InternalTexFmt, m_windowRect.Width(), m_windowRect.Height(), numPostScaleSteps);
+	UpdateRenderGraph();
 	//UpdateStatsPostProc();
 }
 
+void CDX11VideoProcessor::UpdateRenderGraph()
+{
+	// Process() executes these passes, the textures are allocated here and not in the middle of a frame
+	m_RenderGraph.Reset();
+	m_RenderGraphConvertTex = CRenderGraph::External;
+	m_RenderGraphSrcRect = m_srcRect;
+	m_RenderGraphRotation = m_iRotation;
+	m_RenderGraphResizerX.Release();
+	m_RenderGraphResizerY.Release();
+
+	auto ReleaseTextures = [&](const size_t count) {
+		for (size_t i = count; i < m_RenderGraphTexs.size(); i++) {
+			m_TexPool.Release(m_RenderGraphTexs[i]);
+		}
+		m_RenderGraphTexs.resize(count);
+	};
+
+	if (!m_srcWidth || !m_srcHeight || m_windowRect.IsRectEmpty()) {
+		ReleaseTextures(0);
+		return;
+	}
+
+	const UINT numSteps = GetPostScaleSteps();
+	const RenderTexDesc_t postScaleDesc = { (UINT)m_InternalTexFmt, (UINT)m_windowRect.Width(), (UINT)m_windowRect.Height(), GetTexFmtBytesPerPixel(m_InternalTexFmt) };
+	RenderTexDesc_t resizeDesc = {};
+	bool bDirectVP = false;
+
+	if (m_D3D11VP.IsReady() && !numSteps) {
+		if (!(m_iSwapEffect == SWAPEFFECT_Discard && (m_VendorId == PCIV_AMDATI || m_VendorId == PCIV_INTEL))) {
+			const bool bNeedShaderTransform =
+				(m_TexConvertOutput.desc.Width != m_videoRect.Width() || m_TexConvertOutput.desc.Height != m_videoRect.Height() || m_bFlip
+				|| m_videoRect.right > m_windowRect.right || m_videoRect.bottom > m_windowRect.bottom)
+				|| (m_bHdrPassthroughSupport && (m_bHdrPassthrough || m_bHdrLocalToneMapping)); // At least on Nvidia we can sometimes get the "D3D11: Removing Device" error here when HDR Passthrough.
+			bDirectVP = !bNeedShaderTransform;
+		}
+	}
+
+	if (bDirectVP) {
+		m_RenderGraph.AddPass(L"D3D11 VP", RenderPass_D3D11VP, CRenderGraph::External, CRenderGraph::External);
+	}
+	else {
+		int input = CRenderGraph::External; // m_TexSrcVideo
+
+		if (m_D3D11VP.IsReady() || m_PSConvColorData.bEnable) {
+			const auto& desc = m_TexConvertOutput.desc;
+			m_RenderGraphConvertTex = m_RenderGraph.ImportTexture({ (UINT)desc.Format, desc.Width, desc.Height, GetTexFmtBytesPerPixel(desc.Format) });
+			if (m_D3D11VP.IsReady()) {
+				m_RenderGraph.AddPass(L"D3D11 VP", RenderPass_D3D11VP, input, m_RenderGraphConvertTex);
+				m_RenderGraphRotation = 0;
+			} else {
+				m_RenderGraph.AddPass(L"Convert color", RenderPass_ConvertColor, input, m_RenderGraphConvertTex);
+			}
+			input = m_RenderGraphConvertTex;
+			m_RenderGraphSrcRect.SetRect(0, 0, desc.Width, desc.Height);
+		}
+
+		UINT step = 0;
+
+		auto AddStep = [&](const wchar_t* name, const int op) {
+			const int output = (++step < numSteps) ? m_RenderGraph.AddTexture(postScaleDesc) : CRenderGraph::External;
+			m_RenderGraph.AddPass(name, op, input, output);
+			input = output;
+		};
+
+		// resize
+		{
+			const int rotation = m_RenderGraphRotation;
+			ID3D11PixelShader* resizerX;
+			ID3D11PixelShader* resizerY;
+			SelectResizers(m_RenderGraphSrcRect.Size(), m_videoRect.Size(), rotation, resizerX, resizerY);
+			m_RenderGraphResizerX = resizerX;
+			m_RenderGraphResizerY = resizerY;
+
+			const int output = numSteps ? m_RenderGraph.AddTexture(postScaleDesc) : CRenderGraph::External;
+			if (resizerX && resizerY && resizerX != resizerY) {
+				// use only float textures for the intermediate result
+				const UINT h1 = (rotation == 90 || rotation == 270) ? m_RenderGraphSrcRect.Width() : m_RenderGraphSrcRect.Height();
+				resizeDesc = { (UINT)DXGI_FORMAT_R16G16B16A16_FLOAT, postScaleDesc.width, h1, 8 };
+				const int tex = m_RenderGraph.AddTexture(resizeDesc);
+				m_RenderGraph.AddPass(L"Resize width", RenderPass_ResizeWidth, input, tex);
+				m_RenderGraph.AddPass(L"Resize height", RenderPass_ResizeHeight, tex, output);
+			} else {
+				const bool bNoOp = (m_RenderGraphSrcRect == m_videoRect && rotation == 0 && !m_bFlip);
+				m_RenderGraph.AddPass(L"Resize", RenderPass_Resize, input, output, bNoOp);
+			}
+			input = output;
+		}
+
+		if (m_pPSCorrection) {
+			AddStep(L"Correction", RenderPass_Correction);
+		}
+		if (m_pPSHDR10ToneMapping) {
+			AddStep(L"HDR10 tone mapping", RenderPass_HDR10ToneMapping);
+		}
+		for (size_t i = 0; i < m_PostScalePasses.size(); i++) {
+			AddStep(L"Post-scale shader", RenderPass_PostScale + (int)i);
+		}
+		if (m_pPSHalfOUtoInterlace) {
+			AddStep(L"Half OU to interlace", RenderPass_HalfOUtoInterlace);
+		}
+		if (m_bFinalPass) {
+			AddStep(L"Final pass", RenderPass_FinalPass);
+		}
+		ASSERT(step == numSteps);
+	}
+
+	if (!m_RenderGraph.Compile()) {
+		DLog(L"CDX11VideoProcessor::UpdateRenderGraph() : Compile() failed");
+		m_RenderGraph.Reset();
+		ReleaseTextures(0);
+		return;
+	}
+
+	// Larger textures are not allowed for the post-scale and half OU shaders, they get the texture size in the constants
+	// and can read neighboring pixels. The second resize pass reads neighboring rows so the height of its input must be exact.
+	const bool bExactSize = !m_PostScalePasses.empty() || m_pPSHalfOUtoInterlace;
+	const UINT count = m_RenderGraph.GetPhysicalCount();
+	ReleaseTextures(count);
+	for (UINT i = 0; i < count; i++) {
+		const auto& desc = m_RenderGraph.GetPhysicalDesc(i);
+		const bool bExactWidth  = bExactSize && desc == postScaleDesc;
+		const bool bExactHeight = bExactWidth || desc == resizeDesc;
+
+		HRESULT hr = m_TexPool.Acquire(m_RenderGraphTexs[i], m_pDevice, (DXGI_FORMAT)desc.format, desc.width, desc.height, Tex2D_DefaultShaderRTarget, bExactWidth, bExactHeight);
+		if (FAILED(hr)) {
+			DLog(L"CDX11VideoProcessor::UpdateRenderGraph() : m_TexPool.Acquire() failed with error {}", HR2Str(hr));
+			m_RenderGraph.Reset();
+			ReleaseTextures(0);
+			return;
+		}
+	}
+
+	DLog(L"CDX11VideoProcessor::UpdateRenderGraph() : {} passes, {} intermediate textures {:.1f} MiB, peak {:.1f} MiB, without aliasing {:.1f} MiB",
+		m_RenderGraph.GetActivePasses().size(), m_RenderGraph.GetPhysicalCount(),
+		m_RenderGraph.GetAllocatedBytes() / 1048576.0, m_RenderGraph.GetPeakBytes() / 1048576.0, m_RenderGraph.GetUnaliasedBytes() / 1048576.0);
+}
+
 void CDX11VideoProcessor::UpdateUpscalingShaders()
 {
 	m_pShaderUpscaleX.Release();
@@ -2939,6 +3329,58 @@ void CDX11VideoProcessor::UpdateDownscalingShaders()
 	UpdateScalingStrings();
 }
 
+HRESULT CDX11VideoProcessor::UpdateGamutLut(const mp_csp_prim csp_in)
+{
+	if (m_pGamutLutSRV && m_GamutLutPrim == csp_in) {
+		return S_OK;
+	}
+
+	m_pGamutLutSRV.Release();
+	m_pGamutLutTexture.Release();
+	m_GamutLutPrim = MP_CSP_PRIM_AUTO;
+
+	const auto& lut = GetGamutCompressionLut(csp_in, MP_CSP_PRIM_BT_709);
+
+	std::vector<DirectX::PackedVector::HALF> data(GAMUT_LUT_SIZE * GAMUT_LUT_SIZE * GAMUT_LUT_SIZE * 4);
+	for (size_t i = 0, j = 0; i < lut.size(); i += 3, j += 4) {
+		data[j + 0] = DirectX::PackedVector::XMConvertFloatToHalf(lut[i + 0]);
+		data[j + 1] = DirectX::PackedVector::XMConvertFloatToHalf(lut[i + 1]);
+		data[j + 2] = DirectX::PackedVector::XMConvertFloatToHalf(lut[i + 2]);
+		data[j + 3] = DirectX::PackedVector::XMConvertFloatToHalf(1.0f);
+	}
+
+	D3D11_TEXTURE3D_DESC desc = {};
+	desc.Width     = GAMUT_LUT_SIZE;
+	desc.Height    = GAMUT_LUT_SIZE;
+	desc.Depth     = GAMUT_LUT_SIZE;
+	desc.MipLevels = 1;
+	desc.Format    = DXGI_FORMAT_R16G16B16A16_FLOAT;
+	desc.Usage     = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	D3D11_SUBRESOURCE_DATA initData = {};
+	initData.pSysMem          = data.data();
+	initData.SysMemPitch      = GAMUT_LUT_SIZE * 4 * sizeof(DirectX::PackedVector::HALF);
+	initData.SysMemSlicePitch = GAMUT_LUT_SIZE * initData.SysMemPitch;
+
+	HRESULT hr = m_pDevice->CreateTexture3D(&desc, &initData, &m_pGamutLutTexture);
+	if (FAILED(hr)) {
+		DLog(L"CDX11VideoProcessor::UpdateGamutLut() : CreateTexture3D() failed with error {}", HR2Str(hr));
+		return hr;
+	}
+
+	hr = m_pDevice->CreateShaderResourceView(m_pGamutLutTexture, nullptr, &m_pGamutLutSRV);
+	if (FAILED(hr)) {
+		DLog(L"CDX11VideoProcessor::UpdateGamutLut() : CreateShaderResourceView() failed with error {}", HR2Str(hr));
+		m_pGamutLutTexture.Release();
+		return hr;
+	}
+
+	m_GamutLutPrim = csp_in;
+
+	return hr;
+}
+
 HRESULT CDX11VideoProcessor::UpdateConvertColorShader()
 {
 	m_pPSConvertColor.Release();
@@ -2951,11 +3393,20 @@ HRESULT CDX11VideoProcessor::UpdateConvertColorShader()
 
 	MediaSideDataDOVIMetadata* pDOVIMetadata = m_Dovi.bValid ? &m_Dovi.msd : nullptr;
 
+	// the gamut compression LUT is used only for HDR to SDR conversion, SDR content keeps the plain matrix
+	mp_csp_prim gamutLutPrim = MP_CSP_PRIM_AUTO;
+	if (convertType == SHADER_CONVERT_TO_SDR
+			&& (m_srcExFmt.VideoTransferFunction == MFVideoTransFunc_2084 || m_srcExFmt.VideoTransferFunction == MFVideoTransFunc_HLG || pDOVIMetadata)) {
+		if (S_OK == UpdateGamutLut(GetWideGamutPrimaries(m_srcExFmt.VideoPrimaries))) {
+			gamutLutPrim = m_GamutLutPrim;
+		}
+	}
+
 	HRESULT hr = GetShaderConvertColor(true,
 		m_srcWidth,
 		m_TexSrcVideo.desc.Width, m_TexSrcVideo.desc.Height,
 		m_srcRect, m_srcParams, m_srcExFmt, pDOVIMetadata,
-		m_iChromaScaling, convertType, false,
+		m_iChromaScaling, convertType, false, gamutLutPrim,
 		&pShaderCode);
 	if (S_OK == hr) {
 		hr = m_pDevice->CreatePixelShader(pShaderCode->GetBufferPointer(), pShaderCode->GetBufferSize(), nullptr, &m_pPSConvertColor);
@@ -2967,7 +3418,7 @@ HRESULT CDX11VideoProcessor::UpdateConvertColorShader()
 			m_srcWidth,
 			m_TexSrcVideo.desc.Width, m_TexSrcVideo.desc.Height,
 			m_srcRect, m_srcParams, m_srcExFmt, pDOVIMetadata,
-			m_iChromaScaling, convertType, true,
+			m_iChromaScaling, convertType, true, gamutLutPrim,
 			&pShaderCode);
 		if (S_OK == hr) {
 			hr = m_pDevice->CreatePixelShader(pShaderCode->GetBufferPointer(), pShaderCode->GetBufferSize(), nullptr, &m_pPSConvertColorDeint);
@@ -3035,6 +3486,8 @@ void CDX11VideoProcessor::UpdateBitmapShader()
 
 HRESULT CDX11VideoProcessor::D3D11VPPass(ID3D11Texture2D* pRenderTarget, const CRect& srcRect, const CRect& dstRect, const bool second)
 {
+	FRAMETRACE_SCOPE("D3D11VPPass");
+	STAGE_SCOPE(STAGE_VPPass);
 	HRESULT hr = m_D3D11VP.SetRectangles(srcRect, dstRect);
 
 	hr = m_D3D11VP.Process(pRenderTarget, m_SampleFormat, second);
@@ -3047,6 +3500,8 @@ HRESULT CDX11VideoProcessor::D3D11VPPass(ID3D11Texture2D* pRenderTarget, const C
 
 HRESULT CDX11VideoProcessor::ConvertColorPass(ID3D11Texture2D* pRenderTarget)
 {
+	FRAMETRACE_SCOPE("ConvertColorPass");
+	STAGE_SCOPE(STAGE_ConvertPass);
 	CComPtr<ID3D11RenderTargetView> pRenderTargetView;
 
 	HRESULT hr = m_pDevice->CreateRenderTargetView(pRenderTarget, nullptr, &pRenderTargetView);
@@ -3080,6 +3535,7 @@ HRESULT CDX11VideoProcessor::ConvertColorPass(ID3D11Texture2D* pRenderTarget)
 	m_pDeviceContext->PSSetShaderResources(0, 1, &m_TexSrcVideo.pShaderResource.p);
 	m_pDeviceContext->PSSetShaderResources(1, 1, &m_TexSrcVideo.pShaderResource2.p);
 	m_pDeviceContext->PSSetShaderResources(2, 1, &m_TexSrcVideo.pShaderResource3.p);
+	m_pDeviceContext->PSSetShaderResources(3, 1, &m_pGamutLutSRV.p);
 	m_pDeviceContext->PSSetSamplers(0, 1, &m_pSamplerPoint.p);
 	m_pDeviceContext->PSSetSamplers(1, 1, &m_pSamplerLinear.p);
 	m_pDeviceContext->PSSetConstantBuffers(0, 1, &m_PSConvColorData.pConstants);
@@ -3094,25 +3550,21 @@ HRESULT CDX11VideoProcessor::ConvertColorPass(ID3D11Texture2D* pRenderTarget)
 	// Draw textured quad onto render target
 	m_pDeviceContext->Draw(4, 0);
 
-	ID3D11ShaderResourceView* views[3] = {};
-	m_pDeviceContext->PSSetShaderResources(0, 3, views);
+	ID3D11ShaderResourceView* views[4] = {};
+	m_pDeviceContext->PSSetShaderResources(0, 4, views);
 
 	return hr;
 }
 
-HRESULT CDX11VideoProcessor::ResizeShaderPass(const Tex2D_t& Tex, ID3D11Texture2D* pRenderTarget, const CRect& srcRect, const CRect& dstRect, const int rotation)
+void CDX11VideoProcessor::SelectResizers(const CSize& srcSize, const CSize& dstSize, const int rotation, ID3D11PixelShader*& resizerX, ID3D11PixelShader*& resizerY)
 {
-	HRESULT hr = S_OK;
-	const int w2 = dstRect.Width();
-	const int h2 = dstRect.Height();
+	const int w2 = dstSize.cx;
+	const int h2 = dstSize.cy;
 	const int k = m_bInterpolateAt50pct ? 2 : 1;
 
-	int w1, h1;
-	ID3D11PixelShader* resizerX;
-	ID3D11PixelShader* resizerY;
 	if (rotation == 90 || rotation == 270) {
-		w1 = srcRect.Height();
-		h1 = srcRect.Width();
+		const int w1 = srcSize.cy;
+		const int h1 = srcSize.cx;
 		resizerX = (w1 == w2) ? nullptr : (w1 > k * w2) ? m_pShaderDownscaleY.p : m_pShaderUpscaleY.p; // use Y scaling here
 		if (resizerX) {
 			resizerY = (h1 == h2) ? nullptr : (h1 > k * h2) ? m_pShaderDownscaleY.p : m_pShaderUpscaleY.p;
@@ -3120,74 +3572,17 @@ HRESULT CDX11VideoProcessor::ResizeShaderPass(const Tex2D_t& Tex, ID3D11Texture2
 			resizerY = (h1 == h2) ? nullptr : (h1 > k * h2) ? m_pShaderDownscaleX.p : m_pShaderUpscaleX.p; // use X scaling here
 		}
 	} else {
-		w1 = srcRect.Width();
-		h1 = srcRect.Height();
+		const int w1 = srcSize.cx;
+		const int h1 = srcSize.cy;
 		resizerX = (w1 == w2) ? nullptr : (w1 > k * w2) ? m_pShaderDownscaleX.p : m_pShaderUpscaleX.p;
 		resizerY = (h1 == h2) ? nullptr : (h1 > k * h2) ? m_pShaderDownscaleY.p : m_pShaderUpscaleY.p;
 	}
-
-	if (resizerX && resizerY) {
-		// two pass resize
-
-		D3D11_TEXTURE2D_DESC desc;
-		pRenderTarget->GetDesc(&desc);
-
-		if (resizerX == resizerY) {
-			// one pass resize
-			hr = TextureResizeShader(Tex, pRenderTarget, srcRect, dstRect, resizerX, rotation, m_bFlip);
-			DLogIf(FAILED(hr), L"CDX11VideoProcessor::ResizeShaderPass() : failed with error {}", HR2Str(hr));
-
-			return hr;
-		}
-
-		// check intermediate texture
-		const UINT texWidth  = desc.Width;
-		const UINT texHeight = h1;
-
-		if (m_TexResize.pTexture) {
-			if (texWidth != m_TexResize.desc.Width || texHeight != m_TexResize.desc.Height) {
-				m_TexResize.Release(); // need new texture
-			}
-		}
-
-		if (!m_TexResize.pTexture) {
-			// use only float textures here
-			hr = m_TexResize.Create(m_pDevice, DXGI_FORMAT_R16G16B16A16_FLOAT, texWidth, texHeight, Tex2D_DefaultShaderRTarget);
-			if (FAILED(hr)) {
-				DLog(L"CDX11VideoProcessor::ResizeShaderPass() : m_TexResize.Create() failed with error {}", HR2Str(hr));
-				return hr;
-			}
-		}
-
-		CRect resizeRect(dstRect.left, 0, dstRect.right, texHeight);
-
-		// First resize pass
-		hr = TextureResizeShader(Tex, m_TexResize.pTexture, srcRect, resizeRect, resizerX, rotation, m_bFlip);
-		// Second resize pass
-		hr = TextureResizeShader(m_TexResize, pRenderTarget, resizeRect, dstRect, resizerY, 0, false);
-	}
-	else {
-		if (resizerX) {
-			// one pass resize for width
-			hr = TextureResizeShader(Tex, pRenderTarget, srcRect, dstRect, resizerX, rotation, m_bFlip);
-		}
-		else if (resizerY) {
-			// one pass resize for height
-			hr = TextureResizeShader(Tex, pRenderTarget, srcRect, dstRect, resizerY, rotation, m_bFlip);
-		}
-		else {
-			// no resize
-			hr = TextureCopyRect(Tex, pRenderTarget, srcRect, dstRect, m_pPS_Simple, nullptr, rotation, m_bFlip);
-		}
-	}
-
-	DLogIf(FAILED(hr), L"CDX11VideoProcessor::ResizeShaderPass() : failed with error {}", HR2Str(hr));
-
-	return hr;
 }
 
 HRESULT CDX11VideoProcessor::FinalPass(const Tex2D_t& Tex, ID3D11Texture2D* pRenderTarget, const CRect& srcRect, const CRect& dstRect)
 {
+	FRAMETRACE_SCOPE("FinalPass");
+	STAGE_SCOPE(STAGE_FinalPass);
 	CComPtr<ID3D11RenderTargetView> pRenderTargetView;
 
 	HRESULT hr = m_pDevice->CreateRenderTargetView(pRenderTarget, nullptr, &pRenderTargetView);
@@ -3232,11 +3627,16 @@ HRESULT CDX11VideoProcessor::FinalPass(const Tex2D_t& Tex, ID3D11Texture2D* pRen
 	return hr;
 }
 
-void CDX11VideoProcessor::DrawSubtitles(ID3D11Texture2D* pRenderTarget)
+void CDX11VideoProcessor::DrawSubtitles(ID3D11Texture2D* pRenderTarget, ISubPic* pSubPic)
 {
 	HRESULT hr = S_OK;
+	CStageScope<STAGE_DrawSubtitles> subsScope(m_StageTimers);
 
-	CComPtr<ISubPic> pSubPic = m_pFilter->GetSubPic(m_rtStart);
+	if (pSubPic && pSubPic == m_pBlendedSubPic) {
+		// already in the frame
+		subsScope.Cancel();
+		return;
+	}
 	if (pSubPic) {
 		RECT rcSource, rcDest;
 		hr = pSubPic->GetSourceAndDest(m_windowRect, m_videoRect, &rcSource, &rcDest, FALSE, {}, 0, FALSE);
@@ -3256,10 +3656,8 @@ void CDX11VideoProcessor::DrawSubtitles(ID3D11Texture2D* pRenderTarget)
 				pRenderTargetView->Release();
 			}
 		}
-		return;
 	}
-
-	if (m_pFilter->m_pSub11CallBack) {
+	else if (m_pFilter->m_pSub11CallBack) {
 		ID3D11RenderTargetView* pRenderTargetView;
 		hr = m_pDevice->CreateRenderTargetView(pRenderTarget, nullptr, &pRenderTargetView);
 		if (SUCCEEDED(hr)) {
@@ -3280,124 +3678,123 @@ void CDX11VideoProcessor::DrawSubtitles(ID3D11Texture2D* pRenderTarget)
 			pRenderTargetView->Release();
 		}
 	}
+	else {
+		subsScope.Cancel();
+		return;
+	}
+
+	m_RenderStats.substicks = subsScope.Stop();
+	m_LatencyHists[LATENCY_Subtitles].Add(m_RenderStats.substicks);
 }
 
 HRESULT CDX11VideoProcessor::Process(ID3D11Texture2D* pRenderTarget, const CRect& srcRect, const CRect& dstRect, const bool second)
 {
+	FRAMETRACE_SCOPE("Process");
+	STAGE_SCOPE(STAGE_Process);
 	HRESULT hr = S_OK;
 	m_bDitherUsed = false;
-	int rotation = m_iRotation;
 
-	CRect rSrc = srcRect;
-	Tex2D_t* pInputTexture = nullptr;
+	// the passes and their textures are prepared by UpdateRenderGraph()
+	const auto& passes = m_RenderGraph.GetActivePasses();
+	if (passes.empty()) {
+		DLog(L"CDX11VideoProcessor::Process() : no render passes");
+		return E_FAIL;
+	}
+	ASSERT(dstRect == m_videoRect);
 
-	const UINT numSteps = GetPostScaleSteps();
+	auto GetTexture = [&](const int tex) -> Tex2D_t& {
+		if (tex == CRenderGraph::External) {
+			return m_TexSrcVideo;
+		}
+		if (tex == m_RenderGraphConvertTex) {
+			return m_TexConvertOutput;
+		}
+		return m_RenderGraphTexs[m_RenderGraph.GetPhysicalIndex(tex)];
+	};
+	// the pooled textures can be larger than planned, the shader constants use the planned size
+	auto GetTextureSize = [&](const int tex) {
+		if (tex == CRenderGraph::External) {
+			return CSize(m_TexSrcVideo.desc.Width, m_TexSrcVideo.desc.Height);
+		}
+		const auto& desc = m_RenderGraph.GetTextureDesc(tex);
+		return CSize(desc.width, desc.height);
+	};
 
-	if (m_D3D11VP.IsReady()) {
-		if (!(m_iSwapEffect == SWAPEFFECT_Discard && (m_VendorId == PCIV_AMDATI || m_VendorId == PCIV_INTEL))) {
-			const bool bNeedShaderTransform =
-				(m_TexConvertOutput.desc.Width != dstRect.Width() || m_TexConvertOutput.desc.Height != dstRect.Height() || m_bFlip
-				|| dstRect.right > m_windowRect.right || dstRect.bottom > m_windowRect.bottom)
-				|| (m_bHdrPassthroughSupport && (m_bHdrPassthrough || m_bHdrLocalToneMapping)); // At least on Nvidia we can sometimes get the "D3D11: Removing Device" error here when HDR Passthrough.
-			if (!bNeedShaderTransform && !numSteps) {
-				m_bVPScalingUseShaders = false;
-				hr = D3D11VPPass(pRenderTarget, rSrc, dstRect, second);
+	// the resizers of the plan, the resize passes depend on them
+	const CRect rSrc = m_RenderGraphSrcRect;
+	const int rotation = m_RenderGraphRotation;
+	ID3D11PixelShader* resizerX = m_RenderGraphResizerX;
+	ID3D11PixelShader* resizerY = m_RenderGraphResizerY;
 
-				return hr;
-			}
-		}
+	// the post-scale textures have the window size
+	CRect rect;
+	rect.IntersectRect(dstRect, CRect(0, 0, m_windowRect.Width(), m_windowRect.Height()));
+	bool bPostScaleConstants = false;
 
-		CRect rect(0, 0, m_TexConvertOutput.desc.Width, m_TexConvertOutput.desc.Height);
-		hr = D3D11VPPass(m_TexConvertOutput.pTexture, rSrc, rect, second);
-		pInputTexture = &m_TexConvertOutput;
-		rSrc = rect;
-		rotation = 0;
-	}
-	else if (m_PSConvColorData.bEnable) {
-		ConvertColorPass(m_TexConvertOutput.pTexture);
-		pInputTexture = &m_TexConvertOutput;
-		rSrc.SetRect(0, 0, m_TexConvertOutput.desc.Width, m_TexConvertOutput.desc.Height);
-	}
-	else {
-		pInputTexture = &m_TexSrcVideo;
-	}
+	for (const auto& pass : passes) {
+		Tex2D_t& Tex = GetTexture(pass.input);
+		ID3D11Texture2D* pRT = (pass.output == CRenderGraph::External) ? pRenderTarget : GetTexture(pass.output).pTexture.p;
 
-	if (numSteps) {
-		UINT step = 0;
-		Tex2D_t* pTex = m_TexsPostScale.GetFirstTex();
-		ID3D11Texture2D* pRT = pTex->pTexture;
-
-		auto StepSetting = [&]() {
-			step++;
-			pInputTexture = pTex;
-			if (step < numSteps) {
-				pTex = m_TexsPostScale.GetNextTex();
-				pRT = pTex->pTexture;
+		switch (pass.op) {
+		case RenderPass_D3D11VP:
+			if (pass.output == CRenderGraph::External) {
+				m_bVPScalingUseShaders = false;
+				hr = D3D11VPPass(pRenderTarget, srcRect, dstRect, second);
 			} else {
-				pRT = pRenderTarget;
+				m_bVPScalingUseShaders = (rSrc.Size() != dstRect.Size());
+				hr = D3D11VPPass(pRT, srcRect, rSrc, second);
 			}
-		};
-
-		CRect rect;
-		rect.IntersectRect(dstRect, CRect(0, 0, pTex->desc.Width, pTex->desc.Height));
-
-		if (m_D3D11VP.IsReady()) {
-			m_bVPScalingUseShaders = rSrc.Width() != dstRect.Width() || rSrc.Height() != dstRect.Height();
-		}
-
-		if (rSrc != dstRect || rotation != 0) {
-			hr = ResizeShaderPass(*pInputTexture, pRT, rSrc, dstRect, rotation);
-		} else {
-			pTex = pInputTexture; // Hmm
+			break;
+		case RenderPass_ConvertColor:
+			hr = ConvertColorPass(pRT);
+			break;
+		case RenderPass_ResizeWidth: {
+			FRAMETRACE_SCOPE("ResizeShaderPass");
+			STAGE_SCOPE(STAGE_ResizePass);
+			const CRect resizeRect(dstRect.left, 0, dstRect.right, m_RenderGraph.GetTextureDesc(pass.output).height);
+			hr = TextureResizeShader(Tex, pRT, rSrc, resizeRect, resizerX, rotation, m_bFlip);
+			break;
 		}
-
-		if (m_pPSCorrection) {
-			StepSetting();
-			hr = TextureCopyRect(*pInputTexture, pRT, rect, rect, m_pPSCorrection, m_pCorrectionConstants, 0, false);
+		case RenderPass_ResizeHeight: {
+			FRAMETRACE_SCOPE("ResizeShaderPass");
+			STAGE_SCOPE(STAGE_ResizePass);
+			const CRect resizeRect(dstRect.left, 0, dstRect.right, m_RenderGraph.GetTextureDesc(pass.input).height);
+			hr = TextureResizeShader(Tex, pRT, resizeRect, dstRect, resizerY, 0, false);
+			break;
 		}
-
-		if (m_pPSHDR10ToneMapping) {
-			StepSetting();
-
-			if (m_pDoViDynamicConstants) {
-				m_pDeviceContext->PSSetConstantBuffers(1, 1, &m_pDoViDynamicConstants.p);
+		case RenderPass_Resize: {
+			FRAMETRACE_SCOPE("ResizeShaderPass");
+			STAGE_SCOPE(STAGE_ResizePass);
+			if (resizerX) {
+				// one pass resize for width or for both dimensions
+				hr = TextureResizeShader(Tex, pRT, rSrc, dstRect, resizerX, rotation, m_bFlip);
 			}
-
-			hr = TextureCopyRect(*pInputTexture, pRT, rect, rect, m_pPSHDR10ToneMapping, m_pHDR10ToneMappingConstants, 0, false);
-		}
-
-		if (m_pPostScaleShaders.size()) {
-			static __int64 counter = 0;
-			static long start = GetTickCount();
-
-			long stop = GetTickCount();
-			long diff = stop - start;
-			if (diff >= 10 * 60 * 1000) {
-				start = stop;    // reset after 10 min (ps float has its limits in both range and accuracy)
+			else if (resizerY) {
+				// one pass resize for height
+				hr = TextureResizeShader(Tex, pRT, rSrc, dstRect, resizerY, rotation, m_bFlip);
 			}
-
-			PS_EXTSHADER_CONSTANTS ConstData = {
-				{1.0f / pTex->desc.Width, 1.0f / pTex->desc.Height },
-				{(float)pTex->desc.Width, (float)pTex->desc.Height},
-				counter++,
-				(float)diff / 1000,
-				0, 0
-			};
-			m_pDeviceContext->UpdateSubresource(m_pPostScaleConstants, 0, nullptr, &ConstData, 0, 0);
-
-			for (UINT idx = 0; idx < m_pPostScaleShaders.size(); idx++) {
-				StepSetting();
-				hr = TextureCopyRect(*pInputTexture, pRT, rect, rect, m_pPostScaleShaders[idx].shader, m_pPostScaleConstants, 0, false);
+			else {
+				// no resize
+				hr = TextureCopyRect(Tex, pRT, rSrc, dstRect, m_pPS_Simple, nullptr, rotation, m_bFlip);
 			}
+			break;
 		}
+		case RenderPass_Correction:
+			hr = TextureCopyRect(Tex, pRT, rect, rect, m_pPSCorrection, m_pCorrectionConstants, 0, false);
+			break;
+		case RenderPass_HDR10ToneMapping:
+			if (m_pDoViDynamicConstants) {
+				m_pDeviceContext->PSSetConstantBuffers(1, 1, &m_pDoViDynamicConstants.p);
+			}
+			hr = TextureCopyRect(Tex, pRT, rect, rect, m_pPSHDR10ToneMapping, m_pHDR10ToneMappingConstants, 0, false);
+			break;
+		case RenderPass_HalfOUtoInterlace: {
+			DrawSubtitles(Tex.pTexture, m_pFilter->GetSubPic(m_rtStart));
 
-		if (m_pPSHalfOUtoInterlace) {
-			DrawSubtitles(pRT);
-
-			StepSetting();
+			const float height = (float)GetTextureSize(pass.input).cy;
 			FLOAT ConstData[] = {
-				(float)pTex->desc.Height, 0,
-				(float)dstRect.top / pTex->desc.Height, (float)dstRect.bottom / pTex->desc.Height,
+				height, 0,
+				dstRect.top / height, dstRect.bottom / height,
 			};
 			D3D11_MAPPED_SUBRESOURCE mr;
 			hr = m_pDeviceContext->Map(m_pHalfOUtoInterlaceConstantBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mr);
@@ -3405,17 +3802,46 @@ HRESULT CDX11VideoProcessor::Process(ID3D11Texture2D* pRenderTarget, const CRect
 				memcpy(mr.pData, &ConstData, sizeof(ConstData));
 				m_pDeviceContext->Unmap(m_pHalfOUtoInterlaceConstantBuffer, 0);
 			}
-			hr = TextureCopyRect(*pInputTexture, pRT, rect, rect, m_pPSHalfOUtoInterlace, m_pHalfOUtoInterlaceConstantBuffer, 0, false);
+			hr = TextureCopyRect(Tex, pRT, rect, rect, m_pPSHalfOUtoInterlace, m_pHalfOUtoInterlaceConstantBuffer, 0, false);
+			break;
 		}
-
-		if (m_bFinalPass) {
-			StepSetting();
-			hr = FinalPass(*pTex, pRT, rect, rect);
+		case RenderPass_FinalPass:
+			hr = FinalPass(Tex, pRT, rect, rect);
 			m_bDitherUsed = true;
+			break;
+		default: {
+			const size_t index = pass.op - RenderPass_PostScale;
+			if (pass.op < RenderPass_PostScale || index >= m_PostScalePasses.size()) {
+				ASSERT(0);
+				hr = E_UNEXPECTED;
+				break;
+			}
+
+			if (!bPostScaleConstants) {
+				const CSize size = GetTextureSize(pass.input);
+				static __int64 counter = 0;
+				static long start = GetTickCount();
+
+				long stop = GetTickCount();
+				long diff = stop - start;
+				if (diff >= 10 * 60 * 1000) {
+					start = stop;    // reset after 10 min (ps float has its limits in both range and accuracy)
+				}
+
+				PS_EXTSHADER_CONSTANTS ConstData = {
+					{1.0f / size.cx, 1.0f / size.cy },
+					{(float)size.cx, (float)size.cy},
+					counter++,
+					(float)diff / 1000,
+					0, 0
+				};
+				m_pDeviceContext->UpdateSubresource(m_pPostScaleConstants, 0, nullptr, &ConstData, 0, 0);
+				bPostScaleConstants = true;
+			}
+
+			hr = TextureCopyRect(Tex, pRT, rect, rect, m_PostScalePasses[index].shader, m_pPostScaleConstants, 0, false);
+		}
 		}
-	}
-	else {
-		hr = ResizeShaderPass(*pInputTexture, pRenderTarget, rSrc, dstRect, rotation);
 	}
 
 	DLogIf(FAILED(hr), L"CDX11VideoProcessor::Process() : failed with error {}", HR2Str(hr));
@@ -3581,6 +4007,7 @@ HRESULT CDX11VideoProcessor::GetCurentImage(long *pDIBImage)
 			EXECUTE_ASSERT(S_OK == CreatePShaderFromResource(&m_pPSHDR10ToneMapping, IDF_PS_11_HDR10_TONEMAP));
 			DLogIf(m_pPSHDR10ToneMapping, L"CDX11VideoProcessor::InitMediaType() m_pPSHDR10ToneMapping(type: '{}') created", m_iHdrLocalToneMappingType);
 		}
+		UpdateRenderGraph();
 	}
 
 	if (FAILED(hr)) {
@@ -3718,7 +4145,10 @@ HRESULT CDX11VideoProcessor::GetVPInfo(std::wstring& str)
 	if (m_pPostScaleShaders.size()) {
 		str.append(L"\n\nPost scale pixel shaders:");
 		for (const auto& pshader : m_pPostScaleShaders) {
-			str += std::format(L"\n  {}", pshader.name);
+			str += std::format(L"\n  {}{}", pshader.name, pshader.bPointwise ? L" (pointwise)" : L"");
+		}
+		if (m_PostScalePasses.size() < m_pPostScaleShaders.size()) {
+			str += std::format(L"\n  fused into {} passes", m_PostScalePasses.size());
 		}
 	}
 
@@ -3809,6 +4239,7 @@ void CDX11VideoProcessor::Configure(const Settings_t& config)
 	bool changeUpscalingShader   = false;
 	bool changeDowndcalingShader = false;
 	bool changeNumTextures       = false;
+	bool changeResizers          = false;
 	bool changeResizeStats       = false;
 	bool changeSuperRes          = false;
 	bool changeRTXVideoHDR       = false;
@@ -3817,7 +4248,6 @@ void CDX11VideoProcessor::Configure(const Settings_t& config)
 	// settings that do not require preparation
 	m_bShowStats           = config.bShowStats;
 	m_bDeintDouble         = config.bDeintDouble;
-	m_bInterpolateAt50pct  = config.bInterpolateAt50pct;
 	m_bVBlankBeforePresent = config.bVBlankBeforePresent;
 	m_bAdjustPresentTime   = config.bAdjustPresentTime;
 	m_bDeintBlend          = config.bDeintBlend;
@@ -3829,6 +4259,11 @@ void CDX11VideoProcessor::Configure(const Settings_t& config)
 		changeResizeStats = true;
 	}
 
+	if (config.bInterpolateAt50pct != m_bInterpolateAt50pct) {
+		m_bInterpolateAt50pct = config.bInterpolateAt50pct;
+		changeResizers = true; // SelectResizers() depends on it
+	}
+
 	if (config.iTexFormat != m_iTexFormat) {
 		m_iTexFormat = config.iTexFormat;
 		changeTextures = true;
@@ -4027,6 +4462,12 @@ void CDX11VideoProcessor::Configure(const Settings_t& config)
 	if (changeDowndcalingShader) {
 		UpdateDownscalingShaders();
 	}
+	if (changeResizers) {
+		UpdateScalingStrings();
+	}
+	if ((changeUpscalingShader || changeDowndcalingShader || changeResizers) && !changeNumTextures) {
+		UpdateRenderGraph();
+	}
 
 	if (changeLuminanceParams) {
 		SetShaderLuminanceParams();
@@ -4055,6 +4496,13 @@ void CDX11VideoProcessor::SetRotation(int value)
 	if (m_D3D11VP.IsReady()) {
 		m_D3D11VP.SetRotation(static_cast<D3D11_VIDEO_PROCESSOR_ROTATION>(value / 90));
 	}
+	UpdateRenderGraph();
+}
+
+void CDX11VideoProcessor::SetFlip(bool value)
+{
+	m_bFlip = value;
+	UpdateRenderGraph();
 }
 
 void CDX11VideoProcessor::SetStereo3dTransform(int value)
@@ -4069,6 +4517,7 @@ void CDX11VideoProcessor::SetStereo3dTransform(int value)
 	else {
 		m_pPSHalfOUtoInterlace.Release();
 	}
+	UpdateRenderGraph();
 }
 
 void CDX11VideoProcessor::Flush()
@@ -4101,10 +4550,74 @@ void CDX11VideoProcessor::ClearPostScaleShaders()
 		pExtShader.shader.Release();
 	}
 	m_pPostScaleShaders.clear();
+	m_PostScalePasses.clear();
+	UpdateRenderGraph();
 	//UpdateStatsPostProc();
 	DLog(L"CDX11VideoProcessor::ClearPostScaleShaders().");
 }
 
+void CDX11VideoProcessor::UpdatePostScalePasses()
+{
+	m_PostScalePasses.clear();
+
+	const size_t count = m_pPostScaleShaders.size();
+	for (size_t i = 0; i < count; ) {
+		size_t n = 1;
+		if (m_pPostScaleShaders[i].bPointwise) {
+			while (i + n < count && m_pPostScaleShaders[i + n].bPointwise) {
+				n++;
+			}
+		}
+
+		if (n > 1) {
+			std::vector<const PointwiseShader_t*> shaders;
+			std::wstring name;
+			for (size_t j = i; j < i + n; j++) {
+				shaders.emplace_back(&m_pPostScaleShaders[j].pointwise);
+				if (name.size()) {
+					name += L" + ";
+				}
+				name.append(m_pPostScaleShaders[j].name);
+			}
+
+			// the shader list is usually cleared and added again, so only the new combinations are compiled.
+			// The separate passes write to m_InternalTexFmt, the UNORM formats clamp the intermediate results.
+			const std::string code = GetFusedPointwiseCode(shaders, m_InternalTexFmt != DXGI_FORMAT_R16G16B16A16_FLOAT);
+			CComPtr<ID3D11PixelShader> pShader;
+			if (code.size()) {
+				auto it = m_FusedShaders.find(code);
+				if (it != m_FusedShaders.end()) {
+					pShader = it->second;
+				} else {
+					ID3DBlob* pShaderCode = nullptr;
+					HRESULT hr = CompileFusedPointwise(code, &pShaderCode);
+					if (S_OK == hr) {
+						hr = m_pDevice->CreatePixelShader(pShaderCode->GetBufferPointer(), pShaderCode->GetBufferSize(), nullptr, &pShader);
+						pShaderCode->Release();
+					}
+					if (m_FusedShaders.size() >= 32) {
+						m_FusedShaders.clear();
+					}
+					m_FusedShaders.emplace(code, pShader); // failures are cached too
+				}
+			}
+
+			if (pShader) {
+				m_PostScalePasses.push_back({ name, pShader });
+				DLog(L"CDX11VideoProcessor::UpdatePostScalePasses() : \"{}\" fused into one pass.", name);
+				i += n;
+				continue;
+			}
+			DLog(L"CDX11VideoProcessor::UpdatePostScalePasses() : fusion of \"{}\" FAILED!", name);
+		}
+
+		for (size_t j = i; j < i + n; j++) {
+			m_PostScalePasses.push_back({ m_pPostScaleShaders[j].name, m_pPostScaleShaders[j].shader });
+		}
+		i += n;
+	}
+}
+
 HRESULT CDX11VideoProcessor::AddPreScaleShader(const std::wstring& name, const std::string& srcCode)
 {
 #ifdef _DEBUG
@@ -4152,6 +4665,8 @@ HRESULT CDX11VideoProcessor::AddPostScaleShader(const std::wstring& name, const
 		hr = m_pDevice->CreatePixelShader(pShaderCode->GetBufferPointer(), pShaderCode->GetBufferSize(), nullptr, &m_pPostScaleShaders.back().shader);
 		if (S_OK == hr) {
 			m_pPostScaleShaders.back().name = name;
+			m_pPostScaleShaders.back().bPointwise = GetPointwisePixelShader(srcCode, pShaderCode, m_pPostScaleShaders.back().pointwise);
+			UpdatePostScalePasses();
 			UpdatePostScaleTexures();
 			DLog(L"CDX11VideoProcessor::AddPostScaleShader() : \"{}\" pixel shader added successfully.", name);
 		}
@@ -4169,10 +4684,130 @@ ISubPicAllocator* CDX11VideoProcessor::GetSubPicAllocator()
 {
 	if (!m_pSubPicAllocator && m_pDevice) {
 		m_pSubPicAllocator = new CDX11SubPicAllocator(m_pDevice, { 1280, 720 });
+		m_pSubPicAllocator->SetPoolLimit(m_subPicPoolLimit);
+		m_pSubPicAllocator->SetCompressQueued(m_bSubPicCompression);
 	}
 	return m_pSubPicAllocator;
 }
 
+HRESULT CDX11VideoProcessor::GetSubPicPoolStats(BYTE** ppData, unsigned* pSize)
+{
+	CheckPointer(ppData, E_POINTER);
+	CheckPointer(pSize, E_POINTER);
+
+	CComPtr<CDX11SubPicAllocator> pSubPicAllocator = m_pSubPicAllocator;
+	if (!pSubPicAllocator) {
+		return E_ABORT;
+	}
+
+	*pSize = sizeof(SubPicPoolData_t);
+	auto pData = (SubPicPoolData_t*)LocalAlloc(LMEM_FIXED, *pSize); // only this allocator can be used
+	if (!pData) {
+		return E_OUTOFMEMORY;
+	}
+	pSubPicAllocator->GetStats(*pData);
+
+	*ppData = (BYTE*)pData;
+
+	return S_OK;
+}
+
+void CDX11VideoProcessor::SetSubPicPoolLimit(const UINT64 limit)
+{
+	m_subPicPoolLimit = limit;
+	if (m_pSubPicAllocator) {
+		m_pSubPicAllocator->SetPoolLimit(limit);
+	}
+}
+
+void CDX11VideoProcessor::SetSubtitlesBlendInCopy(const bool bBlend)
+{
+	m_bSubsBlendInCopy = bBlend; // PrepareSubtitleBlend() releases the layers, the current frame can still need them
+}
+
+void CDX11VideoProcessor::SetSubPicCompression(const bool bCompress)
+{
+	m_bSubPicCompression = bCompress;
+	if (m_pSubPicAllocator) {
+		m_pSubPicAllocator->SetCompressQueued(bCompress);
+	}
+}
+
+void CDX11VideoProcessor::UpdateStatsSubtitles()
+{
+	const uint64_t tick = GetPreciseTick();
+	const uint64_t interval = tick - m_subsIntervalTick;
+	if (interval < GetPreciseTicksPerSecondI()) {
+		return;
+	}
+	m_subsIntervalTick = tick;
+
+	uint64_t uploadedBytes = 0, skippedUploads = 0;
+	if (m_pSubPicAllocator) {
+		m_pSubPicAllocator->GetUploadStats(uploadedBytes, skippedUploads);
+	}
+	if (uploadedBytes < m_subsUploadedBytes || skippedUploads < m_subsSkippedUploads) {
+		// a new allocator
+		m_subsUploadedBytes = 0;
+		m_subsSkippedUploads = 0;
+	}
+
+	const uint64_t trimmedPixels = CDX11SubPic::GetTrimmedPixels();
+	SubPicPoolData_t pool = {};
+	if (m_pSubPicAllocator) {
+		m_pSubPicAllocator->GetStats(pool);
+	}
+
+	const uint64_t blendedFrames = m_subsBlendedFrames - m_subsBlendedFramesPrev;
+	if (uploadedBytes == m_subsUploadedBytes && skippedUploads == m_subsSkippedUploads && !blendedFrames) {
+		m_strStatsSubtitles.clear();
+	} else {
+		const double seconds = interval * GetPreciseSecondsPerTick();
+		m_strStatsSubtitles = std::format(L"\nSubtitles     : upload {:.2f} MiB/s, unchanged {:.0f}/s, trimmed {:.1f} Mpx/s",
+			(uploadedBytes - m_subsUploadedBytes) / seconds / 1048576.0,
+			(skippedUploads - m_subsSkippedUploads) / seconds,
+			(trimmedPixels - m_subsTrimmedPixels) / seconds / 1000000.0);
+		m_strStatsSubtitles += std::format(L", buffers {:.0f}+{:.0f} MiB",
+			pool.usedBytes / 1048576.0, pool.freeBytes / 1048576.0);
+		if (pool.uncompressedBytes) {
+			m_strStatsSubtitles += std::format(L", compressed {:.1f}/{:.1f} MiB, decode {:.1f} ms/s",
+				pool.compressedBytes / 1048576.0, pool.uncompressedBytes / 1048576.0,
+				(pool.decodeTime - m_subsDecodeTime) / seconds);
+		}
+		if (blendedFrames) {
+			m_strStatsSubtitles += std::format(L", blended in copy {:.0f}/s", blendedFrames / seconds);
+		}
+	}
+
+	// the queue since it was created
+	SubPicQueueStats_t queue = {};
+	if (CComQIPtr<ISubPicQueueStats> pQueueStats = m_pFilter->m_pSubPicQueue.p) {
+		pQueueStats->GetQueueStats(queue);
+	}
+	if (queue.lookups) {
+		// a line is cut after CStatsText::kLineSize characters
+		m_strStatsSubtitles += std::format(L"\nSubtitle queue: lookups {}, reused {}, empty {}, blocking {} {:.1f}/{:.1f} ms, render {:.1f}/{:.1f} ms",
+			queue.lookups, queue.reused, queue.empty, queue.blocking, queue.blockingTime.p95, queue.blockingTime.max,
+			queue.renderTime.p50, queue.renderTime.p95);
+		if (queue.maxSubPics) {
+			uint64_t samples = 0, sum = 0;
+			for (unsigned i = 0; i < SubPicQueueStats_t::kOccupancyBuckets; i++) {
+				samples += queue.occupancy[i];
+				sum += queue.occupancy[i] * i;
+			}
+			m_strStatsSubtitles += std::format(L"\nQueue ahead   : {:.0f}/{:.0f} ms, size {:.1f}/{}, late {}, dropped {}+{}",
+				queue.margin.p50, queue.margin.max, samples ? (double)sum / samples : 0.0, queue.maxSubPics,
+				queue.late, queue.dropped, queue.expired);
+		}
+	}
+
+	m_subsUploadedBytes = uploadedBytes;
+	m_subsSkippedUploads = skippedUploads;
+	m_subsTrimmedPixels = trimmedPixels;
+	m_subsDecodeTime = pool.decodeTime;
+	m_subsBlendedFramesPrev = m_subsBlendedFrames;
+}
+
 void CDX11VideoProcessor::UpdateStatsPresent()
 {
 	DXGI_SWAP_CHAIN_DESC1 swapchain_desc;
@@ -4373,100 +5008,131 @@ HRESULT CDX11VideoProcessor::DrawStats(ID3D11Texture2D* pRenderTarget)
 	if (m_windowRect.IsRectEmpty()) {
 		return E_ABORT;
 	}
+	STAGE_SCOPE(STAGE_DrawStats);
 
-	std::wstring str;
-	str.reserve(700);
-	str.assign(m_strStatsHeader);
-	str.append(m_strStatsDispInfo);
-	str += std::format(L"\nGraph. Adapter: {}", m_strAdapterDescription);
+	auto& text = m_StatsText;
+	text.Begin();
+	text.Append(m_strStatsHeader);
+	text.Append(m_strStatsDispInfo);
+	text.Append(L"\nGraph. Adapter: ").Append(m_strAdapterDescription);
 
 	wchar_t frametype = (m_SampleFormat != D3D11_VIDEO_FRAME_FORMAT_PROGRESSIVE) ? 'i' : 'p';
-	str += std::format(
-		L"\nFrame rate    : {:7.3f}{},{:7.3f}",
-		m_pFilter->m_FrameStats.GetAverageFps(),
-		frametype,
-		m_pFilter->m_DrawStats.GetAverageFps()
-	);
-
-	str.append(m_strStatsInputFmt);
+	text.Append(L"\nFrame rate    : ").AppendFixed(m_pFilter->m_FrameStats.GetAverageFps(), 3, 7).Append(frametype);
+	text.Append(L',').AppendFixed(m_pFilter->m_DrawStats.GetAverageFps(), 3, 7);
+	double refreshRate, refreshRateError;
+	if (m_RefreshEstimator.GetRate(refreshRate, refreshRateError)) {
+		text.Append(L", display ").AppendFixed(refreshRate, 4).Append(L'\u00B1').AppendFixed(refreshRateError, 4);
+	}
+
+	text.Append(m_strStatsInputFmt);
 	if (m_Dovi.bValid && m_Dovi.bHasMMR) {
-		str.append(L", MMR");
+		text.Append(L", MMR");
 	}
-	str.append(m_strStatsVProc);
+	text.Append(m_strStatsVProc);
 
 	const UINT dstW = m_videoRect.Width();
 	const UINT dstH = m_videoRect.Height();
+	text.Append(L"\nScaling       : ").AppendInt(m_srcRectWidth).Append(L'x').AppendInt(m_srcRectHeight);
 	if (m_iRotation) {
-		str += std::format(L"\nScaling       : {}x{} r{}\u00B0> {}x{}", m_srcRectWidth, m_srcRectHeight, m_iRotation, dstW, dstH);
+		text.Append(L" r").AppendInt(m_iRotation).Append(L"\u00B0> ");
 	} else {
-		str += std::format(L"\nScaling       : {}x{} -> {}x{}", m_srcRectWidth, m_srcRectHeight, dstW, dstH);
+		text.Append(L" -> ");
 	}
+	text.AppendInt(dstW).Append(L'x').AppendInt(dstH);
 	if (m_srcRectWidth != dstW || m_srcRectHeight != dstH) {
 		if (m_D3D11VP.IsReady() && m_bVPScaling && !m_bVPScalingUseShaders) {
-			str.append(L" D3D11");
+			text.Append(L" D3D11");
 			if (m_bVPUseSuperRes && m_srcRectWidth < dstW && m_srcRectHeight < dstH) {
-				str.append(L" SuperResolution*");
+				text.Append(L" SuperResolution*");
 			}
 		} else {
-			str += L' ';
+			text.Append(L' ');
 			if (m_strShaderX) {
-				str.append(m_strShaderX);
+				text.Append(m_strShaderX);
 				if (m_strShaderY && m_strShaderY != m_strShaderX) {
-					str += L'/';
-					str.append(m_strShaderY);
+					text.Append(L'/').Append(m_strShaderY);
 				}
 			} else if (m_strShaderY) {
-				str.append(m_strShaderY);
+				text.Append(m_strShaderY);
 			}
 		}
 	}
 
 	if (m_strCorrection || m_pPostScaleShaders.size() || m_bDitherUsed) {
-		str.append(L"\nPostProcessing:");
+		text.Append(L"\nPostProcessing:");
 		if (m_strCorrection) {
-			str += std::format(L" {},", m_strCorrection);
+			text.Append(L' ').Append(m_strCorrection).Append(L',');
 		}
 		if (m_pPostScaleShaders.size()) {
-			str += std::format(L" shaders[{}],", m_pPostScaleShaders.size());
+			text.Append(L" shaders[").AppendInt(m_pPostScaleShaders.size());
+			if (m_PostScalePasses.size() < m_pPostScaleShaders.size()) {
+				text.Append(L" in ").AppendInt(m_PostScalePasses.size()).Append(L" passes");
+			}
+			text.Append(L"],");
 		}
 		if (m_bDitherUsed) {
-			str.append(L" dither");
+			text.Append(L" dither");
 		}
-		str_trim_end(str, ',');
+		text.TrimEnd(',');
+	}
+	if (m_RenderGraph.GetPhysicalCount()) {
+		const auto& poolStats = m_TexPool.GetStats();
+		text.Append(L"\nIntermediates : ").AppendInt(m_RenderGraph.GetPhysicalCount());
+		text.Append(L" tex ").AppendFixed(poolStats.bytes / 1048576.0, 0).Append(L" MiB");
+		text.Append(L", peak ").AppendFixed(m_RenderGraph.GetPeakBytes() / 1048576.0, 0);
+		text.Append(L", new ").AppendInt(poolStats.created);
+		text.Append(L", reused ").AppendInt(poolStats.reused);
+	}
+	text.Append(m_strStatsHDR);
+	text.Append(m_strStatsPresent);
+	if (m_bAdjustPresentTime && m_Cadence.IsLocked()) {
+		// appended to the "Frame sync" line
+		text.Append(L", cadence ").Append(m_Cadence.GetCadenceString());
+		text.Append(L" +").AppendInt(m_Cadence.GetRepeats()).Append(L"/-").AppendInt(m_Cadence.GetDrops());
 	}
-	str.append(m_strStatsHDR);
-	str.append(m_strStatsPresent);
 
-	str += std::format(L"\nFrames        : {:5}, skipped: {}/{}, failed: {}",
-		m_pFilter->m_FrameStats.GetFrames(), m_pFilter->m_DrawStats.m_dropped, m_RenderStats.dropped2, m_RenderStats.failed);
+	text.Append(L"\nFrames        : ").AppendInt(m_pFilter->m_FrameStats.GetFrames(), 5);
+	text.Append(L", skipped: ").AppendInt(m_pFilter->m_DrawStats.m_dropped).Append(L'/').AppendInt(m_RenderStats.dropped2);
+	text.Append(L", failed: ").AppendInt(m_RenderStats.failed);
+	if (const auto& cadence = m_pFilter->m_FrameStats.GetCadence(); cadence.GetCadence() > CFrameCadenceDetector::Cadence_Progressive) {
+		text.Append(L", ").Append(cadence.GetPatternString());
+		if (cadence.IsLocked()) {
+			text.Append(L' ').AppendFixed((double)UNITS / cadence.GetFilmDuration(), 3);
+		}
+	}
 
-	str += std::format(L"\nTimes(ms)     : Copy{:3}, Paint{:3}, Present{:3}",
-		m_RenderStats.copyticks    * 1000 / GetPreciseTicksPerSecondI(),
-		m_RenderStats.paintticks   * 1000 / GetPreciseTicksPerSecondI(),
-		m_RenderStats.presentticks * 1000 / GetPreciseTicksPerSecondI());
+#if STAGE_TIMERS
+	UpdateStatsStages();
+	text.Append(m_strStatsStages);
+#else
+	text.Append(L"\nTimes(ms)     : Copy").AppendInt(m_RenderStats.copyticks * 1000 / GetPreciseTicksPerSecondI(), 3);
+	text.Append(L", Paint").AppendInt(m_RenderStats.paintticks * 1000 / GetPreciseTicksPerSecondI(), 3);
+	text.Append(L", Present").AppendInt(m_RenderStats.presentticks * 1000 / GetPreciseTicksPerSecondI(), 3);
+#endif
+	UpdateStatsSubtitles();
+	text.Append(m_strStatsSubtitles);
 
-	str += std::format(L"\nSync offset   : {:+3} ms", (m_RenderStats.syncoffset + 5000) / 10000);
+	text.Append(L"\nSync offset   : ").AppendInt((m_RenderStats.syncoffset + 5000) / 10000, 3, true).Append(L" ms");
+	if (m_SyncOffsetStats.Count() > 1) {
+		text.Append(L", avg").AppendFixed(m_SyncOffsetStats.Mean() / 10000, 1, 5, true);
+		text.Append(L", dev").AppendFixed(m_SyncOffsetStats.StdDev() / 10000, 1, 5);
+		text.Append(L", jitter").AppendFixed(m_PresentJitter.StdDev() / 10000, 2, 5);
+	}
 
 #if SYNC_OFFSET_EX
 	{
 		const auto [so_min, so_max] = m_Syncs.MinMax();
 		const auto [sod_min, sod_max] = m_SyncDevs.MinMax();
-		str += std::format(L", range[{:+3.0f};{:+3.0f}], max change{:+3.0f}/{:+3.0f}",
-			so_min / 10000.0f,
-			so_max / 10000.0f,
-			sod_min / 10000.0f,
-			sod_max / 10000.0f);
+		text.Append(L", range[").AppendFixed(so_min / 10000.0f, 0, 3, true).Append(L';').AppendFixed(so_max / 10000.0f, 0, 3, true);
+		text.Append(L"], max change").AppendFixed(sod_min / 10000.0f, 0, 3, true).Append(L'/').AppendFixed(sod_max / 10000.0f, 0, 3, true);
 	}
 #endif
-#if TEST_TICKS
-	str += std::format(L"\n1:{:6.3f}, 2:{:6.3f}, 3:{:6.3f}, 4:{:6.3f}, 5:{:6.3f}, 6:{:6.3f} ms",
-		m_RenderStats.t1 * 1000 / GetPreciseTicksPerSecond(),
-		m_RenderStats.t2 * 1000 / GetPreciseTicksPerSecond(),
-		m_RenderStats.t3 * 1000 / GetPreciseTicksPerSecond(),
-		m_RenderStats.t4 * 1000 / GetPreciseTicksPerSecond(),
-		m_RenderStats.t5 * 1000 / GetPreciseTicksPerSecond(),
-		m_RenderStats.t6 * 1000 / GetPreciseTicksPerSecond());
-#endif
+	text.End();
+
+	if (text.GetLineCount() != m_StatsLines) {
+		m_StatsLines = text.GetLineCount();
+		CalcStatsParams();
+	}
 
 	ID3D11RenderTargetView* pRenderTargetView = nullptr;
 	HRESULT hr = m_pDevice->CreateRenderTargetView(pRenderTarget, nullptr, &pRenderTargetView);
@@ -4475,7 +5141,7 @@ HRESULT CDX11VideoProcessor::DrawStats(ID3D11Texture2D* pRenderTarget)
 
 		m_StatsBackground.Draw(pRenderTargetView, rtSize);
 
-		hr = m_Font3D.Draw2DText(pRenderTargetView, rtSize, m_StatsTextPoint.x, m_StatsTextPoint.y, m_dwStatsTextColor, str.c_str());
+		hr = m_Font3D.Draw2DLines(pRenderTargetView, rtSize, m_StatsTextPoint.x, m_StatsTextPoint.y, m_dwStatsTextColor, text);
 		static int col = m_StatsRect.right;
 		if (--col < m_StatsRect.left) {
 			col = m_StatsRect.right;
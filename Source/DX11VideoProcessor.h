@@ -28,10 +28,12 @@
 #include "IVideoRenderer.h"
 #include "DX11Helper.h"
 #include "D3D11VP.h"
+#include "RenderGraph.h"
 #include "D3DUtil/D3D11Font.h"
 #include "D3DUtil/D3D11Geometry.h"
 #include "VideoProcessor.h"
 #include "SubPic/DX11SubPic.h"
+#include "SubtitleBlend.h"
 
 #include <atomic>
 
@@ -69,10 +71,18 @@ private:
 
 	Tex11Video_t m_TexSrcVideo; // for copy of frame
 	Tex2D_t m_TexConvertOutput;
-	Tex2D_t m_TexResize;        // for intermediate result of two-pass resize
-	CTex2DRing m_TexsPostScale;
+	CTex2DPool m_TexPool;       // for m_RenderGraphTexs, they can be larger than needed
 	Tex2D_t m_TexDither;
 
+	// plan of the render passes, it is executed by Process()
+	CRenderGraph m_RenderGraph;
+	std::vector<Tex2D_t> m_RenderGraphTexs; // physical textures of m_RenderGraph
+	int m_RenderGraphConvertTex = CRenderGraph::External; // m_TexConvertOutput in m_RenderGraph
+	CRect m_RenderGraphSrcRect; // source rectangle of the resize passes
+	int m_RenderGraphRotation = 0;
+	CComPtr<ID3D11PixelShader> m_RenderGraphResizerX; // the resize passes were planned for these shaders
+	CComPtr<ID3D11PixelShader> m_RenderGraphResizerY;
+
 	// for GetAlignmentSize()
 	struct Alignment_t {
 		Tex11Video_t texture;
@@ -128,6 +138,10 @@ private:
 
 	CComPtr<ID3D11Buffer> m_pDoviCurvesConstantBuffer;
 
+	CComPtr<ID3D11Texture3D> m_pGamutLutTexture;
+	CComPtr<ID3D11ShaderResourceView> m_pGamutLutSRV;
+	mp_csp_prim m_GamutLutPrim = MP_CSP_PRIM_AUTO;
+
 	CComPtr<ID3D11PixelShader> m_pShaderUpscaleX;
 	CComPtr<ID3D11PixelShader> m_pShaderUpscaleY;
 	CComPtr<ID3D11PixelShader> m_pShaderDownscaleX;
@@ -135,6 +149,8 @@ private:
 
 	std::vector<ExternalPixelShader11_t> m_pPreScaleShaders;
 	std::vector<ExternalPixelShader11_t> m_pPostScaleShaders;
+	std::vector<ExternalPixelShader11_t> m_PostScalePasses; // post-scale shaders with fused pointwise shaders
+	std::map<std::string, CComPtr<ID3D11PixelShader>> m_FusedShaders; // compiled fused shaders by their code
 	CComPtr<ID3D11Buffer> m_pPostScaleConstants;
 	CComPtr<ID3D11PixelShader> m_pPSHalfOUtoInterlace;
 	CComPtr<ID3D11PixelShader> m_pPSFinalPass;
@@ -242,6 +258,28 @@ private:
 
 	// SubPic
 	CComPtr<CDX11SubPicAllocator> m_pSubPicAllocator;
+	std::wstring m_strStatsSubtitles; // subtitle upload of the last second and the subtitle queue
+	uint64_t m_subsIntervalTick = 0;
+	uint64_t m_subsUploadedBytes = 0;
+	uint64_t m_subsSkippedUploads = 0;
+	uint64_t m_subsTrimmedPixels = 0;
+	UINT64 m_subPicPoolLimit = CMemPicPool::kDefaultLimit;
+	bool m_bSubPicCompression = false;
+	double m_subsDecodeTime = 0;
+	// subtitles blended into the frame when it is copied from system memory
+	bool m_bSubsBlendInCopy = false;
+	CSubtitleBlender m_SubBlender;
+	CComPtr<ISubPic> m_pBlendedSubPic; // DrawSubtitles() skips this subpic
+	uint64_t m_blendedVersion = 0;
+	CRect m_blendedSource;
+	CRect m_blendedDest;
+	CRect m_blendedSrcRect;
+	CRect m_blendedVideoRect;
+	CComPtr<ISubPic> m_pFrameSubPic; // the lookup of PrepareSubtitleBlend() for the next Render()
+	bool m_bFrameSubPic = false;
+	std::vector<uint32_t> m_subsBlendPixels;
+	uint64_t m_subsBlendedFrames = 0;
+	uint64_t m_subsBlendedFramesPrev = 0;
 	bool m_bCallbackDeviceIsSet = false;
 	void SetCallbackDevice();
 	void UpdateSubPic();
@@ -285,7 +323,11 @@ private:
 
 	void CalcStatsParams() override;
 
+	void PrepareSubtitleBlend();
 	HRESULT MemCopyToTexSrcVideo(const BYTE* srcData, const int srcPitch);
+	CComPtr<ISubPic> TakeFrameSubPic();
+	bool IsBlendedSubPic(ISubPic* pSubPic);
+	HRESULT RestoreTexSrcVideo();
 
 	bool Preferred10BitOutput() {
 		return m_DisplayBitsPerChannel >= 10 && (m_InternalTexFmt == DXGI_FORMAT_R10G10B10A2_UNORM || m_InternalTexFmt == DXGI_FORMAT_R16G16B16A16_FLOAT);
@@ -326,6 +368,7 @@ public:
 	void Configure(const Settings_t& config) override;
 
 	void SetRotation(int value) override;
+	void SetFlip(bool value) override;
 	void SetStereo3dTransform(int value) override;
 
 	void Flush() override;
@@ -337,23 +380,30 @@ public:
 	HRESULT AddPostScaleShader(const std::wstring& name, const std::string& srcCode) override;
 
 	ISubPicAllocator* GetSubPicAllocator() override;
+	HRESULT GetSubPicPoolStats(BYTE** ppData, unsigned* pSize) override;
+	void SetSubPicPoolLimit(const UINT64 limit) override;
+	void SetSubPicCompression(const bool bCompress) override;
+	void SetSubtitlesBlendInCopy(const bool bBlend) override;
 
 	void SwitchFullScreen(bool set) override;
 
 private:
 	void UpdateTexures();
 	void UpdatePostScaleTexures();
+	void UpdateRenderGraph();
+	void UpdatePostScalePasses();
 	void UpdateUpscalingShaders();
 	void UpdateDownscalingShaders();
+	HRESULT UpdateGamutLut(const mp_csp_prim csp_in);
 	HRESULT UpdateConvertColorShader();
 	void UpdateBitmapShader();
 
 	HRESULT D3D11VPPass(ID3D11Texture2D* pRenderTarget, const CRect& srcRect, const CRect& dstRect, const bool second);
 	HRESULT ConvertColorPass(ID3D11Texture2D* pRenderTarget);
-	HRESULT ResizeShaderPass(const Tex2D_t& Tex, ID3D11Texture2D* pRenderTarget, const CRect& srcRect, const CRect& dstRect, const int rotation);
+	void SelectResizers(const CSize& srcSize, const CSize& dstSize, const int rotation, ID3D11PixelShader*& resizerX, ID3D11PixelShader*& resizerY);
 	HRESULT FinalPass(const Tex2D_t& Tex, ID3D11Texture2D* pRenderTarget, const CRect& srcRect, const CRect& dstRect);
 
-	void DrawSubtitles(ID3D11Texture2D* pRenderTarget);
+	void DrawSubtitles(ID3D11Texture2D* pRenderTarget, ISubPic* pSubPic);
 	HRESULT Process(ID3D11Texture2D* pRenderTarget, const CRect& srcRect, const CRect& dstRect, const bool second);
 
 	HRESULT AlphaBlt(ID3D11ShaderResourceView* pShaderResource, ID3D11Texture2D* pRenderTarget,
@@ -370,6 +420,8 @@ private:
 								const int iRotation, const bool bFlip);
 
 	void UpdateStatsPresent();
+	// Updates m_strStatsSubtitles once a second
+	void UpdateStatsSubtitles();
 	void UpdateStatsStatic() override;
 	//void UpdateStatsPostProc();
 	HRESULT DrawStats(ID3D11Texture2D* pRenderTarget);
@@ -688,6 +688,7 @@ void CDX9VideoProcessor::ReleaseVP()
 
 	m_pFilter->ResetStreamingTimes2();
 	m_RenderStats.Reset();
+	ResetPresentStats();
 
 	m_DXVA2VP.ReleaseVideoProcessor();
 	m_strCorrection = nullptr;
@@ -1002,10 +1003,10 @@ void CDX9VideoProcessor::UpdateScalingStrings()
 void CDX9VideoProcessor::CalcStatsParams()
 {
 	if (m_pD3DDevEx && !m_windowRect.IsRectEmpty()) {
-		if (S_OK == m_Font3D.CreateFontBitmap(L"Consolas", m_StatsFontH, 0)) {
+		if (SUCCEEDED(m_Font3D.CreateFontBitmap(L"Consolas", m_StatsFontH, 0))) {
 			SIZE charSize = m_Font3D.GetMaxCharMetric();
 			m_StatsRect.right  = m_StatsRect.left + 61 * charSize.cx + 5 + 3;
-			m_StatsRect.bottom = m_StatsRect.top + 19 * charSize.cy + 5 + 3;
+			m_StatsRect.bottom = m_StatsRect.top + m_StatsLines * charSize.cy + 5 + 3;
 			m_StatsBackground.Set(m_StatsRect, D3DCOLOR_ARGB(80, 0, 0, 0));
 		}
 
@@ -1283,18 +1284,21 @@ HRESULT CDX9VideoProcessor::ProcessSample(IMediaSample* pSample)
 
 	// always Render(1) a frame after CopySample()
 	hr = Render(1, rtStart);
-	m_pFilter->m_DrawStats.Add(GetPreciseTick());
+	const uint64_t tick = GetPreciseTick();
 	if (m_pFilter->m_filterState == State_Running) {
 		m_pFilter->StreamTime(rtClock);
 	}
 
-	m_RenderStats.syncoffset = rtClock - rtStart;
-
-	int so = (int)std::clamp(m_RenderStats.syncoffset, -UNITS, UNITS);
-#if SYNC_OFFSET_EX
-	m_SyncDevs.Add(so - m_Syncs.Last());
-#endif
-	m_Syncs.Add(so);
+	// S_FALSE - the cadence planner skipped the frame, it was not presented
+	if (hr != S_FALSE) {
+		m_pFilter->m_DrawStats.Add(tick);
+		if (m_pFilter->m_ReceiveTick) {
+			m_LatencyHists[LATENCY_ReceiveToPresent].Add(tick - m_pFilter->m_ReceiveTick);
+		}
+		m_RenderStats.syncoffset = rtClock - rtStart;
+		AddSyncOffset(m_RenderStats.syncoffset, tick);
+	}
+	m_pFilter->m_ReceiveTick = 0;
 
 	if (m_bDoubleFrames) {
 		if (rtEnd < rtClock) {
@@ -1305,18 +1309,16 @@ HRESULT CDX9VideoProcessor::ProcessSample(IMediaSample* pSample)
 		rtStart += rtFrameDur / 2;
 
 		hr = Render(2, rtStart);
-		m_pFilter->m_DrawStats.Add(GetPreciseTick());
-		if (m_pFilter->m_filterState == State_Running) {
-			m_pFilter->StreamTime(rtClock);
-		}
-
-		m_RenderStats.syncoffset = rtClock - rtStart;
+		if (hr != S_FALSE) {
+			const uint64_t tick2 = GetPreciseTick();
+			m_pFilter->m_DrawStats.Add(tick2);
+			if (m_pFilter->m_filterState == State_Running) {
+				m_pFilter->StreamTime(rtClock);
+			}
 
-		so = (int)std::clamp(m_RenderStats.syncoffset, -UNITS, UNITS);
-#if SYNC_OFFSET_EX
-		m_SyncDevs.Add(so - m_Syncs.Last());
-#endif
-		m_Syncs.Add(so);
+			m_RenderStats.syncoffset = rtClock - rtStart;
+			AddSyncOffset(m_RenderStats.syncoffset, tick2);
+		}
 	}
 
 	return hr;
@@ -1324,7 +1326,8 @@ HRESULT CDX9VideoProcessor::ProcessSample(IMediaSample* pSample)
 
 HRESULT CDX9VideoProcessor::CopySample(IMediaSample* pSample)
 {
-	uint64_t tick = GetPreciseTick();
+	FRAMETRACE_SCOPE("CopySample");
+	CStageScope<STAGE_CopySample> copyScope(m_StageTimers);
 
 	// Get frame type
 	m_CurrentSampleFmt = DXVA2_SampleProgressiveFrame; // Progressive
@@ -1361,6 +1364,8 @@ HRESULT CDX9VideoProcessor::CopySample(IMediaSample* pSample)
 			MediaSideDataDOVIMetadata* pDOVIMetadata = nullptr;
 			hr = pMediaSideData->GetSideData(IID_MediaSideDataDOVIMetadataV2, (const BYTE**)&pDOVIMetadata, &size);
 			if (SUCCEEDED(hr) && size == sizeof(MediaSideDataDOVIMetadata) && CheckDoviMetadata(pDOVIMetadata, 0)) {
+				FRAMETRACE_SCOPE("DoVi metadata");
+				STAGE_SCOPE(STAGE_DoviParse);
 				const bool bYCCtoRGBChanged = !m_PSConvColorData.bEnable ||
 					(memcmp(
 						&m_Dovi.msd.ColorMetadata.ycc_to_rgb_matrix,
@@ -1525,7 +1530,8 @@ HRESULT CDX9VideoProcessor::CopySample(IMediaSample* pSample)
 		UpdateStatsStatic();
 	}
 
-	m_RenderStats.copyticks = GetPreciseTick() - tick;
+	m_RenderStats.copyticks = copyScope.Stop();
+	m_LatencyHists[LATENCY_Copy].Add(m_RenderStats.copyticks);
 
 	return hr;
 }
@@ -1600,8 +1606,9 @@ HRESULT CDX9VideoProcessor::Render(int field, const REFERENCE_TIME frameStartTim
 #endif
 	hr = m_pD3DDevEx->EndScene();
 
-	uint64_t tick2 = GetPreciseTick();
-	m_RenderStats.paintticks = tick2 - tick1;
+	m_RenderStats.paintticks = GetPreciseTick() - tick1;
+	m_LatencyHists[LATENCY_Paint].Add(m_RenderStats.paintticks);
+	CStageScope<STAGE_Present> presentScope(m_StageTimers);
 
 	if (m_bVBlankBeforePresent) {
 		hr = m_pD3DDevEx->WaitForVBlank(0);
@@ -1609,9 +1616,13 @@ HRESULT CDX9VideoProcessor::Render(int field, const REFERENCE_TIME frameStartTim
 	}
 
 	if (m_bAdjustPresentTime) {
-		SyncFrameToStreamTime(frameStartTime);
+		if (!SyncFrameToStreamTime(frameStartTime)) {
+			presentScope.Cancel();
+			return S_FALSE; // the cadence planner drops the frame to absorb the clock difference
+		}
 	}
 
+	g_FrameTrace.Add("Present", 'B');
 	if (m_d3dpp.SwapEffect == D3DSWAPEFFECT_DISCARD) {
 		const CRect rSrcPri(CPoint(0, 0), windowSize);
 		const CRect rDstPri(m_windowRect);
@@ -1619,7 +1630,21 @@ HRESULT CDX9VideoProcessor::Render(int field, const REFERENCE_TIME frameStartTim
 	} else {
 		hr = m_pD3DDevEx->PresentEx(nullptr, nullptr, nullptr, nullptr, 0);
 	}
-	m_RenderStats.presentticks = GetPreciseTick() - tick2;
+	g_FrameTrace.Add("Present", 'E');
+	m_RenderStats.presentticks = presentScope.Stop();
+	m_LatencyHists[LATENCY_Present].Add(m_RenderStats.presentticks);
+
+	if (SUCCEEDED(hr) && m_DisplayMode.Height && m_rtRefreshPeriod) {
+		// D3D9 has no vsync time stamps, the scan line gives the time since the vsync
+		D3DRASTER_STATUS rasterStatus;
+		if (SUCCEEDED(m_pD3DDevEx->GetRasterStatus(0, &rasterStatus))) {
+			LARGE_INTEGER qpc, freq;
+			QueryPerformanceCounter(&qpc);
+			QueryPerformanceFrequency(&freq);
+			const REFERENCE_TIME timeSinceVsync = rasterStatus.InVBlank ? 0 : m_rtRefreshPeriod * rasterStatus.ScanLine / m_DisplayMode.Height;
+			AddVsyncObservation(qpc.QuadPart - llMulDiv(timeSinceVsync, freq.QuadPart, UNITS, 0), 0);
+		}
+	}
 
 #ifdef _DEBUG
 	if (FAILED(hr) || hr == S_PRESENT_OCCLUDED || hr == S_PRESENT_MODE_CHANGED) {
@@ -2253,7 +2278,7 @@ HRESULT CDX9VideoProcessor::UpdateConvertColorShader()
 			m_srcWidth,
 			m_TexSrcVideo.Width, m_TexSrcVideo.Height,
 			m_srcRect, m_srcParams, m_srcExFmt, pDOVIMetadata,
-			m_iChromaScaling, convertType, false,
+			m_iChromaScaling, convertType, false, MP_CSP_PRIM_AUTO,
 			&pShaderCode);
 		if (S_OK == hr) {
 			hr = m_pD3DDevEx->CreatePixelShader((const DWORD*)pShaderCode->GetBufferPointer(), &m_pPSConvertColor);
@@ -2265,7 +2290,7 @@ HRESULT CDX9VideoProcessor::UpdateConvertColorShader()
 				m_srcWidth,
 				m_TexSrcVideo.Width, m_TexSrcVideo.Height,
 				m_srcRect, m_srcParams, m_srcExFmt, pDOVIMetadata,
-				m_iChromaScaling, convertType, true,
+				m_iChromaScaling, convertType, true, MP_CSP_PRIM_AUTO,
 				&pShaderCode);
 			if (S_OK == hr) {
 				hr = m_pD3DDevEx->CreatePixelShader((const DWORD*)pShaderCode->GetBufferPointer(), &m_pPSConvertColorDeint);
@@ -2368,6 +2393,8 @@ HRESULT CDX9VideoProcessor::UpdateConvertColorShader()
 
 HRESULT CDX9VideoProcessor::DxvaVPPass(IDirect3DSurface9* pRenderTarget, const CRect& srcRect, const CRect& dstRect, const bool second)
 {
+	FRAMETRACE_SCOPE("DxvaVPPass");
+	STAGE_SCOPE(STAGE_VPPass);
 	m_DXVA2VP.SetRectangles(srcRect, dstRect);
 
 	return m_DXVA2VP.Process(pRenderTarget, m_CurrentSampleFmt, second);
@@ -2375,6 +2402,8 @@ HRESULT CDX9VideoProcessor::DxvaVPPass(IDirect3DSurface9* pRenderTarget, const C
 
 HRESULT CDX9VideoProcessor::ConvertColorPass(IDirect3DSurface9* pRenderTarget)
 {
+	FRAMETRACE_SCOPE("ConvertColorPass");
+	STAGE_SCOPE(STAGE_ConvertPass);
 	HRESULT hr = m_pD3DDevEx->SetRenderTarget(0, pRenderTarget);
 
 	float fConstDataHDR[][4] = {
@@ -2445,6 +2474,8 @@ HRESULT CDX9VideoProcessor::ConvertColorPass(IDirect3DSurface9* pRenderTarget)
 
 HRESULT CDX9VideoProcessor::ResizeShaderPass(IDirect3DTexture9* pTexture, IDirect3DSurface9* pRenderTarget, const CRect& srcRect, const CRect& dstRect)
 {
+	FRAMETRACE_SCOPE("ResizeShaderPass");
+	STAGE_SCOPE(STAGE_ResizePass);
 	HRESULT hr = S_OK;
 	const int w2 = dstRect.Width();
 	const int h2 = dstRect.Height();
@@ -2538,6 +2569,8 @@ HRESULT CDX9VideoProcessor::ResizeShaderPass(IDirect3DTexture9* pTexture, IDirec
 
 HRESULT CDX9VideoProcessor::FinalPass(IDirect3DTexture9* pTexture, IDirect3DSurface9* pRenderTarget, const CRect& srcRect, const CRect& dstRect)
 {
+	FRAMETRACE_SCOPE("FinalPass");
+	STAGE_SCOPE(STAGE_FinalPass);
 	HRESULT hr = m_pD3DDevEx->SetRenderTarget(0, pRenderTarget);
 
 	D3DSURFACE_DESC desc;
@@ -2595,6 +2628,7 @@ HRESULT CDX9VideoProcessor::FinalPass(IDirect3DTexture9* pTexture, IDirect3DSurf
 void CDX9VideoProcessor::DrawSubtitles(IDirect3DSurface9* pRenderTarget)
 {
 	HRESULT hr = S_OK;
+	CStageScope<STAGE_DrawSubtitles> subsScope(m_StageTimers);
 
 	CComPtr<ISubPic> pSubPic = m_pFilter->GetSubPic(m_rtStart);
 	if (pSubPic) {
@@ -2612,10 +2646,8 @@ void CDX9VideoProcessor::DrawSubtitles(IDirect3DSurface9* pRenderTarget)
 				hr_ec = m_pD3DDevEx->BeginScene();
 			}
 		}
-		return;
 	}
-
-	if (m_pFilter->m_pSubCallBack) {
+	else if (m_pFilter->m_pSubCallBack) {
 		HRESULT hr_ec = m_pD3DDevEx->EndScene();
 
 		hr = m_pD3DDevEx->SetRenderTarget(0, pRenderTarget);
@@ -2637,10 +2669,19 @@ void CDX9VideoProcessor::DrawSubtitles(IDirect3DSurface9* pRenderTarget)
 			hr_ec = m_pD3DDevEx->BeginScene();
 		}
 	}
+	else {
+		subsScope.Cancel();
+		return;
+	}
+
+	m_RenderStats.substicks = subsScope.Stop();
+	m_LatencyHists[LATENCY_Subtitles].Add(m_RenderStats.substicks);
 }
 
 HRESULT CDX9VideoProcessor::Process(IDirect3DSurface9* pRenderTarget, const CRect& srcRect, const CRect& dstRect, const bool second)
 {
+	FRAMETRACE_SCOPE("Process");
+	STAGE_SCOPE(STAGE_Process);
 	HRESULT hr = S_OK;
 	m_bDitherUsed = false;
 
@@ -2794,6 +2835,7 @@ HRESULT CDX9VideoProcessor::TextureCopyRect(
 	IDirect3DTexture9* pTexture, const CRect& srcRect, const CRect& dstRect,
 	D3DTEXTUREFILTERTYPE filter, const int iRotation, const bool bFlip)
 {
+	FRAMETRACE_SCOPE("TextureCopyRect");
 	HRESULT hr;
 
 	D3DSURFACE_DESC desc;
@@ -3054,101 +3096,118 @@ HRESULT CDX9VideoProcessor::DrawStats(IDirect3DSurface9* pRenderTarget)
 	if (m_windowRect.IsRectEmpty()) {
 		return E_ABORT;
 	}
+	STAGE_SCOPE(STAGE_DrawStats);
 
-	std::wstring str;
-	str.reserve(700);
-	str.assign(m_strStatsHeader);
-	str.append(m_strStatsDispInfo);
-	str += std::format(L"\nGraph. Adapter: {}", m_strAdapterDescription);
+	auto& text = m_StatsText;
+	text.Begin();
+	text.Append(m_strStatsHeader);
+	text.Append(m_strStatsDispInfo);
+	text.Append(L"\nGraph. Adapter: ").Append(m_strAdapterDescription);
 
 	wchar_t frametype = (m_CurrentSampleFmt >= DXVA2_SampleFieldInterleavedEvenFirst && m_CurrentSampleFmt <= DXVA2_SampleFieldSingleOdd) ? 'i' : 'p';
-	str += std::format(
-		L"\nFrame rate    : {:7.3f}{},{:7.3f}",
-		m_pFilter->m_FrameStats.GetAverageFps(),
-		frametype,
-		m_pFilter->m_DrawStats.GetAverageFps()
-	);
+	text.Append(L"\nFrame rate    : ").AppendFixed(m_pFilter->m_FrameStats.GetAverageFps(), 3, 7).Append(frametype);
+	text.Append(L',').AppendFixed(m_pFilter->m_DrawStats.GetAverageFps(), 3, 7);
+	double refreshRate, refreshRateError;
+	if (m_RefreshEstimator.GetRate(refreshRate, refreshRateError)) {
+		text.Append(L", display ").AppendFixed(refreshRate, 4).Append(L'\u00B1').AppendFixed(refreshRateError, 4);
+	}
 
-	str.append(m_strStatsInputFmt);
+	text.Append(m_strStatsInputFmt);
 
-	str.append(m_strStatsVProc);
+	text.Append(m_strStatsVProc);
 
 	const int dstW = m_videoRect.Width();
 	const int dstH = m_videoRect.Height();
+	text.Append(L"\nScaling       : ").AppendInt(m_srcRectWidth).Append(L'x').AppendInt(m_srcRectHeight);
 	if (m_iRotation) {
-		str += std::format(L"\nScaling       : {}x{} r{}\u00B0> {}x{}", m_srcRectWidth, m_srcRectHeight, m_iRotation, dstW, dstH);
+		text.Append(L" r").AppendInt(m_iRotation).Append(L"\u00B0> ");
 	} else {
-		str += std::format(L"\nScaling       : {}x{} -> {}x{}", m_srcRectWidth, m_srcRectHeight, dstW, dstH);
+		text.Append(L" -> ");
 	}
+	text.AppendInt(dstW).Append(L'x').AppendInt(dstH);
 	if (m_srcRectWidth != dstW || m_srcRectHeight != dstH) {
 		if (m_DXVA2VP.IsReady() && m_bVPScaling && !m_bVPScalingUseShaders) {
-			str.append(L" DXVA2");
+			text.Append(L" DXVA2");
 		} else {
-			str += L' ';
+			text.Append(L' ');
 			if (m_strShaderX) {
-				str.append(m_strShaderX);
+				text.Append(m_strShaderX);
 				if (m_strShaderY && m_strShaderY != m_strShaderX) {
-					str += L'/';
-					str.append(m_strShaderY);
+					text.Append(L'/').Append(m_strShaderY);
 				}
 			} else if (m_strShaderY) {
-				str.append(m_strShaderY);
+				text.Append(m_strShaderY);
 			}
 		}
 	}
 
 	if (m_strCorrection || m_pPostScaleShaders.size() || m_bDitherUsed) {
-		str.append(L"\nPostProcessing:");
+		text.Append(L"\nPostProcessing:");
 		if (m_strCorrection) {
-			str += std::format(L" {},", m_strCorrection);
+			text.Append(L' ').Append(m_strCorrection).Append(L',');
 		}
 		if (m_pPostScaleShaders.size()) {
-			str += std::format(L" shaders[{}],", m_pPostScaleShaders.size());
+			text.Append(L" shaders[").AppendInt(m_pPostScaleShaders.size()).Append(L"],");
 		}
 		if (m_bDitherUsed) {
-			str.append(L" dither");
+			text.Append(L" dither");
 		}
-		str_trim_end(str, ',');
+		text.TrimEnd(',');
+	}
+	text.Append(m_strStatsHDR);
+	text.Append(m_strStatsPresent);
+	if (m_bAdjustPresentTime && m_Cadence.IsLocked()) {
+		// appended to the "Frame sync" line
+		text.Append(L", cadence ").Append(m_Cadence.GetCadenceString());
+		text.Append(L" +").AppendInt(m_Cadence.GetRepeats()).Append(L"/-").AppendInt(m_Cadence.GetDrops());
 	}
-	str.append(m_strStatsHDR);
-	str.append(m_strStatsPresent);
 
-	str += std::format(L"\nFrames        : {:5}, skipped: {}/{}, failed: {}",
-		m_pFilter->m_FrameStats.GetFrames(), m_pFilter->m_DrawStats.m_dropped, m_RenderStats.dropped2, m_RenderStats.failed);
+	text.Append(L"\nFrames        : ").AppendInt(m_pFilter->m_FrameStats.GetFrames(), 5);
+	text.Append(L", skipped: ").AppendInt(m_pFilter->m_DrawStats.m_dropped).Append(L'/').AppendInt(m_RenderStats.dropped2);
+	text.Append(L", failed: ").AppendInt(m_RenderStats.failed);
+	if (const auto& cadence = m_pFilter->m_FrameStats.GetCadence(); cadence.GetCadence() > CFrameCadenceDetector::Cadence_Progressive) {
+		text.Append(L", ").Append(cadence.GetPatternString());
+		if (cadence.IsLocked()) {
+			text.Append(L' ').AppendFixed((double)UNITS / cadence.GetFilmDuration(), 3);
+		}
+	}
 
-	str += std::format(L"\nTimes(ms)     : Copy{:3}, Paint{:3}, Present{:3}",
-		m_RenderStats.copyticks    * 1000 / GetPreciseTicksPerSecondI(),
-		m_RenderStats.paintticks   * 1000 / GetPreciseTicksPerSecondI(),
-		m_RenderStats.presentticks * 1000 / GetPreciseTicksPerSecondI());
+#if STAGE_TIMERS
+	UpdateStatsStages();
+	text.Append(m_strStatsStages);
+#else
+	text.Append(L"\nTimes(ms)     : Copy").AppendInt(m_RenderStats.copyticks * 1000 / GetPreciseTicksPerSecondI(), 3);
+	text.Append(L", Paint").AppendInt(m_RenderStats.paintticks * 1000 / GetPreciseTicksPerSecondI(), 3);
+	text.Append(L", Present").AppendInt(m_RenderStats.presentticks * 1000 / GetPreciseTicksPerSecondI(), 3);
+#endif
 
-	str += std::format(L"\nSync offset   : {:+3} ms", (m_RenderStats.syncoffset + 5000) / 10000);
+	text.Append(L"\nSync offset   : ").AppendInt((m_RenderStats.syncoffset + 5000) / 10000, 3, true).Append(L" ms");
+	if (m_SyncOffsetStats.Count() > 1) {
+		text.Append(L", avg").AppendFixed(m_SyncOffsetStats.Mean() / 10000, 1, 5, true);
+		text.Append(L", dev").AppendFixed(m_SyncOffsetStats.StdDev() / 10000, 1, 5);
+		text.Append(L", jitter").AppendFixed(m_PresentJitter.StdDev() / 10000, 2, 5);
+	}
 
 #if SYNC_OFFSET_EX
 	{
 		const auto [so_min, so_max] = m_Syncs.MinMax();
 		const auto [sod_min, sod_max] = m_SyncDevs.MinMax();
-		str += std::format(L", range[{:+3.0f};{:+3.0f}], max change{:+3.0f}/{:+3.0f}",
-			so_min / 10000.0f,
-			so_max / 10000.0f,
-			sod_min / 10000.0f,
-			sod_max / 10000.0f);
+		text.Append(L", range[").AppendFixed(so_min / 10000.0f, 0, 3, true).Append(L';').AppendFixed(so_max / 10000.0f, 0, 3, true);
+		text.Append(L"], max change").AppendFixed(sod_min / 10000.0f, 0, 3, true).Append(L'/').AppendFixed(sod_max / 10000.0f, 0, 3, true);
 	}
 #endif
-#if TEST_TICKS
-	str += std::format(L"\n1:{:6.3f}, 2:{:6.3f}, 3:{:6.3f}, 4:{:6.3f}, 5:{:6.3f}, 6:{:6.3f} ms",
-		m_RenderStats.t1 * 1000 / GetPreciseTicksPerSecond(),
-		m_RenderStats.t2 * 1000 / GetPreciseTicksPerSecond(),
-		m_RenderStats.t3 * 1000 / GetPreciseTicksPerSecond(),
-		m_RenderStats.t4 * 1000 / GetPreciseTicksPerSecond(),
-		m_RenderStats.t5 * 1000 / GetPreciseTicksPerSecond(),
-		m_RenderStats.t6 * 1000 / GetPreciseTicksPerSecond());
-#endif
+	text.End();
+
+	if (text.GetLineCount() != m_StatsLines) {
+		m_StatsLines = text.GetLineCount();
+		CalcStatsParams();
+	}
 
 	HRESULT hr = S_OK;
 	hr = m_pD3DDevEx->SetRenderTarget(0, pRenderTarget);
 
 	m_StatsBackground.Draw();
-	hr = m_Font3D.Draw2DText(m_StatsTextPoint.x, m_StatsTextPoint.y, D3DCOLOR_XRGB(255, 255, 255), str.c_str());
+	hr = m_Font3D.Draw2DText(m_StatsTextPoint.x, m_StatsTextPoint.y, D3DCOLOR_XRGB(255, 255, 255), text.GetText());
 	static int col = m_StatsRect.right;
 	if (--col < m_StatsRect.left) {
 		col = m_StatsRect.right;
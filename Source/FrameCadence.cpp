@@ -0,0 +1,200 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "stdafx.h"
+#include <cmath>
+#include "FrameCadence.h"
+
+void CFrameCadenceDetector::Reset()
+{
+	m_lastTime = INT64_MIN;
+	m_bRepeatFields = false;
+	m_count = 0;
+	m_pos = 0;
+	for (auto& matches : m_matches) {
+		matches = 0;
+	}
+	m_missed = 0;
+	m_cadence = Cadence_Unknown;
+	m_period = 0;
+	m_baseFrames = 0;
+	m_filmDuration = 0;
+	m_pattern[0] = 0;
+}
+
+void CFrameCadenceDetector::Add(const REFERENCE_TIME timestamp, const bool bRepeatField)
+{
+	if (bRepeatField) {
+		m_bRepeatFields = true;
+	}
+
+	const REFERENCE_TIME delta = timestamp - m_lastTime;
+	const bool bFirst = (m_lastTime == INT64_MIN);
+	m_lastTime = timestamp;
+	if (bFirst) {
+		return;
+	}
+
+	if (delta <= 0 || delta > UNITS) {
+		// seeking, a still picture or a broken time stamp, the cadence is kept until the next lock
+		m_count = 0;
+		for (auto& matches : m_matches) {
+			matches = 0;
+		}
+		m_baseFrames = 0;
+		return;
+	}
+
+	m_deltas[m_pos] = delta;
+	m_fields[m_pos] = bRepeatField ? 3 : 2;
+	m_pos = (m_pos + 1) % kRing;
+	if (m_count < kRing) {
+		m_count++;
+	}
+
+	unsigned period = 0;
+	for (unsigned i = 0; i < std::size(kPeriods); i++) {
+		const unsigned p = kPeriods[i];
+		if (m_count <= p) {
+			break;
+		}
+		const bool bMatch = m_bRepeatFields
+			? Fields(0) == Fields(p)
+			: std::abs(Delta(0) - Delta(p)) <= kTolerance;
+		m_matches[i] = bMatch ? m_matches[i] + 1 : 0;
+
+		// the shortest period that repeats for two cycles
+		if (!period && m_matches[i] >= 2 * p + 2) {
+			period = p;
+		}
+	}
+
+	if (m_baseFrames) {
+		m_baseFrames++;
+	}
+
+	if (period) {
+		m_missed = 0;
+		if (period != m_period) {
+			SetPeriod(period);
+			m_baseFrames = 0;
+		}
+		if (!m_baseFrames) {
+			// start at the beginning of the last cycle, the duration over whole frames is exact with rounded time stamps
+			m_baseTime = timestamp;
+			for (unsigned k = 0; k < period; k++) {
+				m_baseTime -= Delta(k);
+			}
+			m_baseFrames = period;
+		}
+		if (m_baseFrames % period == 0) {
+			m_filmDuration = (double)(timestamp - m_baseTime) / m_baseFrames;
+		}
+	}
+	else if (m_cadence != Cadence_VFR && ++m_missed > kMaxMissed) {
+		m_cadence = Cadence_VFR;
+		m_period = 0;
+		m_baseFrames = 0;
+		m_filmDuration = 0;
+		m_pattern[0] = 0;
+	}
+}
+
+void CFrameCadenceDetector::SetPeriod(const unsigned period)
+{
+	m_period = period;
+
+	// fields of each frame of the cycle in display order
+	uint8_t fields[kRing] = {};
+	bool bIntegral = true;
+	if (m_bRepeatFields) {
+		for (unsigned k = 0; k < period; k++) {
+			fields[k] = Fields(period - 1 - k);
+		}
+	} else {
+		REFERENCE_TIME minDelta = Delta(0);
+		for (unsigned k = 1; k < period; k++) {
+			minDelta = std::min(minDelta, Delta(k));
+		}
+		// the shortest frame is two fields
+		for (unsigned k = 0; k < period && bIntegral; k++) {
+			const double f = 2.0 * Delta(period - 1 - k) / minDelta;
+			const long n = std::lround(f);
+			bIntegral = n <= 9 && std::abs(f - n) < 0.15;
+			fields[k] = (uint8_t)n;
+		}
+	}
+
+	auto IsRotationOf = [&](const std::initializer_list<uint8_t> pattern) {
+		if (pattern.size() != period) {
+			return false;
+		}
+		for (unsigned shift = 0; shift < period; shift++) {
+			unsigned k = 0;
+			for (const auto f : pattern) {
+				if (fields[(k + shift) % period] != f) {
+					break;
+				}
+				k++;
+			}
+			if (k == period) {
+				return true;
+			}
+		}
+		return false;
+	};
+
+	m_pattern[0] = 0;
+	if (!bIntegral) {
+		m_cadence = Cadence_Other;
+	}
+	else if (IsRotationOf({ 2 })) {
+		m_cadence = Cadence_Progressive;
+	}
+	else if (IsRotationOf({ 3, 2 })) {
+		m_cadence = Cadence_32;
+	}
+	else if (IsRotationOf({ 2, 3, 3, 2 })) {
+		m_cadence = Cadence_2332;
+	}
+	else {
+		m_cadence = Cadence_Other;
+		wchar_t* p = m_pattern;
+		for (unsigned k = 0; k < period; k++) {
+			if (k) {
+				*p++ = L':';
+			}
+			*p++ = L'0' + fields[k];
+		}
+		*p = 0;
+	}
+}
+
+const wchar_t* CFrameCadenceDetector::GetPatternString() const
+{
+	switch (m_cadence) {
+	case Cadence_Progressive: return L"2:2";
+	case Cadence_32:          return L"3:2";
+	case Cadence_2332:        return L"2:3:3:2";
+	case Cadence_VFR:         return L"VFR";
+	case Cadence_Other:       return m_pattern[0] ? m_pattern : L"cyclic";
+	default:                  return L"";
+	}
+}
@@ -0,0 +1,85 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+//
+// Detects the cadence of the input frames from the time stamp deltas
+// or from AM_VIDEO_FLAG_REPEAT_FIELD when the decoder sets it (soft telecine).
+// Each delta is compared with the delta one, two, four and five frames earlier,
+// the shortest period that repeats for two cycles is the cadence.
+// The work per frame and the memory are fixed, no Windows API is used.
+//
+
+class CFrameCadenceDetector
+{
+public:
+	enum Cadence_t {
+		Cadence_Unknown,
+		Cadence_Progressive, // 2:2, equal frame durations
+		Cadence_32,          // 3:2 pulldown
+		Cadence_2332,        // 2:3:3:2 pulldown
+		Cadence_Other,       // another repeating pattern
+		Cadence_VFR,         // no repeating pattern
+	};
+
+private:
+	static constexpr unsigned kRing = 8; // more than the longest period
+	static constexpr unsigned kPeriods[] = { 1, 2, 4, 5 };
+	static constexpr unsigned kMaxMissed = 16;
+	static constexpr REFERENCE_TIME kTolerance = 15000; // time stamps are often rounded to 1 ms
+
+	REFERENCE_TIME m_lastTime = INT64_MIN;
+	bool m_bRepeatFields = false; // the decoder sets AM_VIDEO_FLAG_REPEAT_FIELD, the field counts are compared
+
+	REFERENCE_TIME m_deltas[kRing] = {};
+	uint8_t m_fields[kRing] = {};
+	unsigned m_count = 0;
+	unsigned m_pos = 0;
+
+	unsigned m_matches[std::size(kPeriods)] = {};
+	unsigned m_missed = 0;
+
+	Cadence_t m_cadence = Cadence_Unknown;
+	unsigned m_period = 0;
+	REFERENCE_TIME m_baseTime = 0; // the film duration is measured from this time stamp
+	unsigned m_baseFrames = 0;     // frames since m_baseTime
+	double m_filmDuration = 0;
+	wchar_t m_pattern[2 * kRing] = {}; // "3:2", "2:3:3:2"
+
+	REFERENCE_TIME Delta(const unsigned back) const { return m_deltas[(m_pos + kRing - 1 - back) % kRing]; }
+	uint8_t Fields(const unsigned back) const { return m_fields[(m_pos + kRing - 1 - back) % kRing]; }
+
+	void SetPeriod(const unsigned period);
+
+public:
+	void Reset();
+
+	void Add(const REFERENCE_TIME timestamp, const bool bRepeatField);
+
+	Cadence_t GetCadence() const { return m_cadence; }
+	bool IsLocked() const { return m_cadence != Cadence_Unknown && m_cadence != Cadence_VFR; }
+
+	// The duration of the original frames, 0 if there is no cadence
+	REFERENCE_TIME GetFilmDuration() const { return IsLocked() ? (REFERENCE_TIME)(m_filmDuration + 0.5) : 0; }
+
+	// "2:2", "3:2", "2:3:3:2", "VFR", an empty string if unknown
+	const wchar_t* GetPatternString() const;
+};
@@ -0,0 +1,321 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "stdafx.h"
+#include "FrameScheduler.h"
+
+// based on CBaseVideoRenderer from DirectShow base classes, see renbase2.cpp for the detailed comments
+
+//  Helper function for clamping time differences
+static inline int TimeDiff(const REFERENCE_TIME rt)
+{
+	return (int)std::clamp<REFERENCE_TIME>(rt, -(50 * UNITS), 50 * UNITS);
+}
+
+void CFrameScheduler::Reset()
+{
+	m_nNormal = 0;
+	m_trThrottle = 0;
+	m_trRenderAvg = 0;
+	m_trRenderLast = 0;
+	m_trEarliness = 0;
+	m_trWaitAvg = 0;
+	m_trFrameAvg = -1;  // -1000 fps == "unset"
+	m_trDuration = 0;   // 0 - strange value
+	m_trLastDraw = -1000; // set up as first frame since ages (1 sec) ago
+	m_trRememberStampForPerf = 0;
+	m_trLate = 0;
+	m_trFrame = 0;
+
+	m_cFramesDrawn = 0;
+	m_SyncOffsetStats.Reset();
+	m_FrameTimeStats.Reset();
+}
+
+void CFrameScheduler::Notify(const long proportion)
+{
+	// Heuristics: a hyperbola with a panic button asymptote,
+	// no throttling at 1000 and 200 ms at 0 (see the table in renbase2.cpp).
+	if (proportion >= 1000) {
+		m_trThrottle = 0;
+	} else {
+		m_trThrottle = -330000 + (388880000 / (proportion + 167));
+	}
+}
+
+void CFrameScheduler::RecordFrameLateness(int trLate, int trFrame)
+{
+	// Record how timely we are.
+	double tLate = trLate / 10000.0;
+
+	// We can get frames that are very late especially at start-up
+	// and they invalidate the statistics. So ignore things that are more than 1 sec off.
+	if (tLate > 1000 || tLate < -1000) {
+		if (m_cFramesDrawn <= 1) {
+			tLate = 0;
+		} else if (tLate > 0) {
+			tLate = 1000;
+		} else {
+			tLate = -1000;
+		}
+	}
+	// The very first frame often has a invalid time, so don't count it into the statistics.
+	if (m_cFramesDrawn > 1) {
+		m_SyncOffsetStats.Add(tLate);
+	}
+
+	// Inter-frame time doesn't make sense for first frame,
+	// second frame suffers from invalid first frame stamp.
+	if (m_cFramesDrawn > 2) {
+		double tFrame = trFrame / 10000.0;
+
+		// a pause can cause a very long inter-frame time
+		if (tFrame > 1000 || tFrame < 0) {
+			tFrame = 1000;
+		}
+		m_FrameTimeStats.Add(tFrame);
+	}
+	++m_cFramesDrawn;
+}
+
+FrameQuality_t CFrameScheduler::GetQuality(const int trLate, const REFERENCE_TIME trRealStream) const
+{
+	FrameQuality_t q;
+	q.TimeStamp = trRealStream;
+
+	// If we are the main user of time, then report this as Flood, else as Famine.
+	q.bFlood = (m_trFrameAvg >= 0 && m_trFrameAvg <= 2 * m_trRenderAvg);
+
+	q.Proportion = 1000; // default
+
+	if (m_trFrameAvg < 0) {
+		// leave it alone - we don't know enough
+	}
+	else if (trLate > 0) {
+		// try to catch up over the next second
+		q.Proportion = 1000 - (int)(trLate / (UNITS / 1000));
+		if (q.Proportion < 500) {
+			q.Proportion = 500; // don't go daft. (could've been negative!)
+		}
+	}
+	else if (m_trWaitAvg > 20000 && trLate < -20000) {
+		// Go cautiously faster - aim at 2 ms wait.
+		if (m_trWaitAvg >= m_trFrameAvg) {
+			// We are spending a LOT of time waiting
+			q.Proportion = 2000;
+		}
+		else if (m_trFrameAvg + 20000 > m_trWaitAvg) {
+			q.Proportion = 1000 * (m_trFrameAvg / (m_trFrameAvg + 20000 - m_trWaitAvg));
+		}
+		else {
+			// More than the whole frame time waiting, avoids any potential divide by zero.
+			q.Proportion = 2000;
+		}
+
+		if (q.Proportion > 2000) {
+			q.Proportion = 2000; // don't go crazy.
+		}
+	}
+
+	// We add half of the average drawing time, we expect the average to be a better shot than the last frame.
+	q.Late = trLate + m_trRenderAvg / 2;
+
+	return q;
+}
+
+CFrameScheduler::Decision_t CFrameScheduler::ShouldDrawSampleNow(
+	const REFERENCE_TIME trRealStream, const bool bDiscontinuity,
+	REFERENCE_TIME& trStart, REFERENCE_TIME& trEnd,
+	const QualitySink& sendQuality)
+{
+	// We lose about 8 ms on average waiting for the next screen refresh,
+	// so we bias the media samples by -8 ms or by the allowance for the planned vsync.
+	// We don't ever make a stream time negative.
+	if (trStart >= m_trMonitorAllowance) {
+		trStart -= m_trMonitorAllowance;
+		trEnd -= m_trMonitorAllowance; // bias stop to to retain valid frame duration
+	}
+
+	// Cache the time stamp now. We will want to compare what we did with what
+	// we started with (after making the monitor allowance).
+	m_trRememberStampForPerf = trStart;
+
+	const int trTrueLate = TimeDiff(trRealStream - trStart);
+	const int trLate = trTrueLate;
+
+	// Send quality control messages upstream.
+	// The filter upstream is allowed to fail it meaning "you do it".
+	m_bSupplierHandlingQuality = sendQuality ? sendQuality(GetQuality(trLate, trRealStream)) : false;
+
+	// Decision time!  Do we drop, draw when ready or draw immediately?
+
+	const int trDuration = (int)(trEnd - trStart);
+	{
+		// We need to see if the frame rate of the file has just changed.
+		// Minor variations like 33 and 34 ms for 30 fps are ignored.
+		const int t = m_trDuration / 32;
+		if (trDuration > m_trDuration + t || trDuration < m_trDuration - t) {
+			// There's a major variation. Reset the average frame rate to
+			// exactly the current rate and remember the new rate.
+			m_trFrameAvg = trDuration;
+			m_trDuration = trDuration;
+		}
+	}
+
+	// Control the graceful slide back from slow to fast machine mode.
+	const bool bJustDroppedFrame = (m_bSupplierHandlingQuality && bDiscontinuity) // he just dropped one
+		|| (m_nNormal == -1); // we just dropped one
+
+	// Set m_trEarliness (slide back from slow to fast machine mode)
+	if (trLate > 0) {
+		m_trEarliness = 0; // we are no longer in fast machine mode at all!
+	} else if ((trLate >= m_trEarliness) || bJustDroppedFrame) {
+		m_trEarliness = trLate; // Things have slipped of their own accord
+	} else {
+		m_trEarliness = m_trEarliness - m_trEarliness / 8; // graceful slide
+	}
+
+	// Prepare the new wait average - but don't pollute the old one until we have finished with it.
+	// We never mix in a negative wait. This causes us to believe in fast machines slightly more.
+	const int trL = trLate < 0 ? -trLate : 0;
+	const int trWaitAvg = (trL + m_trWaitAvg * (kAvgPeriod - 1)) / kAvgPeriod;
+
+	int trFrame = (int)std::min<REFERENCE_TIME>(trRealStream - m_trLastDraw, UNITS); // Cd be large - 4 min pause!
+
+	// We will DRAW this frame IF...
+	if (
+		// ...the time we are spending drawing is a small fraction of the total
+		// observed inter-frame time so that dropping it won't help much.
+		(3 * m_trRenderAvg <= m_trFrameAvg)
+
+		// ...or our supplier is NOT handling things and the next frame would
+		// be less timely than this one or our supplier CLAIMS to be handling
+		// things, and is now less than a full FOUR frames late.
+		|| (m_bSupplierHandlingQuality
+			? (trLate <= trDuration * 4)
+			: (trLate + trLate < trDuration))
+
+		// ...or we are on average waiting for over eight milliseconds then
+		// this may be just a glitch. Draw it and we'll hope to catch up.
+		|| (m_trWaitAvg > 80000)
+
+		// ...or we haven't drawn an image for over a second. We will update
+		// the display, which stops the video looking hung.
+		|| ((trRealStream - m_trLastDraw) > UNITS)
+	) {
+		Decision_t result;
+
+		// We will play it AT ONCE (slow machine mode) if we are playing catch-up
+		// or if we are running below the true frame rate (with an extra 5% or so),
+		// but we refuse to play early by more than 10 frames.
+		bool bPlayASAP = bJustDroppedFrame
+			|| ((m_trFrameAvg > trDuration + trDuration / 16) && (trLate > -trDuration * 10));
+
+		// We will NOT play it at once if we are more than 900 ms early.
+		if (trLate < -9000000) {
+			bPlayASAP = false;
+		}
+
+		if (bPlayASAP) {
+			m_nNormal = 0;
+			// In slow-machine mode trLate may oscillate between negative and positive
+			// when the supplier is dropping frames. We just update with a zero wait.
+			m_trWaitAvg = (m_trWaitAvg * (kAvgPeriod - 1)) / kAvgPeriod;
+
+			// Assume that we draw it immediately. Update inter-frame stats
+			m_trFrameAvg = (trFrame + m_trFrameAvg * (kAvgPeriod - 1)) / kAvgPeriod;
+
+			PreparePerformanceData(trTrueLate, trFrame);
+
+			m_trLastDraw = trRealStream;
+			if (m_trEarliness > trLate) {
+				m_trEarliness = trLate; // if we are actually early, this is neg
+			}
+			result = DrawNow;
+		}
+		else {
+			++m_nNormal;
+			// Set the average frame rate to EXACTLY the ideal rate, else after exiting
+			// slow-machine mode we would go back into it because of the longer gap.
+			m_trFrameAvg = trDuration;
+
+			// Play it early by m_trEarliness
+			trStart += std::max(m_trEarliness, -m_trFrameAvg); // N.B. earliness is negative
+
+			const int Delay = -trTrueLate;
+			result = Delay <= 0 ? DrawNow : DrawAtTime;
+
+			m_trWaitAvg = trWaitAvg;
+
+			// Predict when it will actually be drawn and update frame stats
+			if (result == DrawAtTime) { // We are going to wait
+				trFrame = TimeDiff(trStart - m_trLastDraw);
+				m_trLastDraw = trStart;
+			} else {
+				// trFrame is already = trRealStream-m_trLastDraw;
+				m_trLastDraw = trRealStream;
+			}
+
+			int iAccuracy;
+			if (Delay > 0) {
+				// Report lateness based on when we intend to play it
+				iAccuracy = TimeDiff(trStart - m_trRememberStampForPerf);
+			} else {
+				// Report lateness based on playing it *now*.
+				iAccuracy = trTrueLate;
+			}
+			PreparePerformanceData(iAccuracy, trFrame);
+		}
+		return result;
+	}
+
+	// We are going to drop this frame!
+	// This will probably give a large negative wack to the wait avg.
+	m_trWaitAvg = trWaitAvg;
+
+	// We are going to drop this frame so draw the next one early
+	m_nNormal = -1;
+
+	return Drop;
+}
+
+void CFrameScheduler::OnRenderStart()
+{
+	RecordFrameLateness(m_trLate, m_trFrame);
+}
+
+void CFrameScheduler::OnRenderEnd(const int trRenderTime)
+{
+	// The renderer time can vary erratically if we are interrupted, figures
+	// can go 9,10,9,9,83,9 and we must disregard 83. But in reality, the rendering time
+	// can cyclically increase and decrease by 25 times. For example : 5 125 6 127 5 126.
+	if (trRenderTime < m_trRenderAvg * 32 || trRenderTime < m_trRenderLast * 32) {
+		m_trRenderAvg = (trRenderTime + (kAvgPeriod - 1) * m_trRenderAvg) / kAvgPeriod;
+	}
+	m_trRenderLast = trRenderTime;
+}
+
+void CFrameScheduler::OnDirectRender()
+{
+	m_trRenderAvg = 0;
+	m_trRenderLast = 5000000; // If we mode switch, we do NOT want this to inhibit
+	                          // the new average getting going, so we set it to half a second
+	RecordFrameLateness(m_trLate, m_trFrame);
+}
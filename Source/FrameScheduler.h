@@ -0,0 +1,117 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <functional>
+#include "SlidingStats.h"
+
+//
+// The drop/draw decision logic of CBaseVideoRenderer2 (CBaseVideoRenderer from DirectShow base classes)
+// without the reference clock and DirectShow interfaces. All times are stream times in 100 ns units
+// and the current time is passed by the caller, so the same code is used by the renderer
+// and by the scheduling simulator (Tests/FrameSchedulerSim.h). No Windows API is used.
+//
+
+struct FrameQuality_t {
+	bool bFlood = false;          // true - most of the time is taken by rendering, false - by the supplier (Famine)
+	long Proportion = 1000;       // requested speed of the supplier, 1000 - normal
+	REFERENCE_TIME Late = 0;      // how late frames are when they get rendered
+	REFERENCE_TIME TimeStamp = 0; // stream time when the message was made
+};
+
+class CFrameScheduler
+{
+public:
+	enum Decision_t {
+		DrawNow,    // S_OK
+		DrawAtTime, // S_FALSE, draw at the corrected start time
+		Drop,       // E_FAIL
+	};
+
+	// Receives the quality message, returns true if the supplier handles quality
+	using QualitySink = std::function<bool(const FrameQuality_t&)>;
+
+	static constexpr int kAvgPeriod = 4; // AVGPERIOD from renbase.h
+
+private:
+	// Hungarian: trFoo is the time Foo in 100 ns units.
+	// Although these are reference times they are all differences between times which are small.
+
+	REFERENCE_TIME m_trMonitorAllowance = 80000; // how earlier than the time stamp the frame is drawn
+
+	int m_nNormal = 0;                     // number of consecutive frames drawn at their normal time, -1 means we just dropped a frame
+	bool m_bSupplierHandlingQuality = false;
+	int m_trThrottle = 0;                  // audio-video throttling requested by Notify
+	int m_trRenderAvg = 0;                 // time frames are taking to draw
+	int m_trRenderLast = 0;                // time for last frame draw
+	int m_trEarliness = 0;                 // how early we play frames after a drop, normally negative or zero
+	int m_trWaitAvg = 0;                   // average of how early we were, negative means late
+	int m_trFrameAvg = -1;                 // average inter-frame time, -1 means unset
+	int m_trDuration = 0;                  // duration of last frame
+	REFERENCE_TIME m_trLastDraw = -1000;   // time of prev frame
+	REFERENCE_TIME m_trRememberStampForPerf = 0; // original time stamp of frame with no earliness fudges
+
+	// lateness and inter-frame time of the frame that is going to be drawn,
+	// they are added to the statistics only when the frame is actually drawn
+	int m_trLate = 0;
+	int m_trFrame = 0;
+
+	// statistics for IQualProp
+	int m_cFramesDrawn = 0;
+	CRunningStats m_SyncOffsetStats; // sync offsets in ms
+	CRunningStats m_FrameTimeStats;  // inter-frame times in ms
+
+	void PreparePerformanceData(int trLate, int trFrame) {
+		m_trLate = trLate;
+		m_trFrame = trFrame;
+	}
+	void RecordFrameLateness(int trLate, int trFrame);
+
+public:
+	// Sets the state so that frames will not initially be dropped and the first frame will be drawn
+	void Reset();
+
+	// Time to draw the frame before its time stamp to be shown on the vsync, not less than 8 ms
+	void SetMonitorAllowance(const REFERENCE_TIME allowance) { m_trMonitorAllowance = std::max<REFERENCE_TIME>(allowance, 80000); }
+
+	// Quality.Proportion from an IQualityControl::Notify call
+	void Notify(const long proportion);
+	int GetThrottle() const { return m_trThrottle; }
+
+	// The quality message that the supplier gets for the current state
+	FrameQuality_t GetQuality(const int trLate, const REFERENCE_TIME trRealStream) const;
+
+	// Decides whether the frame is drawn now, at the corrected start time or dropped.
+	// trRealStream is the current stream time, trStart and trEnd are corrected by the monitor and earliness allowances.
+	Decision_t ShouldDrawSampleNow(
+		const REFERENCE_TIME trRealStream, const bool bDiscontinuity,
+		REFERENCE_TIME& trStart, REFERENCE_TIME& trEnd,
+		const QualitySink& sendQuality);
+
+	// Called when the frame accepted by ShouldDrawSampleNow is drawn
+	void OnRenderStart();
+	void OnRenderEnd(const int trRenderTime);
+	void OnDirectRender();
+
+	int GetFramesDrawn() const { return m_cFramesDrawn; }
+	const CRunningStats& GetSyncOffsetStats() const { return m_SyncOffsetStats; }
+	const CRunningStats& GetFrameTimeStats() const { return m_FrameTimeStats; }
+};
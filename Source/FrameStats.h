@@ -20,10 +20,13 @@
 
 #pragma once
 
+#include <atomic>
+#include <bit>
 #include "Times.h"
+#include "FrameCadence.h"
+#include "SlidingStats.h"
 
 #define SYNC_OFFSET_EX 0
-#define TEST_TICKS 0
 
 template<typename T, unsigned count> class CFrameTimestamps {
 protected:
@@ -80,6 +83,7 @@ class CFrameStats : public CFrameTimestamps<REFERENCE_TIME, 301>
 {
 private:
 	REFERENCE_TIME m_startFrameDuration = 400000;
+	CFrameCadenceDetector m_Cadence;
 
 	inline unsigned GetPrev10Index(unsigned idx) {
 		if (idx < 10) {
@@ -90,6 +94,20 @@ private:
 	}
 
 public:
+	void Reset() {
+		CFrameTimestamps::Reset();
+		m_Cadence.Reset();
+	}
+
+	void Add(REFERENCE_TIME timestamp, const bool bRepeatField) {
+		CFrameTimestamps::Add(timestamp);
+		m_Cadence.Add(timestamp, bRepeatField);
+	}
+
+	const CFrameCadenceDetector& GetCadence() const {
+		return m_Cadence;
+	}
+
 	REFERENCE_TIME GetAverageFrameDuration() override {
 		REFERENCE_TIME frame_duration;
 		if (m_frames > intervals) {
@@ -103,7 +121,13 @@ public:
 			return m_startFrameDuration;
 		}
 
-		if (m_frames > 10) {
+		if (const REFERENCE_TIME film_duration = m_Cadence.GetFilmDuration()) {
+			// the 10 frame check does not work with 3:2 and 2:3:3:2, the cadence is measured over whole cycles
+			if (abs(frame_duration - film_duration) > 10000) {
+				frame_duration = film_duration;
+			}
+		}
+		else if (m_frames > 10) {
 			REFERENCE_TIME frame_duration10 = (m_timestamps[m_index] - m_timestamps[GetPrev10Index(m_index)]) / 10;
 			if (abs(frame_duration - frame_duration10) > 10000) {
 				frame_duration = frame_duration10;
@@ -154,15 +178,6 @@ struct CRenderStats {
 	uint64_t presentticks = 0;
 	REFERENCE_TIME syncoffset = 0;
 
-#if TEST_TICKS
-	uint64_t t1 = 0;
-	uint64_t t2 = 0;
-	uint64_t t3 = 0;
-	uint64_t t4 = 0;
-	uint64_t t5 = 0;
-	uint64_t t6 = 0;
-#endif
-
 	//void NewInterval() {
 	//	skipped_interval = INT_MAX; // needed for forced rendering of the first frame after start or seeking
 	//}
@@ -172,52 +187,106 @@ struct CRenderStats {
 	}
 };
 
-template<typename T> class CMovingAverage
+enum : int {
+	LATENCY_Copy = 0,
+	LATENCY_Subtitles,
+	LATENCY_Paint,
+	LATENCY_Present,
+	LATENCY_ReceiveToPresent,
+	LATENCY_COUNT
+};
+
+// Log-linear histogram of durations in ticks with a fixed size.
+// Each power of two range is split into 16 linear sub-buckets, so the relative error of a percentile is below 1/16.
+// There are no locks, a reader running at the same time as Add() or Reset() can get a slightly inconsistent result.
+class CLatencyHistogram
 {
 private:
-	std::vector<T> fifo;
-	unsigned oldestIndex = 0;
-	unsigned lastIndex = 0;
-	T        sum         = 0;
+	static constexpr unsigned kSubBits    = 4;
+	static constexpr unsigned kSubBuckets = 1u << kSubBits;
+	static constexpr unsigned kBuckets    = (64 - kSubBits + 1) * kSubBuckets;
 
-public:
-	CMovingAverage(unsigned size) {
-		size = std::max(size, 1u);
-		fifo.resize(size);
-	}
+	std::atomic<uint32_t> m_buckets[kBuckets] = {};
+	std::atomic<uint64_t> m_max = 0;
 
-	void Add(T sample) {
-		sum = sum + sample - fifo[oldestIndex];
-		fifo[oldestIndex] = sample;
-		lastIndex = oldestIndex;
-		oldestIndex++;
-		if (oldestIndex == fifo.size()) {
-			oldestIndex = 0;
+	static unsigned BucketIndex(const uint64_t value) {
+		if (value < kSubBuckets) {
+			return (unsigned)value;
 		}
+		const unsigned shift = (unsigned)std::bit_width(value) - 1 - kSubBits;
+		return (shift + 1) * kSubBuckets + (unsigned)((value >> shift) & (kSubBuckets - 1));
 	}
 
-	T Last() {
-		return fifo[lastIndex];
+	// the largest value that falls into the bucket
+	static uint64_t BucketUpperValue(const unsigned index) {
+		if (index < kSubBuckets) {
+			return index;
+		}
+		const unsigned shift = index / kSubBuckets - 1;
+		const uint64_t lower = (uint64_t)(kSubBuckets + index % kSubBuckets) << shift;
+		return lower + ((1ull << shift) - 1);
 	}
 
-	T Average() {
-		return sum / fifo.size();
+public:
+	void Add(const uint64_t ticks) {
+		m_buckets[BucketIndex(ticks)].fetch_add(1, std::memory_order_relaxed);
+
+		uint64_t prev = m_max.load(std::memory_order_relaxed);
+		while (ticks > prev && !m_max.compare_exchange_weak(prev, ticks, std::memory_order_relaxed)) {
+		}
 	}
 
-	std::pair<T, T> MinMax() {
-		const auto [min_e, max_e] = minmax_element(fifo.begin(), fifo.end());
-		return { *min_e, *max_e };
+	void Reset() {
+		for (auto& bucket : m_buckets) {
+			bucket.store(0, std::memory_order_relaxed);
+		}
+		m_max.store(0, std::memory_order_relaxed);
 	}
 
-	T* Data() {
-		return fifo.data();
+	uint64_t GetCount() const {
+		uint64_t count = 0;
+		for (const auto& bucket : m_buckets) {
+			count += bucket.load(std::memory_order_relaxed);
+		}
+		return count;
 	}
 
-	unsigned Size() {
-		return fifo.size();
+	uint64_t GetMax() const {
+		return m_max.load(std::memory_order_relaxed);
 	}
 
-	unsigned OldestIndex() {
-		return oldestIndex;
+	// Returns the value that is not exceeded by the given fraction of samples (0.5 for the median).
+	uint64_t GetPercentile(const double fraction) const {
+		const uint64_t count = GetCount();
+		if (!count) {
+			return 0;
+		}
+
+		const uint64_t rank = std::clamp<uint64_t>((uint64_t)std::ceil(fraction * count), 1, count);
+		const uint64_t max = GetMax();
+		uint64_t sum = 0;
+		for (unsigned i = 0; i < kBuckets; i++) {
+			sum += m_buckets[i].load(std::memory_order_relaxed);
+			if (sum >= rank) {
+				const uint64_t value = BucketUpperValue(i);
+				return (max && value > max) ? max : value;
+			}
+		}
+		return max;
 	}
 };
+
+// Data of IExFilterConfig::Flt_GetBin("statsHistograms")
+struct LatencyStats_t {
+	uint64_t count;
+	double p50; // milliseconds
+	double p95;
+	double p99;
+	double max;
+};
+
+struct LatencyHistogramsData_t {
+	uint32_t size;   // sizeof(LatencyHistogramsData_t)
+	uint32_t stages; // LATENCY_COUNT
+	LatencyStats_t stage[LATENCY_COUNT]; // copy, subtitles, paint, present, Receive to present
+};
@@ -0,0 +1,105 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "stdafx.h"
+#include "Utils/Util.h"
+#include "FrameTrace.h"
+
+CFrameTrace g_FrameTrace;
+
+void CFrameTrace::Enable(const bool enable)
+{
+	if (enable == IsEnabled()) {
+		return;
+	}
+
+	if (enable) {
+		if (!m_pEvents) {
+			m_pEvents.reset(new(std::nothrow) Event_t[kCapacity]);
+			if (!m_pEvents) {
+				return;
+			}
+		}
+		memset(m_pEvents.get(), 0, sizeof(Event_t) * kCapacity);
+		m_pos.store(0, std::memory_order_relaxed);
+	}
+
+	// the buffer is never released, other threads may still be writing to it
+	m_bEnabled.store(enable, std::memory_order_release);
+	DLog(L"CFrameTrace::Enable() : recording is {}", enable ? L"started" : L"stopped");
+}
+
+HRESULT CFrameTrace::SaveToFile(const wchar_t* filename)
+{
+	CheckPointer(filename, E_POINTER);
+
+	if (!m_pEvents) {
+		return E_ABORT;
+	}
+
+	const bool bEnabled = IsEnabled();
+	m_bEnabled.store(false, std::memory_order_relaxed);
+
+	const uint64_t pos = m_pos.load(std::memory_order_acquire);
+	const uint64_t count = std::min<uint64_t>(pos, kCapacity);
+
+	uint64_t firstTick = UINT64_MAX;
+	for (uint64_t i = pos - count; i < pos; i++) {
+		const auto& event = m_pEvents[i & (kCapacity - 1)];
+		if (event.name) {
+			firstTick = std::min(firstTick, event.tick);
+		}
+	}
+
+	const double usPerTick = 1000000.0 / GetPreciseTicksPerSecond();
+	const DWORD pid = GetCurrentProcessId();
+
+	std::string json;
+	json.reserve(count * 80 + 64);
+	json.assign("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+	bool bFirst = true;
+	for (uint64_t i = pos - count; i < pos; i++) {
+		const auto& event = m_pEvents[i & (kCapacity - 1)];
+		if (!event.name) {
+			continue; // not written yet
+		}
+
+		json += std::format("{}\n{{\"name\":\"{}\",\"ph\":\"{}\",\"ts\":{:.3f},\"pid\":{},\"tid\":{}{}}}",
+			bFirst ? "" : ",",
+			event.name, event.phase, (event.tick - firstTick) * usPerTick, pid, event.tid,
+			event.phase == 'i' ? ",\"s\":\"t\"" : "");
+		bFirst = false;
+	}
+	json.append("\n]}\n");
+
+	m_bEnabled.store(bEnabled, std::memory_order_relaxed);
+
+	FILE* fp;
+	if (_wfopen_s(&fp, filename, L"wb") == 0 && fp) {
+		const size_t written = fwrite(json.data(), 1, json.size(), fp);
+		fclose(fp);
+		DLog(L"CFrameTrace::SaveToFile() : {} events saved to \"{}\"", count, filename);
+
+		return (written == json.size()) ? S_OK : E_FAIL;
+	}
+
+	return E_FAIL;
+}
@@ -0,0 +1,97 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include "Times.h"
+
+//
+// Recorder of per-frame events for diagnosing stutter.
+// Events are stored in a ring buffer and saved in the Chrome trace JSON format,
+// which can be opened in chrome://tracing or ui.perfetto.dev.
+// When recording is disabled, an event costs one relaxed load.
+//
+
+class CFrameTrace
+{
+public:
+	struct Event_t {
+		uint64_t tick;    // GetPreciseTick()
+		const char* name; // must be a string literal
+		uint32_t tid;
+		char phase;       // 'B' begin, 'E' end, 'i' instant
+	};
+
+	static constexpr unsigned kCapacity = 1 << 16; // must be a power of two
+
+private:
+	std::atomic<bool> m_bEnabled = false;
+	std::atomic<uint64_t> m_pos = 0;
+	std::unique_ptr<Event_t[]> m_pEvents;
+
+	void AddEvent(const char* name, const char phase) {
+		const uint64_t pos = m_pos.fetch_add(1, std::memory_order_relaxed);
+		auto& event = m_pEvents[pos & (kCapacity - 1)];
+		event.tick  = GetPreciseTick();
+		event.name  = name;
+		event.tid   = GetCurrentThreadId();
+		event.phase = phase;
+	}
+
+public:
+	bool IsEnabled() const { return m_bEnabled.load(std::memory_order_relaxed); }
+
+	// Starts recording from an empty buffer or stops it, must not be called from different threads at the same time
+	void Enable(const bool enable);
+
+	void Add(const char* name, const char phase = 'i') {
+		if (IsEnabled()) {
+			AddEvent(name, phase);
+		}
+	}
+
+	// Saves the recorded events, recording is paused while saving
+	HRESULT SaveToFile(const wchar_t* filename);
+};
+
+extern CFrameTrace g_FrameTrace;
+
+class CFrameTraceScope
+{
+	const char* m_name = nullptr;
+
+public:
+	CFrameTraceScope(const char* name) {
+		if (g_FrameTrace.IsEnabled()) {
+			m_name = name;
+			g_FrameTrace.Add(name, 'B');
+		}
+	}
+	~CFrameTraceScope() {
+		if (m_name) {
+			g_FrameTrace.Add(m_name, 'E');
+		}
+	}
+};
+
+#define FRAMETRACE_EVENT(name) g_FrameTrace.Add(name)
+#define FRAMETRACE_SCOPE(name) CFrameTraceScope frameTraceScope(name)
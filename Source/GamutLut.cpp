@@ -0,0 +1,184 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "stdafx.h"
+#include <map>
+#include <mutex>
+#include "Utils/Util.h"
+#include "GamutLut.h"
+
+// Gamut compression is done in the same way as in the ACES Reference Gamut Compression.
+// For each channel the distance from the achromatic axis is calculated,
+// distances above the threshold are smoothly compressed so that the farthest color
+// of the source gamut lands exactly on the target gamut boundary.
+// Colors inside the threshold are not changed.
+//
+// The distance of a color inside the target gamut is at most 1. A color between the threshold and 1
+// is already displayable but is desaturated a little to make room for the out of gamut colors.
+// The threshold is placed so that the compressed range [threshold, 1] is kMinRoom times
+// wider than the overshoot (limit - 1) of the source gamut, but never below kMinThreshold.
+// The thresholds are per channel. For BT.2020 -> BT.709 the overshoot of red is the largest,
+// so red gets the 0.8 of ACES while green and blue get about 0.95. DCI-P3 -> BT.709 gets about 0.89
+// for red and 0.95 for the others, so more of the saturated colors stay untouched.
+// The ACES value 0.8 is kept as the floor: a lower knee desaturates too many displayable colors,
+// a higher one leaves too little room and the compression curve gets too steep near the boundary.
+
+static constexpr float kCompressPower = 1.2f;
+static constexpr float kMinThreshold  = 0.8f;
+static constexpr float kMaxThreshold  = 0.95f;
+static constexpr float kMinRoom       = 0.5f;
+
+static void ConvertToTarget(float rgb[3], const float (&m)[3][3], const float r, const float g, const float b)
+{
+	rgb[0] = m[0][0] * r + m[0][1] * g + m[0][2] * b;
+	rgb[1] = m[1][0] * r + m[1][1] * g + m[1][2] * b;
+	rgb[2] = m[2][0] * r + m[2][1] * g + m[2][2] * b;
+}
+
+static inline float GridValue(const int i)
+{
+	return std::pow((float)i / (GAMUT_LUT_SIZE - 1), GAMUT_LUT_GAMMA);
+}
+
+CGamutCompression::CGamutCompression(mp_csp_prim csp_in, mp_csp_prim csp_out)
+{
+	GetColorspaceGamutConversionMatrix(m_matrix, csp_in, csp_out);
+
+	// the farthest distance from the achromatic axis is achieved on the source gamut boundary,
+	// the faces of the RGB cube are sampled densely
+	constexpr int kSteps = 128;
+	for (int face = 0; face < 6; face++) {
+		for (int u = 0; u <= kSteps; u++) {
+			for (int v = 0; v <= kSteps; v++) {
+				float src[3];
+				src[face % 3] = (face < 3) ? 0.0f : 1.0f;
+				src[(face + 1) % 3] = (float)u / kSteps;
+				src[(face + 2) % 3] = (float)v / kSteps;
+
+				float rgb[3];
+				ConvertToTarget(rgb, m_matrix, src[0], src[1], src[2]);
+				const float ach = std::max({ rgb[0], rgb[1], rgb[2] });
+				if (ach > 0.0f) {
+					for (int i = 0; i < 3; i++) {
+						m_limits[i] = std::max(m_limits[i], (ach - rgb[i]) / ach);
+					}
+				}
+			}
+		}
+	}
+
+	for (int i = 0; i < 3; i++) {
+		m_thresholds[i] = std::clamp(1.0f - kMinRoom * (m_limits[i] - 1.0f), kMinThreshold, kMaxThreshold);
+	}
+}
+
+float CGamutCompression::CompressDistance(const int i, const float dist) const
+{
+	const float threshold = m_thresholds[i];
+	const float limit = m_limits[i];
+	if (dist < threshold || limit <= 1.0f) {
+		return dist;
+	}
+
+	// scale is selected so that the limit is mapped to 1.0
+	const float scale = (limit - threshold)
+		/ std::pow(std::pow((1.0f - threshold) / (limit - threshold), -kCompressPower) - 1.0f, 1.0f / kCompressPower);
+
+	const float nd = (dist - threshold) / scale;
+	return threshold + scale * nd / std::pow(1.0f + std::pow(nd, kCompressPower), 1.0f / kCompressPower);
+}
+
+void CGamutCompression::Convert(float dst[3], const float src[3]) const
+{
+	float rgb[3];
+	ConvertToTarget(rgb, m_matrix, src[0], src[1], src[2]);
+
+	const float ach = std::max({ rgb[0], rgb[1], rgb[2] });
+	if (ach <= 0.0f) {
+		dst[0] = dst[1] = dst[2] = 0.0f;
+		return;
+	}
+
+	for (int i = 0; i < 3; i++) {
+		const float dist = (ach - rgb[i]) / ach;
+		rgb[i] = ach - CompressDistance(i, dist) * ach;
+	}
+
+	// too bright colors are scaled down, this keeps the hue and the saturation
+	const float peak = std::max({ rgb[0], rgb[1], rgb[2] });
+	if (peak > 1.0f) {
+		for (int i = 0; i < 3; i++) {
+			rgb[i] /= peak;
+		}
+	}
+
+	for (int i = 0; i < 3; i++) {
+		dst[i] = std::clamp(rgb[i], 0.0f, 1.0f);
+	}
+}
+
+static std::vector<float> BakeGamutCompressionLut(mp_csp_prim csp_in, mp_csp_prim csp_out)
+{
+	const CGamutCompression compression(csp_in, csp_out);
+
+	float grid[GAMUT_LUT_SIZE];
+	for (int i = 0; i < GAMUT_LUT_SIZE; i++) {
+		grid[i] = GridValue(i);
+	}
+
+	std::vector<float> lut(GAMUT_LUT_SIZE * GAMUT_LUT_SIZE * GAMUT_LUT_SIZE * 3);
+	float* p = lut.data();
+
+	for (int b = 0; b < GAMUT_LUT_SIZE; b++) {
+		for (int g = 0; g < GAMUT_LUT_SIZE; g++) {
+			for (int r = 0; r < GAMUT_LUT_SIZE; r++) {
+				const float src[3] = { grid[r], grid[g], grid[b] };
+				compression.Convert(p, src);
+				p += 3;
+			}
+		}
+	}
+
+	DLog(L"BakeGamutCompressionLut() : LUT {}x{}x{} for primaries {} -> {} created, thresholds {:.3f} {:.3f} {:.3f}",
+		GAMUT_LUT_SIZE, GAMUT_LUT_SIZE, GAMUT_LUT_SIZE, (int)csp_in, (int)csp_out,
+		compression.GetThreshold(0), compression.GetThreshold(1), compression.GetThreshold(2));
+
+	return lut;
+}
+
+const std::vector<float>& GetGamutCompressionLut(mp_csp_prim csp_in, mp_csp_prim csp_out)
+{
+	static std::mutex s_mutex;
+	static std::map<int, std::vector<float>> s_luts;
+
+	ASSERT(csp_in > MP_CSP_PRIM_AUTO && csp_in < MP_CSP_PRIM_COUNT);
+	ASSERT(csp_out > MP_CSP_PRIM_AUTO && csp_out < MP_CSP_PRIM_COUNT);
+
+	const int key = csp_in * MP_CSP_PRIM_COUNT + csp_out;
+
+	std::lock_guard<std::mutex> lock(s_mutex);
+
+	auto it = s_luts.find(key);
+	if (it == s_luts.end()) {
+		it = s_luts.emplace(key, BakeGamutCompressionLut(csp_in, csp_out)).first;
+	}
+
+	return it->second;
+}
@@ -0,0 +1,64 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include "csputils.h"
+
+// Number of grid points per axis of the gamut compression 3D LUT
+#define GAMUT_LUT_SIZE 33
+
+// The LUT is addressed by the source RGB encoded with this gamma
+#define GAMUT_LUT_GAMMA 2.2f
+
+// Converts linear light RGB from csp_in to csp_out primaries and compresses the colors
+// that are outside of the csp_out gamut, see GamutLut.cpp.
+class CGamutCompression
+{
+private:
+	float m_matrix[3][3] = {};
+	float m_limits[3] = {}; // the farthest distance from the achromatic axis of the source gamut
+	float m_thresholds[3] = {};
+
+	float CompressDistance(const int i, const float dist) const;
+
+public:
+	CGamutCompression(mp_csp_prim csp_in, mp_csp_prim csp_out);
+
+	// src is the linear source RGB in the [0,1] range, dst is the linear target RGB in the [0,1] range
+	void Convert(float dst[3], const float src[3]) const;
+
+	// the conversion matrix without the compression
+	const float (&GetMatrix() const)[3][3] { return m_matrix; }
+	// distances from the achromatic axis below the threshold are not changed
+	float GetThreshold(const int i) const { return m_thresholds[i]; }
+};
+
+// Returns the cached gamut compression LUT for the (csp_in, csp_out) pair.
+// The LUT has GAMUT_LUT_SIZE^3 RGB entries (R changes fastest), is addressed
+// by GAMUT_LUT_GAMMA encoded source RGB and contains linear light target RGB in the [0,1] range.
+// csp_in and csp_out must be valid values.
+const std::vector<float>& GetGamutCompressionLut(mp_csp_prim csp_in, mp_csp_prim csp_out);
+
+// Returns the source primaries for the gamut compression LUT, BT.2020 is used for HDR video with other primaries
+inline mp_csp_prim GetWideGamutPrimaries(const UINT videoPrimaries)
+{
+	return (videoPrimaries == MFVideoPrimaries_DCI_P3) ? MP_CSP_PRIM_DCI_P3 : MP_CSP_PRIM_BT_2020;
+}
@@ -20,6 +20,7 @@
 
 #include "stdafx.h"
 #include <memory>
+#include <immintrin.h>
 #include <wincodec.h>
 #include "Utils/CPUInfo.h"
 #include "Utils/gpu_memcpy_sse4.h"
@@ -912,6 +913,208 @@ void fill_u32(void* dst, const uint32_t c, const size_t count)
 #endif
 }
 
+// index of the first pixel that is not equal to c, count if there is none
+static int FirstNotEqual_u32(const uint32_t* p, const int count, const uint32_t c, const bool bAVX2)
+{
+	int i = 0;
+	unsigned long bit;
+
+	if (bAVX2) {
+		const __m256i vc = _mm256_set1_epi32((int)c);
+		// 32 pixels per step for the empty lines, then 8 pixels to find the pixel
+		for (; i + 32 <= count; i += 32) {
+			const __m256i x0 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(p + i)), vc);
+			const __m256i x1 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(p + i + 8)), vc);
+			const __m256i x2 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(p + i + 16)), vc);
+			const __m256i x3 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(p + i + 24)), vc);
+			const __m256i x = _mm256_or_si256(_mm256_or_si256(x0, x1), _mm256_or_si256(x2, x3));
+			if (!_mm256_testz_si256(x, x)) {
+				break;
+			}
+		}
+		for (; i + 8 <= count; i += 8) {
+			const __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(p + i)), vc);
+			const unsigned mask = ~(unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(eq)) & 0xFF;
+			if (mask) {
+				_BitScanForward(&bit, mask);
+				return i + (int)bit;
+			}
+		}
+	}
+	else {
+		const __m128i vc = _mm_set1_epi32((int)c);
+		for (; i + 4 <= count; i += 4) {
+			const __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(p + i)), vc);
+			const unsigned mask = ~(unsigned)_mm_movemask_ps(_mm_castsi128_ps(eq)) & 0xF;
+			if (mask) {
+				_BitScanForward(&bit, mask);
+				return i + (int)bit;
+			}
+		}
+	}
+
+	for (; i < count; i++) {
+		if (p[i] != c) {
+			return i;
+		}
+	}
+	return count;
+}
+
+// index of the last pixel that is not equal to c, -1 if there is none
+static int LastNotEqual_u32(const uint32_t* p, const int count, const uint32_t c, const bool bAVX2)
+{
+	int i = count;
+	unsigned long bit;
+
+	if (bAVX2) {
+		const __m256i vc = _mm256_set1_epi32((int)c);
+		for (; i >= 32; i -= 32) {
+			const __m256i x0 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(p + i - 32)), vc);
+			const __m256i x1 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(p + i - 24)), vc);
+			const __m256i x2 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(p + i - 16)), vc);
+			const __m256i x3 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(p + i - 8)), vc);
+			const __m256i x = _mm256_or_si256(_mm256_or_si256(x0, x1), _mm256_or_si256(x2, x3));
+			if (!_mm256_testz_si256(x, x)) {
+				break;
+			}
+		}
+		for (; i >= 8; i -= 8) {
+			const __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(p + i - 8)), vc);
+			const unsigned mask = ~(unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(eq)) & 0xFF;
+			if (mask) {
+				_BitScanReverse(&bit, mask);
+				return i - 8 + (int)bit;
+			}
+		}
+	}
+	else {
+		const __m128i vc = _mm_set1_epi32((int)c);
+		for (; i >= 4; i -= 4) {
+			const __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(p + i - 4)), vc);
+			const unsigned mask = ~(unsigned)_mm_movemask_ps(_mm_castsi128_ps(eq)) & 0xF;
+			if (mask) {
+				_BitScanReverse(&bit, mask);
+				return i - 4 + (int)bit;
+			}
+		}
+	}
+
+	while (--i >= 0) {
+		if (p[i] != c) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+bool GetBoundingRect_u32(const uint32_t* data, const UINT pitch, const RECT& rect, const uint32_t c, RECT& result)
+{
+	static const bool bAVX2 = CPUInfo::HaveAVX2();
+
+	const int width = rect.right - rect.left;
+	if (width <= 0 || rect.bottom <= rect.top) {
+		return false;
+	}
+	auto Line = [&](const int y) { return data + (size_t)pitch * y + rect.left; };
+
+	// the whole lines above and below the pixels
+	int top = rect.top;
+	while (top < rect.bottom && FirstNotEqual_u32(Line(top), width, c, bAVX2) == width) {
+		top++;
+	}
+	if (top == rect.bottom) {
+		return false;
+	}
+	int bottom = rect.bottom;
+	while (LastNotEqual_u32(Line(bottom - 1), width, c, bAVX2) < 0) {
+		bottom--;
+	}
+
+	// only the part of each line outside of the found columns
+	int left = width;
+	int right = 0;
+	for (int y = top; y < bottom; y++) {
+		const uint32_t* line = Line(y);
+		if (left) {
+			left = FirstNotEqual_u32(line, left, c, bAVX2);
+		}
+		if (right < width) {
+			const int start = std::max(right, left);
+			const int last = LastNotEqual_u32(line + start, width - start, c, bAVX2);
+			if (last >= 0) {
+				right = start + last + 1;
+			}
+		}
+	}
+
+	result = { rect.left + left, top, rect.left + right, bottom };
+	return true;
+}
+
+static inline uint64_t Mix64(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCDull;
+	h ^= h >> 33;
+	h *= 0xC4CEB9FE1A85EC53ull;
+	h ^= h >> 33;
+	return h;
+}
+
+uint64_t Hash_u32(const uint32_t* data, const UINT pitch, const RECT& rect, const uint64_t seed)
+{
+	static const bool bAVX2 = CPUInfo::HaveAVX2();
+	constexpr uint64_t kPrime = 0x100000001B3ull;
+
+	const int width = rect.right - rect.left;
+	const int height = rect.bottom - rect.top;
+	uint64_t h = Mix64(seed ^ ((uint64_t)(uint32_t)width << 32 | (uint32_t)height));
+	if (width <= 0 || height <= 0) {
+		return h;
+	}
+
+	for (int y = rect.top; y < rect.bottom; y++) {
+		const uint32_t* p = data + (size_t)pitch * y + rect.left;
+		int x = 0;
+
+		if (bAVX2 && width >= 8) {
+			// eight lanes of two 32-bit states, each lane hashes every eighth pixel
+			const __m256i k1 = _mm256_set1_epi32((int)0x9E3779B1);
+			const __m256i k2 = _mm256_set1_epi32((int)0x85EBCA77);
+			__m256i a = _mm256_set1_epi32((int)h);
+			__m256i b = _mm256_set1_epi32((int)(h >> 32));
+			for (; x + 8 <= width; x += 8) {
+				const __m256i v = _mm256_loadu_si256((const __m256i*)(p + x));
+				a = _mm256_mullo_epi32(_mm256_xor_si256(a, v), k1);
+				a = _mm256_xor_si256(a, _mm256_srli_epi32(a, 15));
+				b = _mm256_mullo_epi32(_mm256_add_epi32(b, v), k2);
+				b = _mm256_xor_si256(b, _mm256_srli_epi32(b, 13));
+			}
+			alignas(32) uint32_t la[8];
+			alignas(32) uint32_t lb[8];
+			_mm256_store_si256((__m256i*)la, a);
+			_mm256_store_si256((__m256i*)lb, b);
+			for (int i = 0; i < 8; i++) {
+				h = (h ^ ((uint64_t)la[i] << 32 | lb[i])) * kPrime;
+			}
+		} else {
+			for (; x + 2 <= width; x += 2) {
+				uint64_t v;
+				memcpy(&v, p + x, 8);
+				h = (h ^ v) * kPrime;
+				h = _rotl64(h, 31);
+			}
+		}
+
+		for (; x < width; x++) {
+			h = (h ^ p[x]) * kPrime;
+		}
+	}
+
+	return Mix64(h);
+}
+
 void ClipToSurface(const int texW, const int texH, RECT& s, RECT& d)
 {
 	const int sw = s.right - s.left;
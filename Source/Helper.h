@@ -201,6 +201,14 @@ void ConvertR10G10B10A2toBGR64(const UINT lines, BYTE* dst, UINT dst_pitch, cons
 
 void fill_u32(void* dst, const uint32_t c, const size_t count);
 
+// The smallest rect with all pixels of 'rect' that are not equal to c, false if there is none.
+// 'pitch' is in pixels. AVX2 is used if the CPU supports it.
+bool GetBoundingRect_u32(const uint32_t* data, const UINT pitch, const RECT& rect, const uint32_t c, RECT& result);
+
+// A 64-bit hash of the pixels of 'rect' and its size to find identical pictures, it is not a cryptographic hash.
+// The value depends on the CPU, it must not be stored. 'pitch' is in pixels. AVX2 is used if the CPU supports it.
+uint64_t Hash_u32(const uint32_t* data, const UINT pitch, const RECT& rect, const uint64_t seed);
+
 void ClipToSurface(const int texW, const int texH, RECT& s, RECT& d);
 
 void set_colorspace(const DXVA2_ExtendedFormat extfmt, mp_colorspace& colorspace);
@@ -0,0 +1,182 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "stdafx.h"
+#include <cmath>
+#include "RefreshRateEstimator.h"
+
+void CRefreshRateEstimator::Reset()
+{
+	m_count = 0;
+	m_pos = 0;
+	m_sinceFit = 0;
+	m_lastIndex = 0;
+	m_lastRefreshCount = 0;
+	m_lastTime = 0;
+	m_period = 0;
+	SetRate({});
+}
+
+void CRefreshRateEstimator::SetRate(const Rate_t& rate)
+{
+	std::lock_guard<std::mutex> lock(m_rateMutex);
+	m_rate = rate;
+}
+
+void CRefreshRateEstimator::SetNominalRate(const double rate)
+{
+	const double period = rate > 0 ? 1.0 / rate : 0;
+	if (std::abs(period - m_nominalPeriod) > m_nominalPeriod * 0.001) {
+		Reset();
+	}
+	m_nominalPeriod = period;
+}
+
+void CRefreshRateEstimator::AddVsync(const double time, const uint32_t refreshCount)
+{
+	int64_t index = 0;
+
+	if (m_count) {
+		const double dt = time - m_lastTime;
+		if (refreshCount) {
+			if (refreshCount == m_lastRefreshCount) {
+				return;
+			}
+			index = m_lastIndex + (int32_t)(refreshCount - m_lastRefreshCount);
+		} else {
+			const double period = m_period > 0 ? m_period : m_nominalPeriod;
+			if (period <= 0) {
+				return;
+			}
+			const double n = std::round(dt / period);
+			if (n < 1) {
+				return; // the same vsync
+			}
+			index = m_lastIndex + (int64_t)n;
+		}
+
+		if (index <= m_lastIndex || dt <= 0 || dt > 1.0) {
+			// the counter was reset, the clock jumped or there is a long pause
+			Reset();
+			index = 0;
+		}
+	}
+
+	m_samples[m_pos] = { index, time };
+	m_pos = (m_pos + 1) % kWindow;
+	if (m_count < kWindow) {
+		m_count++;
+	}
+	m_lastIndex = index;
+	m_lastRefreshCount = refreshCount;
+	m_lastTime = time;
+
+	if (m_count >= kMinSamples && ++m_sinceFit >= kFitInterval) {
+		m_sinceFit = 0;
+		Fit();
+	}
+}
+
+void CRefreshRateEstimator::Fit()
+{
+	// relative to the oldest sample, so the sums keep their precision
+	const unsigned first = (m_pos + kWindow - m_count) % kWindow;
+	const int64_t index0 = m_samples[first].index;
+	const double time0 = m_samples[first].time;
+
+	for (unsigned i = 0; i < m_count; i++) {
+		const auto& s = m_samples[(first + i) % kWindow];
+		m_x[i] = (double)(s.index - index0);
+		m_y[i] = s.time - time0;
+		m_w[i] = 1.0;
+	}
+
+	double slope = 0, intercept = 0, sxx = 0, sw = 0;
+	auto WeightedFit = [&]() {
+		double sx = 0, sy = 0;
+		sw = 0;
+		for (unsigned i = 0; i < m_count; i++) {
+			sw += m_w[i];
+			sx += m_w[i] * m_x[i];
+			sy += m_w[i] * m_y[i];
+		}
+		const double mx = sx / sw;
+		const double my = sy / sw;
+		double sxy = 0;
+		sxx = 0;
+		for (unsigned i = 0; i < m_count; i++) {
+			const double dx = m_x[i] - mx;
+			sxx += m_w[i] * dx * dx;
+			sxy += m_w[i] * dx * (m_y[i] - my);
+		}
+		if (sxx <= 0) {
+			return false;
+		}
+		slope = sxy / sxx;
+		intercept = my - slope * mx;
+		for (unsigned i = 0; i < m_count; i++) {
+			m_r[i] = m_y[i] - (intercept + slope * m_x[i]);
+		}
+		return true;
+	};
+
+	if (!WeightedFit()) {
+		return;
+	}
+
+	// iteratively reweighted least squares, the scale is the median absolute residual
+	for (int iter = 0; iter < 3; iter++) {
+		for (unsigned i = 0; i < m_count; i++) {
+			m_a[i] = std::abs(m_r[i]);
+		}
+		std::nth_element(m_a, m_a + m_count / 2, m_a + m_count);
+		const double sigma = 1.4826 * m_a[m_count / 2];
+		const double c = std::max(1.5 * sigma, 1e-7); // not below the 100 ns resolution of the time stamps
+
+		for (unsigned i = 0; i < m_count; i++) {
+			const double ar = std::abs(m_r[i]);
+			m_w[i] = ar <= c ? 1.0 : c / ar;
+		}
+		if (!WeightedFit()) {
+			return;
+		}
+	}
+
+	if (slope <= 0) {
+		return;
+	}
+
+	double swrr = 0;
+	for (unsigned i = 0; i < m_count; i++) {
+		swrr += m_w[i] * m_r[i] * m_r[i];
+	}
+	const double slopeError = std::sqrt(swrr / std::max(sw - 2.0, 1.0) / sxx);
+
+	m_period = slope;
+	SetRate({ 1.0 / slope, slopeError / (slope * slope) });
+}
+
+bool CRefreshRateEstimator::GetRate(double& rate, double& rateError) const
+{
+	std::lock_guard<std::mutex> lock(m_rateMutex);
+	rate = m_rate.rate;
+	rateError = m_rate.error;
+	return rate > 0;
+}
@@ -0,0 +1,86 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <mutex>
+
+//
+// Estimates the real display refresh rate from vsync time stamps.
+// The vsync times are fitted by a line (time = a + period * vsync index) over a sliding window
+// using least squares with Huber weights, so single late time stamps do not move the result.
+// No Windows API is used, the math can be checked with synthetic time stamps.
+//
+
+class CRefreshRateEstimator
+{
+public:
+	static constexpr unsigned kWindow = 256;     // vsync time stamps in the sliding window
+	static constexpr unsigned kMinSamples = 32;  // time stamps required for the first estimate
+	static constexpr unsigned kFitInterval = 16; // new time stamps between fits
+
+private:
+	struct Sample_t {
+		int64_t index; // vsync number
+		double time;   // in seconds
+	};
+	Sample_t m_samples[kWindow] = {};
+	unsigned m_count = 0;
+	unsigned m_pos = 0;
+	unsigned m_sinceFit = 0;
+
+	double m_nominalPeriod = 0; // in seconds, used to number vsyncs without a refresh counter
+	int64_t m_lastIndex = 0;
+	uint32_t m_lastRefreshCount = 0;
+	double m_lastTime = 0;
+
+	double m_period = 0;
+
+	// buffers of Fit(), too large for the stack
+	double m_x[kWindow] = {};
+	double m_y[kWindow] = {};
+	double m_w[kWindow] = {};
+	double m_r[kWindow] = {};
+	double m_a[kWindow] = {};
+
+	// the result, it is read from other threads
+	struct Rate_t {
+		double rate  = 0; // Hz
+		double error = 0; // standard error in Hz
+	};
+	mutable std::mutex m_rateMutex;
+	Rate_t m_rate;
+
+	void SetRate(const Rate_t& rate);
+	void Fit();
+
+public:
+	void Reset();
+
+	// The rate reported by the system, vsyncs without a refresh counter are numbered with it
+	void SetNominalRate(const double rate);
+
+	// time is in seconds, refreshCount is the vsync counter (DXGI_FRAME_STATISTICS::SyncRefreshCount) or 0 if unknown.
+	// Repeated time stamps of the same vsync are ignored.
+	void AddVsync(const double time, const uint32_t refreshCount);
+
+	// Returns false if there is no estimate yet
+	bool GetRate(double& rate, double& rateError) const;
+};
@@ -0,0 +1,174 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "stdafx.h"
+#include "Utils/Util.h"
+#include "RenderGraph.h"
+
+void CRenderGraph::Reset()
+{
+	m_Textures.clear();
+	m_Imported.clear();
+	m_Passes.clear();
+
+	m_ActivePasses.clear();
+	m_Physical.clear();
+	m_PhysicalDescs.clear();
+	m_PeakBytes = 0;
+	m_UnaliasedBytes = 0;
+}
+
+int CRenderGraph::AddTexture(const RenderTexDesc_t& desc)
+{
+	m_Textures.emplace_back(desc);
+	m_Imported.emplace_back(false);
+	return (int)m_Textures.size() - 1;
+}
+
+int CRenderGraph::ImportTexture(const RenderTexDesc_t& desc)
+{
+	m_Textures.emplace_back(desc);
+	m_Imported.emplace_back(true);
+	return (int)m_Textures.size() - 1;
+}
+
+void CRenderGraph::AddPass(const wchar_t* name, const int op, const int input, const int output, const bool bNoOp)
+{
+	ASSERT(input >= External && input < (int)m_Textures.size());
+	ASSERT(output >= External && output < (int)m_Textures.size());
+
+	m_Passes.push_back({ name, op, input, output, bNoOp });
+}
+
+bool CRenderGraph::Compile()
+{
+	const int numTextures = (int)m_Textures.size();
+
+	m_ActivePasses.clear();
+	m_Physical.assign(numTextures, External);
+	m_PhysicalDescs.clear();
+	m_PeakBytes = 0;
+	m_UnaliasedBytes = 0;
+
+	// remove no-op passes, the following passes read the input of the removed pass
+	std::vector<int> alias(numTextures);
+	for (int i = 0; i < numTextures; i++) {
+		alias[i] = i;
+	}
+	auto Resolve = [&](int tex) {
+		while (tex != External && alias[tex] != tex) {
+			tex = alias[tex];
+		}
+		return tex;
+	};
+
+	for (const auto& pass : m_Passes) {
+		const int input = Resolve(pass.input);
+		// a pass to the render target or to an imported texture must be kept, something has to write there
+		if (pass.bNoOp && pass.output != External && !m_Imported[pass.output]) {
+			alias[pass.output] = input;
+			continue;
+		}
+		m_ActivePasses.push_back({ pass.name, pass.op, input, pass.output, false });
+	}
+
+	// texture lifetimes in active pass indexes
+	std::vector<int> first(numTextures, INT_MAX);
+	std::vector<int> last(numTextures, -1);
+	for (int i = 0; i < (int)m_ActivePasses.size(); i++) {
+		const auto& pass = m_ActivePasses[i];
+		if (pass.output != External) {
+			if (first[pass.output] != INT_MAX) {
+				DLog(L"CRenderGraph::Compile() : texture {} is written twice", pass.output);
+				return false;
+			}
+			first[pass.output] = i;
+			last[pass.output] = std::max(last[pass.output], i);
+		}
+		if (pass.input != External) {
+			if (first[pass.input] > i) {
+				DLog(L"CRenderGraph::Compile() : texture {} is read before it is written", pass.input);
+				return false;
+			}
+			last[pass.input] = i;
+		}
+	}
+
+	// greedy assignment, a physical texture is free after the last pass that reads it
+	std::vector<int> physicalLast;
+	for (int i = 0; i < (int)m_ActivePasses.size(); i++) {
+		const int tex = m_ActivePasses[i].output;
+		if (tex == External || m_Imported[tex]) {
+			continue;
+		}
+
+		const auto& desc = m_Textures[tex];
+		int index = External;
+		for (int p = 0; p < (int)m_PhysicalDescs.size(); p++) {
+			if (physicalLast[p] < i && m_PhysicalDescs[p] == desc) {
+				index = p;
+				break;
+			}
+		}
+		if (index == External) {
+			m_PhysicalDescs.emplace_back(desc);
+			physicalLast.emplace_back(-1);
+			index = (int)m_PhysicalDescs.size() - 1;
+		}
+		m_Physical[tex] = index;
+		physicalLast[index] = last[tex];
+		m_UnaliasedBytes += desc.Bytes();
+	}
+
+	// peak memory of textures alive at the same time
+	for (int i = 0; i < (int)m_ActivePasses.size(); i++) {
+		UINT64 bytes = 0;
+		for (int tex = 0; tex < numTextures; tex++) {
+			if (m_Physical[tex] != External && first[tex] <= i && i <= last[tex]) {
+				bytes += m_Textures[tex].Bytes();
+			}
+		}
+		m_PeakBytes = std::max(m_PeakBytes, bytes);
+	}
+
+	return true;
+}
+
+int CRenderGraph::GetPhysicalIndex(const int texture) const
+{
+	if (texture < 0 || texture >= (int)m_Physical.size()) {
+		return External;
+	}
+	return m_Physical[texture];
+}
+
+UINT CRenderGraph::GetPhysicalCount(const RenderTexDesc_t& desc) const
+{
+	return (UINT)std::count(m_PhysicalDescs.begin(), m_PhysicalDescs.end(), desc);
+}
+
+UINT64 CRenderGraph::GetAllocatedBytes() const
+{
+	UINT64 bytes = 0;
+	for (const auto& desc : m_PhysicalDescs) {
+		bytes += desc.Bytes();
+	}
+	return bytes;
+}
@@ -0,0 +1,89 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+//
+// A small planner for the render passes of a video processor.
+// Passes are described declaratively, passes that do nothing are removed,
+// and intermediate textures with disjoint lifetimes are assigned to the same
+// physical texture. It does not depend on Direct3D.
+//
+
+struct RenderTexDesc_t {
+	UINT format = 0; // DXGI_FORMAT or D3DFORMAT, only compared for equality
+	UINT width  = 0;
+	UINT height = 0;
+	UINT bpp    = 0; // bytes per pixel
+
+	UINT64 Bytes() const { return (UINT64)width * height * bpp; }
+	bool operator==(const RenderTexDesc_t&) const = default;
+};
+
+class CRenderGraph
+{
+public:
+	// the source texture or the render target, they are not managed by the planner
+	static constexpr int External = -1;
+
+	struct Pass_t {
+		const wchar_t* name;
+		int op; // the operation, defined by the caller
+		int input;
+		int output;
+		bool bNoOp; // the output is the same as the input
+	};
+
+private:
+	std::vector<RenderTexDesc_t> m_Textures;
+	std::vector<bool> m_Imported;
+	std::vector<Pass_t> m_Passes;
+
+	// compiled plan
+	std::vector<Pass_t> m_ActivePasses;
+	std::vector<int> m_Physical; // physical texture index for each texture, or External if the texture is not used
+	std::vector<RenderTexDesc_t> m_PhysicalDescs;
+	UINT64 m_PeakBytes = 0;
+	UINT64 m_UnaliasedBytes = 0;
+
+public:
+	void Reset();
+
+	// an intermediate texture, it can share a physical texture with others
+	int AddTexture(const RenderTexDesc_t& desc);
+	// a texture owned by the caller, it is never aliased and has no physical texture
+	int ImportTexture(const RenderTexDesc_t& desc);
+	void AddPass(const wchar_t* name, const int op, const int input, const int output, const bool bNoOp = false);
+
+	// Removes no-op passes, computes texture lifetimes and assigns physical textures
+	bool Compile();
+
+	const std::vector<Pass_t>& GetActivePasses() const { return m_ActivePasses; }
+	const RenderTexDesc_t& GetTextureDesc(const int texture) const { return m_Textures[texture]; }
+	bool IsImported(const int texture) const { return texture != External && m_Imported[texture]; }
+	int GetPhysicalIndex(const int texture) const;
+	UINT GetPhysicalCount() const { return (UINT)m_PhysicalDescs.size(); }
+	UINT GetPhysicalCount(const RenderTexDesc_t& desc) const;
+	const RenderTexDesc_t& GetPhysicalDesc(const UINT index) const { return m_PhysicalDescs[index]; }
+
+	UINT64 GetAllocatedBytes() const; // memory of all physical textures
+	UINT64 GetPeakBytes() const { return m_PeakBytes; } // max memory of intermediate textures used by one pass
+	UINT64 GetUnaliasedBytes() const { return m_UnaliasedBytes; } // memory without texture aliasing
+};
@@ -0,0 +1,401 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "stdafx.h"
+#include <set>
+#include "ShaderFusion.h"
+
+// The shaders are combined on the token level. The source has already passed the preprocessor,
+// so the macros of one shader can not affect the others, and the generated code uses no macros.
+
+enum TokenType_t {
+	TOKEN_SPACE, // white space and comments
+	TOKEN_IDENT,
+	TOKEN_NUMBER,
+	TOKEN_PUNCT,
+	TOKEN_DIRECTIVE,
+};
+
+struct Token_t {
+	TokenType_t type;
+	std::string text;
+};
+
+static inline bool IsIdentChar(const char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+static inline bool IsDigit(const char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+static std::vector<Token_t> Tokenize(const std::string& code)
+{
+	std::vector<Token_t> tokens;
+	bool bLineStart = true;
+	size_t i = 0;
+
+	while (i < code.size()) {
+		const char c = code[i];
+		const size_t start = i;
+
+		if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v') {
+			while (i < code.size() && (code[i] == ' ' || code[i] == '\t' || code[i] == '\r' || code[i] == '\n' || code[i] == '\f' || code[i] == '\v')) {
+				bLineStart = bLineStart || code[i] == '\n';
+				i++;
+			}
+			tokens.push_back({ TOKEN_SPACE, code.substr(start, i - start) });
+			continue;
+		}
+
+		if (c == '/' && i + 1 < code.size() && code[i + 1] == '/') {
+			i = code.find('\n', i);
+			if (i == code.npos) {
+				i = code.size();
+			}
+			tokens.push_back({ TOKEN_SPACE, " " });
+			continue;
+		}
+		if (c == '/' && i + 1 < code.size() && code[i + 1] == '*') {
+			i = code.find("*/", i + 2);
+			i = (i == code.npos) ? code.size() : i + 2;
+			tokens.push_back({ TOKEN_SPACE, " " });
+			continue;
+		}
+
+		if (c == '#' && bLineStart) {
+			while (i < code.size() && code[i] != '\n') {
+				if (code[i] == '\\' && i + 1 < code.size() && (code[i + 1] == '\n' || code[i + 1] == '\r')) {
+					i = code.find('\n', i + 1);
+					if (i == code.npos) {
+						i = code.size();
+						break;
+					}
+				}
+				i++;
+			}
+			tokens.push_back({ TOKEN_DIRECTIVE, code.substr(start, i - start) });
+			continue;
+		}
+
+		bLineStart = false;
+
+		if (IsIdentChar(c) && !IsDigit(c)) {
+			while (i < code.size() && IsIdentChar(code[i])) {
+				i++;
+			}
+			tokens.push_back({ TOKEN_IDENT, code.substr(start, i - start) });
+		}
+		else if (IsDigit(c) || (c == '.' && i + 1 < code.size() && IsDigit(code[i + 1]))) {
+			i++;
+			while (i < code.size()) {
+				const char prev = code[i - 1];
+				if (IsIdentChar(code[i]) || code[i] == '.' || ((code[i] == '+' || code[i] == '-') && (prev == 'e' || prev == 'E'))) {
+					i++;
+				} else {
+					break;
+				}
+			}
+			tokens.push_back({ TOKEN_NUMBER, code.substr(start, i - start) });
+		}
+		else if (c == '"') {
+			i = code.find('"', i + 1);
+			i = (i == code.npos) ? code.size() : i + 1;
+			tokens.push_back({ TOKEN_PUNCT, code.substr(start, i - start) });
+		}
+		else {
+			i++;
+			tokens.push_back({ TOKEN_PUNCT, std::string(1, c) });
+		}
+	}
+
+	return tokens;
+}
+
+// the index of the first token from i that is not a space, or the size of tokens
+static size_t SkipSpace(const std::vector<Token_t>& tokens, size_t i)
+{
+	while (i < tokens.size() && tokens[i].type == TOKEN_SPACE) {
+		i++;
+	}
+	return i;
+}
+
+static inline size_t NextToken(const std::vector<Token_t>& tokens, const size_t i)
+{
+	return SkipSpace(tokens, i + 1);
+}
+
+static const Token_t* PrevToken(const std::vector<Token_t>& tokens, size_t i)
+{
+	while (i-- > 0) {
+		if (tokens[i].type != TOKEN_SPACE) {
+			return &tokens[i];
+		}
+	}
+	return nullptr;
+}
+
+static inline bool IsPunct(const Token_t* token, const char c)
+{
+	return token && token->type == TOKEN_PUNCT && token->text.size() == 1 && token->text[0] == c;
+}
+
+static inline bool IsIdent(const Token_t* token, const char* text)
+{
+	return token && token->type == TOKEN_IDENT && token->text == text;
+}
+
+// Splits the global scope into declarations. A declaration ends with ';' or with '}' of a function body.
+static std::vector<std::vector<Token_t>> SplitDeclarations(const std::vector<Token_t>& tokens)
+{
+	std::vector<std::vector<Token_t>> decls(1);
+	int depth = 0;
+
+	for (size_t i = 0; i < tokens.size(); i++) {
+		const Token_t& token = tokens[i];
+		decls.back().push_back(token);
+		if (token.type != TOKEN_PUNCT) {
+			continue;
+		}
+
+		bool bEnd = false;
+		switch (token.text[0]) {
+		case '(': case '[': case '{':
+			depth++;
+			break;
+		case ')': case ']': case '}':
+			depth--;
+			if (token.text[0] == '}' && depth == 0) {
+				const size_t next = NextToken(tokens, i);
+				bEnd = (next == tokens.size() || !IsPunct(&tokens[next], ';'));
+			}
+			break;
+		case ';':
+			bEnd = (depth == 0);
+			break;
+		}
+		if (bEnd) {
+			decls.emplace_back();
+		}
+	}
+
+	return decls;
+}
+
+// Adds the names declared in the global scope: functions, variables, objects and structures.
+static void AddDeclaredNames(std::set<std::string>& names, const std::vector<Token_t>& decl)
+{
+	int depth = 0;
+	bool bInitializer = false;
+
+	for (size_t i = 0; i < decl.size(); i++) {
+		const Token_t& token = decl[i];
+		if (token.type == TOKEN_PUNCT) {
+			switch (token.text[0]) {
+			case '(': case '[': case '{':
+				depth++;
+				break;
+			case ')': case ']': case '}':
+				depth--;
+				break;
+			case '=':
+				bInitializer = bInitializer || depth == 0;
+				break;
+			case ',': case ';':
+				bInitializer = bInitializer && depth != 0;
+				break;
+			}
+			continue;
+		}
+		if (token.type != TOKEN_IDENT || depth != 0 || bInitializer) {
+			continue;
+		}
+
+		const Token_t* prev = PrevToken(decl, i);
+		const size_t next = NextToken(decl, i);
+		if (IsIdent(prev, "struct")) {
+			names.insert(token.text);
+		}
+		else if (!IsPunct(prev, ':') && next < decl.size() && decl[next].type == TOKEN_PUNCT
+				&& std::string_view("(;=[,:{").find(decl[next].text[0]) != std::string_view::npos) {
+			names.insert(token.text);
+		}
+	}
+}
+
+static bool GetFusedPart(std::string& part, const PointwiseShader_t& shader, const size_t k)
+{
+	std::vector<Token_t> tokens = Tokenize(shader.code);
+
+	// only the line information of the preprocessor may remain
+	for (auto& token : tokens) {
+		if (token.type == TOKEN_DIRECTIVE) {
+			std::string_view directive(token.text);
+			directive.remove_prefix(1);
+			directive.remove_prefix(std::min(directive.find_first_not_of(" \t"), directive.size()));
+			if (!directive.starts_with("line") && !directive.starts_with("pragma")) {
+				return false;
+			}
+			token = { TOKEN_SPACE, "\n" };
+		}
+	}
+
+	std::vector<Token_t> globals;
+	std::set<std::string> names;
+
+	for (auto& decl : SplitDeclarations(tokens)) {
+		const size_t first = SkipSpace(decl, 0);
+		if (first < decl.size() && (IsIdent(&decl[first], "cbuffer") || IsIdent(&decl[first], "tbuffer"))) {
+			continue; // replaced by the shared constant buffer
+		}
+
+		if (k > 0) {
+			// the input texture is replaced with the result of the previous shader
+			if (first < decl.size() && decl[first].type == TOKEN_IDENT && decl[first].text.starts_with("Texture")
+					&& std::any_of(decl.begin(), decl.end(), [&](const Token_t& token) { return token.type == TOKEN_IDENT && token.text == shader.texName; })) {
+				continue;
+			}
+			// the registers are bound only for the first shader
+			for (size_t i = 0; i < decl.size(); i++) {
+				if (IsIdent(&decl[i], "register") && IsPunct(PrevToken(decl, i), ':')) {
+					size_t end = NextToken(decl, i);
+					if (end < decl.size() && IsPunct(&decl[end], '(')) {
+						while (end < decl.size() && !IsPunct(&decl[end], ')')) {
+							end++;
+						}
+					}
+					size_t colon = i;
+					while (!IsPunct(&decl[colon], ':')) {
+						colon--;
+					}
+					decl.erase(decl.begin() + colon, decl.begin() + std::min(end + 1, decl.size()));
+					i = colon;
+				}
+			}
+		}
+
+		AddDeclaredNames(names, decl);
+		globals.insert(globals.end(), decl.begin(), decl.end());
+	}
+
+	if (!names.contains("main")) {
+		return false;
+	}
+
+	const std::string prefix = std::format("fused{}_", k);
+	part.clear();
+
+	for (size_t i = 0; i < globals.size(); i++) {
+		const Token_t& token = globals[i];
+		const Token_t* prev = PrevToken(globals, i);
+		if (token.type != TOKEN_IDENT || IsPunct(prev, '.')) {
+			part += token.text;
+			continue;
+		}
+
+		if (k > 0 && token.text == shader.texName) {
+			const size_t dot = NextToken(globals, i);
+			const size_t method = NextToken(globals, dot);
+			const size_t paren = NextToken(globals, method);
+			if (paren < globals.size() && IsPunct(&globals[dot], '.') && IsIdent(&globals[method], "Sample") && IsPunct(&globals[paren], '(')) {
+				part += "FusedSample(";
+				i = paren;
+				continue;
+			}
+		}
+
+		if (names.contains(token.text)) {
+			part += prefix + token.text;
+			continue;
+		}
+
+		auto it = std::find_if(shader.constants.begin(), shader.constants.end(), [&](const auto& constant) { return constant.first == token.text; });
+		if (it != shader.constants.end()) {
+			// a local variable with the name of a constant can not be replaced
+			if (prev && prev->type == TOKEN_IDENT && prev->text != "return") {
+				return false;
+			}
+			part += '(' + it->second + ')';
+			continue;
+		}
+
+		part += token.text;
+	}
+
+	return true;
+}
+
+std::string GetFusedPointwiseCode(const std::vector<const PointwiseShader_t*>& shaders, const bool bClamp)
+{
+	if (shaders.size() < 2) {
+		return {};
+	}
+
+	UINT cbufferSize = 0;
+	for (const auto& shader : shaders) {
+		cbufferSize = std::max(cbufferSize, shader->cbufferSize);
+	}
+
+	// the result of the previous shader replaces the sampling of the input texture
+	std::string code(
+		"static float4 fused_color;\n"
+		"float4 FusedSample(SamplerState s, float2 coord) { return fused_color; }\n"
+	);
+	if (cbufferSize) {
+		code += std::format("cbuffer PS_FUSED_CONSTANTS : register(b0) {{ float4 fused_cb[{}]; }};\n", (cbufferSize + 15) / 16);
+	}
+
+	for (size_t k = 0; k < shaders.size(); k++) {
+		std::string part;
+		if (!GetFusedPart(part, *shaders[k], k)) {
+			return {};
+		}
+		code += part;
+		code += '\n';
+	}
+
+	code.append(
+		"float4 main(float4 pos : SV_POSITION, float2 coord : TEXCOORD) : SV_Target\n"
+		"{\n"
+	);
+	for (size_t k = 0; k < shaders.size(); k++) {
+		std::string args;
+		for (const auto& arg : shaders[k]->args) {
+			if (args.size()) {
+				args += ", ";
+			}
+			args += arg;
+		}
+		code += std::format("fused_color = fused{}_main({});\n", k, args);
+		if (bClamp && k + 1 < shaders.size()) {
+			code += "fused_color = saturate(fused_color);\n";
+		}
+	}
+	code.append(
+		"return fused_color;\n"
+		"}\n"
+	);
+
+	return code;
+}
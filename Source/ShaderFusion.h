@@ -0,0 +1,39 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#pragma once
+
+// A pointwise pixel shader only samples its input texture at the current texture coordinates,
+// so several of them can be combined into one pass.
+struct PointwiseShader_t {
+	std::string code;    // the source after the preprocessor, without macros
+	std::string texName; // the input texture
+	std::vector<std::string> args; // arguments of the entry point in the order of the input signature
+	std::vector<std::pair<std::string, std::string>> constants; // cbuffer variable name and its expression in fused_cb
+	UINT cbufferSize = 0;
+};
+
+// Generates one pixel shader that applies the pointwise shaders one after another.
+// Each shader becomes a separate set of renamed functions and variables, the result of the previous
+// shader replaces the input texture sample of the next one. No macros are generated.
+// bClamp - the separate passes write to UNORM textures, the result of each shader except the last is clamped to [0, 1].
+// Returns an empty string if the shaders can not be combined.
+std::string GetFusedPointwiseCode(const std::vector<const PointwiseShader_t*>& shaders, const bool bClamp = false);
@@ -20,31 +20,46 @@
 
 #include "stdafx.h"
 #include <D3Dcompiler.h>
+#include <d3d11shader.h>
 #include "Helper.h"
 #include "resource.h"
 #include "IVideoRenderer.h"
 #include "Shaders.h"
+#include "GamutLut.h"
+#include "FrameTrace.h"
 
 
-HRESULT CompileShader(const std::string& srcCode, const D3D_SHADER_MACRO* pDefines, LPCSTR pTarget, ID3DBlob** ppShaderBlob)
+static HMODULE GetD3DCompilerModule()
 {
-	//ASSERT(*ppShaderBlob == nullptr);
-
 	static HMODULE s_hD3dcompilerDll = LoadLibraryW(L"d3dcompiler_47.dll");
+	return s_hD3dcompilerDll;
+}
+
+static HRESULT D3DCompileMain(const std::string& srcCode, const D3D_SHADER_MACRO* pDefines, LPCSTR pTarget, ID3DBlob** ppShaderBlob, ID3DBlob** ppErrorBlob)
+{
+	FRAMETRACE_SCOPE("CompileShader");
 	static pD3DCompile s_fnD3DCompile = nullptr;
 
-	if (s_hD3dcompilerDll && !s_fnD3DCompile) {
-		s_fnD3DCompile = (pD3DCompile)GetProcAddress(s_hD3dcompilerDll, "D3DCompile");
+	HMODULE hD3dcompilerDll = GetD3DCompilerModule();
+	if (hD3dcompilerDll && !s_fnD3DCompile) {
+		s_fnD3DCompile = (pD3DCompile)GetProcAddress(hD3dcompilerDll, "D3DCompile");
 	}
 
 	if (!s_fnD3DCompile) {
 		return E_FAIL;
 	}
 
-	ID3DBlob* pErrorBlob = nullptr;
-	HRESULT hr = s_fnD3DCompile(
+	return s_fnD3DCompile(
 		srcCode.c_str(), srcCode.size(), nullptr, pDefines, nullptr,
-		"main", pTarget, 0, 0, ppShaderBlob, &pErrorBlob);
+		"main", pTarget, 0, 0, ppShaderBlob, ppErrorBlob);
+}
+
+HRESULT CompileShader(const std::string& srcCode, const D3D_SHADER_MACRO* pDefines, LPCSTR pTarget, ID3DBlob** ppShaderBlob)
+{
+	//ASSERT(*ppShaderBlob == nullptr);
+
+	ID3DBlob* pErrorBlob = nullptr;
+	HRESULT hr = D3DCompileMain(srcCode, pDefines, pTarget, ppShaderBlob, &pErrorBlob);
 
 	if (FAILED(hr)) {
 		ASSERT(0);
@@ -601,6 +616,7 @@ HRESULT GetShaderConvertColor(
 	const int chromaScaling,
 	const int convertType,
 	const bool blendDeinterlace,
+	const mp_csp_prim gamutLutPrim,
 	ID3DBlob** ppCode)
 {
 	DLog(L"GetShaderConvertColor() started for {} {}x{} extfmt:{:#010x} chroma:{}", fmtParams.str, texW, texH, exFmt.value, chromaScaling);
@@ -610,7 +626,9 @@ HRESULT GetShaderConvertColor(
 	LPVOID data;
 	DWORD size;
 
-	const bool bBT2020Primaries = (exFmt.VideoPrimaries == MFVideoPrimaries_BT2020);
+	const bool bGamutLut = bDX11 && gamutLutPrim != MP_CSP_PRIM_AUTO;
+	// DCI-P3 primaries are converted only with the gamut compression LUT
+	const bool bWideGamutPrimaries = (exFmt.VideoPrimaries == MFVideoPrimaries_BT2020) || (bGamutLut && exFmt.VideoPrimaries == MFVideoPrimaries_DCI_P3);
 	const bool bConvertHDRtoSDR = (convertType == SHADER_CONVERT_TO_SDR && (exFmt.VideoTransferFunction == MFVideoTransFunc_2084 || exFmt.VideoTransferFunction == MFVideoTransFunc_HLG || pDoviMetadata));
 	const bool bApplyHLG = (exFmt.VideoTransferFunction == MFVideoTransFunc_HLG && !pDoviMetadata);
 	const bool bConvertHLGtoPQ = (convertType == SHADER_CONVERT_TO_PQ && bApplyHLG);
@@ -631,7 +649,14 @@ HRESULT GetShaderConvertColor(
 		}
 	}
 
-	if (bBT2020Primaries || bConvertHDRtoSDR) {
+	if (bGamutLut && (bWideGamutPrimaries || bConvertHDRtoSDR)) {
+		code.append("Texture3D texGamutLut : register(t3);\n");
+		code += std::format("static const float lut_scale = {};\n", (GAMUT_LUT_SIZE - 1.0f) / GAMUT_LUT_SIZE);
+		code += std::format("static const float lut_offset = {};\n", 0.5f / GAMUT_LUT_SIZE);
+		code += std::format("static const float lut_gamma = {};\n", GAMUT_LUT_GAMMA);
+		code.append("#define CONVERT_PRIMARIES(c) texGamutLut.SampleLevel(sampL, pow(saturate(c), 1.0 / lut_gamma) * lut_scale + lut_offset, 0).rgb\n");
+	}
+	else if (bWideGamutPrimaries || bConvertHDRtoSDR) {
 		float matrix_conv_prim[3][3];
 		GetColorspaceGamutConversionMatrix(matrix_conv_prim, MP_CSP_PRIM_BT_2020, MP_CSP_PRIM_BT_709);
 		code.append("static const float3x3 matrix_conv_prim = {\n");
@@ -642,6 +667,7 @@ HRESULT GetShaderConvertColor(
 			code.append("\n");
 		}
 		code.append("};\n");
+		code.append("#define CONVERT_PRIMARIES(c) mul(matrix_conv_prim, c)\n");
 	}
 
 	if (bConvertHDRtoSDR) {
@@ -878,7 +904,7 @@ HRESULT GetShaderConvertColor(
 		code.append(
 			"color = ST2084ToLinear(color, LuminanceScale);\n"
 			"color.rgb = ToneMappingHable(color.rgb);\n"
-			"color.rgb = mul(matrix_conv_prim, color.rgb);\n"
+			"color.rgb = CONVERT_PRIMARIES(color.rgb);\n"
 		);
 		isLinear = true;
 	}
@@ -889,7 +915,7 @@ HRESULT GetShaderConvertColor(
 			"color = LinearToST2084(color, 1000.0);\n"
 		);
 	}
-	else if (bBT2020Primaries) {
+	else if (bWideGamutPrimaries) {
 		std::string toLinear;
 		switch (exFmt.VideoTransferFunction) {
 		case DXVA2_VideoTransFunc_10:   toLinear = "\\\\nothing\n";                  break;
@@ -908,7 +934,7 @@ HRESULT GetShaderConvertColor(
 			code.append("color = saturate(color);\n");
 			code.append(toLinear);
 			code.append(
-				"color.rgb = mul(matrix_conv_prim, color.rgb);\n"
+				"color.rgb = CONVERT_PRIMARIES(color.rgb);\n"
 			);
 			isLinear = true;
 		}
@@ -928,3 +954,260 @@ HRESULT GetShaderConvertColor(
 
 	return CompileShader(code, nullptr, target, ppCode);
 }
+
+//////////////////////////////
+// Pointwise shader fusion
+
+static HRESULT ReflectShader(ID3DBlob* pShaderCode, ID3D11ShaderReflection** ppReflection)
+{
+	static decltype(&D3DReflect) s_fnD3DReflect = nullptr;
+
+	HMODULE hD3dcompilerDll = GetD3DCompilerModule();
+	if (hD3dcompilerDll && !s_fnD3DReflect) {
+		s_fnD3DReflect = (decltype(&D3DReflect))GetProcAddress(hD3dcompilerDll, "D3DReflect");
+	}
+
+	if (!s_fnD3DReflect) {
+		return E_FAIL;
+	}
+
+	return s_fnD3DReflect(pShaderCode->GetBufferPointer(), pShaderCode->GetBufferSize(), __uuidof(ID3D11ShaderReflection), (void**)ppReflection);
+}
+
+static HRESULT DisassembleShader(ID3DBlob* pShaderCode, std::string& asmCode)
+{
+	static decltype(&D3DDisassemble) s_fnD3DDisassemble = nullptr;
+
+	HMODULE hD3dcompilerDll = GetD3DCompilerModule();
+	if (hD3dcompilerDll && !s_fnD3DDisassemble) {
+		s_fnD3DDisassemble = (decltype(&D3DDisassemble))GetProcAddress(hD3dcompilerDll, "D3DDisassemble");
+	}
+
+	if (!s_fnD3DDisassemble) {
+		return E_FAIL;
+	}
+
+	CComPtr<ID3DBlob> pAsmBlob;
+	HRESULT hr = s_fnD3DDisassemble(pShaderCode->GetBufferPointer(), pShaderCode->GetBufferSize(), 0, nullptr, &pAsmBlob);
+	if (S_OK == hr) {
+		asmCode.assign((const char*)pAsmBlob->GetBufferPointer(), pAsmBlob->GetBufferSize());
+	}
+
+	return hr;
+}
+
+static HRESULT PreprocessShader(const std::string& srcCode, std::string& outCode)
+{
+	static pD3DPreprocess s_fnD3DPreprocess = nullptr;
+
+	HMODULE hD3dcompilerDll = GetD3DCompilerModule();
+	if (hD3dcompilerDll && !s_fnD3DPreprocess) {
+		s_fnD3DPreprocess = (pD3DPreprocess)GetProcAddress(hD3dcompilerDll, "D3DPreprocess");
+	}
+
+	if (!s_fnD3DPreprocess) {
+		return E_FAIL;
+	}
+
+	CComPtr<ID3DBlob> pCodeBlob;
+	HRESULT hr = s_fnD3DPreprocess(srcCode.c_str(), srcCode.size(), nullptr, nullptr, nullptr, &pCodeBlob, nullptr);
+	if (S_OK == hr) {
+		outCode.assign((const char*)pCodeBlob->GetBufferPointer(), pCodeBlob->GetBufferSize());
+		str_trim_end(outCode, '\0');
+	}
+
+	return hr;
+}
+
+static bool GetPointwiseShaderInfo(ID3DBlob* pShaderCode, PointwiseShader_t& info)
+{
+	CComPtr<ID3D11ShaderReflection> pReflection;
+	if (FAILED(ReflectShader(pShaderCode, &pReflection))) {
+		return false;
+	}
+
+	D3D11_SHADER_DESC desc;
+	if (FAILED(pReflection->GetDesc(&desc))) {
+		return false;
+	}
+
+	// only one 2D texture and only the constant buffer with the standard parameters in b0
+	std::string cbufferName;
+	for (UINT i = 0; i < desc.BoundResources; i++) {
+		D3D11_SHADER_INPUT_BIND_DESC bindDesc;
+		pReflection->GetResourceBindingDesc(i, &bindDesc);
+		switch (bindDesc.Type) {
+		case D3D_SIT_TEXTURE:
+			if (info.texName.size() || bindDesc.BindPoint != 0 || bindDesc.Dimension != D3D_SRV_DIMENSION_TEXTURE2D) {
+				return false;
+			}
+			info.texName = bindDesc.Name;
+			break;
+		case D3D_SIT_SAMPLER:
+			break;
+		case D3D_SIT_CBUFFER:
+			if (cbufferName.size() || bindDesc.BindPoint != 0) {
+				return false;
+			}
+			cbufferName = bindDesc.Name;
+			break;
+		default:
+			return false;
+		}
+	}
+
+	// the input texture coordinates must be the only coordinates used for sampling
+	std::string coordReg;
+	std::string coordSwizzle;
+	for (UINT i = 0; i < desc.InputParameters; i++) {
+		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
+		pReflection->GetInputParameterDesc(i, &paramDesc);
+		if (paramDesc.SystemValueType == D3D_NAME_POSITION) {
+			info.args.emplace_back("pos");
+		}
+		else if (_stricmp(paramDesc.SemanticName, "TEXCOORD") == 0 && paramDesc.SemanticIndex == 0) {
+			info.args.emplace_back("coord");
+			coordReg = std::format("v{}.", paramDesc.Register);
+			for (int c = 0; c < 4; c++) {
+				if (paramDesc.Mask & (1 << c)) {
+					coordSwizzle += "xyzw"[c];
+				}
+			}
+		}
+		else {
+			return false;
+		}
+	}
+	if (coordSwizzle.size() != 2) {
+		return false;
+	}
+
+	std::string asmCode;
+	if (FAILED(DisassembleShader(pShaderCode, asmCode))) {
+		return false;
+	}
+
+	size_t pos = 0;
+	while (pos < asmCode.size()) {
+		size_t end = asmCode.find('\n', pos);
+		if (end == std::string::npos) {
+			end = asmCode.size();
+		}
+		std::string_view line(asmCode.data() + pos, end - pos);
+		pos = end + 1;
+
+		const size_t start = line.find_first_not_of(" \t");
+		if (start == line.npos) {
+			continue;
+		}
+		line.remove_prefix(start);
+
+		std::string_view opcode = line.substr(0, line.find_first_of(" \t("));
+		if (opcode.starts_with("sample") || opcode.starts_with("gather") || opcode.starts_with("ld") || opcode == "lod" || opcode == "resinfo" || opcode == "bufinfo") {
+			if (opcode != "sample" && opcode != "sample_indexable") {
+				return false;
+			}
+			// sample dest, address, resource, sampler
+			const size_t comma = line.find(',');
+			if (comma == line.npos) {
+				return false;
+			}
+			std::string_view address = line.substr(comma + 1);
+			address.remove_prefix(std::min(address.find_first_not_of(' '), address.size()));
+			if (!address.starts_with(coordReg) || address.substr(coordReg.size(), 2) != coordSwizzle) {
+				return false;
+			}
+		}
+	}
+
+	if (cbufferName.size()) {
+		ID3D11ShaderReflectionConstantBuffer* pConstantBuffer = pReflection->GetConstantBufferByName(cbufferName.c_str());
+		D3D11_SHADER_BUFFER_DESC bufferDesc;
+		if (FAILED(pConstantBuffer->GetDesc(&bufferDesc))) {
+			return false;
+		}
+		info.cbufferSize = bufferDesc.Size;
+
+		for (UINT i = 0; i < bufferDesc.Variables; i++) {
+			ID3D11ShaderReflectionVariable* pVariable = pConstantBuffer->GetVariableByIndex(i);
+			D3D11_SHADER_VARIABLE_DESC varDesc;
+			D3D11_SHADER_TYPE_DESC typeDesc;
+			if (FAILED(pVariable->GetDesc(&varDesc)) || FAILED(pVariable->GetType()->GetDesc(&typeDesc))) {
+				return false;
+			}
+			if ((typeDesc.Class != D3D_SVC_SCALAR && typeDesc.Class != D3D_SVC_VECTOR) || typeDesc.Elements || typeDesc.Rows != 1) {
+				return false;
+			}
+			const UINT reg  = varDesc.StartOffset / 16;
+			const UINT comp = (varDesc.StartOffset % 16) / 4;
+			if (comp + typeDesc.Columns > 4) {
+				return false;
+			}
+			std::string expr = std::format("fused_cb[{}].{}", reg, std::string_view("xyzw").substr(comp, typeDesc.Columns));
+			switch (typeDesc.Type) {
+			case D3D_SVT_FLOAT: break;
+			case D3D_SVT_UINT:  expr = std::format("asuint({})", expr); break;
+			case D3D_SVT_INT:   expr = std::format("asint({})", expr); break;
+			default:
+				return false;
+			}
+			info.constants.emplace_back(varDesc.Name, expr);
+		}
+	}
+
+	return true;
+}
+
+bool GetPointwisePixelShader(const std::string& srcCode, ID3DBlob* pShaderCode, PointwiseShader_t& shader)
+{
+	shader = {};
+	// the macros are expanded here, so they can not leak into the other fused shaders
+	if (!GetPointwiseShaderInfo(pShaderCode, shader) || FAILED(PreprocessShader(srcCode, shader.code))) {
+		shader = {};
+		return false;
+	}
+
+	return true;
+}
+
+HRESULT CompileFusedPointwise(const std::string& code, ID3DBlob** ppCode)
+{
+	ID3DBlob* pErrorBlob = nullptr;
+	HRESULT hr = D3DCompileMain(code, nullptr, "ps_4_0", ppCode, &pErrorBlob);
+	if (FAILED(hr)) {
+		SAFE_RELEASE(*ppCode);
+		if (pErrorBlob) {
+			std::string strErrorMsgs((char*)pErrorBlob->GetBufferPointer(), pErrorBlob->GetBufferSize());
+			DLog(strErrorMsgs);
+		}
+	}
+	SAFE_RELEASE(pErrorBlob);
+
+	if (S_OK == hr) {
+		// a texture that is still sampled by the next shaders means the input was not replaced
+		CComPtr<ID3D11ShaderReflection> pReflection;
+		D3D11_SHADER_DESC desc;
+		hr = ReflectShader(*ppCode, &pReflection);
+		if (S_OK == hr) {
+			hr = pReflection->GetDesc(&desc);
+		}
+		if (S_OK == hr) {
+			UINT textures = 0;
+			for (UINT i = 0; i < desc.BoundResources; i++) {
+				D3D11_SHADER_INPUT_BIND_DESC bindDesc;
+				pReflection->GetResourceBindingDesc(i, &bindDesc);
+				if (bindDesc.Type == D3D_SIT_TEXTURE) {
+					textures++;
+				}
+			}
+			if (textures > 1) {
+				hr = E_FAIL;
+			}
+		}
+		if (FAILED(hr)) {
+			SAFE_RELEASE(*ppCode);
+		}
+	}
+
+	return hr;
+}
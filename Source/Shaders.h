@@ -21,6 +21,7 @@
 #pragma once
 
 #include <d3dcommon.h>
+#include "ShaderFusion.h"
 
 struct PS_COLOR_TRANSFORM {
 	DirectX::XMFLOAT4 cm_r;
@@ -70,4 +71,12 @@ HRESULT GetShaderConvertColor(
 	const int chromaScaling,
 	const int convertType,
 	const bool blendDeinterlace,
+	const mp_csp_prim gamutLutPrim,
 	ID3DBlob** ppCode);
+
+// Returns true if the DX11 pixel shader only samples the input texture at the current texture coordinates,
+// the shader is then described for GetFusedPointwiseCode()
+bool GetPointwisePixelShader(const std::string& srcCode, ID3DBlob* pShaderCode, PointwiseShader_t& shader);
+
+// Compiles the code generated by GetFusedPointwiseCode()
+HRESULT CompileFusedPointwise(const std::string& code, ID3DBlob** ppCode);
@@ -0,0 +1,202 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+// Mean and variance of all added values (Welford's algorithm), it does not overflow on long sessions.
+class CRunningStats
+{
+private:
+	uint64_t m_count = 0;
+	double m_mean = 0;
+	double m_m2 = 0; // sum of squared deviations from the mean
+
+public:
+	void Reset() {
+		m_count = 0;
+		m_mean = 0;
+		m_m2 = 0;
+	}
+
+	void Add(const double value) {
+		m_count++;
+		const double delta = value - m_mean;
+		m_mean += delta / m_count;
+		m_m2 += delta * (value - m_mean);
+	}
+
+	uint64_t Count() const { return m_count; }
+	double Mean() const { return m_mean; }
+	// sample variance
+	double Variance() const { return m_count > 1 ? m_m2 / (m_count - 1) : 0; }
+	double StdDev() const { return std::sqrt(Variance()); }
+};
+
+// Statistics of the last 'size' values: min and max through monotonic queues,
+// mean and variance updated in floating point when a value enters and leaves the window.
+// Add() is amortized O(1), the memory is allocated once in the constructor.
+template<typename T> class CSlidingStats
+{
+private:
+	struct Entry_t {
+		uint64_t seq;
+		T value;
+	};
+
+	// ring of entries with increasing seq and monotonic values
+	class CMonotonicQueue
+	{
+	private:
+		std::vector<Entry_t> m_ring;
+		unsigned m_head = 0;
+		unsigned m_count = 0;
+
+		unsigned Back() const { return (m_head + m_count - 1) % m_ring.size(); }
+
+	public:
+		CMonotonicQueue(const unsigned size) : m_ring(size) {}
+
+		void Clear() {
+			m_head = 0;
+			m_count = 0;
+		}
+
+		// removes values that can no longer be the extreme: bBefore(old, new) is true for them
+		template<typename Cmp> void Push(const uint64_t seq, const T value, Cmp bBefore) {
+			while (m_count && bBefore(m_ring[Back()].value, value)) {
+				m_count--;
+			}
+			m_ring[(m_head + m_count) % m_ring.size()] = { seq, value };
+			m_count++;
+		}
+
+		void Expire(const uint64_t firstSeq) {
+			while (m_count && m_ring[m_head].seq < firstSeq) {
+				m_head = (m_head + 1) % m_ring.size();
+				m_count--;
+			}
+		}
+
+		T Front() const { return m_count ? m_ring[m_head].value : T{}; }
+	};
+
+	std::vector<T> m_fifo;
+	unsigned m_oldestIndex = 0;
+	unsigned m_lastIndex = 0;
+	unsigned m_count = 0;
+	uint64_t m_seq = 0;
+
+	CMonotonicQueue m_minQueue;
+	CMonotonicQueue m_maxQueue;
+
+	double m_mean = 0;
+	double m_m2 = 0;
+	unsigned m_sinceRecalc = 0;
+
+	void Recalc() {
+		// removes the rounding errors that the sliding updates accumulate
+		double sum = 0;
+		for (unsigned i = 0; i < m_count; i++) {
+			sum += (double)m_fifo[i];
+		}
+		m_mean = sum / m_count;
+		m_m2 = 0;
+		for (unsigned i = 0; i < m_count; i++) {
+			const double d = (double)m_fifo[i] - m_mean;
+			m_m2 += d * d;
+		}
+		m_sinceRecalc = 0;
+	}
+
+public:
+	CSlidingStats(unsigned size)
+		: m_fifo(std::max(size, 1u))
+		, m_minQueue(std::max(size, 1u))
+		, m_maxQueue(std::max(size, 1u))
+	{
+	}
+
+	void Reset() {
+		std::fill(m_fifo.begin(), m_fifo.end(), T{});
+		m_oldestIndex = 0;
+		m_lastIndex = 0;
+		m_count = 0;
+		m_seq = 0;
+		m_minQueue.Clear();
+		m_maxQueue.Clear();
+		m_mean = 0;
+		m_m2 = 0;
+		m_sinceRecalc = 0;
+	}
+
+	void Add(const T sample) {
+		const double x = (double)sample;
+		if (m_count < m_fifo.size()) {
+			m_count++;
+			const double delta = x - m_mean;
+			m_mean += delta / m_count;
+			m_m2 += delta * (x - m_mean);
+		} else {
+			const double old = (double)m_fifo[m_oldestIndex];
+			const double oldMean = m_mean;
+			m_mean += (x - old) / m_count;
+			m_m2 += (x - old) * (x - m_mean + old - oldMean);
+			m_sinceRecalc++;
+		}
+		m_fifo[m_oldestIndex] = sample;
+		if (m_sinceRecalc >= m_fifo.size()) {
+			Recalc();
+		}
+
+		// expire first, so the queues never hold more than the window
+		m_seq++;
+		const uint64_t firstSeq = m_seq - m_count + 1;
+		m_minQueue.Expire(firstSeq);
+		m_maxQueue.Expire(firstSeq);
+		m_minQueue.Push(m_seq, sample, [](const T a, const T b) { return a >= b; });
+		m_maxQueue.Push(m_seq, sample, [](const T a, const T b) { return a <= b; });
+
+		m_lastIndex = m_oldestIndex;
+		m_oldestIndex++;
+		if (m_oldestIndex == m_fifo.size()) {
+			m_oldestIndex = 0;
+		}
+	}
+
+	T Last() const { return m_fifo[m_lastIndex]; }
+
+	unsigned Count() const { return m_count; }
+	T Min() const { return m_minQueue.Front(); }
+	T Max() const { return m_maxQueue.Front(); }
+	std::pair<T, T> MinMax() const { return { Min(), Max() }; }
+
+	double Mean() const { return m_mean; }
+	// sample variance of the values in the window
+	double Variance() const { return m_count > 1 ? std::max(m_m2, 0.0) / (m_count - 1) : 0; }
+	double StdDev() const { return std::sqrt(Variance()); }
+
+	// the ring for drawing graphs
+	const T* Data() const { return m_fifo.data(); }
+	unsigned Size() const { return (unsigned)m_fifo.size(); }
+	unsigned OldestIndex() const { return m_oldestIndex; }
+};
@@ -0,0 +1,172 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include "Times.h"
+
+// 0 - STAGE_SCOPE is empty, the stage table is not shown
+#define STAGE_TIMERS 1
+
+enum : int {
+	STAGE_CopySample = 0,
+	STAGE_DoviParse,
+	STAGE_VPPass,      // D3D11 VP or DXVA2 VP
+	STAGE_ConvertPass, // color conversion shader
+	STAGE_ResizePass,  // resize shaders
+	STAGE_FinalPass,   // final shader pass with dithering
+	STAGE_Process,     // all passes of a frame
+	STAGE_DrawSubtitles,
+	STAGE_DrawStats,
+	STAGE_Present,
+	STAGE_COUNT
+};
+
+inline constexpr const wchar_t* kStageNames[STAGE_COUNT] = {
+	L"Copy", L"DoVi", L"VP", L"Conv", L"Resize", L"Final", L"Proc", L"Subs", L"Stats", L"Present"
+};
+
+struct StageStats_t {
+	uint64_t count;
+	uint64_t totalTicks;
+	uint64_t maxTicks;
+};
+
+// Count, total and max time of each render stage. There are no locks,
+// a reader running at the same time as Add() can get a slightly inconsistent result.
+class CStageTimers
+{
+private:
+	struct Stage_t {
+		std::atomic<uint64_t> count = 0;
+		std::atomic<uint64_t> total = 0;
+		std::atomic<uint64_t> max = 0;
+		std::atomic<uint64_t> intervalMax = 0;
+		// values at the previous TakeInterval(), used by one reader
+		uint64_t prevCount = 0;
+		uint64_t prevTotal = 0;
+	};
+	Stage_t m_stages[STAGE_COUNT];
+
+	static void UpdateMax(std::atomic<uint64_t>& max, const uint64_t ticks) {
+		uint64_t prev = max.load(std::memory_order_relaxed);
+		while (ticks > prev && !max.compare_exchange_weak(prev, ticks, std::memory_order_relaxed)) {
+		}
+	}
+
+public:
+	void Add(const int id, const uint64_t ticks) {
+		auto& stage = m_stages[id];
+		stage.count.fetch_add(1, std::memory_order_relaxed);
+		stage.total.fetch_add(ticks, std::memory_order_relaxed);
+		UpdateMax(stage.max, ticks);
+		UpdateMax(stage.intervalMax, ticks);
+	}
+
+	void Reset() {
+		for (auto& stage : m_stages) {
+			stage.count.store(0, std::memory_order_relaxed);
+			stage.total.store(0, std::memory_order_relaxed);
+			stage.max.store(0, std::memory_order_relaxed);
+			stage.intervalMax.store(0, std::memory_order_relaxed);
+			stage.prevCount = 0;
+			stage.prevTotal = 0;
+		}
+	}
+
+	// Since the last Reset()
+	StageStats_t Get(const int id) const {
+		const auto& stage = m_stages[id];
+		return {
+			stage.count.load(std::memory_order_relaxed),
+			stage.total.load(std::memory_order_relaxed),
+			stage.max.load(std::memory_order_relaxed)
+		};
+	}
+
+	// Since the previous call, must be called from one thread
+	StageStats_t TakeInterval(const int id) {
+		auto& stage = m_stages[id];
+		const uint64_t count = stage.count.load(std::memory_order_relaxed);
+		const uint64_t total = stage.total.load(std::memory_order_relaxed);
+		const StageStats_t interval = {
+			count - stage.prevCount,
+			total - stage.prevTotal,
+			stage.intervalMax.exchange(0, std::memory_order_relaxed)
+		};
+		stage.prevCount = count;
+		stage.prevTotal = total;
+		return interval;
+	}
+};
+
+// Measures the time from the constructor to Stop() or the destructor.
+// The stage is a template parameter, so a wrong id does not compile.
+template<int id> class CStageScope
+{
+	static_assert(id >= 0 && id < STAGE_COUNT);
+
+	CStageTimers& m_timers;
+	const uint64_t m_start;
+	bool m_bStopped = false;
+
+public:
+	CStageScope(CStageTimers& timers)
+		: m_timers(timers)
+		, m_start(GetPreciseTick())
+	{
+	}
+	~CStageScope() {
+		if (!m_bStopped) {
+			Stop();
+		}
+	}
+
+	// The time is not added to the stage
+	void Cancel() { m_bStopped = true; }
+
+	// Adds the time to the stage and returns it in ticks
+	uint64_t Stop() {
+		const uint64_t ticks = GetPreciseTick() - m_start;
+		m_bStopped = true;
+#if STAGE_TIMERS
+		m_timers.Add(id, ticks);
+#endif
+		return ticks;
+	}
+};
+
+#if STAGE_TIMERS
+#define STAGE_SCOPE(id) CStageScope<id> stageScope##id(m_StageTimers)
+#else
+#define STAGE_SCOPE(id)
+#endif
+
+// Data of IExFilterConfig::Flt_GetBin("statsStages")
+struct StageTimersData_t {
+	uint32_t size;   // sizeof(StageTimersData_t)
+	uint32_t stages; // STAGE_COUNT
+	struct {
+		uint64_t count;
+		double avg; // milliseconds
+		double max;
+	} stage[STAGE_COUNT]; // copy, DoVi, VP, convert, resize, final, process, subtitles, stats, present
+};
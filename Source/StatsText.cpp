@@ -0,0 +1,132 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "stdafx.h"
+#include <charconv>
+#include "StatsText.h"
+
+void CStatsText::Begin()
+{
+	m_len = 0;
+	m_lineIndex = 0;
+}
+
+void CStatsText::End()
+{
+	CommitLine();
+	const unsigned count = std::min(m_lineIndex, kMaxLines);
+	if (count != m_count) {
+		m_count = count;
+		m_version++; // for GetText()
+	}
+}
+
+void CStatsText::CommitLine()
+{
+	if (m_lineIndex < kMaxLines) {
+		auto& line = m_lines[m_lineIndex];
+		if (!line.version || line.len != m_len || wmemcmp(line.text, m_line, m_len) != 0) {
+			wmemcpy(line.text, m_line, m_len);
+			line.len = m_len;
+			line.version = ++m_version;
+		}
+	}
+	m_lineIndex++;
+	m_len = 0;
+}
+
+CStatsText& CStatsText::Append(const wchar_t ch)
+{
+	if (ch == L'\n') {
+		CommitLine();
+	}
+	else if (m_len < kLineSize) {
+		m_line[m_len++] = ch;
+	}
+	return *this;
+}
+
+CStatsText& CStatsText::Append(const wchar_t* str)
+{
+	if (str) {
+		while (*str) {
+			Append(*str++);
+		}
+	}
+	return *this;
+}
+
+void CStatsText::AppendChars(const char* str, const unsigned len, const unsigned width, const bool bSign)
+{
+	const unsigned signLen = (bSign && str[0] != '-') ? 1 : 0;
+	for (unsigned n = len + signLen; n < width; n++) {
+		Append(L' ');
+	}
+	if (signLen) {
+		Append(L'+');
+	}
+	for (unsigned i = 0; i < len; i++) {
+		Append((wchar_t)str[i]);
+	}
+}
+
+CStatsText& CStatsText::AppendInt(const int64_t value, const unsigned width, const bool bSign)
+{
+	char buf[24];
+	const auto result = std::to_chars(buf, buf + std::size(buf), value);
+	AppendChars(buf, (unsigned)(result.ptr - buf), width, bSign);
+	return *this;
+}
+
+CStatsText& CStatsText::AppendFixed(const double value, const int precision, const unsigned width, const bool bSign)
+{
+	char buf[64];
+	const auto result = std::to_chars(buf, buf + std::size(buf), value, std::chars_format::fixed, precision);
+	if (result.ec == std::errc()) {
+		AppendChars(buf, (unsigned)(result.ptr - buf), width, bSign);
+	} else {
+		AppendChars("#", 1, width, false); // too large for the statistics
+	}
+	return *this;
+}
+
+void CStatsText::TrimEnd(const wchar_t ch)
+{
+	while (m_len && m_line[m_len - 1] == ch) {
+		m_len--;
+	}
+}
+
+const wchar_t* CStatsText::GetText()
+{
+	if (m_textVersion != m_version) {
+		m_textVersion = m_version;
+		wchar_t* p = m_text;
+		for (unsigned i = 0; i < m_count; i++) {
+			if (i) {
+				*p++ = L'\n';
+			}
+			wmemcpy(p, m_lines[i].text, m_lines[i].len);
+			p += m_lines[i].len;
+		}
+		*p = 0;
+	}
+	return m_text;
+}
@@ -0,0 +1,78 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+//
+// Text of the statistics stored as fixed lines. The text is written again on every frame
+// between Begin() and End(), '\n' starts a new line. A line that differs from the previous frame
+// gets a new version, so a font can lay out only the changed lines.
+// Numbers are written with std::to_chars, nothing is allocated.
+//
+
+class CStatsText
+{
+public:
+	static constexpr unsigned kMaxLines = 32;
+	static constexpr unsigned kLineSize = 128; // longer lines are cut
+
+private:
+	struct Line_t {
+		wchar_t text[kLineSize];
+		unsigned len;
+		uint32_t version; // 0 - never written
+	};
+	Line_t m_lines[kMaxLines] = {};
+	unsigned m_count = 0; // lines of the last End()
+	uint32_t m_version = 0;
+
+	// the line being written
+	wchar_t m_line[kLineSize] = {};
+	unsigned m_len = 0;
+	unsigned m_lineIndex = 0;
+
+	wchar_t m_text[kMaxLines * (kLineSize + 1)] = {};
+	uint32_t m_textVersion = 0;
+
+	void CommitLine();
+	void AppendChars(const char* str, const unsigned len, const unsigned width, const bool bSign);
+
+public:
+	void Begin();
+	void End();
+
+	CStatsText& Append(const wchar_t ch);
+	CStatsText& Append(const wchar_t* str);
+	CStatsText& Append(const std::wstring& str) { return Append(str.c_str()); }
+	// like std::format "{:+width}"
+	CStatsText& AppendInt(const int64_t value, const unsigned width = 0, const bool bSign = false);
+	// like std::format "{:+width.precisionf}"
+	CStatsText& AppendFixed(const double value, const int precision, const unsigned width = 0, const bool bSign = false);
+	// removes the characters at the end of the current line
+	void TrimEnd(const wchar_t ch);
+
+	unsigned GetLineCount() const { return m_count; }
+	const wchar_t* GetLine(const unsigned i, unsigned& len) const { len = m_lines[i].len; return m_lines[i].text; }
+	// changes when the text of the line changes
+	uint32_t GetLineVersion(const unsigned i) const { return m_lines[i].version; }
+
+	// all lines separated by '\n', joined again only after a change
+	const wchar_t* GetText();
+};
@@ -20,7 +20,9 @@
 #include "stdafx.h"
 #include "DX11SubPic.h"
 #include "Helper.h"
+#include "Times.h"
 #include <DirectXMath.h>
+#include <bit>
 
 #define ENABLE_DUMP_SUBPIC 0
 
@@ -134,6 +136,380 @@ static HRESULT DumpTexture2D(ID3D11DeviceContext* pDeviceContext, ID3D11Texture2
 }
 #endif
 
+//
+// CMemPicPool
+//
+
+unsigned CMemPicPool::SizeClass(const size_t size)
+{
+	if (size < 4) {
+		return (unsigned)size;
+	}
+	// the exponent and the two bits after the highest bit
+	const unsigned e = (unsigned)std::bit_width(size) - 1;
+	return std::min(e * 4 + (unsigned)((size >> (e - 2)) & 3), kClasses - 1);
+}
+
+void CMemPicPool::Trim(const ULONGLONG now)
+{
+	for (;;) {
+		// the least recently freed buffer
+		std::vector<Free_t>* pOldest = nullptr;
+		for (auto& free : m_free) {
+			if (free.size() && (!pOldest || free.front().lastUsed < pOldest->front().lastUsed)) {
+				pOldest = &free;
+			}
+		}
+		if (!pOldest) {
+			break;
+		}
+		if (m_Stats.usedBytes + m_Stats.freeBytes <= m_Stats.limit && now - pOldest->front().lastUsed < kMaxFreeAge) {
+			break;
+		}
+
+		m_Stats.freeCount--;
+		m_Stats.freeBytes -= pOldest->front().buffer.size * 4;
+		m_Stats.released++;
+		pOldest->erase(pOldest->begin());
+	}
+}
+
+CMemPicPool::Buffer_t CMemPicPool::Acquire(const size_t size)
+{
+	CAutoLock Lock(&m_csLock);
+
+	Buffer_t buffer;
+
+	const unsigned sizeClass = SizeClass(size);
+	for (unsigned c = sizeClass; c < kClasses && c <= sizeClass + kMaxLargerClasses && !buffer.data; c++) {
+		auto& free = m_free[c];
+		for (auto it = free.rbegin(); it != free.rend(); ++it) {
+			if (it->buffer.size >= size) {
+				buffer = std::move(it->buffer);
+				free.erase(std::next(it).base());
+				break;
+			}
+		}
+	}
+
+	if (buffer.data) {
+		m_Stats.freeCount--;
+		m_Stats.freeBytes -= buffer.size * 4;
+		m_Stats.reused++;
+	} else {
+		buffer.data.reset(new(std::nothrow) uint32_t[size]);
+		if (!buffer.data) {
+			// the free buffers are too small, but their memory can be enough
+			for (auto& free : m_free) {
+				m_Stats.released += free.size();
+				free.clear();
+			}
+			m_Stats.freeCount = 0;
+			m_Stats.freeBytes = 0;
+			buffer.data.reset(new(std::nothrow) uint32_t[size]);
+			if (!buffer.data) {
+				return buffer;
+			}
+		}
+		buffer.size = size;
+		m_Stats.created++;
+	}
+
+	m_Stats.usedCount++;
+	m_Stats.usedBytes += buffer.size * 4;
+
+	Trim(GetTickCount64());
+
+	return buffer;
+}
+
+void CMemPicPool::Release(Buffer_t&& buffer)
+{
+	if (!buffer.data) {
+		return;
+	}
+
+	CAutoLock Lock(&m_csLock);
+
+	ASSERT(m_Stats.usedCount > 0);
+	m_Stats.usedCount--;
+	m_Stats.usedBytes -= buffer.size * 4;
+
+	const ULONGLONG now = GetTickCount64();
+	m_Stats.freeCount++;
+	m_Stats.freeBytes += buffer.size * 4;
+	m_free[SizeClass(buffer.size)].push_back({ std::move(buffer), now });
+
+	Trim(now);
+}
+
+void CMemPicPool::SetLimit(const UINT64 limit)
+{
+	CAutoLock Lock(&m_csLock);
+
+	m_Stats.limit = limit;
+	Trim(GetTickCount64());
+}
+
+CMemPicPool::Stats_t CMemPicPool::GetStats()
+{
+	CAutoLock Lock(&m_csLock);
+
+	return m_Stats;
+}
+
+//
+// MemPic_t
+//
+
+void MemPic_t::InitTiles(const bool bSparse)
+{
+	tilesX = (w + kTileSize - 1) / kTileSize;
+	tilesY = (h + kTileSize - 1) / kTileSize;
+	const UINT count = tilesX * tilesY;
+	occupied.assign((count + 63) / 64, bSparse ? 0 : UINT64_MAX);
+	if (bSparse) {
+		slots.assign(count, kNoSlot);
+		tileCount = 0;
+	}
+}
+
+void MemPic_t::ResetTiles()
+{
+	if (tileCount) {
+		std::fill(occupied.begin(), occupied.end(), 0);
+		std::fill(slots.begin(), slots.end(), kNoSlot);
+		if (bCompressed) {
+			ms_compressedBytes -= CompressedSize();
+			ms_uncompressedBytes -= (uint64_t)tileCount * kTileSize * kTileSize * 4;
+			stream.clear();
+			lineStarts.clear();
+			palette.clear();
+			paletteHash.clear();
+		}
+		tileCount = 0;
+	}
+}
+
+void MemPic_t::ReserveTiles(const UINT count)
+{
+	ASSERT(tileCount == 0);
+	if (count > tileCapacity) {
+		const size_t tilePixels = kTileSize * kTileSize;
+		CMemPicPool::Buffer_t buffer = { std::move(tileData), (size_t)tileCapacity * tilePixels };
+		if (pool) {
+			pool->Release(std::move(buffer));
+			buffer = pool->Acquire(count * tilePixels);
+		} else {
+			buffer.data.reset(new(std::nothrow) uint32_t[count * tilePixels]);
+			buffer.size = count * tilePixels;
+		}
+		tileData = std::move(buffer.data);
+		tileCapacity = tileData ? (UINT)(buffer.size / tilePixels) : 0;
+	}
+}
+
+uint32_t* MemPic_t::AddTile(const UINT tx, const UINT ty)
+{
+	if (tileCount >= tileCapacity) {
+		return nullptr;
+	}
+	slots[ty * tilesX + tx] = tileCount;
+	SetOccupied(tx, ty, true);
+	return tileData.get() + (size_t)kTileSize * kTileSize * tileCount++;
+}
+
+void MemPic_t::AddCompressedTile(const UINT tx, const UINT ty, const uint32_t* src, const UINT srcPitch, const CRect& rect, const uint32_t clear)
+{
+	const size_t prevSize = CompressedSize();
+
+	const CRect tileRect = TileRect(tx, ty);
+	const UINT width = tileRect.Width();
+	// the columns of 'rect' in the tile
+	const UINT x0 = rect.left - tileRect.left;
+	const UINT x1 = rect.right - tileRect.left;
+
+	// -1 if the palette is full
+	auto PaletteIndex = [&](const uint32_t color) {
+		if (paletteHash.empty()) {
+			paletteHash.resize(kMaxPalette * 2);
+		}
+		UINT h = (color * 0x9E3779B1u) >> 23; // 9 bits
+		for (;;) {
+			const uint16_t entry = paletteHash[h];
+			if (!entry) {
+				if (palette.size() == kMaxPalette) {
+					return -1;
+				}
+				palette.push_back(color);
+				paletteHash[h] = (uint16_t)palette.size();
+				return (int)palette.size() - 1;
+			}
+			if (palette[entry - 1] == color) {
+				return entry - 1;
+			}
+			h = (h + 1) & (kMaxPalette * 2 - 1);
+		}
+	};
+
+	const uint32_t slot = tileCount++;
+	slots[ty * tilesX + tx] = slot;
+	SetOccupied(tx, ty, true);
+	lineStarts.resize((size_t)tileCount * kTileSize);
+
+	for (LONG y = tileRect.top; y < tileRect.bottom; y++) {
+		lineStarts[(size_t)slot * kTileSize + (y - tileRect.top)] = (uint32_t)stream.size();
+		if (y < rect.top || y >= rect.bottom) {
+			stream.push_back(Run_Clear | (uint8_t)(width - 1));
+			continue;
+		}
+
+		const uint32_t* line = src + (size_t)srcPitch * (y - rect.top) - x0;
+		auto Pixel = [&](const UINT x) { return (x >= x0 && x < x1) ? line[x] : clear; };
+		auto RunLength = [&](const UINT x, const uint32_t color) {
+			UINT n = 1;
+			while (x + n < width && Pixel(x + n) == color) {
+				n++;
+			}
+			return n;
+		};
+
+		UINT x = 0;
+		while (x < width) {
+			const uint32_t color = Pixel(x);
+			const UINT n = RunLength(x, color);
+			if (color == clear) {
+				stream.push_back(Run_Clear | (uint8_t)(n - 1));
+				x += n;
+				continue;
+			}
+			if (n >= kMinFillRun) {
+				const int index = PaletteIndex(color);
+				if (index >= 0) {
+					stream.push_back(Run_Fill | (uint8_t)(n - 1));
+					stream.push_back((uint8_t)index);
+					x += n;
+					continue;
+				}
+			}
+
+			// up to a clear pixel or a long run of one color
+			UINT end = x + n;
+			while (end < width) {
+				const uint32_t next = Pixel(end);
+				if (next == clear) {
+					break;
+				}
+				const UINT m = RunLength(end, next);
+				if (m >= kMinFillRun) {
+					break;
+				}
+				end += m;
+			}
+			stream.push_back(Run_Literal | (uint8_t)(end - x - 1));
+			for (; x < end; x++) {
+				const uint32_t pixel = Pixel(x);
+				const size_t pos = stream.size();
+				stream.resize(pos + 4);
+				memcpy(&stream[pos], &pixel, 4);
+			}
+		}
+	}
+
+	ms_compressedBytes += CompressedSize() - prevSize;
+	ms_uncompressedBytes += kTileSize * kTileSize * 4;
+}
+
+void MemPic_t::CopyRect(const CRect& rect, BYTE* dst, const UINT dstPitch, const uint32_t clear) const
+{
+	if (data) {
+		// the pixels of the tiles that are not occupied are already clear
+		const uint32_t* src = data.get() + w * rect.top + rect.left;
+		const UINT copyW_bytes = rect.Width() * 4;
+		for (LONG y = rect.top; y < rect.bottom; y++) {
+			memcpy(dst, src, copyW_bytes);
+			src += w;
+			dst += dstPitch;
+		}
+		return;
+	}
+
+	const uint64_t startTick = bCompressed ? GetPreciseTick() : 0;
+
+	const CRect range = TileRange(rect);
+	for (LONG ty = range.top; ty < range.bottom; ty++) {
+		for (LONG tx = range.left; tx < range.right; tx++) {
+			CRect r;
+			r.IntersectRect(TileRect(tx, ty), rect);
+			BYTE* d = dst + dstPitch * (r.top - rect.top) + (r.left - rect.left) * 4;
+
+			const uint32_t slot = slots[ty * tilesX + tx];
+			if (slot != kNoSlot && bCompressed) {
+				// the runs are expanded straight to dst
+				const UINT x0 = r.left - tx * kTileSize;
+				const UINT x1 = r.right - tx * kTileSize;
+				for (LONG y = r.top; y < r.bottom; y++) {
+					const uint8_t* p = stream.data() + lineStarts[(size_t)slot * kTileSize + (y - ty * kTileSize)];
+					uint32_t* line = (uint32_t*)d - x0;
+					for (UINT x = 0; x < x1;) {
+						const uint8_t type = *p & 0xC0;
+						const UINT n = (*p++ & 0x3F) + 1;
+						const UINT s = std::max(x, x0);
+						const UINT e = std::min(x + n, x1);
+						if (type == Run_Literal) {
+							if (s < e) {
+								memcpy(line + s, p + (s - x) * 4, (e - s) * 4);
+							}
+							p += n * 4;
+						} else {
+							const uint32_t color = type == Run_Fill ? palette[*p++] : clear;
+							if (s < e) {
+								fill_u32(line + s, color, e - s);
+							}
+						}
+						x += n;
+					}
+					d += dstPitch;
+				}
+			}
+			else if (slot == kNoSlot) {
+				for (LONG y = r.top; y < r.bottom; y++) {
+					fill_u32(d, clear, r.Width());
+					d += dstPitch;
+				}
+			} else {
+				const uint32_t* src = tileData.get() + (size_t)kTileSize * kTileSize * slot
+					+ kTileSize * (r.top - ty * kTileSize) + (r.left - tx * kTileSize);
+				for (LONG y = r.top; y < r.bottom; y++) {
+					memcpy(d, src, r.Width() * 4);
+					src += kTileSize;
+					d += dstPitch;
+				}
+			}
+		}
+	}
+
+	if (bCompressed) {
+		ms_decodeTicks += GetPreciseTick() - startTick;
+	}
+}
+
+void MemPic_t::ReleaseBuffers()
+{
+	if (bCompressed) {
+		ResetTiles();
+	}
+	if (pool) {
+		pool->Release({ std::move(data), dataSize });
+		pool->Release({ std::move(tileData), (size_t)tileCapacity * kTileSize * kTileSize });
+	}
+	data.reset();
+	tileData.reset();
+	dataSize = 0;
+	tileCapacity = 0;
+	tileCount = 0;
+}
+
 //
 // CDX11SubPic
 //
@@ -149,7 +525,6 @@ CDX11SubPic::CDX11SubPic(MemPic_t&& pMemPic, CDX11SubPicAllocator *pAllocator)
 CDX11SubPic::~CDX11SubPic()
 {
 	CAutoLock Lock(&CDX11SubPicAllocator::ms_SurfaceQueueLock);
-	// Add surface to cache
 	if (m_pAllocator) {
 		for (auto it = m_pAllocator->m_AllocatedSurfaces.begin(), end = m_pAllocator->m_AllocatedSurfaces.end(); it != end; ++it) {
 			if (*it == this) {
@@ -157,8 +532,9 @@ CDX11SubPic::~CDX11SubPic()
 				break;
 			}
 		}
-		m_pAllocator->m_FreeSurfaces.push_back(std::move(m_MemPic));
 	}
+	// the buffers are reused by the pool, also after the allocator is released
+	m_MemPic.ReleaseBuffers();
 }
 
 // ISubPic
@@ -188,11 +564,20 @@ STDMETHODIMP CDX11SubPic::CopyTo(ISubPic* pSubPic)
 		return hr;
 	}
 
-	if (m_rcDirty.IsRectEmpty()) {
-		return S_FALSE;
+	if (!m_MemPic.data) {
+		// a sparse picture is only a copy
+		return E_FAIL;
 	}
 
 	auto pDstMemPic = reinterpret_cast<MemPic_t*>(pSubPic->GetObject());
+	if (!pDstMemPic->data) {
+		pDstMemPic->ResetTiles();
+		pDstMemPic->Changed();
+	}
+
+	if (m_rcDirty.IsRectEmpty()) {
+		return S_FALSE;
+	}
 
 	CRect copyRect(m_rcDirty);
 	copyRect.InflateRect(1, 1);
@@ -201,6 +586,63 @@ STDMETHODIMP CDX11SubPic::CopyTo(ISubPic* pSubPic)
 		return S_FALSE;
 	}
 
+	const CRect range = m_MemPic.TileRange(copyRect);
+
+	if (!pDstMemPic->data && pDstMemPic->bCompressed) {
+		const uint32_t clear = m_bInvAlpha ? 0x00000000 : 0xFF000000;
+		for (LONG ty = range.top; ty < range.bottom; ty++) {
+			for (LONG tx = range.left; tx < range.right; tx++) {
+				if (m_MemPic.IsOccupied(tx, ty)) {
+					CRect r;
+					r.IntersectRect(m_MemPic.TileRect(tx, ty), copyRect);
+					pDstMemPic->AddCompressedTile(tx, ty, m_MemPic.data.get() + m_MemPic.w * r.top + r.left, m_MemPic.w, r, clear);
+				}
+			}
+		}
+
+		return S_OK;
+	}
+
+	if (!pDstMemPic->data) {
+		// only the occupied tiles are copied
+		UINT count = 0;
+		for (LONG ty = range.top; ty < range.bottom; ty++) {
+			for (LONG tx = range.left; tx < range.right; tx++) {
+				count += m_MemPic.IsOccupied(tx, ty);
+			}
+		}
+		pDstMemPic->ReserveTiles(count);
+
+		const uint32_t clear = m_bInvAlpha ? 0x00000000 : 0xFF000000;
+		for (LONG ty = range.top; ty < range.bottom; ty++) {
+			for (LONG tx = range.left; tx < range.right; tx++) {
+				if (!m_MemPic.IsOccupied(tx, ty)) {
+					continue;
+				}
+				uint32_t* dst = pDstMemPic->AddTile(tx, ty);
+				if (!dst) {
+					return E_OUTOFMEMORY;
+				}
+
+				const CRect tileRect = m_MemPic.TileRect(tx, ty);
+				CRect r;
+				r.IntersectRect(tileRect, copyRect);
+				if (r != tileRect) {
+					fill_u32(dst, clear, MemPic_t::kTileSize * MemPic_t::kTileSize);
+				}
+				const uint32_t* src = m_MemPic.data.get() + m_MemPic.w * r.top + r.left;
+				dst += MemPic_t::kTileSize * (r.top - tileRect.top) + (r.left - tileRect.left);
+				for (LONG y = r.top; y < r.bottom; y++) {
+					memcpy(dst, src, r.Width() * 4);
+					src += m_MemPic.w;
+					dst += MemPic_t::kTileSize;
+				}
+			}
+		}
+
+		return S_OK;
+	}
+
 	const UINT copyW_bytes = copyRect.Width() * 4;
 	UINT copyH = copyRect.Height();
 	auto src = m_MemPic.data.get() + m_MemPic.w * copyRect.top + copyRect.left;
@@ -211,41 +653,57 @@ STDMETHODIMP CDX11SubPic::CopyTo(ISubPic* pSubPic)
 		src += m_MemPic.w;
 		dst += pDstMemPic->w;
 	}
+	for (LONG ty = range.top; ty < range.bottom; ty++) {
+		for (LONG tx = range.left; tx < range.right; tx++) {
+			if (m_MemPic.IsOccupied(tx, ty)) {
+				pDstMemPic->SetOccupied(tx, ty, true);
+			}
+		}
+	}
+	pDstMemPic->Changed();
 
 	return S_OK;
 }
 
 STDMETHODIMP CDX11SubPic::ClearDirtyRect()
 {
-	if (m_rcDirty.IsRectEmpty()) {
-		return S_FALSE;
-	}
-
-	m_rcDirty.InflateRect(1, 1);
-#ifdef _WIN64
-	const LONG a = 16 / sizeof(uint32_t) - 1;
-	m_rcDirty.left &= ~a;
-	m_rcDirty.right = (m_rcDirty.right + a) & ~a;
-#endif
-	m_rcDirty.IntersectRect(m_rcDirty, CRect(0, 0, m_MemPic.w, m_MemPic.h));
-
-	uint32_t* ptr = m_MemPic.data.get() + m_MemPic.w * m_rcDirty.top + m_rcDirty.left;
-	const UINT dirtyW = m_rcDirty.Width();
-	UINT dirtyH = m_rcDirty.Height();
+	m_rcDirty.SetRectEmpty();
 
-	while (dirtyH-- > 0) {
-		fill_u32(ptr, m_bInvAlpha ? 0x00000000 : 0xFF000000, dirtyW);
-		ptr += m_MemPic.w;
+	if (!m_MemPic.data) {
+		m_MemPic.ResetTiles();
+		m_MemPic.Changed();
+		return S_OK;
 	}
 
-	m_rcDirty.SetRectEmpty();
+	// only the occupied tiles have drawn pixels
+	const uint32_t clear = m_bInvAlpha ? 0x00000000 : 0xFF000000;
+	bool bCleared = false;
+	for (UINT ty = 0; ty < m_MemPic.tilesY; ty++) {
+		for (UINT tx = 0; tx < m_MemPic.tilesX; tx++) {
+			if (!m_MemPic.IsOccupied(tx, ty)) {
+				continue;
+			}
+			const CRect tileRect = m_MemPic.TileRect(tx, ty);
+			uint32_t* ptr = m_MemPic.data.get() + m_MemPic.w * tileRect.top + tileRect.left;
+			for (LONG y = tileRect.top; y < tileRect.bottom; y++) {
+				fill_u32(ptr, clear, tileRect.Width());
+				ptr += m_MemPic.w;
+			}
+			m_MemPic.SetOccupied(tx, ty, false);
+			bCleared = true;
+		}
+	}
+	if (!bCleared) {
+		return S_FALSE;
+	}
+	m_MemPic.Changed();
 
 	return S_OK;
 }
 
 STDMETHODIMP CDX11SubPic::Lock(SubPicDesc& spd)
 {
-	if (!m_MemPic.data) {
+	if (!m_MemPic.data) { // sparse
 		return E_FAIL;
 	}
 
@@ -267,6 +725,31 @@ STDMETHODIMP CDX11SubPic::Unlock(RECT* pDirtyRect)
 	} else {
 		m_rcDirty = CRect(CPoint(0, 0), m_size);
 	}
+	m_MemPic.Changed();
+
+	// providers often mark the whole subpic or a loose rect as dirty,
+	// the copies, the clearing and the upload only need the drawn pixels
+	if (m_MemPic.data && !m_rcDirty.IsRectEmpty()) {
+		const uint32_t clear = m_bInvAlpha ? 0x00000000 : 0xFF000000;
+		const CRect range = m_MemPic.TileRange(m_rcDirty);
+		CRect rcDrawn;
+		for (LONG ty = range.top; ty < range.bottom; ty++) {
+			for (LONG tx = range.left; tx < range.right; tx++) {
+				const CRect tileRect = m_MemPic.TileRect(tx, ty);
+				CRect r;
+				r.IntersectRect(tileRect, m_rcDirty);
+				RECT rcTile;
+				const bool bDrawn = GetBoundingRect_u32(m_MemPic.data.get(), m_MemPic.w, r, clear, rcTile);
+				if (bDrawn) {
+					rcDrawn.UnionRect(rcDrawn, &rcTile);
+				}
+				// the part of the tile outside of the dirty rect is not known
+				m_MemPic.SetOccupied(tx, ty, bDrawn || (r != tileRect && m_MemPic.IsOccupied(tx, ty)));
+			}
+		}
+		ms_trimmedPixels += (uint64_t)m_rcDirty.Width() * m_rcDirty.Height() - (uint64_t)rcDrawn.Width() * rcDrawn.Height();
+		m_rcDirty = rcDrawn;
+	}
 
 	return S_OK;
 }
@@ -296,6 +779,7 @@ CDX11SubPicAllocator::CDX11SubPicAllocator(ID3D11Device* pDevice, SIZE maxsize)
 	: CSubPicAllocatorImpl(maxsize, true)
 	, m_pDevice(pDevice)
 	, m_maxsize(maxsize)
+	, m_pPool(std::make_shared<CMemPicPool>())
 {
 	CreateBlendState();
 	CreateOtherStates();
@@ -310,10 +794,37 @@ CDX11SubPicAllocator::~CDX11SubPicAllocator()
 void CDX11SubPicAllocator::GetStats(int& _nFree, int& _nAlloc)
 {
 	CAutoLock Lock(&ms_SurfaceQueueLock);
-	_nFree = (int)m_FreeSurfaces.size();
+	_nFree = (int)m_pPool->GetStats().freeCount;
 	_nAlloc = (int)m_AllocatedSurfaces.size();
 }
 
+void CDX11SubPicAllocator::GetStats(SubPicPoolData_t& data)
+{
+	const auto stats = m_pPool->GetStats();
+	data.size      = sizeof(SubPicPoolData_t);
+	data.freeCount = stats.freeCount;
+	data.freeBytes = stats.freeBytes;
+	data.usedCount = stats.usedCount;
+	data.usedBytes = stats.usedBytes;
+	data.limit     = stats.limit;
+	data.created   = stats.created;
+	data.reused    = stats.reused;
+	data.released  = stats.released;
+
+	data.compressedBytes   = MemPic_t::ms_compressedBytes;
+	data.uncompressedBytes = MemPic_t::ms_uncompressedBytes;
+	data.decodeTime        = MemPic_t::ms_decodeTicks * GetPreciseSecondsPerTick() * 1000.0;
+
+	CAutoLock Lock(&ms_SurfaceQueueLock);
+	data.allocatedSubPics = (uint32_t)m_AllocatedSurfaces.size();
+}
+
+void CDX11SubPicAllocator::GetUploadStats(uint64_t& uploadedBytes, uint64_t& skippedUploads)
+{
+	uploadedBytes = m_uploadedBytes;
+	skippedUploads = m_skippedUploads;
+}
+
 void CDX11SubPicAllocator::ClearCache()
 {
 	// Clear the allocator of any remaining subpics
@@ -322,10 +833,10 @@ void CDX11SubPicAllocator::ClearCache()
 		pSubPic->m_pAllocator = nullptr;
 	}
 	m_AllocatedSurfaces.clear();
-	m_FreeSurfaces.clear();
 
 	m_pOutputShaderResource.Release();
 	m_pOutputTexture.Release();
+	m_pUploadedPic = nullptr;
 }
 
 // ISubPicAllocator
@@ -452,7 +963,7 @@ void CDX11SubPicAllocator::CreateBlendState()
 
 void CDX11SubPicAllocator::CreateOtherStates()
 {
-	D3D11_BUFFER_DESC BufferDesc = { sizeof(VERTEX) * 4, D3D11_USAGE_DYNAMIC, D3D11_BIND_VERTEX_BUFFER, D3D11_CPU_ACCESS_WRITE, 0, 0 };
+	D3D11_BUFFER_DESC BufferDesc = { sizeof(VERTEX) * 4 * kMaxBands, D3D11_USAGE_DYNAMIC, D3D11_BIND_VERTEX_BUFFER, D3D11_CPU_ACCESS_WRITE, 0, 0 };
 	EXECUTE_ASSERT(S_OK == m_pDevice->CreateBuffer(&BufferDesc, nullptr, &m_pVertexBuffer));
 
 	D3D11_SAMPLER_DESC SampDesc = {};
@@ -477,6 +988,14 @@ void CDX11SubPicAllocator::ReleaseAllStates()
 	m_pSamplerLinear.Release();
 }
 
+void CDX11SubPicAllocator::SetUploaded(const MemPic_t& memPic, const CRect& copyRect, const uint64_t bytes)
+{
+	m_pUploadedPic = &memPic;
+	m_uploadedVersion = memPic.version;
+	m_uploadedRect = copyRect;
+	m_uploadedBytes += bytes;
+}
+
 HRESULT CDX11SubPicAllocator::Render(const MemPic_t& memPic, const CRect& dirtyRect, const CRect& srcRect, const CRect& dstRect)
 {
 	HRESULT hr = S_OK;
@@ -491,64 +1010,121 @@ HRESULT CDX11SubPicAllocator::Render(const MemPic_t& memPic, const CRect& dirtyR
 	bool stretching = (srcRect.Size() != dstRect.Size());
 
 	CRect copyRect(dirtyRect);
+	RECT subpicRect = { 0, 0, memPic.w, memPic.h };
 	if (stretching) {
 		copyRect.InflateRect(1, 1);
-		RECT subpicRect = { 0, 0, memPic.w, memPic.h };
 		EXECUTE_ASSERT(copyRect.IntersectRect(copyRect, &subpicRect));
 	}
 
+	// the tile rows with drawn pixels, two subtitle lines at the top and at the bottom
+	// of the picture are two bands and the middle of the picture is not uploaded
+	UINT nBands = 0;
+	const CRect range = memPic.TileRange(srcRect);
+	for (LONG ty = range.top; ty < range.bottom; ty++) {
+		LONG left = range.right;
+		LONG right = range.left;
+		for (LONG tx = range.left; tx < range.right; tx++) {
+			if (memPic.IsOccupied(tx, ty)) {
+				left = std::min(left, tx);
+				right = tx + 1;
+			}
+		}
+		if (left >= right) {
+			continue;
+		}
+
+		CRect band(left * MemPic_t::kTileSize, ty * MemPic_t::kTileSize, right * MemPic_t::kTileSize, (ty + 1) * MemPic_t::kTileSize);
+		band.IntersectRect(band, srcRect);
+		if (nBands && (m_bands[nBands - 1].bottom == band.top || nBands == kMaxBands)) {
+			m_bands[nBands - 1].UnionRect(m_bands[nBands - 1], band);
+		} else {
+			m_bands[nBands++] = band;
+		}
+	}
+	if (!nBands) {
+		return S_OK;
+	}
+
+	// the pixels around the bands are needed for the linear interpolation
+	CRect uploadRects[kMaxBands];
+	uint64_t uploadBytes = 0;
+	for (UINT i = 0; i < nBands; i++) {
+		uploadRects[i] = m_bands[i];
+		if (stretching) {
+			uploadRects[i].InflateRect(1, 1);
+			uploadRects[i].IntersectRect(uploadRects[i], &subpicRect);
+		}
+		uploadBytes += (uint64_t)uploadRects[i].Width() * uploadRects[i].Height() * 4;
+	}
+
 	CComPtr<ID3D11DeviceContext> pDeviceContext;
 	m_pDevice->GetImmediateContext(&pDeviceContext);
 
 	D3D11_TEXTURE2D_DESC texDesc = {};
 	m_pOutputTexture->GetDesc(&texDesc);
 
-	uint32_t* src = memPic.data.get() + memPic.w * copyRect.top + copyRect.left;
-	if (texDesc.Usage == D3D11_USAGE_DYNAMIC) {
+	const uint32_t clear = m_bInvAlpha ? 0x00000000 : 0xFF000000;
+	if (&memPic == m_pUploadedPic && memPic.version == m_uploadedVersion && copyRect == m_uploadedRect) {
+		// the same subpicture as in the previous frame
+		m_skippedUploads++;
+	}
+	else if (texDesc.Usage == D3D11_USAGE_DYNAMIC) {
 		// workaround for an Intel driver bug where frequent UpdateSubresource calls caused high memory consumption
 		D3D11_MAPPED_SUBRESOURCE mr;
 		hr = pDeviceContext->Map(m_pOutputTexture, 0, D3D11_MAP_WRITE_DISCARD, 0, &mr);
 		if (SUCCEEDED(hr)) {
-			BYTE* dst = (BYTE*)mr.pData + mr.RowPitch * copyRect.top + (copyRect.left * 4);
-			const UINT copyW_bytes = copyRect.Width() * 4;
-			UINT copyH = copyRect.Height();
-			while (copyH-- > 0) {
-				memcpy(dst, src, copyW_bytes);
-				src += memPic.w;
-				dst += mr.RowPitch;
+			for (UINT i = 0; i < nBands; i++) {
+				const CRect& r = uploadRects[i];
+				memPic.CopyRect(r, (BYTE*)mr.pData + mr.RowPitch * r.top + (r.left * 4), mr.RowPitch, clear);
 			}
 			pDeviceContext->Unmap(m_pOutputTexture, 0);
+			SetUploaded(memPic, copyRect, uploadBytes);
 		}
 	}
 	else {
-		D3D11_BOX dstBox = { copyRect.left, copyRect.top, 0, copyRect.right, copyRect.bottom, 1 };
-		pDeviceContext->UpdateSubresource(m_pOutputTexture, 0, &dstBox, src, memPic.w * 4, 0);
+		for (UINT i = 0; i < nBands; i++) {
+			const CRect& r = uploadRects[i];
+			D3D11_BOX dstBox = { r.left, r.top, 0, r.right, r.bottom, 1 };
+			if (memPic.data) {
+				pDeviceContext->UpdateSubresource(m_pOutputTexture, 0, &dstBox, memPic.data.get() + memPic.w * r.top + r.left, memPic.w * 4, 0);
+			} else {
+				m_uploadBuffer.resize((size_t)r.Width() * r.Height());
+				memPic.CopyRect(r, (BYTE*)m_uploadBuffer.data(), r.Width() * 4, clear);
+				pDeviceContext->UpdateSubresource(m_pOutputTexture, 0, &dstBox, m_uploadBuffer.data(), r.Width() * 4, 0);
+			}
+		}
+		SetUploaded(memPic, copyRect, uploadBytes);
 	}
 
 	const float src_dx = 1.0f / texDesc.Width;
 	const float src_dy = 1.0f / texDesc.Height;
-	const float src_l = src_dx * srcRect.left;
-	const float src_r = src_dx * srcRect.right;
-	const float src_t = src_dy * srcRect.top;
-	const float src_b = src_dy * srcRect.bottom;
-
-	const POINT points[4] = {
-		{ -1, -1 },
-		{ -1, +1 },
-		{ +1, -1 },
-		{ +1, +1 }
-	};
 
-	const VERTEX Vertices[4] = {
-		// Vertices for drawing whole texture
+	// the viewport is dstRect, the position of each band is relative to srcRect
+	const float pos_dx = 2.0f / srcRect.Width();
+	const float pos_dy = 2.0f / srcRect.Height();
+
+	VERTEX Vertices[kMaxBands * 4];
+	for (UINT i = 0; i < nBands; i++) {
+		const CRect& band = m_bands[i];
+		const float src_l = src_dx * band.left;
+		const float src_r = src_dx * band.right;
+		const float src_t = src_dy * band.top;
+		const float src_b = src_dy * band.bottom;
+
+		const float pos_l = pos_dx * (band.left - srcRect.left) - 1.0f;
+		const float pos_r = pos_dx * (band.right - srcRect.left) - 1.0f;
+		const float pos_t = 1.0f - pos_dy * (band.top - srcRect.top);
+		const float pos_b = 1.0f - pos_dy * (band.bottom - srcRect.top);
+
+		// Vertices for drawing the band
 		// 2 ___4
 		//  |\ |
 		// 1|_\|3
-		{ {(float)points[0].x, (float)points[0].y, 0}, {src_l, src_b} },
-		{ {(float)points[1].x, (float)points[1].y, 0}, {src_l, src_t} },
-		{ {(float)points[2].x, (float)points[2].y, 0}, {src_r, src_b} },
-		{ {(float)points[3].x, (float)points[3].y, 0}, {src_r, src_t} },
-	};
+		Vertices[i * 4 + 0] = { {pos_l, pos_b, 0}, {src_l, src_b} };
+		Vertices[i * 4 + 1] = { {pos_l, pos_t, 0}, {src_l, src_t} };
+		Vertices[i * 4 + 2] = { {pos_r, pos_b, 0}, {src_r, src_b} };
+		Vertices[i * 4 + 3] = { {pos_r, pos_t, 0}, {src_r, src_t} };
+	}
 
 	D3D11_MAPPED_SUBRESOURCE mr;
 	hr = pDeviceContext->Map(m_pVertexBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mr);
@@ -556,7 +1132,7 @@ HRESULT CDX11SubPicAllocator::Render(const MemPic_t& memPic, const CRect& dirtyR
 		return hr;
 	}
 
-	memcpy(mr.pData, &Vertices, sizeof(Vertices));
+	memcpy(mr.pData, &Vertices, sizeof(VERTEX) * 4 * nBands);
 	pDeviceContext->Unmap(m_pVertexBuffer, 0);
 
 	UINT Stride = sizeof(VERTEX);
@@ -578,7 +1154,9 @@ HRESULT CDX11SubPicAllocator::Render(const MemPic_t& memPic, const CRect& dirtyR
 	vp.MaxDepth = 1.0f;
 	pDeviceContext->RSSetViewports(1, &vp);
 
-	pDeviceContext->Draw(4, 0);
+	for (UINT i = 0; i < nBands; i++) {
+		pDeviceContext->Draw(4, i * 4);
+	}
 
 #if _DEBUG & ENABLE_DUMP_SUBPIC
 	{
@@ -605,27 +1183,24 @@ bool CDX11SubPicAllocator::Alloc(bool fStatic, ISubPic** ppSubPic)
 	*ppSubPic = nullptr;
 
 	MemPic_t pMemPic;
-
-	if (!fStatic) {
-		CAutoLock cAutoLock(&ms_SurfaceQueueLock);
-		if (!m_FreeSurfaces.empty()) {
-			pMemPic = std::move(m_FreeSurfaces.front());
-			m_FreeSurfaces.pop_front();
-		}
-	}
-
-	if (!pMemPic.data) {
-		pMemPic.w = ALIGN(m_maxsize.cx, 16/sizeof(uint32_t));
-		pMemPic.h = m_maxsize.cy;
-
-		const UINT picSize = pMemPic.w * pMemPic.h;
-		auto data = new(std::nothrow) uint32_t[picSize];
-		if (!data) {
+	pMemPic.w = ALIGN(m_maxsize.cx, 16/sizeof(uint32_t));
+	pMemPic.h = m_maxsize.cy;
+	pMemPic.pool = m_pPool;
+
+	// a dynamic subpic of a write-only allocator is only a copy of the static subpic
+	const bool bSparse = !fStatic && m_fDynamicWriteOnly;
+	if (!bSparse) {
+		auto buffer = m_pPool->Acquire((size_t)pMemPic.w * pMemPic.h);
+		if (!buffer.data) {
 			return false;
 		}
 
-		pMemPic.data.reset(data);
+		pMemPic.data = std::move(buffer.data);
+		pMemPic.dataSize = buffer.size;
 	}
+	pMemPic.bCompressed = bSparse && m_bCompressQueued;
+	pMemPic.InitTiles(bSparse);
+	pMemPic.Changed();
 
 	*ppSubPic = new CDX11SubPic(std::move(pMemPic), fStatic ? 0 : this);
 	if (!(*ppSubPic)) {
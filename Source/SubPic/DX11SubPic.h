@@ -21,23 +21,180 @@
 
 #include "SubPicImpl.h"
 #include <deque>
+#include <atomic>
+#include <memory>
 #include <d3d11_1.h>
 
+// CMemPicPool
+
+// Pool of the pixel buffers of the subpics. The free buffers are grouped in size classes
+// (four for each power of two), a free buffer that is large enough is reused, also after
+// a change of the maximum subpic size. The least recently freed buffers are released
+// when the used and free buffers exceed the memory limit or after a while without use.
+class CMemPicPool
+{
+public:
+	static constexpr UINT64 kDefaultLimit = 256 * 1048576;
+
+	struct Stats_t {
+		UINT64 created   = 0; // buffers allocated by the pool
+		UINT64 reused    = 0; // requests served by a free buffer
+		UINT64 released  = 0; // free buffers released by the limit or the age
+		UINT   freeCount = 0;
+		UINT64 freeBytes = 0;
+		UINT   usedCount = 0;
+		UINT64 usedBytes = 0;
+		UINT64 limit     = 0;
+	};
+
+	struct Buffer_t {
+		std::unique_ptr<uint32_t[]> data;
+		size_t size = 0; // pixels
+	};
+
+private:
+	static constexpr unsigned kClasses = 4 * 48;
+	static constexpr unsigned kMaxLargerClasses = 3; // a free buffer less than two times larger is reused
+	static constexpr ULONGLONG kMaxFreeAge = 10000; // ms
+
+	struct Free_t {
+		Buffer_t buffer;
+		ULONGLONG lastUsed;
+	};
+	std::vector<Free_t> m_free[kClasses]; // the most recently freed buffer of each class is at the back
+
+	CCritSec m_csLock;
+	Stats_t m_Stats;
+
+	static unsigned SizeClass(const size_t size);
+	void Trim(const ULONGLONG now);
+
+public:
+	CMemPicPool(const UINT64 limit = kDefaultLimit) { m_Stats.limit = limit; }
+
+	// data is nullptr if there is not enough memory, the buffer can be larger than requested
+	Buffer_t Acquire(const size_t size);
+	void Release(Buffer_t&& buffer);
+
+	void SetLimit(const UINT64 limit);
+	Stats_t GetStats();
+};
+
+// Data of IExFilterConfig::Flt_GetBin("statsSubPicPool")
+struct SubPicPoolData_t {
+	uint32_t size; // sizeof(SubPicPoolData_t)
+	uint32_t freeCount;
+	uint64_t freeBytes;
+	uint32_t usedCount;
+	uint32_t allocatedSubPics; // dynamic subpics that have not been released
+	uint64_t usedBytes;
+	uint64_t limit;
+	uint64_t created;
+	uint64_t reused;
+	uint64_t released;
+	// compressed dynamic subpics
+	uint64_t compressedBytes;
+	uint64_t uncompressedBytes; // the size of the same tiles without compression
+	double decodeTime;          // milliseconds since the start
+};
+
 // CDX11SubPic
 
 
 class CDX11SubPicAllocator;
 
+// The picture is divided into tiles, the tiles without drawn pixels are not copied, cleared or uploaded.
+// A static subpicture has the whole picture in 'data'. A dynamic subpicture of a write-only
+// allocator is sparse, it keeps only the occupied tiles in 'tileData' and cannot be locked.
+// A compressed sparse picture keeps each line of the occupied tiles as runs in 'stream':
+// a byte with the type in the two high bits and the length - 1 in the low six bits, then
+// a palette index for a fill run or the pixels of a literal run. Clear runs have no data.
 struct MemPic_t {
-	std::unique_ptr<uint32_t[]> data;
+	static constexpr UINT kTileSize = 64;
+	static constexpr uint32_t kNoSlot = UINT32_MAX;
+	enum : uint8_t {
+		Run_Clear   = 0x00,
+		Run_Fill    = 0x40,
+		Run_Literal = 0x80,
+	};
+	static constexpr UINT kMinFillRun = 3; // a shorter run of the same color is a part of a literal run
+	static constexpr UINT kMaxPalette = 256;
+
+	std::unique_ptr<uint32_t[]> data; // nullptr for a sparse picture
+	size_t dataSize = 0; // pixels, can be larger than w * h
 	UINT w = 0;
 	UINT h = 0;
+	uint64_t version = 0; // a new value after each change of data
+
+	UINT tilesX = 0;
+	UINT tilesY = 0;
+	std::vector<uint64_t> occupied; // a bit for each tile, the pixels of the other tiles have the clear value
+
+	// sparse picture
+	std::vector<uint32_t> slots; // the index in tileData of each occupied tile
+	std::unique_ptr<uint32_t[]> tileData;
+	UINT tileCapacity = 0;
+	UINT tileCount = 0;
+
+	// compressed sparse picture
+	bool bCompressed = false;
+	std::vector<uint8_t> stream;
+	std::vector<uint32_t> lineStarts; // kTileSize for each occupied tile
+	std::vector<uint32_t> palette;
+	std::vector<uint16_t> paletteHash; // index + 1 in palette, 0 for an empty entry
+
+	std::shared_ptr<CMemPicPool> pool; // the buffers are returned to the pool by ReleaseBuffers()
+
+	void Changed() { version = ++ms_lastVersion; }
+
+	inline static std::atomic<uint64_t> ms_lastVersion = 0;
+
+	// all compressed pictures
+	inline static std::atomic<uint64_t> ms_compressedBytes = 0;
+	inline static std::atomic<uint64_t> ms_uncompressedBytes = 0; // the size of the same tiles without compression
+	inline static std::atomic<uint64_t> ms_decodeTicks = 0;       // GetPreciseTick() units
+
+	// all tiles are occupied in a whole picture (the data is not initialized), no tiles in a sparse picture
+	void InitTiles(const bool bSparse);
+
+	bool IsOccupied(const UINT tx, const UINT ty) const {
+		const UINT i = ty * tilesX + tx;
+		return (occupied[i >> 6] >> (i & 63)) & 1;
+	}
+	void SetOccupied(const UINT tx, const UINT ty, const bool bOccupied) {
+		const UINT i = ty * tilesX + tx;
+		occupied[i >> 6] = bOccupied ? occupied[i >> 6] | (1ull << (i & 63)) : occupied[i >> 6] & ~(1ull << (i & 63));
+	}
+	CRect TileRect(const UINT tx, const UINT ty) const {
+		return CRect(tx * kTileSize, ty * kTileSize, std::min((tx + 1) * kTileSize, w), std::min((ty + 1) * kTileSize, h));
+	}
+	// the tiles that contain the pixels of 'rect'
+	CRect TileRange(const CRect& rect) const {
+		return CRect(rect.left / kTileSize, rect.top / kTileSize, (rect.right + kTileSize - 1) / kTileSize, (rect.bottom + kTileSize - 1) / kTileSize);
+	}
+
+	// sparse picture
+	void ResetTiles();
+	void ReserveTiles(const UINT count); // after ResetTiles()
+	uint32_t* AddTile(const UINT tx, const UINT ty); // pitch is kTileSize
+	// compresses the pixels of 'rect' in the tile, the other pixels of the tile are clear
+	void AddCompressedTile(const UINT tx, const UINT ty, const uint32_t* src, const UINT srcPitch, const CRect& rect, const uint32_t clear);
+	// the memory of the compressed tiles
+	size_t CompressedSize() const { return stream.size() + (lineStarts.size() + palette.size()) * sizeof(uint32_t); }
+
+	// copies 'rect' to dst, the tiles that are not occupied are filled with 'clear'
+	void CopyRect(const CRect& rect, BYTE* dst, const UINT dstPitch, const uint32_t clear) const;
+
+	void ReleaseBuffers();
 };
 
 class CDX11SubPic : public CSubPicImpl
 {
 	MemPic_t m_MemPic;
 
+	// pixels removed from the dirty rects by Unlock() in all subpics
+	inline static std::atomic<uint64_t> ms_trimmedPixels = 0;
+
 protected:
 	STDMETHODIMP_(void*) GetObject() override; // returns MemPic_t*
 
@@ -55,6 +212,8 @@ public:
 	STDMETHODIMP Unlock(RECT* pDirtyRect) override;
 	STDMETHODIMP AlphaBlt(RECT* pSrc, RECT* pDst, SubPicDesc* pTarget) override;
 	STDMETHODIMP_(bool) IsNeedAlloc() override;
+
+	static uint64_t GetTrimmedPixels() { return ms_trimmedPixels; }
 };
 
 // CDX11SubPicAllocator
@@ -71,21 +230,44 @@ class CDX11SubPicAllocator : public CSubPicAllocatorImpl, public CCritSec
 	CComPtr<ID3D11SamplerState> m_pSamplerPoint;
 	CComPtr<ID3D11SamplerState> m_pSamplerLinear;
 
+	// the bands of tile rows with drawn pixels, each is drawn as a separate quad
+	static constexpr UINT kMaxBands = 16;
+	CRect m_bands[kMaxBands];
+	std::vector<uint32_t> m_uploadBuffer; // for UpdateSubresource() from a sparse picture
+
+	// the picture in m_pOutputTexture, the same picture is not uploaded again
+	const MemPic_t* m_pUploadedPic = nullptr;
+	uint64_t m_uploadedVersion = 0;
+	CRect m_uploadedRect;
+	std::atomic<uint64_t> m_uploadedBytes = 0;
+	std::atomic<uint64_t> m_skippedUploads = 0;
+
+	std::shared_ptr<CMemPicPool> m_pPool;
+	std::atomic<bool> m_bCompressQueued = false;
+
 	bool Alloc(bool fStatic, ISubPic** ppSubPic) override;
 
 	HRESULT CreateOutputTex();
+	void SetUploaded(const MemPic_t& memPic, const CRect& copyRect, const uint64_t bytes);
 	void CreateBlendState();
 	void CreateOtherStates();
 	void ReleaseAllStates();
 
 public:
 	inline static CCritSec ms_SurfaceQueueLock;
-	std::deque<MemPic_t> m_FreeSurfaces;
 	std::deque<CDX11SubPic*> m_AllocatedSurfaces;
 
 	HRESULT Render(const MemPic_t& memPic, const CRect& dirtyRect, const CRect& srcRect, const CRect& dstRect);
 
 	void GetStats(int& _nFree, int& _nAlloc);
+	void GetStats(SubPicPoolData_t& data);
+	// the pixel buffers of the used and free subpics are limited to 'limit' bytes if possible
+	void SetPoolLimit(const UINT64 limit) { m_pPool->SetLimit(limit); }
+	// the dynamic subpics allocated after the call keep their tiles compressed
+	void SetCompressQueued(const bool bCompress) { m_bCompressQueued = bCompress; }
+	bool GetInverseAlpha() const { return m_bInvAlpha; }
+	// bytes copied to the output texture and the drawings without a copy since the allocator was created
+	void GetUploadStats(uint64_t& uploadedBytes, uint64_t& skippedUploads);
 
 	CDX11SubPicAllocator(ID3D11Device* pDevice, SIZE maxsize);
 	~CDX11SubPicAllocator();
@@ -23,6 +23,8 @@
 #include <chrono>
 #include <intsafe.h>
 #include "Utils/Util.h"
+#include "Helper.h"
+#include "Times.h"
 #include "SubPicQueueImpl.h"
 
 #define SUBPIC_TRACE_LEVEL 0
@@ -56,6 +58,7 @@ STDMETHODIMP CSubPicQueueImpl::NonDelegatingQueryInterface(REFIID riid, void** p
 {
 	return
 		QI(ISubPicQueue)
+		QI(ISubPicQueueStats)
 		__super::NonDelegatingQueryInterface(riid, ppv);
 }
 
@@ -100,10 +103,30 @@ STDMETHODIMP CSubPicQueueImpl::SetTime(REFERENCE_TIME rtNow)
 	return S_OK;
 }
 
+// ISubPicQueueStats
+
+STDMETHODIMP CSubPicQueueImpl::GetQueueStats(SubPicQueueStats_t& stats)
+{
+	m_stats.Get(stats, m_nStatsMaxSubPics);
+
+	return S_OK;
+}
+
+STDMETHODIMP CSubPicQueueImpl::ResetQueueStats()
+{
+	m_stats.Reset();
+
+	return S_OK;
+}
+
 // private
 
-HRESULT CSubPicQueueImpl::RenderTo(ISubPic* pSubPic, REFERENCE_TIME rtStart, REFERENCE_TIME rtStop, double fps, BOOL bIsAnimated)
+HRESULT CSubPicQueueImpl::RenderTo(ISubPic* pSubPic, REFERENCE_TIME rtStart, REFERENCE_TIME rtStop, double fps, BOOL bIsAnimated, uint64_t* pHash/* = nullptr*/)
 {
+	if (pHash) {
+		*pHash = 0;
+	}
+
 	CheckPointer(pSubPic, E_POINTER);
 
 	HRESULT hr = E_FAIL;
@@ -129,11 +152,21 @@ HRESULT CSubPicQueueImpl::RenderTo(ISubPic* pSubPic, REFERENCE_TIME rtStart, REF
 		} else {
 			rtRender += (rtStop - rtStart - 1);
 		}
+		const uint64_t renderTick = GetPreciseTick();
 		hr = pSubPicProvider->Render(spd, rtRender, fps, r);
+		m_stats.AddRenderTime(GetPreciseTick() - renderTick);
 
 		pSubPic->SetStart(rtStart);
 		pSubPic->SetStop(rtStop);
 
+		if (pHash && SUCCEEDED(hr) && spd.bpp == 32 && spd.bits) {
+			// the pixels outside of r are clear, the position and the size of the subpic are a part of the hash
+			CRect rcHash;
+			rcHash.IntersectRect(r, CRect(0, 0, spd.w, spd.h));
+			const uint64_t seed = (uint64_t)spd.w << 48 ^ (uint64_t)spd.h << 32 ^ (uint64_t)rcHash.left << 16 ^ (uint64_t)rcHash.top;
+			*pHash = Hash_u32((const uint32_t*)spd.bits, spd.pitch / 4, rcHash, seed) | 1;
+		}
+
 		pSubPic->Unlock(r);
 	}
 
@@ -160,6 +193,7 @@ CSubPicQueue::CSubPicQueue(int nMaxSubPic, bool bDisableAnim, bool bAllowDropSub
 		}
 		return;
 	}
+	m_nStatsMaxSubPics = (unsigned)m_nMaxSubPic;
 
 	CAMThread::Create();
 }
@@ -171,6 +205,12 @@ CSubPicQueue::~CSubPicQueue()
 	CAMThread::Close();
 }
 
+void CSubPicQueue::GetDedupStats(uint64_t& queued, uint64_t& deduplicated) const
+{
+	queued = m_stats.queued;
+	deduplicated = m_stats.deduplicated;
+}
+
 // ISubPicQueue
 
 STDMETHODIMP CSubPicQueue::SetFPS(double fps)
@@ -225,15 +265,14 @@ STDMETHODIMP CSubPicQueue::Invalidate(REFERENCE_TIME rtInvalidate)
 		}
 	}
 
-	while (m_queue.size() && m_queue.back()->GetStop() > rtInvalidate) {
+	while (m_queue.size() && m_queue.back().rtStop > rtInvalidate) {
 #if SUBPIC_TRACE_LEVEL > 2
-		const CComPtr<ISubPic>& pSubPic = m_queue.back();
-		REFERENCE_TIME rtStart = pSubPic->GetStart();
-		REFERENCE_TIME rtStop = pSubPic->GetStop();
-		REFERENCE_TIME rtSegmentStop = pSubPic->GetSegmentStop();
-		DLog(L"  %f -> %f -> %f", double(rtStart) / 10000000.0, double(rtStop) / 10000000.0, double(rtSegmentStop) / 10000000.0);
+		const auto& entry = m_queue.back();
+		REFERENCE_TIME rtStart = entry.pSubPic->GetStart();
+		DLog(L"  %f -> %f -> %f", double(rtStart) / 10000000.0, double(entry.rtStop) / 10000000.0, double(entry.rtSegmentStop) / 10000000.0);
 #endif
 		m_queue.pop_back();
+		m_stats.dropped++;
 	}
 
 	// If we invalidate in the past, always give the queue a chance to re-render the modified subtitles
@@ -257,6 +296,7 @@ STDMETHODIMP_(bool) CSubPicQueue::LookupSubPic(REFERENCE_TIME rtNow, CComPtr<ISu
 STDMETHODIMP_(bool) CSubPicQueue::LookupSubPic(REFERENCE_TIME rtNow, bool bAdviseBlocking, CComPtr<ISubPic>& ppSubPic)
 {
 	bool bStopSearch = false;
+	bool bExact = false;
 
 	{
 		std::lock_guard<std::mutex> lock(m_mutexSubpic);
@@ -277,6 +317,7 @@ STDMETHODIMP_(bool) CSubPicQueue::LookupSubPic(REFERENCE_TIME rtNow, bool bAdvis
 					DLog(L"LookupSubPic: Exact match on the latest subpic");
 #endif
 					bStopSearch = true;
+					bExact = true;
 				} else {
 #if SUBPIC_TRACE_LEVEL > 2
 					DLog(L"LookupSubPic: Possible match on the latest subpic");
@@ -289,6 +330,7 @@ STDMETHODIMP_(bool) CSubPicQueue::LookupSubPic(REFERENCE_TIME rtNow, bool bAdvis
 	}
 
 	bool bTryBlocking = bAdviseBlocking || !m_bAllowDropSubPic;
+	bool bQueueState = false; // the queue state is added once per lookup
 	while (!bStopSearch) {
 		// Look for the subpic in the queue
 		{
@@ -298,9 +340,21 @@ STDMETHODIMP_(bool) CSubPicQueue::LookupSubPic(REFERENCE_TIME rtNow, bool bAdvis
 			DLog(L"LookupSubPic: Searching the queue");
 #endif
 
+			// A queued subpic is not shared until LookupSubPic takes it out of the queue,
+			// the times of an extended entry are applied to it then
+			auto TakeSubPic = [](const auto& entry) {
+				if (entry.bExtended) {
+					entry.pSubPic->SetStop(entry.rtStop);
+					if (entry.rtSegmentStop > entry.pSubPic->GetSegmentStop()) {
+						entry.pSubPic->SetSegmentStop(entry.rtSegmentStop);
+					}
+				}
+				return entry.pSubPic;
+			};
+
 			while (m_queue.size() && !bStopSearch) {
-				const CComPtr<ISubPic>& pSubPic = m_queue.front();
-				REFERENCE_TIME rtSegmentStart = pSubPic->GetSegmentStart();
+				const auto& entry = m_queue.front();
+				REFERENCE_TIME rtSegmentStart = entry.pSubPic->GetSegmentStart();
 
 				if (rtSegmentStart > rtNow) {
 #if SUBPIC_TRACE_LEVEL > 2
@@ -309,9 +363,9 @@ STDMETHODIMP_(bool) CSubPicQueue::LookupSubPic(REFERENCE_TIME rtNow, bool bAdvis
 					bStopSearch = true;
 				} else { // rtSegmentStart <= rtNow
 					bool bRemoveFromQueue = true;
-					REFERENCE_TIME rtStart = pSubPic->GetStart();
-					REFERENCE_TIME rtStop = pSubPic->GetStop();
-					REFERENCE_TIME rtSegmentStop = pSubPic->GetSegmentStop();
+					REFERENCE_TIME rtStart = entry.pSubPic->GetStart();
+					REFERENCE_TIME rtStop = entry.rtStop;
+					REFERENCE_TIME rtSegmentStop = entry.rtSegmentStop;
 
 					if (rtSegmentStop <= rtNow) {
 #if SUBPIC_TRACE_LEVEL > 2
@@ -319,21 +373,23 @@ STDMETHODIMP_(bool) CSubPicQueue::LookupSubPic(REFERENCE_TIME rtNow, bool bAdvis
 							  double(rtNow) / 10000000.0, double(rtStart) / 10000000.0,
 							  double(rtStop) / 10000000.0, double(rtSegmentStop) / 10000000.0);
 #endif
+						m_stats.expired++;
 					} else { // rtNow < rtSegmentStop
 						if (rtStart <= rtNow && rtNow < rtStop) {
 #if SUBPIC_TRACE_LEVEL > 2
 							DLog(L"Exact match found in the queue");
 #endif
-							ppSubPic = pSubPic;
+							ppSubPic = TakeSubPic(entry);
 							bStopSearch = true;
+							bExact = true;
 						} else if (rtNow >= rtStop) {
 							// Reuse old subpic
-							ppSubPic = pSubPic;
+							ppSubPic = TakeSubPic(entry);
 						} else { // rtNow < rtStart
 							if (!ppSubPic || ppSubPic->GetStop() <= rtNow) {
 								// Should be really rare that we use a subpic in advance
 								// unless we mispredicted the timing slightly
-								ppSubPic = pSubPic;
+								ppSubPic = TakeSubPic(entry);
 							} else {
 								bRemoveFromQueue = false;
 							}
@@ -347,6 +403,11 @@ STDMETHODIMP_(bool) CSubPicQueue::LookupSubPic(REFERENCE_TIME rtNow, bool bAdvis
 				}
 			}
 
+			if (!bQueueState) {
+				bQueueState = true;
+				m_stats.AddQueueState((unsigned)m_queue.size(), m_queue.size() ? m_queue.back().rtStop - rtNow : 0);
+			}
+
 			lock.unlock();
 			m_condQueueFull.notify_one();
 		}
@@ -374,11 +435,13 @@ STDMETHODIMP_(bool) CSubPicQueue::LookupSubPic(REFERENCE_TIME rtNow, bool bAdvis
 
 					auto queueReady = [this, rtNow]() {
 						return ((int)m_queue.size() == m_nMaxSubPic)
-							   || (m_queue.size() && m_queue.back()->GetStop() > rtNow);
+							   || (m_queue.size() && m_queue.back().rtStop > rtNow);
 					};
 
 					auto duration = bAdviseBlocking ? std::chrono::milliseconds(m_rtTimePerFrame / 10000) : std::chrono::seconds(1);
-					m_condQueueReady.wait_for(lock, duration, queueReady);
+					const uint64_t waitTick = GetPreciseTick();
+					const bool bReady = m_condQueueReady.wait_for(lock, duration, queueReady);
+					m_stats.AddBlocking(GetPreciseTick() - waitTick, !bReady);
 				}
 			}
 		} else {
@@ -386,6 +449,8 @@ STDMETHODIMP_(bool) CSubPicQueue::LookupSubPic(REFERENCE_TIME rtNow, bool bAdvis
 		}
 	}
 
+	m_stats.AddLookup(bExact ? CSubPicQueueStats::Lookup_Exact : ppSubPic ? CSubPicQueueStats::Lookup_Reused : CSubPicQueueStats::Lookup_Empty);
+
 	if (ppSubPic) {
 		// Save the subpic for later reuse
 		std::lock_guard<std::mutex> lock(m_mutexSubpic);
@@ -417,8 +482,8 @@ STDMETHODIMP CSubPicQueue::GetStats(int& nSubPics, REFERENCE_TIME& rtNow, REFERE
 	nSubPics = (int)m_queue.size();
 	rtNow = m_rtNow;
 	if (nSubPics) {
-		rtStart = m_queue.front()->GetStart();
-		rtStop = m_queue.back()->GetStop();
+		rtStart = m_queue.front().pSubPic->GetStart();
+		rtStop = m_queue.back().rtStop;
 	} else {
 		rtStart = rtStop = 0;
 	}
@@ -433,10 +498,8 @@ STDMETHODIMP CSubPicQueue::GetStats(int nSubPic, REFERENCE_TIME& rtStart, REFERE
 	HRESULT hr = E_INVALIDARG;
 
 	if (nSubPic >= 0 && nSubPic < (int)m_queue.size()) {
-		auto it = m_queue.cbegin();
-		std::advance(it, nSubPic);
-		rtStart = (*it)->GetStart();
-		rtStop  = (*it)->GetStop();
+		rtStart = m_queue[nSubPic].pSubPic->GetStart();
+		rtStop  = m_queue[nSubPic].rtStop;
 		hr = S_OK;
 	} else {
 		rtStart = rtStop = -1;
@@ -447,7 +510,7 @@ STDMETHODIMP CSubPicQueue::GetStats(int nSubPic, REFERENCE_TIME& rtStart, REFERE
 
 // private
 
-bool CSubPicQueue::EnqueueSubPic(CComPtr<ISubPic>& pSubPic, bool bBlocking)
+bool CSubPicQueue::EnqueueSubPic(CComPtr<ISubPic>& pSubPic, bool bBlocking, const uint64_t hash)
 {
 	auto canAddToQueue = [this]() {
 		return (int)m_queue.size() < m_nMaxSubPic;
@@ -466,8 +529,10 @@ bool CSubPicQueue::EnqueueSubPic(CComPtr<ISubPic>& pSubPic, bool bBlocking)
 #if SUBPIC_TRACE_LEVEL > 1
 			DLog(L"Subtitle Renderer Thread: Dropping rendered subpic because of invalidation");
 #endif
+			m_stats.dropped++;
 		} else {
-			m_queue.emplace_back(pSubPic);
+			m_queue.push_back({ pSubPic, hash, pSubPic->GetStop(), pSubPic->GetSegmentStop(), false });
+			m_stats.queued++;
 			lock.unlock();
 			m_condQueueReady.notify_one();
 			bAdded = true;
@@ -478,6 +543,40 @@ bool CSubPicQueue::EnqueueSubPic(CComPtr<ISubPic>& pSubPic, bool bBlocking)
 	return bAdded;
 }
 
+bool CSubPicQueue::ExtendLastSubPic(ISubPic* pStatic, const uint64_t hash)
+{
+	if (!hash) {
+		return false;
+	}
+
+	const REFERENCE_TIME rtStart = pStatic->GetStart();
+	const REFERENCE_TIME rtStop = pStatic->GetStop();
+
+	std::unique_lock<std::mutex> lock(m_mutexQueue);
+
+	if (m_queue.empty() || (m_bInvalidate && rtStop > m_rtInvalidate)) {
+		return false;
+	}
+
+	// an animated subpic starts a quarter of a frame after the stop of the previous frame
+	auto& last = m_queue.back();
+	if (last.hash != hash || rtStart < last.pSubPic->GetStart() || rtStart > last.rtStop + m_rtTimePerFrame / 2 || rtStop <= last.rtStop) {
+		return false;
+	}
+
+#if SUBPIC_TRACE_LEVEL > 1
+	DLog(L"Subtitle Renderer Thread: Extending the last subpic %f -> %f", double(last.rtStop) / 10000000.0, double(rtStop) / 10000000.0);
+#endif
+	last.rtStop = rtStop;
+	last.rtSegmentStop = std::max(last.rtSegmentStop, pStatic->GetSegmentStop());
+	last.bExtended = true;
+	m_stats.deduplicated++;
+	lock.unlock();
+	m_condQueueReady.notify_one();
+
+	return true;
+}
+
 REFERENCE_TIME CSubPicQueue::GetCurrentRenderingTime()
 {
 	REFERENCE_TIME rtNow = -1;
@@ -486,7 +585,7 @@ REFERENCE_TIME CSubPicQueue::GetCurrentRenderingTime()
 		std::lock_guard<std::mutex> lock(m_mutexQueue);
 
 		if (m_queue.size()) {
-			rtNow = m_queue.back()->GetStop();
+			rtNow = m_queue.back().rtStop;
 		}
 	}
 
@@ -516,14 +615,33 @@ DWORD CSubPicQueue::ThreadProc()
 			REFERENCE_TIME rtTimePerFrame = m_rtTimePerFrame;
 			m_bInvalidate = false;
 			CComPtr<ISubPic> pSubPic;
+			uint64_t subPicHash = 0;
 
 			SUBTITLE_TYPE sType = pSubPicProvider->GetType();
 
+			// Copies a rendered static subpic to a new dynamic subpic in pSubPic
+			auto CopyStatic = [&](ISubPic* pStatic, const HRESULT hrTextureSize, const SIZE& virtualSize, const POINT& virtualTopLeft, const uint64_t hash) {
+				pSubPic.Release();
+				subPicHash = hash;
+				if (FAILED(m_pAllocator->AllocDynamic(&pSubPic))
+						|| FAILED(pStatic->CopyTo(pSubPic))) {
+					return false;
+				}
+
+				if (SUCCEEDED(hrTextureSize)) {
+					pSubPic->SetVirtualTextureSize(virtualSize, virtualTopLeft);
+				}
+
+				pSubPic->SetType(sType);
+				return true;
+			};
+
 			REFERENCE_TIME rtStartRendering = GetCurrentRenderingTime();
 			POSITION pos = pSubPicProvider->GetStartPosition(rtStartRendering, fps);
 			if (!pos) {
 				bWaitForEvent = true;
 			}
+			bool bStopRendering = false;
 			for (; pos; pos = pSubPicProvider->GetNext(pos)) {
 				REFERENCE_TIME rtStart = pSubPicProvider->GetStart(pos, fps);
 				REFERENCE_TIME rtStop = pSubPicProvider->GetStop(pos, fps);
@@ -548,7 +666,6 @@ DWORD CSubPicQueue::ThreadProc()
 				// Check that we aren't late already...
 				if (rtCurrent < rtStop) {
 					bool bIsAnimated = pSubPicProvider->IsAnimated(pos) && !bDisableAnim;
-					bool bStopRendering = false;
 
 					while (rtCurrent < rtStop) {
 						SIZE	maxTextureSize, virtualSize;
@@ -572,11 +689,12 @@ DWORD CSubPicQueue::ThreadProc()
 							rtStopReal = rtStop;
 						}
 
-						HRESULT hr;
+						REFERENCE_TIME rtRenderStart, rtRenderStop;
 						if (bIsAnimated) {
 							// 3/4 is a magic number we use to avoid reusing the wrong frame due to slight
 							// misprediction of the frame end time
-							hr = RenderTo(pStatic, rtCurrent, std::min(rtCurrent + rtTimePerFrame * 3 / 4, rtStopReal), fps, bIsAnimated);
+							rtRenderStart = rtCurrent;
+							rtRenderStop = std::min(rtCurrent + rtTimePerFrame * 3 / 4, rtStopReal);
 							// Set the segment start and stop timings
 							pStatic->SetSegmentStart(rtStart);
 							// The stop timing can be moved so that the duration from the current start time
@@ -587,13 +705,16 @@ DWORD CSubPicQueue::ThreadProc()
 							pStatic->SetSegmentStop(std::max(rtCurrent + rtTimePerFrame, rtStopReal));
 							rtCurrent = std::min(rtCurrent + rtTimePerFrame, rtStopReal);
 						} else {
-							hr = RenderTo(pStatic, rtStart, rtStopReal, fps, bIsAnimated);
+							rtRenderStart = rtStart;
+							rtRenderStop = rtStopReal;
 							// Non-animated subtitles aren't part of a segment
 							pStatic->SetSegmentStart(ISubPic::INVALID_SUBPIC_TIME);
 							pStatic->SetSegmentStop(ISubPic::INVALID_SUBPIC_TIME);
 							rtCurrent = rtStopReal;
 						}
 
+						uint64_t hash;
+						HRESULT hr = RenderTo(pStatic, rtRenderStart, rtRenderStop, fps, bIsAnimated, &hash);
 						if (FAILED(hr)) {
 							break;
 						}
@@ -607,28 +728,24 @@ DWORD CSubPicQueue::ThreadProc()
 							  r.Width(), r.Height());
 #endif
 
-						pSubPic.Release();
-						if (FAILED(m_pAllocator->AllocDynamic(&pSubPic))
-								|| FAILED(pStatic->CopyTo(pSubPic))) {
-							break;
-						}
-
-						if (SUCCEEDED(hr2)) {
-							pSubPic->SetVirtualTextureSize(virtualSize, virtualTopLeft);
-						}
-
-						pSubPic->SetType(sType);
+						// the same pixels as the last subpic do not need a new subpic
+						if (!ExtendLastSubPic(pStatic, hash)) {
+							if (!CopyStatic(pStatic, hr2, virtualSize, virtualTopLeft, hash)) {
+								break;
+							}
 
-						// Try to enqueue the subpic, if the queue is full stop rendering
-						if (!EnqueueSubPic(pSubPic, false)) {
-							bStopRendering = true;
-							break;
+							// Try to enqueue the subpic, if the queue is full stop rendering
+							if (!EnqueueSubPic(pSubPic, false, subPicHash)) {
+								bStopRendering = true;
+								break;
+							}
 						}
 
 						if (m_rtNow > rtCurrent) {
 #if SUBPIC_TRACE_LEVEL > 0
 							DLog(L"Subtitle Renderer Thread: the queue is late, trying to catch up...");
 #endif
+							m_stats.late++;
 							rtCurrent = m_rtNow;
 						}
 					}
@@ -640,6 +757,7 @@ DWORD CSubPicQueue::ThreadProc()
 #if SUBPIC_TRACE_LEVEL > 0
 					DLog(L"Subtitle Renderer Thread: the queue is late, trying to catch up...");
 #endif
+					m_stats.late++;
 				}
 			}
 
@@ -648,7 +766,7 @@ DWORD CSubPicQueue::ThreadProc()
 			// If we couldn't enqueue the subpic before, wait for some room in the queue
 			// but unsure to unlock the subpicture provider first to avoid deadlocks
 			if (pSubPic) {
-				EnqueueSubPic(pSubPic, true);
+				EnqueueSubPic(pSubPic, true, subPicHash);
 			}
 		} else {
 			bWaitForEvent = true;
@@ -705,7 +823,10 @@ STDMETHODIMP_(bool) CSubPicQueueNoThread::LookupSubPic(REFERENCE_TIME rtNow, boo
 
 	if (pSubPic && pSubPic->GetStart() <= rtNow && rtNow < pSubPic->GetStop()) {
 		ppSubPic = pSubPic;
+		m_stats.AddLookup(CSubPicQueueStats::Lookup_Exact);
 	} else {
+		// the subpic is rendered on the calling thread, the whole lookup is blocking
+		const uint64_t lookupTick = GetPreciseTick();
 		CComPtr<ISubPicProvider> pSubPicProvider;
 		if (SUCCEEDED(GetSubPicProvider(&pSubPicProvider)) && pSubPicProvider
 				&& SUCCEEDED(pSubPicProvider->Lock())) {
@@ -781,6 +902,8 @@ STDMETHODIMP_(bool) CSubPicQueueNoThread::LookupSubPic(REFERENCE_TIME rtNow, boo
 
 			pSubPicProvider->Unlock();
 		}
+		m_stats.AddBlocking(GetPreciseTick() - lookupTick, false);
+		m_stats.AddLookup(ppSubPic ? CSubPicQueueStats::Lookup_Exact : CSubPicQueueStats::Lookup_Empty);
 	}
 
 	return !!ppSubPic;
@@ -21,14 +21,16 @@
 
 #pragma once
 
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <deque>
 #include <condition_variable>
 
 #include "ISubPic.h"
+#include "SubPicQueueStats.h"
 
-class CSubPicQueueImpl : public CUnknown, public ISubPicQueue
+class CSubPicQueueImpl : public CUnknown, public ISubPicQueue, public ISubPicQueueStats
 {
 	static const double DEFAULT_FPS;
 
@@ -93,12 +95,16 @@ protected:
 
 	CComPtr<ISubPicAllocator> m_pAllocator;
 
+	CSubPicQueueStats m_stats;
+	unsigned m_nStatsMaxSubPics = 0; // SubPicQueueStats_t::maxSubPics
+
 	std::shared_ptr<SubPicProviderWithSharedLock> GetSubPicProviderWithSharedLock() {
 		CAutoLock cAutoLock(&m_csSubPicProvider);
 		return m_pSubPicProviderWithSharedLock;
 	}
 
-	HRESULT RenderTo(ISubPic* pSubPic, REFERENCE_TIME rtStart, REFERENCE_TIME rtStop, double fps, BOOL bIsAnimated);
+	// pHash receives a hash of the rendered pixels, 0 if they cannot be read
+	HRESULT RenderTo(ISubPic* pSubPic, REFERENCE_TIME rtStart, REFERENCE_TIME rtStop, double fps, BOOL bIsAnimated, uint64_t* pHash = nullptr);
 
 public:
 	CSubPicQueueImpl(ISubPicAllocator* pAllocator, HRESULT* phr);
@@ -123,6 +129,11 @@ public:
 	STDMETHODIMP GetStats(int& nSubPics, REFERENCE_TIME& rtNow, REFERENCE_TIME& rtStart, REFERENCE_TIME& rtStop) PURE;
 	STDMETHODIMP GetStats(int nSubPics, REFERENCE_TIME& rtStart, REFERENCE_TIME& rtStop) PURE;
 	*/
+
+	// ISubPicQueueStats
+
+	STDMETHODIMP GetQueueStats(SubPicQueueStats_t& stats);
+	STDMETHODIMP ResetQueueStats();
 };
 
 class CSubPicQueue : public CSubPicQueueImpl, protected CAMThread
@@ -135,7 +146,17 @@ protected:
 	bool m_bExitThread = false;
 
 	CComPtr<ISubPic> m_pSubPic;
-	std::deque<CComQIPtr<ISubPic>> m_queue;
+
+	struct QueueEntry_t {
+		CComPtr<ISubPic> pSubPic;
+		uint64_t hash; // of the pixels, 0 if unknown
+		// ExtendLastSubPic() changes only the entry, the subpic may be read by other threads.
+		// LookupSubPic() applies the times to the subpic when it takes the subpic out of the queue.
+		REFERENCE_TIME rtStop;
+		REFERENCE_TIME rtSegmentStop;
+		bool bExtended;
+	};
+	std::deque<QueueEntry_t> m_queue;
 
 	std::mutex m_mutexSubpic; // to protect m_pSubPic
 	std::mutex m_mutexQueue; // to protect m_queue
@@ -149,7 +170,9 @@ protected:
 	bool m_bInvalidate = false;
 	REFERENCE_TIME m_rtInvalidate = 0;
 
-	bool EnqueueSubPic(CComPtr<ISubPic>& pSubPic, bool bBlocking);
+	bool EnqueueSubPic(CComPtr<ISubPic>& pSubPic, bool bBlocking, const uint64_t hash);
+	// extends the last queued subpic if pStatic has the same pixels and follows it
+	bool ExtendLastSubPic(ISubPic* pStatic, const uint64_t hash);
 	REFERENCE_TIME GetCurrentRenderingTime();
 
 	// CAMThread
@@ -159,6 +182,9 @@ public:
 	CSubPicQueue(int nMaxSubPic, bool bDisableAnim, bool bAllowDropSubPic, ISubPicAllocator* pAllocator, HRESULT* phr);
 	virtual ~CSubPicQueue();
 
+	// the rendered subpics that were queued and that only extended the previous subpic
+	void GetDedupStats(uint64_t& queued, uint64_t& deduplicated) const;
+
 	// ISubPicQueue
 
 	STDMETHODIMP SetFPS(double fps);
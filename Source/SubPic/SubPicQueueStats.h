@@ -0,0 +1,169 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include "ISubPic.h"
+#include "FrameStats.h"
+
+// Data of ISubPicQueueStats::GetQueueStats() and IExFilterConfig::Flt_GetBin("statsSubPicQueue")
+struct SubPicQueueStats_t {
+	static constexpr unsigned kOccupancyBuckets = 17; // the last one counts 16 and more subpics
+
+	uint32_t size;       // sizeof(SubPicQueueStats_t)
+	uint32_t maxSubPics; // 0 for a queue without a thread, it renders in LookupSubPic
+	uint64_t lookups;
+	uint64_t exact;      // a subpic for the lookup time was found
+	uint64_t reused;     // an older subpic or a subpic in advance was returned
+	uint64_t empty;      // no subpic
+	uint64_t blocking;   // LookupSubPic waited for the queue thread or rendered itself
+	uint64_t timeouts;   // the wait ended without a subpic
+	uint64_t queued;
+	uint64_t deduplicated; // rendered subpics that extended the previous one
+	uint64_t dropped;      // rendered subpics removed by Invalidate()
+	uint64_t expired;      // queued subpics that ended before a lookup returned them
+	uint64_t late;         // the queue thread was behind the playback time
+	LatencyStats_t renderTime;   // milliseconds, rendering of one subpic
+	LatencyStats_t blockingTime; // milliseconds, blocking lookups
+	LatencyStats_t margin;       // milliseconds, the end of the queued subpics after the lookup time
+	uint64_t occupancy[kOccupancyBuckets]; // queued subpics at a lookup that searched the queue
+};
+
+//
+// ISubPicQueueStats
+//
+
+interface __declspec(uuid("4F0D2B7A-8C61-4E3B-A5D9-71B6C0E8F324"))
+ISubPicQueueStats :
+public IUnknown {
+	STDMETHOD (GetQueueStats) (SubPicQueueStats_t& stats /*[out]*/) PURE;
+	STDMETHOD (ResetQueueStats) () PURE;
+};
+
+//
+// Counters and histograms of a subpicture queue for the whole session.
+// All members are atomic, the queue thread and the lookups add to them without a lock.
+// The histograms keep microseconds, so they do not depend on the tick source.
+//
+
+class CSubPicQueueStats
+{
+public:
+	enum Lookup_t {
+		Lookup_Exact,
+		Lookup_Reused,
+		Lookup_Empty,
+	};
+
+	std::atomic<uint64_t> queued = 0;
+	std::atomic<uint64_t> deduplicated = 0;
+	std::atomic<uint64_t> dropped = 0;
+	std::atomic<uint64_t> expired = 0;
+	std::atomic<uint64_t> late = 0;
+
+private:
+	std::atomic<uint64_t> m_lookups[3] = {};
+	std::atomic<uint64_t> m_timeouts = 0;
+	std::atomic<uint64_t> m_occupancy[SubPicQueueStats_t::kOccupancyBuckets] = {};
+
+	CLatencyHistogram m_renderTime;   // microseconds
+	CLatencyHistogram m_blockingTime; // microseconds
+	CLatencyHistogram m_margin;       // microseconds
+
+	static uint64_t TicksToMicroseconds(const uint64_t ticks) {
+		return (uint64_t)(ticks * 1000000.0 / GetPreciseTicksPerSecond() + 0.5);
+	}
+
+	static LatencyStats_t GetLatency(const CLatencyHistogram& hist) {
+		return {
+			hist.GetCount(),
+			hist.GetPercentile(0.50) / 1000.0,
+			hist.GetPercentile(0.95) / 1000.0,
+			hist.GetPercentile(0.99) / 1000.0,
+			hist.GetMax() / 1000.0
+		};
+	}
+
+public:
+	void AddLookup(const Lookup_t type) {
+		m_lookups[type].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void AddRenderTime(const uint64_t ticks) {
+		m_renderTime.Add(TicksToMicroseconds(ticks));
+	}
+
+	void AddBlocking(const uint64_t ticks, const bool bTimeout) {
+		m_blockingTime.Add(TicksToMicroseconds(ticks));
+		if (bTimeout) {
+			m_timeouts.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	// the queue state at a lookup, a late queue has no margin
+	void AddQueueState(const unsigned count, const REFERENCE_TIME margin) {
+		m_occupancy[std::min(count, SubPicQueueStats_t::kOccupancyBuckets - 1)].fetch_add(1, std::memory_order_relaxed);
+		m_margin.Add((uint64_t)std::max(margin, 0LL) / 10);
+	}
+
+	void Reset() {
+		queued = 0;
+		deduplicated = 0;
+		dropped = 0;
+		expired = 0;
+		late = 0;
+		for (auto& lookups : m_lookups) {
+			lookups = 0;
+		}
+		m_timeouts = 0;
+		for (auto& occupancy : m_occupancy) {
+			occupancy = 0;
+		}
+		m_renderTime.Reset();
+		m_blockingTime.Reset();
+		m_margin.Reset();
+	}
+
+	void Get(SubPicQueueStats_t& stats, const unsigned maxSubPics) const {
+		stats.size       = sizeof(SubPicQueueStats_t);
+		stats.maxSubPics = maxSubPics;
+		stats.exact      = m_lookups[Lookup_Exact].load(std::memory_order_relaxed);
+		stats.reused     = m_lookups[Lookup_Reused].load(std::memory_order_relaxed);
+		stats.empty      = m_lookups[Lookup_Empty].load(std::memory_order_relaxed);
+		stats.lookups    = stats.exact + stats.reused + stats.empty;
+		stats.blocking   = m_blockingTime.GetCount();
+		stats.timeouts   = m_timeouts.load(std::memory_order_relaxed);
+
+		stats.queued       = queued.load(std::memory_order_relaxed);
+		stats.deduplicated = deduplicated.load(std::memory_order_relaxed);
+		stats.dropped      = dropped.load(std::memory_order_relaxed);
+		stats.expired      = expired.load(std::memory_order_relaxed);
+		stats.late         = late.load(std::memory_order_relaxed);
+
+		stats.renderTime   = GetLatency(m_renderTime);
+		stats.blockingTime = GetLatency(m_blockingTime);
+		stats.margin       = GetLatency(m_margin);
+
+		for (unsigned i = 0; i < SubPicQueueStats_t::kOccupancyBuckets; i++) {
+			stats.occupancy[i] = m_occupancy[i].load(std::memory_order_relaxed);
+		}
+	}
+};
@@ -22,6 +22,7 @@
 #include "stdafx.h"
 #include "XySubPicQueueImpl.h"
 #include "XySubPicProvider.h"
+#include "Times.h"
 
 //
 // CXySubPicQueueNoThread
@@ -42,6 +43,7 @@ CXySubPicQueueNoThread::~CXySubPicQueueNoThread()
 STDMETHODIMP CXySubPicQueueNoThread::Invalidate(REFERENCE_TIME rtInvalidate)
 {
 	m_llSubId = 0;
+	m_hash = 0;
 	return __super::Invalidate(rtInvalidate);
 }
 
@@ -66,6 +68,10 @@ STDMETHODIMP_(bool) CXySubPicQueueNoThread::LookupSubPic(REFERENCE_TIME rtNow, b
 		pSubPic = m_pSubPic;
 	}
 
+	// RequestFrame() waits for the subtitle filter, the whole lookup is blocking
+	const uint64_t lookupTick = GetPreciseTick();
+	bool bReused = false;
+
 	if (pXySubPicProvider) {
 		double fps = m_fps;
 		REFERENCE_TIME rtTimePerFrame = static_cast<REFERENCE_TIME>(10000000.0 / fps);
@@ -101,35 +107,51 @@ STDMETHODIMP_(bool) CXySubPicQueueNoThread::LookupSubPic(REFERENCE_TIME rtNow, b
 					CAutoLock cAutoLock(&m_csLock);
 
 					m_pSubPic.Release();
+					pSubPic.Release();
 
-					if (FAILED(m_pAllocator->AllocDynamic(&m_pSubPic))) {
-						return false;
+					if (SUCCEEDED(m_pAllocator->AllocDynamic(&m_pSubPic))) {
+						pSubPic = m_pSubPic;
 					}
-
-					pSubPic = m_pSubPic;
 				}
 
-				if (!bAllocSubPic && m_llSubId == id) { // same subtitle as last time
+				if (!pSubPic) {
+					// AllocDynamic() failed, the lookup is counted as empty
+					DLog(L"LookupSubPic: AllocDynamic failed");
+				}
+				else if (!bAllocSubPic && m_llSubId == id) { // same subtitle as last time
 					pSubPic->SetStop(rtStop);
 					ppSubPic = pSubPic;
+					bReused = true;
 				}
 				else if (m_pAllocator->IsDynamicWriteOnly()) {
 					CComPtr<ISubPic> pStatic;
+					uint64_t hash = 0;
 					hr = m_pAllocator->GetStatic(&pStatic);
 					if (SUCCEEDED(hr)) {
-						hr = RenderTo(pStatic, rtStart, rtStop, fps, true);
+						hr = RenderTo(pStatic, rtStart, rtStop, fps, true, &hash);
 					}
 					if (SUCCEEDED(hr)) {
-						hr = pStatic->CopyTo(pSubPic);
+						if (!bAllocSubPic && hash && hash == m_hash) {
+							// a new subtitle with the same pixels, the shown subpic is not copied and uploaded again
+							pSubPic->SetStop(rtStop);
+							m_stats.deduplicated++;
+							bReused = true;
+						} else {
+							hr = pStatic->CopyTo(pSubPic);
+						}
 					}
 					if (SUCCEEDED(hr)) {
 						ppSubPic = pSubPic;
 						m_llSubId = id;
+						m_hash = hash;
+					} else {
+						m_hash = 0;
 					}
 				}
 				else if (SUCCEEDED(RenderTo(pSubPic, rtStart, rtStop, fps, true))) {
 					ppSubPic = pSubPic;
 					m_llSubId = id;
+					m_hash = 0;
 				}
 
 				if (ppSubPic) {
@@ -143,5 +165,8 @@ STDMETHODIMP_(bool) CXySubPicQueueNoThread::LookupSubPic(REFERENCE_TIME rtNow, b
 		}
 	}
 
+	m_stats.AddBlocking(GetPreciseTick() - lookupTick, false);
+	m_stats.AddLookup(bReused ? CSubPicQueueStats::Lookup_Reused : ppSubPic ? CSubPicQueueStats::Lookup_Exact : CSubPicQueueStats::Lookup_Empty);
+
 	return !!ppSubPic;
 }
@@ -27,6 +27,7 @@
 class CXySubPicQueueNoThread : public CSubPicQueueNoThread
 {
 	ULONGLONG m_llSubId;
+	uint64_t m_hash = 0; // of the pixels of m_pSubPic, 0 if unknown
 
 public:
 	CXySubPicQueueNoThread(ISubPicAllocator* pAllocator, HRESULT* phr);
@@ -0,0 +1,322 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "stdafx.h"
+#include <immintrin.h>
+#include "Utils/CPUInfo.h"
+#include "SubtitleBlend.h"
+
+// out = value + d * (1 - opacity), all in 16-bit scale
+static inline __m128i Blend_epu16(const __m128i d, const __m128i value, const __m128i opacity)
+{
+	return _mm_adds_epu16(_mm_sub_epi16(d, _mm_mulhi_epu16(d, opacity)), value);
+}
+
+static inline __m256i Blend_epu16(const __m256i d, const __m256i value, const __m256i opacity)
+{
+	return _mm256_adds_epu16(_mm256_sub_epi16(d, _mm256_mulhi_epu16(d, opacity)), value);
+}
+
+static inline uint32_t Blend_u16(const uint32_t d, const uint32_t value, const uint32_t opacity)
+{
+	return std::min(d - ((d * opacity) >> 16) + value, 65535u);
+}
+
+static void BlendLine8(BYTE* dst, const BYTE* src, const uint16_t* value, const uint16_t* opacity, const UINT count, const CSubtitleBlender::Simd_t simd)
+{
+	UINT i = 0;
+	if (simd == CSubtitleBlender::SIMD_AVX2) {
+		const __m256i round = _mm256_set1_epi16(128);
+		for (; i + 16 <= count; i += 16) {
+			__m256i d = _mm256_slli_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(src + i))), 8);
+			d = Blend_epu16(d, _mm256_loadu_si256((const __m256i*)(value + i)), _mm256_loadu_si256((const __m256i*)(opacity + i)));
+			d = _mm256_srli_epi16(_mm256_adds_epu16(d, round), 8);
+			d = _mm256_permute4x64_epi64(_mm256_packus_epi16(d, d), 0x08);
+			_mm_storeu_si128((__m128i*)(dst + i), _mm256_castsi256_si128(d));
+		}
+	} else if (simd == CSubtitleBlender::SIMD_SSE2) {
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i round = _mm_set1_epi16(128);
+		for (; i + 16 <= count; i += 16) {
+			const __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+			__m128i lo = _mm_unpacklo_epi8(zero, s); // s << 8
+			__m128i hi = _mm_unpackhi_epi8(zero, s);
+			lo = Blend_epu16(lo, _mm_loadu_si128((const __m128i*)(value + i)), _mm_loadu_si128((const __m128i*)(opacity + i)));
+			hi = Blend_epu16(hi, _mm_loadu_si128((const __m128i*)(value + i + 8)), _mm_loadu_si128((const __m128i*)(opacity + i + 8)));
+			lo = _mm_srli_epi16(_mm_adds_epu16(lo, round), 8);
+			hi = _mm_srli_epi16(_mm_adds_epu16(hi, round), 8);
+			_mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(lo, hi));
+		}
+	}
+	for (; i < count; i++) {
+		dst[i] = (BYTE)std::min((Blend_u16(src[i] << 8, value[i], opacity[i]) + 128) >> 8, 255u);
+	}
+}
+
+static void BlendLine16(uint16_t* dst, const uint16_t* src, const uint16_t* value, const uint16_t* opacity, const UINT count, const CSubtitleBlender::Simd_t simd)
+{
+	UINT i = 0;
+	if (simd == CSubtitleBlender::SIMD_AVX2) {
+		for (; i + 16 <= count; i += 16) {
+			const __m256i d = _mm256_loadu_si256((const __m256i*)(src + i));
+			_mm256_storeu_si256((__m256i*)(dst + i),
+				Blend_epu16(d, _mm256_loadu_si256((const __m256i*)(value + i)), _mm256_loadu_si256((const __m256i*)(opacity + i))));
+		}
+	}
+	if (simd != CSubtitleBlender::SIMD_NONE) {
+		for (; i + 8 <= count; i += 8) {
+			const __m128i d = _mm_loadu_si128((const __m128i*)(src + i));
+			_mm_storeu_si128((__m128i*)(dst + i),
+				Blend_epu16(d, _mm_loadu_si128((const __m128i*)(value + i)), _mm_loadu_si128((const __m128i*)(opacity + i))));
+		}
+	}
+	for (; i < count; i++) {
+		dst[i] = (uint16_t)Blend_u16(src[i], value[i], opacity[i]);
+	}
+}
+
+static inline uint16_t ToU16(const double x)
+{
+	return (uint16_t)std::clamp(x + 0.5, 0.0, 65535.0);
+}
+
+CSubtitleBlender::CSubtitleBlender()
+	: m_simd(CPUInfo::HaveAVX2() ? SIMD_AVX2 : SIMD_SSE2)
+{
+}
+
+bool CSubtitleBlender::IsFormatSupported(const ColorFormat_t cformat)
+{
+	switch (cformat) {
+	case CF_NV12:
+	case CF_P010:
+	case CF_P016:
+	case CF_YV12:
+	case CF_YUV420P8:
+	case CF_XRGB32:
+	case CF_ARGB32:
+		return true;
+	}
+	return false;
+}
+
+bool CSubtitleBlender::IsPrepared(const void* pPicture, const uint64_t version, const ColorFormat_t cformat, const DXVA2_ExtendedFormat& exFmt,
+	const bool bInvAlpha, const RECT& rect) const
+{
+	return m_planes && m_key.pPicture == pPicture && m_key.version == version && EqualRect(&m_key.rect, &rect)
+		&& m_key.cformat == cformat && m_key.matrix == exFmt.VideoTransferMatrix && m_key.range == exFmt.NominalRange
+		&& m_key.bInvAlpha == bInvAlpha;
+}
+
+void CSubtitleBlender::Prepare(const void* pPicture, const uint64_t version, const ColorFormat_t cformat, const DXVA2_ExtendedFormat& exFmt,
+	const bool bInvAlpha, const uint32_t* pixels, const UINT pitch, const RECT& rect)
+{
+	Reset();
+	if (!IsFormatSupported(cformat) || IsRectEmpty(&rect)) {
+		return;
+	}
+
+	if (cformat == CF_XRGB32 || cformat == CF_ARGB32) {
+		PrepareRGB(pixels, pitch, rect, bInvAlpha);
+	} else {
+		for (auto& layer : m_layers) {
+			layer.bytesPerElement = (cformat == CF_P010 || cformat == CF_P016) ? 2 : 1;
+		}
+		PrepareYUV(pixels, pitch, rect, bInvAlpha, exFmt);
+		if (cformat == CF_NV12 || cformat == CF_P010 || cformat == CF_P016) {
+			// interleave U and V
+			Layer_t uv;
+			uv.bytesPerElement = m_layers[1].bytesPerElement;
+			uv.rect = m_layers[1].rect;
+			uv.rect.left *= 2;
+			uv.rect.right *= 2;
+			const size_t count = m_layers[1].value.size();
+			uv.value.resize(count * 2);
+			uv.opacity.resize(count * 2);
+			for (size_t i = 0; i < count; i++) {
+				uv.value[i * 2]       = m_layers[1].value[i];
+				uv.value[i * 2 + 1]   = m_layers[2].value[i];
+				uv.opacity[i * 2]     = m_layers[1].opacity[i];
+				uv.opacity[i * 2 + 1] = m_layers[1].opacity[i];
+			}
+			m_layers[1] = std::move(uv);
+			m_layers[2] = {};
+			m_planes = 2;
+		}
+		else if (cformat == CF_YV12) {
+			std::swap(m_layers[1], m_layers[2]);
+		}
+	}
+
+	m_key = { pPicture, version, rect, cformat, exFmt.VideoTransferMatrix, exFmt.NominalRange, bInvAlpha };
+}
+
+void CSubtitleBlender::PrepareRGB(const uint32_t* pixels, const UINT pitch, const RECT& rect, const bool bInvAlpha)
+{
+	Layer_t& layer = m_layers[0];
+	layer.bytesPerElement = 1;
+	layer.rect = { rect.left * 4, rect.top, rect.right * 4, rect.bottom };
+	const UINT w = rect.right - rect.left;
+	const UINT h = rect.bottom - rect.top;
+	layer.value.resize((size_t)w * h * 4);
+	layer.opacity.resize((size_t)w * h * 4);
+
+	uint16_t* value = layer.value.data();
+	uint16_t* opacity = layer.opacity.data();
+	for (UINT y = 0; y < h; y++) {
+		const uint32_t* line = pixels + (size_t)pitch * y;
+		for (UINT x = 0; x < w; x++) {
+			const uint32_t p = line[x];
+			const uint32_t a = bInvAlpha ? (p >> 24) : 255 - (p >> 24);
+			// B, G, R, the fourth byte of the frame is not changed
+			value[0] = (uint16_t)((p & 0xFF) << 8);
+			value[1] = (uint16_t)(p & 0xFF00);
+			value[2] = (uint16_t)((p >> 8) & 0xFF00);
+			value[3] = 0;
+			opacity[0] = opacity[1] = opacity[2] = (uint16_t)(a * 257);
+			opacity[3] = 0;
+			value += 4;
+			opacity += 4;
+		}
+	}
+	m_planes = 1;
+}
+
+void CSubtitleBlender::PrepareYUV(const uint32_t* pixels, const UINT pitch, const RECT& rect, const bool bInvAlpha, const DXVA2_ExtendedFormat& exFmt)
+{
+	double kr, kb;
+	switch (exFmt.VideoTransferMatrix) {
+	case DXVA2_VideoTransferMatrix_BT601:     kr = 0.299;  kb = 0.114;  break;
+	case DXVA2_VideoTransferMatrix_SMPTE240M: kr = 0.212;  kb = 0.087;  break;
+	default:                                  kr = 0.2126; kb = 0.0722; break; // BT.709
+	}
+	const double kg = 1.0 - kr - kb;
+
+	// the 8-bit formats are blended in the same 16-bit scale, 255 is 65280
+	const bool b16 = m_layers[0].bytesPerElement == 2;
+	const bool bFullRange = exFmt.NominalRange == DXVA2_NominalRange_0_255;
+	const double yScale = bFullRange ? (b16 ? 65535.0 : 65280.0) : 219.0 * 256;
+	const double cScale = bFullRange ? (b16 ? 65535.0 : 65280.0) : 224.0 * 256;
+	const double yOffset = bFullRange ? 0.0 : 16.0 * 256;
+	const double cOffset = 128.0 * 256;
+
+	const UINT w = rect.right - rect.left;
+	const UINT h = rect.bottom - rect.top;
+
+	Layer_t& layerY = m_layers[0];
+	layerY.rect = rect;
+	layerY.value.resize((size_t)w * h);
+	layerY.opacity.resize((size_t)w * h);
+
+	// the chroma of each 2x2 block is the average of its pixels, the pixels outside of rect are transparent
+	const RECT rectC = { rect.left / 2, rect.top / 2, (rect.right + 1) / 2, (rect.bottom + 1) / 2 };
+	const UINT wc = rectC.right - rectC.left;
+	const UINT hc = rectC.bottom - rectC.top;
+	std::vector<double> sumU((size_t)wc * hc);
+	std::vector<double> sumV((size_t)wc * hc);
+	std::vector<double> sumA((size_t)wc * hc);
+
+	for (UINT y = 0; y < h; y++) {
+		const uint32_t* line = pixels + (size_t)pitch * y;
+		const size_t lineC = (size_t)wc * ((rect.top + y) / 2 - rectC.top);
+		for (UINT x = 0; x < w; x++) {
+			const uint32_t p = line[x];
+			const double a = (bInvAlpha ? (p >> 24) : 255 - (p >> 24)) / 255.0;
+			const double r = ((p >> 16) & 0xFF) / 255.0;
+			const double g = ((p >> 8) & 0xFF) / 255.0;
+			const double b = (p & 0xFF) / 255.0;
+
+			// value = M * color + opacity * offset, then out = value + in * (1 - opacity)
+			const double luma = kr * r + kg * g + kb * b;
+			const size_t i = (size_t)w * y + x;
+			layerY.value[i] = ToU16(yScale * luma + a * yOffset);
+			layerY.opacity[i] = ToU16(a * 65535.0);
+
+			const size_t ic = lineC + (rect.left + x) / 2 - rectC.left;
+			sumU[ic] += cScale * (b - luma) / (2.0 * (1.0 - kb)) + a * cOffset;
+			sumV[ic] += cScale * (r - luma) / (2.0 * (1.0 - kr)) + a * cOffset;
+			sumA[ic] += a;
+		}
+	}
+
+	for (UINT n = 1; n < 3; n++) {
+		Layer_t& layer = m_layers[n];
+		layer.rect = rectC;
+		layer.value.resize((size_t)wc * hc);
+		layer.opacity.resize((size_t)wc * hc);
+		const auto& sum = (n == 1) ? sumU : sumV;
+		for (size_t i = 0; i < sum.size(); i++) {
+			layer.value[i] = ToU16(sum[i] / 4);
+			layer.opacity[i] = ToU16(sumA[i] / 4 * 65535.0);
+		}
+	}
+	m_planes = 3;
+}
+
+void CSubtitleBlender::Reset()
+{
+	for (auto& layer : m_layers) {
+		layer = {};
+	}
+	m_planes = 0;
+	m_key = {};
+}
+
+void CSubtitleBlender::BlendPlane(const UINT plane, BYTE* dst, const UINT dstPitch, const BYTE* src, const int srcPitch)
+{
+	if (plane >= m_planes) {
+		return;
+	}
+
+	Layer_t& layer = m_layers[plane];
+	const UINT width = layer.rect.right - layer.rect.left;
+	const UINT offset = layer.rect.left * layer.bytesPerElement;
+	const size_t linesize = (size_t)width * layer.bytesPerElement;
+	layer.clean.resize(linesize * (layer.rect.bottom - layer.rect.top));
+	for (LONG y = layer.rect.top; y < layer.rect.bottom; y++) {
+		BYTE* d = dst + (size_t)dstPitch * y + offset;
+		const BYTE* s = src + (ptrdiff_t)srcPitch * y + offset;
+		const size_t i = (size_t)width * (y - layer.rect.top);
+		memcpy(&layer.clean[i * layer.bytesPerElement], s, linesize);
+		if (layer.bytesPerElement == 2) {
+			BlendLine16((uint16_t*)d, (const uint16_t*)s, &layer.value[i], &layer.opacity[i], width, m_simd);
+		} else {
+			BlendLine8(d, s, &layer.value[i], &layer.opacity[i], width, m_simd);
+		}
+	}
+}
+
+void CSubtitleBlender::RestorePlane(const UINT plane, BYTE* dst, const UINT dstPitch) const
+{
+	if (plane >= m_planes) {
+		return;
+	}
+
+	const Layer_t& layer = m_layers[plane];
+	const size_t linesize = (size_t)(layer.rect.right - layer.rect.left) * layer.bytesPerElement;
+	if (layer.clean.size() != linesize * (layer.rect.bottom - layer.rect.top)) {
+		return;
+	}
+
+	const UINT offset = layer.rect.left * layer.bytesPerElement;
+	for (LONG y = layer.rect.top; y < layer.rect.bottom; y++) {
+		memcpy(dst + (size_t)dstPitch * y + offset, &layer.clean[linesize * (y - layer.rect.top)], linesize);
+	}
+}
@@ -0,0 +1,93 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include "Helper.h"
+
+//
+// Blends a subtitle picture into a frame from system memory while the frame is copied to a texture.
+// The subtitle pixels are converted once to "layers" in the layout of each plane: a premultiplied
+// value and an opacity per element. The frame is not read back from the texture, the blended lines
+// are written again from the source frame after the plane is copied. The source lines under the
+// subtitles are kept, so the frame can be restored when the subtitles of a redraw are different.
+//
+
+class CSubtitleBlender
+{
+public:
+	enum Simd_t {
+		SIMD_NONE, // C code only, for the tests
+		SIMD_SSE2,
+		SIMD_AVX2,
+	};
+
+private:
+	struct Layer_t {
+		std::vector<uint16_t> value;   // premultiplied color with the offset of the format, 16-bit scale
+		std::vector<uint16_t> opacity; // 0 - 65535
+		RECT rect = {};       // in elements and lines of the plane
+		UINT bytesPerElement = 1;
+		std::vector<BYTE> clean; // the source lines at rect of the last blended frame
+	};
+	Layer_t m_layers[3];
+	UINT m_planes = 0;
+
+	struct Key_t {
+		const void* pPicture;
+		uint64_t version;
+		RECT rect;
+		ColorFormat_t cformat;
+		UINT matrix;
+		UINT range;
+		bool bInvAlpha;
+	};
+	Key_t m_key = {};
+
+	Simd_t m_simd;
+
+	void PrepareRGB(const uint32_t* pixels, const UINT pitch, const RECT& rect, const bool bInvAlpha);
+	void PrepareYUV(const uint32_t* pixels, const UINT pitch, const RECT& rect, const bool bInvAlpha, const DXVA2_ExtendedFormat& exFmt);
+
+public:
+	CSubtitleBlender();
+
+	// AVX2 is used by default if the CPU supports it
+	void SetSimd(const Simd_t simd) { m_simd = simd; }
+
+	// NV12, P010, P016, YV12, YUV420P8, XRGB32 and ARGB32
+	static bool IsFormatSupported(const ColorFormat_t cformat);
+
+	// 'pixels' are BGRA of the subtitle picture at 'rect' of the frame, 'pitch' is in pixels.
+	// The layers are kept while pPicture and version do not change.
+	void Prepare(const void* pPicture, const uint64_t version, const ColorFormat_t cformat, const DXVA2_ExtendedFormat& exFmt,
+		const bool bInvAlpha, const uint32_t* pixels, const UINT pitch, const RECT& rect);
+	bool IsPrepared(const void* pPicture, const uint64_t version, const ColorFormat_t cformat, const DXVA2_ExtendedFormat& exFmt,
+		const bool bInvAlpha, const RECT& rect) const;
+	void Reset();
+	bool IsEmpty() const { return !m_planes; }
+
+	// 'dst' is the copy of the plane 'src', the subtitle lines of dst are written again.
+	// The planes are numbered in memory order, the second plane of YV12 is V.
+	void BlendPlane(const UINT plane, BYTE* dst, const UINT dstPitch, const BYTE* src, const int srcPitch);
+	// writes the source lines of the last BlendPlane() back to 'dst'
+	void RestorePlane(const UINT plane, BYTE* dst, const UINT dstPitch) const;
+};
@@ -19,50 +19,154 @@
 */
 
 #include "stdafx.h"
+#include <intrin.h>
+#include "Utils/CPUInfo.h"
+#include "Utils/Util.h"
 #include "Times.h"
 
 // code from VirtualDub\system\source\time.cpp
 
-uint64_t GetPreciseTick()
-{
-	LARGE_INTEGER li;
-	QueryPerformanceCounter(&li);
-	return li.QuadPart;
-}
-
 namespace {
-	uint64_t GetPreciseTicksPerSecondNowI()
+	uint64_t GetQPC()
+	{
+		LARGE_INTEGER li;
+		QueryPerformanceCounter(&li);
+		return li.QuadPart;
+	}
+
+	uint64_t GetQPCFrequency()
 	{
 		LARGE_INTEGER freq;
 		QueryPerformanceFrequency(&freq);
 		return freq.QuadPart;
 	}
 
-	double GetPreciseTicksPerSecondNow()
+	// immutable after the initialization
+	struct TickSource_t {
+		bool bTSC = false;
+		uint64_t ticksPerSecond = 0;
+		double secondsPerTick = 0;
+		uint64_t qpcFrequency = 0;
+		uint64_t qpc0 = 0; // the last calibration reading, CheckPreciseTickSource() measures the drift from it
+		uint64_t tsc0 = 0;
+	};
+
+	// a QueryPerformanceCounter reading with the TSC in the middle of it,
+	// returns false if the thread was interrupted
+	bool ReadPair(uint64_t& qpc, uint64_t& tsc)
 	{
-		LARGE_INTEGER freq;
-		QueryPerformanceFrequency(&freq);
-		return (double)freq.QuadPart;
+		const uint64_t tscBefore = __rdtsc();
+		qpc = GetQPC();
+		const uint64_t tscAfter = __rdtsc();
+		tsc = tscBefore + (tscAfter - tscBefore) / 2;
+		return tscAfter - tscBefore < 20000;
+	}
+
+	bool ReadPairRetry(uint64_t& qpc, uint64_t& tsc)
+	{
+		for (int attempts = 0; attempts < 10; attempts++) {
+			if (ReadPair(qpc, tsc)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// TSC ticks per second measured against QueryPerformanceCounter over the duration, 0 on failure.
+	// qpc1 and tsc1 receive the last reading.
+	uint64_t MeasureTSCFrequency(const uint64_t qpcFrequency, const uint64_t qpcDuration, uint64_t& qpc1, uint64_t& tsc1)
+	{
+		uint64_t qpc0, tsc0;
+		if (!ReadPairRetry(qpc0, tsc0)) {
+			return 0;
+		}
+		do {
+			if (!ReadPairRetry(qpc1, tsc1)) {
+				return 0;
+			}
+		} while (qpc1 - qpc0 < qpcDuration);
+
+		if (tsc1 <= tsc0) {
+			return 0;
+		}
+		return (uint64_t)((double)(tsc1 - tsc0) * qpcFrequency / (qpc1 - qpc0) + 0.5);
+	}
+
+	TickSource_t InitTickSource()
+	{
+		const uint64_t qpcFrequency = GetQPCFrequency();
+		TickSource_t source = { false, qpcFrequency, 1.0 / qpcFrequency, qpcFrequency };
+
+		if (CPUInfo::HaveInvariantTSC()) {
+			uint64_t qpc, tsc;
+			ReadPairRetry(qpc, tsc); // the first reads are slow and would bias the first measurement
+
+			// two measurements over 20 ms, each is accurate to a few ppm.
+			// If they disagree the TSC is not reliable (virtual machines) and QueryPerformanceCounter is used.
+			const uint64_t freq1 = MeasureTSCFrequency(qpcFrequency, qpcFrequency / 50, qpc, tsc);
+			const uint64_t freq2 = MeasureTSCFrequency(qpcFrequency, qpcFrequency / 50, qpc, tsc);
+			if (freq1 > qpcFrequency && freq2 > qpcFrequency
+					&& std::abs((double)freq1 - (double)freq2) < freq1 * 50e-6) {
+				const uint64_t tscFrequency = freq1 / 2 + freq2 / 2;
+				source = { true, tscFrequency, 1.0 / tscFrequency, qpcFrequency, qpc, tsc };
+			}
+			DLog(L"InitTickSource() : TSC {}, {} and {} Hz", source.bTSC ? L"used" : L"not used", freq1, freq2);
+		}
+
+		return source;
+	}
+
+	const TickSource_t& TickSource()
+	{
+		// a thread-safe static, it is initialized by the first caller, the others wait for it
+		static const TickSource_t source = InitTickSource();
+		return source;
 	}
 }
 
-uint64_t GetPreciseTicksPerSecondI()
+uint64_t GetPreciseTick()
 {
-	static uint64_t ticksPerSecond = GetPreciseTicksPerSecondNowI();
+	if (TickSource().bTSC) {
+		return __rdtsc();
+	}
+	return GetQPC();
+}
 
-	return ticksPerSecond;
+uint64_t GetPreciseTicksPerSecondI()
+{
+	return TickSource().ticksPerSecond;
 }
 
 double GetPreciseTicksPerSecond()
 {
-	static double ticksPerSecond = GetPreciseTicksPerSecondNow();
-
-	return ticksPerSecond;
+	return (double)TickSource().ticksPerSecond;
 }
 
 double GetPreciseSecondsPerTick()
 {
-	static double secondsPerTick = 1.0 / GetPreciseTicksPerSecondNow();
+	return TickSource().secondsPerTick;
+}
+
+bool IsPreciseTickTSC()
+{
+	return TickSource().bTSC;
+}
+
+double CheckPreciseTickSource()
+{
+	const auto& source = TickSource();
+	uint64_t qpc, tsc;
+	if (!source.bTSC || !ReadPairRetry(qpc, tsc) || qpc <= source.qpc0) {
+		return 0;
+	}
+
+	const double qpcSeconds = (double)(qpc - source.qpc0) / source.qpcFrequency;
+	const double tscSeconds = (double)(int64_t)(tsc - source.tsc0) * source.secondsPerTick;
+	const double drift = (tscSeconds - qpcSeconds) / qpcSeconds * 1e6;
+
+	// the calibration is accurate to a few ppm, a larger drift means that the TSC is not reliable (virtual machines)
+	DLogIf(std::abs(drift) > 100, L"CheckPreciseTickSource() : TSC and QPC differ by {:.3f} ms after {:.0f} s ({:+.1f} ppm)",
+		(tscSeconds - qpcSeconds) * 1000, qpcSeconds, drift);
 
-	return secondsPerTick;
+	return drift;
 }
@@ -20,7 +20,19 @@
 
 #pragma once
 
+// The ticks are the invariant TSC if the CPU has it, otherwise QueryPerformanceCounter.
+// They are not QueryPerformanceCounter units, DXGI and D3D9 time stamps need QueryPerformanceCounter.
+// The source and the frequency are chosen once and do not change. The first call of
+// these functions calibrates the TSC against QueryPerformanceCounter, it takes about 40 ms.
 uint64_t GetPreciseTick();
 uint64_t GetPreciseTicksPerSecondI();
 double   GetPreciseTicksPerSecond();
 double   GetPreciseSecondsPerTick();
+
+
+// true if GetPreciseTick() reads the TSC
+bool IsPreciseTickTSC();
+
+// The drift of the TSC from QueryPerformanceCounter since the calibration in ppm, 0 without the TSC.
+// A large drift is logged, the tick source is not changed at run time.
+double CheckPreciseTickSource();
@@ -11,6 +11,7 @@
 
 
 static int nCPUType = CPUInfo::PROCESSOR_UNKNOWN;
+static bool bInvariantTSC = false;
 
 #ifdef _WIN32
 //  Windows
@@ -99,6 +100,11 @@ static int GetCPUInfo()
 			HW_AVX2 = (info[1] & ((int)1 << 5)) != 0;
 		}
 	}
+	if (nExIds >= 0x80000007) {
+		// the TSC runs at a constant rate in all ACPI P-, C- and T-states
+		cpuid(info, 0x80000007);
+		bInvariantTSC = (info[3] & ((int)1 << 8)) != 0;
+	}
 	if (nExIds >= 0x80000001) {
 		cpuid(info, 0x80000001);
 		HW_SSE4a = (info[2] & ((int)1 << 6)) != 0;
@@ -147,4 +153,5 @@ namespace CPUInfo {
 	const bool HaveSSE42()           { return bSSE42; }
 	const bool HaveAVX()             { return bAVX;   }
 	const bool HaveAVX2()            { return bAVX2;  }
+	const bool HaveInvariantTSC()    { return bInvariantTSC; }
 } // namespace CPUInfo
@@ -33,4 +33,5 @@ namespace CPUInfo {
 	const bool HaveSSE42();
 	const bool HaveAVX();
 	const bool HaveAVX2();
+	const bool HaveInvariantTSC();
 } // namespace CPUInfo
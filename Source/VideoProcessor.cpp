@@ -59,6 +59,100 @@ void CVideoProcessor::SetShowStats(bool value)
 	}
 }
 
+HRESULT CVideoProcessor::GetLatencyHistograms(BYTE** ppData, unsigned* pSize)
+{
+	CheckPointer(ppData, E_POINTER);
+	CheckPointer(pSize, E_POINTER);
+
+	*pSize = sizeof(LatencyHistogramsData_t);
+	auto pData = (LatencyHistogramsData_t*)LocalAlloc(LMEM_FIXED, *pSize); // only this allocator can be used
+	if (!pData) {
+		return E_OUTOFMEMORY;
+	}
+
+	pData->size = sizeof(LatencyHistogramsData_t);
+	pData->stages = LATENCY_COUNT;
+
+	const double ms = 1000.0 / GetPreciseTicksPerSecond();
+	for (int i = 0; i < LATENCY_COUNT; i++) {
+		const auto& hist = m_LatencyHists[i];
+		auto& stage = pData->stage[i];
+		stage.count = hist.GetCount();
+		stage.p50 = hist.GetPercentile(0.50) * ms;
+		stage.p95 = hist.GetPercentile(0.95) * ms;
+		stage.p99 = hist.GetPercentile(0.99) * ms;
+		stage.max = hist.GetMax() * ms;
+	}
+
+	*ppData = (BYTE*)pData;
+
+	return S_OK;
+}
+
+void CVideoProcessor::ResetLatencyHistograms()
+{
+	for (auto& hist : m_LatencyHists) {
+		hist.Reset();
+	}
+}
+
+HRESULT CVideoProcessor::GetStageTimers(BYTE** ppData, unsigned* pSize)
+{
+	CheckPointer(ppData, E_POINTER);
+	CheckPointer(pSize, E_POINTER);
+
+	*pSize = sizeof(StageTimersData_t);
+	auto pData = (StageTimersData_t*)LocalAlloc(LMEM_FIXED, *pSize); // only this allocator can be used
+	if (!pData) {
+		return E_OUTOFMEMORY;
+	}
+
+	pData->size = sizeof(StageTimersData_t);
+	pData->stages = STAGE_COUNT;
+
+	const double ms = 1000.0 / GetPreciseTicksPerSecond();
+	for (int i = 0; i < STAGE_COUNT; i++) {
+		const auto timer = m_StageTimers.Get(i);
+		auto& stage = pData->stage[i];
+		stage.count = timer.count;
+		stage.avg = timer.count ? timer.totalTicks * ms / timer.count : 0;
+		stage.max = timer.maxTicks * ms;
+	}
+
+	*ppData = (BYTE*)pData;
+
+	return S_OK;
+}
+
+void CVideoProcessor::UpdateStatsStages()
+{
+	const uint64_t tick = GetPreciseTick();
+	if (tick - m_stagesIntervalTick < GetPreciseTicksPerSecondI()) {
+		return;
+	}
+	m_stagesIntervalTick = tick;
+
+	// "avg/max" in milliseconds, three stages per line
+	const double ms = 1000.0 / GetPreciseTicksPerSecond();
+	m_strStatsStages.assign(L"\nStages(ms)    :");
+	unsigned n = 0;
+	for (int i = 0; i < STAGE_COUNT; i++) {
+		const auto interval = m_StageTimers.TakeInterval(i);
+		if (interval.count) {
+			if (n && n % 3 == 0) {
+				m_strStatsStages.append(L"\n               ");
+			}
+			m_strStatsStages += std::format(L" {} {:.2f}/{:.1f}{}",
+				kStageNames[i],
+				interval.totalTicks * ms / interval.count,
+				interval.maxTicks * ms,
+				n % 3 < 2 ? L"," : L"");
+			n++;
+		}
+	}
+	str_trim_end(m_strStatsStages, ',');
+}
+
 void CVideoProcessor::UpdateStatsByWindow()
 {
 	if (m_iResizeStats == 1) {
@@ -142,8 +236,12 @@ void CVideoProcessor::SetDisplayInfo(const DisplayConfig_t& dc, const bool prima
 {
 	if (dc.refreshRate.Numerator) {
 		m_uHalfRefreshPeriodMs = (UINT32)(500ull * dc.refreshRate.Denominator / dc.refreshRate.Numerator);
+		m_rtRefreshPeriod = (REFERENCE_TIME)(UNITS * dc.refreshRate.Denominator / dc.refreshRate.Numerator);
+		m_RefreshEstimator.SetNominalRate((double)dc.refreshRate.Numerator / dc.refreshRate.Denominator);
 	} else {
 		m_uHalfRefreshPeriodMs = 0;
+		m_rtRefreshPeriod = 0;
+		m_RefreshEstimator.SetNominalRate(0);
 	}
 
 	m_strStatsDispInfo.assign(L"\nDisplay: ");
@@ -255,17 +353,100 @@ void CVideoProcessor::UpdateStatsInputFmt()
 	}
 }
 
-void CVideoProcessor::SyncFrameToStreamTime(const REFERENCE_TIME frameStartTime)
+bool CVideoProcessor::SyncFrameToStreamTime(const REFERENCE_TIME frameStartTime)
 {
 	if (m_pFilter->m_filterState == State_Running && frameStartTime != INVALID_TIME) {
-		if (SUCCEEDED(m_pFilter->StreamTime(m_streamTime)) && frameStartTime > m_streamTime) {
-			const auto sleepTime = (frameStartTime - m_streamTime) / 10000LL - m_uHalfRefreshPeriodMs;
-			if (sleepTime > 0 && sleepTime < 42) {
-				// We are waiting for Preset to display the frame at the required display refresh interval.
-				// This is relevant for displays with high frame rates (for example 144 Hz).
-				// But no longer than 41 ms to avoid problems with the DVD-Video menu.
-				Sleep(static_cast<DWORD>(sleepTime));
+		if (SUCCEEDED(m_pFilter->StreamTime(m_streamTime))) {
+			if (m_rtRefreshPeriod) {
+				const REFERENCE_TIME frameDuration = m_pFilter->m_FrameStats.GetAverageFrameDuration();
+				m_Cadence.SetRates(m_rtRefreshPeriod, m_bDoubleFrames ? frameDuration / 2 : frameDuration);
+			}
+
+			REFERENCE_TIME presentTime;
+			const auto plan = m_Cadence.PlanFrame(frameStartTime, m_streamTime, presentTime);
+
+			// The frame is planned for a vsync that may come almost a vsync period before its start time,
+			// so the scheduler wakes us up earlier than the usual 8 ms.
+			m_pFilter->m_Scheduler.SetMonitorAllowance(plan == CCadencePlanner::Plan_None ? 0 : m_rtRefreshPeriod);
+
+			if (plan == CCadencePlanner::Plan_Skip) {
+				return false;
 			}
+			if (plan == CCadencePlanner::Plan_Present) {
+				const auto sleepTime = (presentTime - m_streamTime) / 10000LL;
+				if (sleepTime > 0 && sleepTime < std::max(42LL, m_rtRefreshPeriod * 2 / 10000)) {
+					Sleep(static_cast<DWORD>(sleepTime));
+				}
+				return true;
+			}
+
+			if (frameStartTime > m_streamTime) {
+				const auto sleepTime = (frameStartTime - m_streamTime) / 10000LL - m_uHalfRefreshPeriodMs;
+				if (sleepTime > 0 && sleepTime < 42) {
+					// We are waiting for Preset to display the frame at the required display refresh interval.
+					// This is relevant for displays with high frame rates (for example 144 Hz).
+					// But no longer than 41 ms to avoid problems with the DVD-Video menu.
+					Sleep(static_cast<DWORD>(sleepTime));
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+void CVideoProcessor::ResetPresentStats()
+{
+	m_Cadence.Reset();
+	m_SyncOffsetStats.Reset();
+	m_PresentJitter.Reset();
+	m_lastPresentTick = 0;
+}
+
+void CVideoProcessor::AddSyncOffset(const REFERENCE_TIME syncOffset, const uint64_t presentTick)
+{
+	const int so = (int)std::clamp(syncOffset, -UNITS, UNITS);
+#if SYNC_OFFSET_EX
+	m_SyncDevs.Add(so - m_Syncs.Last());
+#endif
+	m_Syncs.Add(so);
+	m_SyncOffsetStats.Add(so);
+
+	if (m_lastPresentTick && m_rtRefreshPeriod > 0) {
+		const double interval = (presentTick - m_lastPresentTick) * (double)UNITS / GetPreciseTicksPerSecond();
+		// the jitter is the difference from the planned cadence interval or else from a whole number of vsyncs,
+		// so the alternating intervals of 3:2 are not counted
+		double vsyncs = m_Cadence.GetPlannedVsyncs();
+		if (!vsyncs) {
+			vsyncs = std::max(std::round(interval / m_rtRefreshPeriod), 1.0);
+		}
+		const double deviation = interval - vsyncs * m_rtRefreshPeriod;
+		m_PresentJitter.Add((int)std::clamp(deviation, -(double)UNITS, (double)UNITS));
+	}
+	m_lastPresentTick = presentTick;
+
+	// the drift of the tick source is only logged, switching the source would break the stored ticks
+	if (!m_lastTickSourceCheck) {
+		m_lastTickSourceCheck = presentTick;
+	} else if (presentTick - m_lastTickSourceCheck >= 10 * GetPreciseTicksPerSecondI()) {
+		CheckPreciseTickSource();
+		m_lastTickSourceCheck = presentTick;
+	}
+}
+
+void CVideoProcessor::AddVsyncObservation(const LONGLONG vsyncQpc, const UINT refreshCount)
+{
+	LARGE_INTEGER qpc, freq;
+	QueryPerformanceCounter(&qpc);
+	QueryPerformanceFrequency(&freq);
+
+	m_RefreshEstimator.AddVsync((double)vsyncQpc / freq.QuadPart, refreshCount);
+
+	const REFERENCE_TIME timeSinceVsync = llMulDiv(qpc.QuadPart - vsyncQpc, UNITS, freq.QuadPart, 0);
+	if (m_bAdjustPresentTime && m_pFilter->m_filterState == State_Running && timeSinceVsync >= 0) {
+		CRefTime streamTime;
+		if (SUCCEEDED(m_pFilter->StreamTime(streamTime))) {
+			m_Cadence.AddVsync(streamTime - timeSinceVsync);
 		}
 	}
 }
@@ -21,8 +21,13 @@
 #pragma once
 
 #include <evr9.h>
+#include "CadencePlanner.h"
+#include "RefreshRateEstimator.h"
 #include "DisplayConfig.h"
 #include "FrameStats.h"
+#include "FrameTrace.h"
+#include "StageTimers.h"
+#include "StatsText.h"
 #include "SubPic/ISubPic.h"
 
 enum : int {
@@ -125,6 +130,9 @@ protected:
 	bool m_bDoubleFrames = false;
 
 	UINT32 m_uHalfRefreshPeriodMs = 0;
+	REFERENCE_TIME m_rtRefreshPeriod = 0;
+	CCadencePlanner m_Cadence; // used with m_bAdjustPresentTime
+	CRefreshRateEstimator m_RefreshEstimator;
 
 	bool m_bAllowDeepColorBitmaps = false;
 
@@ -135,6 +143,11 @@ protected:
 
 	// Statistics
 	CRenderStats m_RenderStats;
+	CLatencyHistogram m_LatencyHists[LATENCY_COUNT];
+	CStageTimers m_StageTimers;
+	CStatsText m_StatsText;
+	std::wstring m_strStatsStages; // stage table of the last second
+	uint64_t m_stagesIntervalTick = 0;
 	std::wstring m_strStatsHeader;
 	std::wstring m_strStatsInputFmt;
 	std::wstring m_strStatsVProc;
@@ -147,13 +160,20 @@ protected:
 	const wchar_t* m_strShaderY = nullptr;
 	int m_StatsFontH = 14;
 	RECT m_StatsRect = { 10, 10, 10 + 5 + 63*8 + 3, 10 + 5 + 18*17 + 3 };
+	unsigned m_StatsLines = 20; // m_StatsRect fits these lines, the line count of the last m_StatsText
 	const POINT m_StatsTextPoint = { 10 + 5, 10 + 5};
 
 	// Graph of a function
-	CMovingAverage<int> m_Syncs = CMovingAverage<int>(120);
+	CSlidingStats<int> m_Syncs = CSlidingStats<int>(120);
 #if SYNC_OFFSET_EX
-	CMovingAverage<int> m_SyncDevs = CMovingAverage<int>(m_Syncs.Size()-1);
+	CSlidingStats<int> m_SyncDevs = CSlidingStats<int>(m_Syncs.Size()-1);
 #endif
+	// sync offset and present jitter statistics over about 3 minutes at 60 Hz
+	static constexpr unsigned kSyncStatsWindow = 60 * 180;
+	CSlidingStats<int> m_SyncOffsetStats = CSlidingStats<int>(kSyncStatsWindow);
+	CSlidingStats<int> m_PresentJitter = CSlidingStats<int>(kSyncStatsWindow); // present interval minus the planned interval
+	uint64_t m_lastPresentTick = 0;
+	uint64_t m_lastTickSourceCheck = 0;
 	int m_Xstep  = 4;
 	int m_Yscale = 2;
 	RECT m_GraphRect = {};
@@ -186,6 +206,8 @@ public:
 
 	void Start() { m_rtStart = 0; }
 	virtual void Flush() = 0;
+	// The planned vsyncs and the sync statistics are not valid after a seek, stop or pause
+	void ResetPresentStats();
 	virtual HRESULT Reset(bool bDisplayModeChange) = 0;
 
 	virtual bool IsInit() const { return false; }
@@ -207,7 +229,7 @@ public:
 	int GetRotation() { return m_iRotation; }
 	virtual void SetRotation(int value) = 0;
 	bool GetFlip() { return m_bFlip; }
-	void SetFlip(bool value) { m_bFlip = value; }
+	virtual void SetFlip(bool value) { m_bFlip = value; }
 	virtual void SetStereo3dTransform(int value) {};
 	void SetAllowDeepColorBitmaps(bool value) { m_bAllowDeepColorBitmaps = value; }
 
@@ -221,6 +243,12 @@ public:
 	virtual HRESULT GetDisplayedImage(BYTE **ppDib, unsigned *pSize) = 0;
 	virtual HRESULT GetVPInfo(std::wstring& str) = 0;
 
+	// can be called from any thread
+	HRESULT GetLatencyHistograms(BYTE** ppData, unsigned* pSize);
+	void ResetLatencyHistograms();
+	HRESULT GetStageTimers(BYTE** ppData, unsigned* pSize);
+	void ResetStageTimers() { m_StageTimers.Reset(); }
+
 	void UpdateStatsByWindow();
 	void UpdateStatsByDisplay();
 	bool CheckGraphPlacement();
@@ -230,8 +258,14 @@ public:
 	void SetDisplayInfo(const DisplayConfig_t& dc, const bool primary, const bool exclusiveScreen);
 
 	bool GetDoubleRate() { return m_bDoubleFrames; }
+	bool GetMeasuredRefreshRate(double& rate, double& rateError) const { return m_RefreshEstimator.GetRate(rate, rateError); }
 
 	virtual ISubPicAllocator* GetSubPicAllocator() { return nullptr; }
+	// the buffer pool of the subpics, DX11 only
+	virtual HRESULT GetSubPicPoolStats(BYTE** ppData, unsigned* pSize) { return E_NOTIMPL; }
+	virtual void SetSubPicPoolLimit(const UINT64 limit) {}
+	virtual void SetSubPicCompression(const bool bCompress) {}
+	virtual void SetSubtitlesBlendInCopy(const bool bBlend) {}
 
 	virtual void SwitchFullScreen(bool set) {};
 
@@ -264,9 +298,17 @@ protected:
 	}
 
 	void UpdateStatsInputFmt();
+	// Updates m_strStatsStages once a second
+	void UpdateStatsStages();
 
 	CRefTime m_streamTime;
-	void SyncFrameToStreamTime(const REFERENCE_TIME frameStartTime);
+	// Waits until the planned present time of the frame, returns false if the frame should not be presented
+	bool SyncFrameToStreamTime(const REFERENCE_TIME frameStartTime);
+	// Adds the sync offset of the presented frame to the graph and the statistics
+	void AddSyncOffset(const REFERENCE_TIME syncOffset, const uint64_t presentTick);
+	// Passes the measured vsync time to the refresh rate estimator and the cadence planner.
+	// vsyncQpc is in QueryPerformanceCounter units, refreshCount is 0 if unknown.
+	void AddVsyncObservation(const LONGLONG vsyncQpc, const UINT refreshCount);
 
 public:
 	// IUnknown
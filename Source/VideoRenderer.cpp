@@ -350,6 +350,7 @@ HRESULT CMpcVideoRenderer::EndFlush()
 	DLog(L"CMpcVideoRenderer::EndFlush()");
 
 	m_VideoProcessor->Flush();
+	m_VideoProcessor->ResetPresentStats();
 
 	HRESULT hr = __super::EndFlush();
 
@@ -518,6 +519,9 @@ HRESULT CMpcVideoRenderer::Receive(IMediaSample* pSample)
 {
 	// override CBaseRenderer::Receive() for the implementation of the search during the pause
 
+	m_ReceiveTick = GetPreciseTick();
+	FRAMETRACE_EVENT("Receive");
+
 	if (m_bFlushing) {
 		DLog(L"CMpcVideoRenderer::Receive() - flushing, skip sample");
 		return S_OK;
@@ -564,6 +568,7 @@ HRESULT CMpcVideoRenderer::Receive(IMediaSample* pSample)
 	// will lock the critical section and check we can still render the data
 
 	hr = WaitForRenderTime();
+	FRAMETRACE_EVENT("WaitForRenderTime wake");
 	if (FAILED(hr)) {
 		m_bInReceive = FALSE;
 		return NOERROR;
@@ -700,6 +705,11 @@ STDMETHODIMP CMpcVideoRenderer::Run(REFERENCE_TIME rtStart)
 	CAutoLock cVideoLock(&m_InterfaceLock);
 	m_filterState = State_Running;
 
+	{
+		CAutoLock cRendererLock(&m_RendererLock);
+		m_VideoProcessor->ResetPresentStats();
+	}
+
 	return CBaseVideoRenderer2::Run(rtStart);
 }
 
@@ -709,6 +719,11 @@ STDMETHODIMP CMpcVideoRenderer::Pause()
 
 	m_filterState = State_Paused;
 
+	{
+		CAutoLock cRendererLock(&m_RendererLock);
+		m_VideoProcessor->ResetPresentStats();
+	}
+
 	return CBaseVideoRenderer2::Pause();
 }
 
@@ -722,6 +737,7 @@ STDMETHODIMP CMpcVideoRenderer::Stop()
 	{
 		CAutoLock cRendererLock(&m_RendererLock);
 		m_VideoProcessor->Flush();
+		m_VideoProcessor->ResetPresentStats();
 	}
 
 	return CBaseVideoRenderer2::Stop();
@@ -1352,6 +1368,11 @@ STDMETHODIMP CMpcVideoRenderer::Flt_GetBool(LPCSTR field, bool* value)
 		return S_OK;
 	}
 
+	if (!strcmp(field, "traceEnable")) {
+		*value = g_FrameTrace.IsEnabled();
+		return S_OK;
+	}
+
 	return E_INVALIDARG;
 }
 
@@ -1416,6 +1437,43 @@ STDMETHODIMP CMpcVideoRenderer::Flt_GetBin(LPCSTR field, LPVOID* value, unsigned
 		return hr;
 	}
 
+	if (!strcmp(field, "statsHistograms")) {
+		// LatencyHistogramsData_t, the histograms are lock-free
+		return m_VideoProcessor->GetLatencyHistograms((BYTE**)value, size);
+	}
+	if (!strcmp(field, "statsStages")) {
+		// StageTimersData_t, count, average and max time of each render stage
+		return m_VideoProcessor->GetStageTimers((BYTE**)value, size);
+	}
+	if (!strcmp(field, "statsSubPicPool")) {
+		// SubPicPoolData_t, the buffers of the subtitle pictures
+		return m_VideoProcessor->GetSubPicPoolStats((BYTE**)value, size);
+	}
+	if (!strcmp(field, "statsSubPicQueue")) {
+		// SubPicQueueStats_t, the subtitle queue since it was created
+		CheckPointer(value, E_POINTER);
+		CheckPointer(size, E_POINTER);
+
+		CComQIPtr<ISubPicQueueStats> pQueueStats;
+		{
+			CAutoLock cAutoLock(&m_InterfaceLock);
+			pQueueStats = m_pSubPicQueue.p;
+		}
+		if (!pQueueStats) {
+			return E_ABORT;
+		}
+
+		*size = sizeof(SubPicQueueStats_t);
+		auto pData = (SubPicQueueStats_t*)LocalAlloc(LMEM_FIXED, *size); // only this allocator can be used
+		if (!pData) {
+			return E_OUTOFMEMORY;
+		}
+		pQueueStats->GetQueueStats(*pData);
+		*value = pData;
+
+		return S_OK;
+	}
+
 	return E_INVALIDARG;
 }
 
@@ -1473,6 +1531,24 @@ STDMETHODIMP CMpcVideoRenderer::Flt_SetBool(LPCSTR field, bool value)
 		return S_OK;
 	}
 
+	if (!strcmp(field, "subtitlesBlendInCopy")) {
+		// the subtitles are blended into the frames from system memory on the CPU
+		m_VideoProcessor->SetSubtitlesBlendInCopy(value);
+		return S_OK;
+	}
+
+	if (!strcmp(field, "subPicCompression")) {
+		// the queued subtitle pictures are kept compressed
+		m_VideoProcessor->SetSubPicCompression(value);
+		return S_OK;
+	}
+
+	if (!strcmp(field, "traceEnable")) {
+		// starts recording from an empty buffer
+		g_FrameTrace.Enable(value);
+		return S_OK;
+	}
+
 	return E_INVALIDARG;
 }
 
@@ -1503,6 +1579,30 @@ STDMETHODIMP CMpcVideoRenderer::Flt_SetInt(LPCSTR field, int value)
 		}
 	}
 
+	if (!strcmp(field, "statsHistograms") && value == 0) {
+		// 0 resets the latency histograms
+		m_VideoProcessor->ResetLatencyHistograms();
+		return S_OK;
+	}
+	if (!strcmp(field, "statsStages") && value == 0) {
+		// 0 resets the stage timers
+		m_VideoProcessor->ResetStageTimers();
+		return S_OK;
+	}
+	if (!strcmp(field, "statsSubPicQueue") && value == 0) {
+		// 0 resets the subtitle queue statistics
+		CAutoLock cAutoLock(&m_InterfaceLock);
+		if (CComQIPtr<ISubPicQueueStats> pQueueStats = m_pSubPicQueue.p) {
+			pQueueStats->ResetQueueStats();
+		}
+		return S_OK;
+	}
+	if (!strcmp(field, "subPicPoolLimit") && value > 0) {
+		// MiB
+		m_VideoProcessor->SetSubPicPoolLimit((UINT64)value * 1048576);
+		return S_OK;
+	}
+
 	return E_INVALIDARG;
 }
 
@@ -1561,6 +1661,13 @@ STDMETHODIMP CMpcVideoRenderer::Flt_SetBin(LPCSTR field, LPVOID value, int size)
 				return m_VideoProcessor->AddPostScaleShader(shaderName, shaderCode);
 			}
 		}
+
+		if (!strcmp(field, "cmd_saveTrace")) {
+			// the file name is a wide string, the terminating null is optional
+			std::wstring filename((LPCWSTR)value, size / sizeof(wchar_t));
+			str_trim_end(filename, L'\0');
+			return g_FrameTrace.SaveToFile(filename.c_str());
+		}
 	}
 
 	return E_INVALIDARG;
@@ -1722,6 +1829,15 @@ STDMETHODIMP CMpcVideoRenderer::GetDouble(LPCSTR field, double* value)
 		// hmm, calculate Refresh Time in milliseconds (not Refresh Rate)
 		return S_OK;
 	}
+	// estimated from the vsync time stamps, in Hz
+	if (!strcmp(field, "measuredRefreshRate")) {
+		double rateError;
+		return m_VideoProcessor->GetMeasuredRefreshRate(*value, rateError) ? S_OK : E_FAIL;
+	}
+	if (!strcmp(field, "measuredRefreshRateError")) {
+		double rate;
+		return m_VideoProcessor->GetMeasuredRefreshRate(rate, *value) ? S_OK : E_FAIL;
+	}
 
 	return E_INVALIDARG;
 }
@@ -1764,6 +1880,7 @@ STDMETHODIMP CMpcVideoRenderer::GetString(LPCSTR field, LPWSTR* value, int* char
 
 CComPtr<ISubPic> CMpcVideoRenderer::GetSubPic(REFERENCE_TIME rtStart)
 {
+	FRAMETRACE_SCOPE("GetSubPic");
 	CComPtr<ISubPic> pSubPic;
 	if (m_pSubPicQueue) {
 		const auto rtNow = m_rtStartTime + rtStart;
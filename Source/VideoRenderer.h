@@ -113,6 +113,7 @@ private:
 
 	int m_Stepping = 0;
 	REFERENCE_TIME m_rtStartTime = 0;
+	uint64_t m_ReceiveTick = 0; // GetPreciseTick() at the beginning of Receive(), 0 if the sample is already rendered
 
 	// VideoProcessor
 	std::unique_ptr<CVideoProcessor> m_VideoProcessor;
@@ -11,7 +11,12 @@
 
 #pragma warning(disable:4305)
 
-void mp_invert_matrix3x3(float m[3][3])
+static constexpr double cabs(double x)
+{
+    return x < 0 ? -x : x;
+}
+
+static constexpr void invert_matrix3x3(float m[3][3])
 {
     float m00 = m[0][0], m01 = m[0][1], m02 = m[0][2],
           m10 = m[1][0], m11 = m[1][1], m12 = m[1][2],
@@ -39,8 +44,13 @@ void mp_invert_matrix3x3(float m[3][3])
     }
 }
 
+void mp_invert_matrix3x3(float m[3][3])
+{
+    invert_matrix3x3(m);
+}
+
 // A := A * B
-static void mp_mul_matrix3x3(float a[3][3], float b[3][3])
+static constexpr void mp_mul_matrix3x3(float a[3][3], const float b[3][3])
 {
     float a00 = a[0][0], a01 = a[0][1], a02 = a[0][2],
           a10 = a[1][0], a11 = a[1][1], a12 = a[1][2],
@@ -53,8 +63,16 @@ static void mp_mul_matrix3x3(float a[3][3], float b[3][3])
     }
 }
 
+// CIE standard illuminant series
+static constexpr struct mp_csp_col_xy
+    d50 = {0.34577, 0.35850},
+    d65 = {0.31271, 0.32902},
+    c   = {0.31006, 0.31616},
+    dci = {0.31400, 0.35100},
+    e   = {1.0/3.0, 1.0/3.0};
+
 // return the primaries associated with a certain mp_csp_primaries val
-struct mp_csp_primaries mp_get_csp_primaries(enum mp_csp_prim spc)
+static constexpr struct mp_csp_primaries get_csp_primaries(enum mp_csp_prim spc)
 {
     /*
     Values from: ITU-R Recommendations BT.470-6, BT.601-7, BT.709-5, BT.2020-0
@@ -67,14 +85,6 @@ struct mp_csp_primaries mp_get_csp_primaries(enum mp_csp_prim spc)
     Other colorspaces from https://en.wikipedia.org/wiki/RGB_color_space#Specifications
     */
 
-    // CIE standard illuminant series
-    static const struct mp_csp_col_xy
-        d50 = {0.34577, 0.35850},
-        d65 = {0.31271, 0.32902},
-        c   = {0.31006, 0.31616},
-        dci = {0.31400, 0.35100},
-        e   = {1.0/3.0, 1.0/3.0};
-
     switch (spc) {
     case MP_CSP_PRIM_BT_470M:
         return {
@@ -204,6 +214,11 @@ struct mp_csp_primaries mp_get_csp_primaries(enum mp_csp_prim spc)
     }
 }
 
+struct mp_csp_primaries mp_get_csp_primaries(enum mp_csp_prim spc)
+{
+    return get_csp_primaries(spc);
+}
+
 // Get the nominal peak for a given colorspace, relative to the reference white
 // level. In other words, this returns the brightest encodable value that can
 // be represented by a given transfer curve.
@@ -227,7 +242,7 @@ bool mp_trc_is_hdr(enum mp_csp_trc trc)
 
 // Compute the RGB/XYZ matrix as described here:
 // http://www.brucelindbloom.com/index.html?Eqn_RGB_XYZ_Matrix.html
-void mp_get_rgb2xyz_matrix(struct mp_csp_primaries space, float m[3][3])
+static constexpr void get_rgb2xyz_matrix(const struct mp_csp_primaries space, float m[3][3])
 {
     float S[3], X[4], Z[4];
 
@@ -249,7 +264,7 @@ void mp_get_rgb2xyz_matrix(struct mp_csp_primaries space, float m[3][3])
         m[2][i] = Z[i];
     }
 
-    mp_invert_matrix3x3(m);
+    invert_matrix3x3(m);
 
     for (int i = 0; i < 3; i++)
         S[i] = m[i][0] * X[3] + m[i][1] * 1 + m[i][2] * Z[3];
@@ -262,13 +277,39 @@ void mp_get_rgb2xyz_matrix(struct mp_csp_primaries space, float m[3][3])
     }
 }
 
+struct rgb2xyz_table_t {
+    float m[MP_CSP_PRIM_COUNT][3][3];
+};
+
+static constexpr rgb2xyz_table_t make_rgb2xyz_table()
+{
+    rgb2xyz_table_t table = {};
+    for (int p = MP_CSP_PRIM_AUTO + 1; p < MP_CSP_PRIM_COUNT; p++) {
+        get_rgb2xyz_matrix(get_csp_primaries((mp_csp_prim)p), table.m[p]);
+    }
+    // AUTO is not evaluated, the default assumption is BT.709
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            table.m[MP_CSP_PRIM_AUTO][i][j] = table.m[MP_CSP_PRIM_BT_709][i][j];
+        }
+    }
+    return table;
+}
+
+static constexpr rgb2xyz_table_t s_rgb2xyz_table = make_rgb2xyz_table();
+
+void mp_get_rgb2xyz_matrix(struct mp_csp_primaries space, float m[3][3])
+{
+    get_rgb2xyz_matrix(space, m);
+}
+
 // M := M * XYZd<-XYZs
-static void mp_apply_chromatic_adaptation(struct mp_csp_col_xy src,
-                                          struct mp_csp_col_xy dest, float m[3][3])
+static constexpr void mp_apply_chromatic_adaptation(struct mp_csp_col_xy src,
+                                                    struct mp_csp_col_xy dest, float m[3][3])
 {
     // If the white points are nearly identical, this is a wasteful identity
     // operation.
-    if (fabs(src.x - dest.x) < 1e-6 && fabs(src.y - dest.y) < 1e-6)
+    if (cabs(src.x - dest.x) < 1e-6 && cabs(src.y - dest.y) < 1e-6)
         return;
 
     // XYZd<-XYZs = Ma^-1 * (I*[Cd/Cs]) * Ma
@@ -302,26 +343,26 @@ static void mp_apply_chromatic_adaptation(struct mp_csp_col_xy src,
     mp_mul_matrix3x3(tmp, bradford);
 
     // M := M * Ma^-1 * tmp
-    mp_invert_matrix3x3(bradford);
+    invert_matrix3x3(bradford);
     mp_mul_matrix3x3(m, bradford);
     mp_mul_matrix3x3(m, tmp);
 }
 
 // get the coefficients of an ST 428-1 xyz -> rgb conversion matrix
 // intent = the rendering intent used to convert to the target primaries
-static void mp_get_xyz2rgb_coeffs(struct mp_csp_params *params,
-                                  enum mp_render_intent intent, struct mp_cmat *m)
+static constexpr void mp_get_xyz2rgb_coeffs(const struct mp_csp_params *params,
+                                            enum mp_render_intent intent, struct mp_cmat *m)
 {
     // Convert to DCI-P3
-    struct mp_csp_primaries prim = mp_get_csp_primaries(MP_CSP_PRIM_DCI_P3);
+    struct mp_csp_primaries prim = get_csp_primaries(MP_CSP_PRIM_DCI_P3);
     float brightness = params->brightness;
-    mp_get_rgb2xyz_matrix(prim, m->m);
-    mp_invert_matrix3x3(m->m);
+    get_rgb2xyz_matrix(prim, m->m);
+    invert_matrix3x3(m->m);
 
     // All non-absolute mappings want to map source white to target white
     if (intent != MP_INTENT_ABSOLUTE_COLORIMETRIC) {
         // SMPTE EG 432-1 Annex H defines the white point as equal energy
-        static const struct mp_csp_col_xy smpte432 = {1.0/3.0, 1.0/3.0};
+        constexpr struct mp_csp_col_xy smpte432 = {1.0/3.0, 1.0/3.0};
         mp_apply_chromatic_adaptation(smpte432, prim.white, m->m);
     }
 
@@ -329,7 +370,7 @@ static void mp_get_xyz2rgb_coeffs(struct mp_csp_params *params,
     // want to linearize any brightness additions. 2 is a reasonable
     // approximation for any sort of gamma function that could be in use.
     // As this is an aesthetic setting only, any exact values do not matter.
-    brightness *= fabs(brightness);
+    brightness *= (float)cabs(brightness);
 
     for (int i = 0; i < 3; i++)
         m->c[i] = brightness;
@@ -338,9 +379,8 @@ static void mp_get_xyz2rgb_coeffs(struct mp_csp_params *params,
 // Get multiplication factor required if image data is fit within the LSBs of a
 // higher smaller bit depth fixed-point texture data.
 // This is broken. Use mp_get_csp_uint_mul().
-double mp_get_csp_mul(enum mp_csp csp, int input_bits, int texture_bits)
+static constexpr double get_csp_mul(enum mp_csp csp, int input_bits, int texture_bits)
 {
-    assert(texture_bits >= input_bits);
 
     // Convenience for some irrelevant cases, e.g. rgb565 or disabling expansion.
     if (!input_bits)
@@ -357,6 +397,13 @@ double mp_get_csp_mul(enum mp_csp csp, int input_bits, int texture_bits)
     return (1LL << input_bits) / ((1LL << texture_bits) - 1.) * 255 / 256;
 }
 
+double mp_get_csp_mul(enum mp_csp csp, int input_bits, int texture_bits)
+{
+    assert(texture_bits >= input_bits);
+
+    return get_csp_mul(csp, input_bits, texture_bits);
+}
+
 /* Fill in the Y, U, V vectors of a yuv-to-rgb conversion matrix
  * based on the given luma weights of the R, G and B components (lr, lg, lb).
  * lr+lg+lb is assumed to equal 1.
@@ -377,9 +424,9 @@ double mp_get_csp_mul(enum mp_csp csp, int input_bits, int texture_bits)
  * Under these conditions the given parameters lr, lg, lb uniquely
  * determine the mapping of Y, U, V to R, G, B.
  */
-static void luma_coeffs(struct mp_cmat *mat, float lr, float lg, float lb)
+static constexpr void luma_coeffs(struct mp_cmat *mat, float lr, float lg, float lb)
 {
-    assert(fabs(lr+lg+lb - 1) < 1e-6);
+    assert(cabs(lr+lg+lb - 1) < 1e-6);
     *mat = mp_cmat{
         { {1, 0,                    2 * (1-lr)          },
           {1, -2 * (1-lb) * lb/lg, -2 * (1-lr) * lr/lg  },
@@ -389,12 +436,15 @@ static void luma_coeffs(struct mp_cmat *mat, float lr, float lg, float lb)
 }
 
 // get the coefficients of the yuv -> rgb conversion matrix
-void mp_get_csp_matrix(struct mp_csp_params *params, struct mp_cmat *m)
+// huecos/huesin are passed from outside because cos/sin are not constexpr
+static constexpr void get_csp_matrix(const struct mp_csp_params *params,
+                                     float huecos, float huesin, struct mp_cmat *m)
 {
     enum mp_csp colorspace = params->color.space;
     if (colorspace <= MP_CSP_AUTO || colorspace >= MP_CSP_COUNT)
         colorspace = MP_CSP_BT_601;
-    enum mp_csp_levels levels_in = params->color.levels;
+    // -1 is any full range, it is not a value of mp_csp_levels
+    int levels_in = params->color.levels;
     if (levels_in <= MP_CSP_LEVELS_AUTO || levels_in >= MP_CSP_LEVELS_COUNT)
         levels_in = MP_CSP_LEVELS_TV;
 
@@ -413,7 +463,7 @@ void mp_get_csp_matrix(struct mp_csp_params *params, struct mp_cmat *m)
     }
     case MP_CSP_RGB: {
         *m = mp_cmat{{{1, 0, 0}, {0, 1, 0}, {0, 0, 1}}};
-        levels_in = (mp_csp_levels)-1;
+        levels_in = -1;
         break;
     }
     case MP_CSP_XYZ: {
@@ -423,7 +473,7 @@ void mp_get_csp_matrix(struct mp_csp_params *params, struct mp_cmat *m)
         // provided in mp_csp_params. (At the risk of clipping, if the
         // chosen primaries are too small to fit the actual data)
         mp_get_xyz2rgb_coeffs(params, MP_INTENT_RELATIVE_COLORIMETRIC, m);
-        levels_in = (mp_csp_levels)-1;
+        levels_in = -1;
         break;
     }
     case MP_CSP_YCGCO: {
@@ -439,15 +489,13 @@ void mp_get_csp_matrix(struct mp_csp_params *params, struct mp_cmat *m)
     };
 
     if (params->is_float)
-        levels_in = (mp_csp_levels)-1;
+        levels_in = -1;
 
     if ((colorspace == MP_CSP_BT_601 || colorspace == MP_CSP_BT_709 ||
          colorspace == MP_CSP_SMPTE_240M || colorspace == MP_CSP_BT_2020_NC))
     {
         // Hue is equivalent to rotating input [U, V] subvector around the origin.
         // Saturation scales [U, V].
-        float huecos = params->gray ? 0 : params->saturation * cos(params->hue);
-        float huesin = params->gray ? 0 : params->saturation * sin(params->hue);
         for (int i = 0; i < 3; i++) {
             float u = m->m[i][1], v = m->m[i][2];
             m->m[i][1] = huecos * u - huesin * v;
@@ -457,7 +505,7 @@ void mp_get_csp_matrix(struct mp_csp_params *params, struct mp_cmat *m)
 
     // The values below are written in 0-255 scale - thus bring s into range.
     double s =
-        mp_get_csp_mul(colorspace, params->input_bits, params->texture_bits) / 255;
+        get_csp_mul(colorspace, params->input_bits, params->texture_bits) / 255;
     // NOTE: The yuvfull ranges as presented here are arguably ambiguous,
     // and conflict with at least the full-range YCbCr/ICtCp values as defined
     // by ITU-R BT.2100. If somebody ever complains about full-range YUV looking
@@ -508,6 +556,63 @@ void mp_get_csp_matrix(struct mp_csp_params *params, struct mp_cmat *m)
     }
 }
 
+// Precomputed matrices for the default ProcAmp values (brightness 0, contrast 1, hue 0, saturation 1),
+// which is what the video processors request for almost every video.
+#define CSP_TABLE_MIN_BITS 8
+#define CSP_TABLE_MAX_BITS 16
+
+struct csp_matrix_table_t {
+    mp_cmat m[MP_CSP_COUNT][MP_CSP_LEVELS_COUNT][MP_CSP_LEVELS_COUNT][CSP_TABLE_MAX_BITS - CSP_TABLE_MIN_BITS + 1];
+};
+
+static constexpr csp_matrix_table_t make_csp_matrix_table()
+{
+    csp_matrix_table_t table = {};
+    for (int csp = 0; csp < MP_CSP_COUNT; csp++) {
+        for (int lin = 0; lin < MP_CSP_LEVELS_COUNT; lin++) {
+            for (int lout = 0; lout < MP_CSP_LEVELS_COUNT; lout++) {
+                for (int bits = CSP_TABLE_MIN_BITS; bits <= CSP_TABLE_MAX_BITS; bits++) {
+                    mp_csp_params params;
+                    params.color.space  = (mp_csp)csp;
+                    params.color.levels = (mp_csp_levels)lin;
+                    params.levels_out   = (mp_csp_levels)lout;
+                    params.input_bits = params.texture_bits = bits;
+                    get_csp_matrix(&params, 1.0f, 0.0f, &table.m[csp][lin][lout][bits - CSP_TABLE_MIN_BITS]);
+                }
+            }
+        }
+    }
+    return table;
+}
+
+static constexpr csp_matrix_table_t s_csp_matrix_table = make_csp_matrix_table();
+
+void mp_get_csp_matrix(struct mp_csp_params *params, struct mp_cmat *m)
+{
+    const bool bDefaultProcAmp = params->brightness == 0 && params->contrast == 1
+        && params->hue == 0 && params->saturation == 1 && !params->gray;
+
+    if (bDefaultProcAmp && !params->is_float
+            && params->input_bits == params->texture_bits
+            && params->input_bits >= CSP_TABLE_MIN_BITS && params->input_bits <= CSP_TABLE_MAX_BITS
+            && params->color.space >= 0 && params->color.space < MP_CSP_COUNT
+            && params->color.levels >= 0 && params->color.levels < MP_CSP_LEVELS_COUNT
+            && params->levels_out >= 0 && params->levels_out < MP_CSP_LEVELS_COUNT) {
+        *m = s_csp_matrix_table.m[params->color.space][params->color.levels][params->levels_out][params->input_bits - CSP_TABLE_MIN_BITS];
+        return;
+    }
+
+    mp_calc_csp_matrix(params, m);
+}
+
+void mp_calc_csp_matrix(struct mp_csp_params *params, struct mp_cmat *m)
+{
+    const float huecos = params->gray ? 0 : params->saturation * cos(params->hue);
+    const float huesin = params->gray ? 0 : params->saturation * sin(params->hue);
+
+    get_csp_matrix(params, huecos, huesin, m);
+}
+
 void mp_invert_cmat(struct mp_cmat *out, struct mp_cmat *in)
 {
     *out = *in;
@@ -546,12 +651,43 @@ void transpose_matrix3x3(float(&t)[3][3], const float(&m)[3][3])
     }
 }
 
+struct gamut_conv_table_t {
+	float m[MP_CSP_PRIM_COUNT][MP_CSP_PRIM_COUNT][3][3];
+};
+
+static constexpr gamut_conv_table_t make_gamut_conv_table()
+{
+	gamut_conv_table_t table = {};
+	for (int in = MP_CSP_PRIM_AUTO + 1; in < MP_CSP_PRIM_COUNT; in++) {
+		for (int out = MP_CSP_PRIM_AUTO + 1; out < MP_CSP_PRIM_COUNT; out++) {
+			float (&matrix)[3][3] = table.m[in][out];
+			for (int i = 0; i < 3; i++) {
+				for (int j = 0; j < 3; j++) {
+					matrix[i][j] = s_rgb2xyz_table.m[out][i][j];
+				}
+			}
+			invert_matrix3x3(matrix);
+			mp_mul_matrix3x3(matrix, s_rgb2xyz_table.m[in]);
+		}
+	}
+	// AUTO is BT.709
+	for (int p = MP_CSP_PRIM_AUTO; p < MP_CSP_PRIM_COUNT; p++) {
+		const int q = (p == MP_CSP_PRIM_AUTO) ? MP_CSP_PRIM_BT_709 : p;
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++) {
+				table.m[MP_CSP_PRIM_AUTO][p][i][j] = table.m[MP_CSP_PRIM_BT_709][q][i][j];
+				table.m[p][MP_CSP_PRIM_AUTO][i][j] = table.m[q][MP_CSP_PRIM_BT_709][i][j];
+			}
+		}
+	}
+	return table;
+}
+
+static constexpr gamut_conv_table_t s_gamut_conv_table = make_gamut_conv_table();
+
 void GetColorspaceGamutConversionMatrix(float matrix[3][3], mp_csp_prim csp_in, mp_csp_prim csp_out)
 {
-	float matrix_rgb2xyz_in[3][3];
-	mp_get_rgb2xyz_matrix(mp_get_csp_primaries(csp_in), matrix_rgb2xyz_in);
+	ASSERT(csp_in >= 0 && csp_in < MP_CSP_PRIM_COUNT && csp_out >= 0 && csp_out < MP_CSP_PRIM_COUNT);
 
-	mp_get_rgb2xyz_matrix(mp_get_csp_primaries(csp_out), matrix);
-	mp_invert_matrix3x3(matrix);
-	mp_mul_matrix3x3(matrix, matrix_rgb2xyz_in);
+	memcpy(matrix, s_gamut_conv_table.m[csp_in][csp_out], sizeof(s_gamut_conv_table.m[csp_in][csp_out]));
 }
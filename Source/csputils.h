@@ -127,11 +127,11 @@ struct mp_csp_col_xy {
     float x, y;
 };
 
-static inline float mp_xy_X(struct mp_csp_col_xy xy) {
+static constexpr float mp_xy_X(struct mp_csp_col_xy xy) {
     return xy.x / xy.y;
 }
 
-static inline float mp_xy_Z(struct mp_csp_col_xy xy) {
+static constexpr float mp_xy_Z(struct mp_csp_col_xy xy) {
     return (1 - xy.x - xy.y) / xy.y;
 }
 
@@ -165,6 +165,8 @@ void mp_get_rgb2xyz_matrix(struct mp_csp_primaries space, float m[3][3]);
 
 double mp_get_csp_mul(enum mp_csp csp, int input_bits, int texture_bits);
 void mp_get_csp_matrix(struct mp_csp_params *params, struct mp_cmat *out);
+// the same as mp_get_csp_matrix() without the precomputed matrices
+void mp_calc_csp_matrix(struct mp_csp_params *params, struct mp_cmat *out);
 
 void mp_invert_matrix3x3(float m[3][3]);
 void mp_invert_cmat(struct mp_cmat *out, struct mp_cmat *in);
@@ -176,4 +178,5 @@ void mp_invert_cmat(struct mp_cmat *out, struct mp_cmat *in);
 void mul_matrix3x3(float(&c)[3][3], const float(&a)[3][3], const float(&b)[3][3]);
 void transpose_matrix3x3(float(&t)[3][3], const float(&m)[3][3]);
 
+// Returns a precomputed RGB to RGB matrix for linear light, csp_in and csp_out must be valid values
 void GetColorspaceGamutConversionMatrix(float matrix[3][3], mp_csp_prim csp_in, mp_csp_prim csp_out);
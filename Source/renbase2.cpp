@@ -3,22 +3,13 @@
 #include "stdafx.h"
 #include "renbase2.h"
 
-//  Helper function for clamping time differences
-int inline TimeDiff(const REFERENCE_TIME rt)
-{
-	return std::clamp(rt, -(50 * UNITS), 50 * UNITS);
-}
-
 CBaseVideoRenderer2::CBaseVideoRenderer2(
       REFCLSID RenderClass, // CLSID for this renderer
       __in_opt LPCTSTR pName,         // Debug ONLY description
       __inout_opt LPUNKNOWN pUnk,       // Aggregated owner object
       __inout HRESULT *phr) :       // General OLE return code
 
-    CBaseRenderer(RenderClass,pName,pUnk,phr),
-    //m_cFramesDropped(0),
-    m_cFramesDrawn(0),
-    m_bSupplierHandlingQuality(FALSE)
+    CBaseRenderer(RenderClass,pName,pUnk,phr)
 {
     ResetStreamingTimes();
 #ifdef _DEBUG
@@ -61,27 +52,9 @@ CBaseVideoRenderer2::~CBaseVideoRenderer2()
 
 HRESULT CBaseVideoRenderer2::ResetStreamingTimes()
 {
-    m_trLastDraw = -1000;     // set up as first frame since ages (1 sec) ago
+    m_Scheduler.Reset();
     m_tStreamingStart = timeGetTime();
-    m_trRenderAvg = 0;
-    m_trFrameAvg = -1;        // -1000 fps == "unset"
-    m_trDuration = 0;         // 0 - strange value
-    m_trRenderLast = 0;
-    m_trWaitAvg = 0;
     m_tRenderStart = 0;
-    m_cFramesDrawn = 0;
-    //m_cFramesDropped = 0;
-    m_iTotAcc = 0;
-    m_iSumSqAcc = 0;
-    m_iSumSqFrameTime = 0;
-    m_trFrame = 0;          // hygiene - not really needed
-    m_trLate = 0;           // hygiene - not really needed
-    m_iSumFrameTime = 0;
-    m_nNormal = 0;
-    m_trEarliness = 0;
-    m_trTarget = -300000;  // 30mSec early
-    m_trThrottle = 0;
-    m_trRememberStampForPerf = 0;
 
     return NOERROR;
 } // ResetStreamingTimes
@@ -137,79 +110,11 @@ void CBaseVideoRenderer2::OnWaitEnd()
 } // OnWaitEnd
 
 
-// Put data on one side that describes the lateness of the current frame.
-// We don't yet know whether it will actually be drawn.  In direct draw mode,
-// this decision is up to the filter upstream, and it could change its mind.
-// The rules say that if it did draw it must call Receive().  One way or
-// another we eventually get into either OnRenderStart or OnDirectRender and
-// these both call RecordFrameLateness to update the statistics.
-
-void CBaseVideoRenderer2::PreparePerformanceData(int trLate, int trFrame)
-{
-    m_trLate = trLate;
-    m_trFrame = trFrame;
-} // PreparePerformanceData
-
-
-// update the statistics:
-// m_iTotAcc, m_iSumSqAcc, m_iSumSqFrameTime, m_iSumFrameTime, m_cFramesDrawn
-// Note that because the properties page reports using these variables,
-// 1. We need to be inside a critical section
-// 2. They must all be updated together.  Updating the sums here and the count
-// elsewhere can result in imaginary jitter (i.e. attempts to find square roots
-// of negative numbers) in the property page code.
-
-void CBaseVideoRenderer2::RecordFrameLateness(int trLate, int trFrame)
-{
-    // Record how timely we are.
-    int tLate = trLate/10000;
-
-    // Best estimate of moment of appearing on the screen is average of
-    // start and end draw times.  Here we have only the end time.  This may
-    // tend to show us as spuriously late by up to 1/2 frame rate achieved.
-    // Decoder probably monitors draw time.  We don't bother.
-
-    // This is a kludge - we can get frames that are very late
-    // especially (at start-up) and they invalidate the statistics.
-    // So ignore things that are more than 1 sec off.
-    if (tLate>1000 || tLate<-1000) {
-        if (m_cFramesDrawn<=1) {
-            tLate = 0;
-        } else if (tLate>0) {
-            tLate = 1000;
-        } else {
-            tLate = -1000;
-        }
-    }
-    // The very first frame often has a invalid time, so don't
-    // count it into the statistics.   (???)
-    if (m_cFramesDrawn>1) {
-        m_iTotAcc += tLate;
-        m_iSumSqAcc += (tLate*tLate);
-    }
-
-    // calculate inter-frame time.  Doesn't make sense for first frame
-    // second frame suffers from invalid first frame stamp.
-    if (m_cFramesDrawn>2) {
-        int tFrame = trFrame/10000;    // convert to mSec else it overflows
-
-        // This is a kludge.  It can overflow anyway (a pause can cause
-        // a very long inter-frame time) and it overflows at 2**31/10**7
-        // or about 215 seconds i.e. 3min 35sec
-        if (tFrame>1000||tFrame<0) tFrame = 1000;
-        m_iSumSqFrameTime += tFrame*tFrame;
-        ASSERT(m_iSumSqFrameTime>=0);
-        m_iSumFrameTime += tFrame;
-    }
-    ++m_cFramesDrawn;
-
-} // RecordFrameLateness
-
-
 void CBaseVideoRenderer2::ThrottleWait()
 {
-    if (m_trThrottle>0) {
-        int iThrottle = m_trThrottle/10000;    // convert to mSec
+    const int trThrottle = m_Scheduler.GetThrottle();
+    if (trThrottle>0) {
+        int iThrottle = trThrottle/10000;    // convert to mSec
         DbgLog((LOG_TRACE, 0, TEXT("Throttle %d ms"), iThrottle));
         Sleep(iThrottle);
     } else {
@@ -220,18 +125,13 @@ void CBaseVideoRenderer2::ThrottleWait()
 
 // Whenever a frame is rendered it goes though either OnRenderStart
 // or OnDirectRender.  Data that are generated during ShouldDrawSample
-// are added to the statistics by calling RecordFrameLateness from both
-// these two places.
+// are added to the statistics by the scheduler from both these two places.
 
 // Called in place of OnRenderStart..OnRenderEnd
 // When a DirectDraw image is drawn
 void CBaseVideoRenderer2::OnDirectRender(IMediaSample *pMediaSample)
 {
-    m_trRenderAvg = 0;
-    m_trRenderLast = 5000000;  // If we mode switch, we do NOT want this
-                               // to inhibit the new average getting going!
-                               // so we set it to half a second
-    RecordFrameLateness(m_trLate, m_trFrame);
+    m_Scheduler.OnDirectRender();
     ThrottleWait();
 } // OnDirectRender
 
@@ -242,7 +142,7 @@ void CBaseVideoRenderer2::OnDirectRender(IMediaSample *pMediaSample)
 
 void CBaseVideoRenderer2::OnRenderStart(IMediaSample *pMediaSample)
 {
-    RecordFrameLateness(m_trLate, m_trFrame);
+    m_Scheduler.OnRenderStart();
     m_tRenderStart = timeGetTime();
 } // OnRenderStart
 
@@ -254,16 +154,11 @@ void CBaseVideoRenderer2::OnRenderStart(IMediaSample *pMediaSample)
 
 void CBaseVideoRenderer2::OnRenderEnd(IMediaSample *pMediaSample)
 {
-    // The renderer time can vary erratically if we are interrupted so we do
-    // some smoothing to help get more sensible figures out but even that is
-    // not enough as figures can go 9,10,9,9,83,9 and we must disregard 83
+    // The renderer time can vary erratically if we are interrupted,
+    // the scheduler disregards odd looking spikes.
 
     int tr = (timeGetTime() - m_tRenderStart)*10000;   // convert mSec->UNITS
-	if (tr < m_trRenderAvg*32 || tr < m_trRenderLast*32) {
-		// But in reality, the rendering time can cyclically increase and decrease by 25 times. For example : 5 125 6 127 5 126.
-        m_trRenderAvg = (tr + (AVGPERIOD-1)*m_trRenderAvg)/AVGPERIOD;
-    }
-    m_trRenderLast = tr;
+    m_Scheduler.OnRenderEnd(tr);
     ThrottleWait();
 } // OnRenderEnd
 
@@ -314,12 +209,7 @@ STDMETHODIMP CBaseVideoRenderer2::Notify( IBaseFilter * pSelf, Quality q)
     // P60-ish machine).  The easy way to get these coefficients is to use
     // Renbase.xls follow the instructions therein using excel solver.
 
-    if (q.Proportion>=1000) { m_trThrottle = 0; }
-    else {
-        // The DWORD is to make quite sure I get unsigned arithmetic
-        // as the constant is between 2**31 and 2**32
-        m_trThrottle = -330000 + (388880000/(q.Proportion+167));
-    }
+    m_Scheduler.Notify(q.Proportion);
     return NOERROR;
 } // Notify
 
@@ -360,94 +250,19 @@ STDMETHODIMP CBaseVideoRenderer2::Notify( IBaseFilter * pSelf, Quality q)
 // the time stamps in the frames.  They get Quality.Late from us.
 //
 
-HRESULT CBaseVideoRenderer2::SendQuality(REFERENCE_TIME trLate,
-                                        REFERENCE_TIME trRealStream)
+HRESULT CBaseVideoRenderer2::SendQuality(const FrameQuality_t& fq)
 {
     Quality q;
     HRESULT hr;
 
+    // The message is made by the scheduler, see CFrameScheduler::GetQuality.
     // If we are the main user of time, then report this as Flood/Dry.
     // If our suppliers are, then report it as Famine/Glut.
-    //
-    // We need to take action, but avoid hunting.  Hunting is caused by
-    // 1. Taking too much action too soon and overshooting
-    // 2. Taking too long to react (so averaging can CAUSE hunting).
-    //
-    // The reason why we use trLate as well as Wait is to reduce hunting;
-    // if the wait time is coming down and about to go into the red, we do
-    // NOT want to rely on some average which is only telling is that it used
-    // to be OK once.
-
-    q.TimeStamp = (REFERENCE_TIME)trRealStream;
-
-    if (m_trFrameAvg<0) {
-        q.Type = Famine;      // guess
-    }
-    // Is the greater part of the time taken bltting or something else
-    else if (m_trFrameAvg > 2*m_trRenderAvg) {
-        q.Type = Famine;                        // mainly other
-    } else {
-        q.Type = Flood;                         // mainly bltting
-    }
-
-    q.Proportion = 1000;               // default
-
-    if (m_trFrameAvg<0) {
-        // leave it alone - we don't know enough
-    }
-    else if ( trLate> 0 ) {
-        // try to catch up over the next second
-        // We could be Really, REALLY late, but rendering all the frames
-        // anyway, just because it's so cheap.
-
-        q.Proportion = 1000 - (int)((trLate)/(UNITS/1000));
-        if (q.Proportion<500) {
-           q.Proportion = 500;      // don't go daft. (could've been negative!)
-        } else {
-        }
 
-    } else if (  m_trWaitAvg>20000
-              && trLate<-20000
-              ){
-        // Go cautiously faster - aim at 2mSec wait.
-        if (m_trWaitAvg>=m_trFrameAvg) {
-            // This can happen because of some fudges.
-            // The waitAvg is how long we originally planned to wait
-            // The frameAvg is more honest.
-            // It means that we are spending a LOT of time waiting
-            q.Proportion = 2000;    // double.
-        } else {
-            if (m_trFrameAvg+20000 > m_trWaitAvg) {
-                q.Proportion
-                    = 1000 * (m_trFrameAvg / (m_trFrameAvg + 20000 - m_trWaitAvg));
-            } else {
-                // We're apparently spending more than the whole frame time waiting.
-                // Assume that the averages are slightly out of kilter, but that we
-                // are indeed doing a lot of waiting.  (This leg probably never
-                // happens, but the code avoids any potential divide by zero).
-                q.Proportion = 2000;
-            }
-        }
-
-        if (q.Proportion>2000) {
-            q.Proportion = 2000;    // don't go crazy.
-        }
-    }
-
-    // Tell the supplier how late frames are when they get rendered
-    // That's how late we are now.
-    // If we are in directdraw mode then the guy upstream can see the drawing
-    // times and we'll just report on the start time.  He can figure out any
-    // offset to apply.  If we are in DIB Section mode then we will apply an
-    // extra offset which is half of our drawing time.  This is usually small
-    // but can sometimes be the dominant effect.  For this we will use the
-    // average drawing time rather than the last frame.  If the last frame took
-    // a long time to draw and made us late, that's already in the lateness
-    // figure.  We should not add it in again unless we expect the next frame
-    // to be the same.  We don't, we expect the average to be a better shot.
-    // In direct draw mode the RenderAvg will be zero.
-
-    q.Late = trLate + m_trRenderAvg/2;
+    q.Type = fq.bFlood ? Flood : Famine;
+    q.Proportion = fq.Proportion;
+    q.Late = fq.Late;
+    q.TimeStamp = fq.TimeStamp;
 
     // A specific sink interface may be set through IPin
 
@@ -481,10 +296,8 @@ HRESULT CBaseVideoRenderer2::SendQuality(REFERENCE_TIME trLate,
 // Return S_OK if it is to be drawn Now (as soon as possible)
 // Return S_FALSE if it is to be drawn when it's due
 // Return an error if we want to drop it
-// m_nNormal=-1 indicates that we dropped the previous frame and so this
-// one should be drawn early.  Respect it and update it.
-// Use current stream time plus a number of heuristics (detailed below)
-// to make the decision
+// Use current stream time plus a number of heuristics (detailed in
+// CFrameScheduler) to make the decision
 
 HRESULT CBaseVideoRenderer2::ShouldDrawSampleNow(IMediaSample *pMediaSample,
                                                 __inout REFERENCE_TIME *ptrStart,
@@ -494,262 +307,32 @@ HRESULT CBaseVideoRenderer2::ShouldDrawSampleNow(IMediaSample *pMediaSample,
     // Don't call us unless there's a clock interface to synchronise with
     ASSERT(m_pClock);
 
-    // We lose a bit of time depending on the monitor type waiting for the next
-    // screen refresh.  On average this might be about 8mSec - so it will be
-    // later than we think when the picture appears.  To compensate a bit
-    // we bias the media samples by -8mSec i.e. 80000 UNITs.
-    // We don't ever make a stream time negative (call it paranoia)
-    if (*ptrStart>=80000) {
-        *ptrStart -= 80000;
-        *ptrEnd -= 80000;       // bias stop to to retain valid frame duration
-    }
-
-    // Cache the time stamp now.  We will want to compare what we did with what
-    // we started with (after making the monitor allowance).
-    m_trRememberStampForPerf = *ptrStart;
-
     // Get reference times (current and late)
     REFERENCE_TIME trRealStream;     // the real time now expressed as stream time.
     m_pClock->GetTime(&trRealStream);
 
     trRealStream -= m_tStart;     // convert to stream time (this is a reftime)
 
-    // We have to wory about two versions of "lateness".  The truth, which we
-    // try to work out here and the one measured against m_trTarget which
-    // includes long term feedback.  We report statistics against the truth
-    // but for operational decisions we work to the target.
-    // We use TimeDiff to make sure we get an integer because we
-    // may actually be late (or more likely early if there is a big time
-    // gap) by a very long time.
-    const int trTrueLate = TimeDiff(trRealStream - *ptrStart);
-    const int trLate = trTrueLate;
-
-    // Send quality control messages upstream, measured against target
-    HRESULT hr = SendQuality(trLate, trRealStream);
-    // Note: the filter upstream is allowed to this FAIL meaning "you do it".
-    m_bSupplierHandlingQuality = (hr==S_OK);
-
-    // Decision time!  Do we drop, draw when ready or draw immediately?
-
-    const int trDuration = (int)(*ptrEnd - *ptrStart);
-    {
-        // We need to see if the frame rate of the file has just changed.
-        // This would make comparing our previous frame rate with the current
-        // frame rate inefficient.  Hang on a moment though.  I've seen files
-        // where the frames vary between 33 and 34 mSec so as to average
-        // 30fps.  A minor variation like that won't hurt us.
-        int t = m_trDuration/32;
-        if (  trDuration > m_trDuration+t
-           || trDuration < m_trDuration-t
-           ) {
-            // There's a major variation.  Reset the average frame rate to
-            // exactly the current rate to disable decision 9002 for this frame,
-            // and remember the new rate.
-            m_trFrameAvg = trDuration;
-            m_trDuration = trDuration;
-        }
-    }
-
-    // Control the graceful slide back from slow to fast machine mode.
-    // After a frame drop accept an early frame and set the earliness to here
-    // If this frame is already later than the earliness then slide it to here
-    // otherwise do the standard slide (reduce by about 12% per frame).
-    // Note: earliness is normally NEGATIVE
-    BOOL bJustDroppedFrame
-        = (  m_bSupplierHandlingQuality
-          //  Can't use the pin sample properties because we might
-          //  not be in Receive when we call this
-          && (S_OK == pMediaSample->IsDiscontinuity())          // he just dropped one
-          )
-       || (m_nNormal==-1);                          // we just dropped one
-
-
-    // Set m_trEarliness (slide back from slow to fast machine mode)
-    if (trLate>0) {
-        m_trEarliness = 0;   // we are no longer in fast machine mode at all!
-    } else if (  (trLate>=m_trEarliness) || bJustDroppedFrame) {
-        m_trEarliness = trLate;  // Things have slipped of their own accord
-    } else {
-        m_trEarliness = m_trEarliness - m_trEarliness/8;  // graceful slide
+    // The scheduler biases the media samples by -8mSec for the screen refresh,
+    // sends quality control messages upstream through us and decides
+    // whether we drop, draw when ready or draw immediately.
+    const auto decision = m_Scheduler.ShouldDrawSampleNow(
+        trRealStream,
+        //  Can't use the pin sample properties because we might
+        //  not be in Receive when we call this
+        S_OK == pMediaSample->IsDiscontinuity(),
+        *ptrStart, *ptrEnd,
+        [this](const FrameQuality_t& fq) {
+            // Note: the filter upstream is allowed to this FAIL meaning "you do it".
+            return SendQuality(fq) == S_OK;
+        });
+
+    switch (decision) {
+    case CFrameScheduler::DrawNow:    return S_OK;    // Draw it now
+    case CFrameScheduler::DrawAtTime: return S_FALSE; // Wait until it's due
+    default:                          return E_FAIL;  // drop it
     }
 
-    // prepare the new wait average - but don't pollute the old one until
-    // we have finished with it.
-    int trWaitAvg;
-    {
-        // We never mix in a negative wait.  This causes us to believe in fast machines
-        // slightly more.
-        int trL = trLate<0 ? -trLate : 0;
-        trWaitAvg = (trL + m_trWaitAvg*(AVGPERIOD-1))/AVGPERIOD;
-    }
-
-
-    int trFrame;
-    {
-        REFERENCE_TIME tr = trRealStream - m_trLastDraw; // Cd be large - 4 min pause!
-        if (tr>10000000) {
-            tr = 10000000;   // 1 second - arbitrarily.
-        }
-        trFrame = int(tr);
-    }
-
-    // We will DRAW this frame IF...
-    if (
-          // ...the time we are spending drawing is a small fraction of the total
-          // observed inter-frame time so that dropping it won't help much.
-          (3*m_trRenderAvg <= m_trFrameAvg)
-
-         // ...or our supplier is NOT handling things and the next frame would
-         // be less timely than this one or our supplier CLAIMS to be handling
-         // things, and is now less than a full FOUR frames late.
-       || ( m_bSupplierHandlingQuality
-          ? (trLate <= trDuration*4)
-          : (trLate+trLate < trDuration)
-          )
-
-          // ...or we are on average waiting for over eight milliseconds then
-          // this may be just a glitch.  Draw it and we'll hope to catch up.
-       || (m_trWaitAvg > 80000)
-
-          // ...or we haven't drawn an image for over a second.  We will update
-          // the display, which stops the video looking hung.
-          // Do this regardless of how late this media sample is.
-       || ((trRealStream - m_trLastDraw) > UNITS)
-
-    ) {
-        HRESULT Result;
-
-        // We are going to play this frame.  We may want to play it early.
-        // We will play it early if we think we are in slow machine mode.
-        // If we think we are NOT in slow machine mode, we will still play
-        // it early by m_trEarliness as this controls the graceful slide back.
-        // and in addition we aim at being m_trTarget late rather than "on time".
-
-        BOOL bPlayASAP = FALSE;
-
-        // we will play it AT ONCE (slow machine mode) if...
-
-            // ...we are playing catch-up
-        if ( bJustDroppedFrame) {
-            bPlayASAP = TRUE;
-        }
-
-            // ...or if we are running below the true frame rate
-            // exact comparisons are glitchy, for these measurements,
-            // so add an extra 5% or so
-        else if (  (m_trFrameAvg > trDuration + trDuration/16)
-
-                   // It's possible to get into a state where we are losing ground, but
-                   // are a very long way ahead.  To avoid this or recover from it
-                   // we refuse to play early by more than 10 frames.
-                && (trLate > - trDuration*10)
-                ){
-            bPlayASAP = TRUE;
-        }
-#if 0
-            // ...or if we have been late and are less than one frame early
-        else if (  (trLate + trDuration > 0)
-                && (m_trWaitAvg<=20000)
-                ) {
-            bPlayASAP = TRUE;
-        }
-#endif
-        // We will NOT play it at once if we are grossly early.  On very slow frame
-        // rate movies - e.g. clock.avi - it is not a good idea to leap ahead just
-        // because we got starved (for instance by the net) and dropped one frame
-        // some time or other.  If we are more than 900mSec early, then wait.
-        if (trLate<-9000000) {
-            bPlayASAP = FALSE;
-        }
-
-        if (bPlayASAP) {
-
-            m_nNormal = 0;
-            // When we are here, we are in slow-machine mode.  trLate may well
-            // oscillate between negative and positive when the supplier is
-            // dropping frames to keep sync.  We should not let that mislead
-            // us into thinking that we have as much as zero spare time!
-            // We just update with a zero wait.
-            m_trWaitAvg = (m_trWaitAvg*(AVGPERIOD-1))/AVGPERIOD;
-
-            // Assume that we draw it immediately.  Update inter-frame stats
-            m_trFrameAvg = (trFrame + m_trFrameAvg*(AVGPERIOD-1))/AVGPERIOD;
-
-            // If this is NOT a perf build, then report what we know so far
-            // without looking at the clock any more.  This assumes that we
-            // actually wait for exactly the time we hope to.  It also reports
-            // how close we get to the manipulated time stamps that we now have
-            // rather than the ones we originally started with.  It will
-            // therefore be a little optimistic.  However it's fast.
-            PreparePerformanceData(trTrueLate, trFrame);
-
-            m_trLastDraw = trRealStream;
-            if (m_trEarliness > trLate) {
-                m_trEarliness = trLate;  // if we are actually early, this is neg
-            }
-            Result = S_OK;                   // Draw it now
-
-        } else {
-            ++m_nNormal;
-            // Set the average frame rate to EXACTLY the ideal rate.
-            // If we are exiting slow-machine mode then we will have caught up
-            // and be running ahead, so as we slide back to exact timing we will
-            // have a longer than usual gap at this point.  If we record this
-            // real gap then we'll think that we're running slow and go back
-            // into slow-machine mode and vever get it straight.
-            m_trFrameAvg = trDuration;
-
-            // Play it early by m_trEarliness and by m_trTarget
-
-            {
-                int trE = m_trEarliness;
-                if (trE < -m_trFrameAvg) {
-                    trE = -m_trFrameAvg;
-                }
-                *ptrStart += trE;           // N.B. earliness is negative
-            }
-
-            int Delay = -trTrueLate;
-            Result = Delay<=0 ? S_OK : S_FALSE;     // OK = draw now, FALSE = wait
-
-            m_trWaitAvg = trWaitAvg;
-
-            // Predict when it will actually be drawn and update frame stats
-
-            if (Result==S_FALSE) {   // We are going to wait
-                trFrame = TimeDiff(*ptrStart-m_trLastDraw);
-                m_trLastDraw = *ptrStart;
-            } else {
-                // trFrame is already = trRealStream-m_trLastDraw;
-                m_trLastDraw = trRealStream;
-            }
-
-            int iAccuracy;
-            if (Delay>0) {
-                // Report lateness based on when we intend to play it
-                iAccuracy = TimeDiff(*ptrStart-m_trRememberStampForPerf);
-            } else {
-                // Report lateness based on playing it *now*.
-                iAccuracy = trTrueLate;     // trRealStream-RememberStampForPerf;
-            }
-            PreparePerformanceData(iAccuracy, trFrame);
-        }
-        return Result;
-    }
-
-    // We are going to drop this frame!
-    // Of course in DirectDraw mode the guy upstream may draw it anyway.
-
-    // This will probably give a large negative wack to the wait avg.
-    m_trWaitAvg = trWaitAvg;
-
-    // We are going to drop this frame so draw the next one early
-    // n.b. if the supplier is doing direct draw then he may draw it anyway
-    // but he's doing something funny to arrive here in that case.
-
-    m_nNormal = -1;
-    return E_FAIL;                         // drop it
-
 } // ShouldDrawSampleNow
 
 
@@ -773,7 +356,14 @@ BOOL CBaseVideoRenderer2::ScheduleSample(IMediaSample *pMediaSample)
 			StartTime = m_tRenderStart * 10000ll;
 		}
 	}
-	m_FrameStats.Add(StartTime); // do it for every input frame
+	bool bRepeatField = false;
+	if (CComQIPtr<IMediaSample2> pMS2 = pMediaSample) {
+		AM_SAMPLE2_PROPERTIES props;
+		if (SUCCEEDED(pMS2->GetProperties(sizeof(props), (BYTE*)&props))) {
+			bRepeatField = !!(props.dwTypeSpecificFlags & AM_VIDEO_FLAG_REPEAT_FIELD);
+		}
+	}
+	m_FrameStats.Add(StartTime, bRepeatField); // do it for every input frame
 
     BOOL bDrawImage = CBaseRenderer::ScheduleSample(pMediaSample);
     if (bDrawImage == FALSE) {
@@ -791,8 +381,8 @@ BOOL CBaseVideoRenderer2::ScheduleSample(IMediaSample *pMediaSample)
 		return FALSE;
     }
 
-    // m_cFramesDrawn must NOT be updated here.  It has to be updated
-    // in RecordFrameLateness at the same time as the other statistics.
+    // The count of drawn frames must NOT be updated here.  It is updated
+    // by the scheduler at the same time as the other statistics.
     return TRUE;
 }
 
@@ -854,66 +444,18 @@ STDMETHODIMP CBaseVideoRenderer2::get_AvgSyncOffset(__out int *piAvg)
     }
 
     // Note that we didn't gather the stats on the first frame
-    // so we use m_cFramesDrawn-1 here
-    if (m_cFramesDrawn<=1) {
-        *piAvg = 0;
-    } else {
-        *piAvg = (int)(m_iTotAcc / (m_cFramesDrawn-1));
-    }
+    *piAvg = (int)std::lround(m_Scheduler.GetSyncOffsetStats().Mean());
     return NOERROR;
 } // get_AvgSyncOffset
 
 
-// To avoid dragging in the maths library - a cheap
-// approximate integer square root.
-// We do this by getting a starting guess which is between 1
-// and 2 times too large, followed by THREE iterations of
-// Newton Raphson.  (That will give accuracy to the nearest mSec
-// for the range in question - roughly 0..1000)
-//
-// It would be faster to use a linear interpolation and ONE NR, but
-// who cares.  If anyone does - the best linear interpolation is
-// to approximates sqrt(x) by
-// y = x * (sqrt(2)-1) + 1 - 1/sqrt(2) + 1/(8*(sqrt(2)-1))
-// 0r y = x*0.41421 + 0.59467
-// This minimises the maximal error in the range in question.
-// (error is about +0.008883 and then one NR will give error .0000something
-// (Of course these are integers, so you can't just multiply by 0.41421
-// you'd have to do some sort of MulDiv).
-// Anyone wanna check my maths?  (This is only for a property display!)
-
-int isqrt_(int x)
-{
-    int s = 1;
-    // Make s an initial guess for sqrt(x)
-    if (x > 0x40000000) {
-       s = 0x8000;     // prevent any conceivable closed loop
-    } else {
-        while (s*s<x) {    // loop cannot possible go more than 31 times
-            s = 2*s;       // normally it goes about 6 times
-        }
-        // Three NR iterations.
-        if (x==0) {
-           s= 0; // Wouldn't it be tragic to divide by zero whenever our
-                 // accuracy was perfect!
-        } else {
-            s = (s*s+x)/(2*s);
-            if (s>0) s = (s*s+x)/(2*s);
-            if (s>0) s = (s*s+x)/(2*s);
-        }
-    }
-    return s;
-}
-
 //
 //  Do estimates for standard deviations for per-frame
 //  statistics
 //
 HRESULT CBaseVideoRenderer2::GetStdDev(
-    int nSamples,
-    __out int *piResult,
-    LONGLONG llSumSq,
-    LONGLONG iTot
+    const CRunningStats& stats,
+    __out int *piResult
 )
 {
     CheckPointer(piResult,E_POINTER);
@@ -924,24 +466,8 @@ HRESULT CBaseVideoRenderer2::GetStdDev(
         return NOERROR;
     }
 
-    // If S is the Sum of the Squares of observations and
-    //    T the Total (i.e. sum) of the observations and there were
-    //    N observations, then an estimate of the standard deviation is
-    //      sqrt( (S - T**2/N) / (N-1) )
-
-    if (nSamples<=1) {
-        *piResult = 0;
-    } else {
-        LONGLONG x;
-        // First frames have invalid stamps, so we get no stats for them
-        // So we need 2 frames to get 1 datum, so N is cFramesDrawn-1
-
-        // so we use m_cFramesDrawn-1 here
-        x = llSumSq - llMulDiv(iTot, iTot, nSamples, 0);
-        x = x / (nSamples-1);
-        ASSERT(x>=0);
-        *piResult = isqrt_((LONG)x);
-    }
+    // the statistics are kept in floating point (Welford), they do not overflow on long sessions
+    *piResult = (int)std::lround(stats.StdDev());
     return NOERROR;
 }
 
@@ -952,10 +478,7 @@ STDMETHODIMP CBaseVideoRenderer2::get_DevSyncOffset(__out int *piDev)
 {
     // First frames have invalid stamps, so we get no stats for them
     // So we need 2 frames to get 1 datum, so N is cFramesDrawn-1
-    return GetStdDev(m_cFramesDrawn - 1,
-                     piDev,
-                     m_iSumSqAcc,
-                     m_iTotAcc);
+    return GetStdDev(m_Scheduler.GetSyncOffsetStats(), piDev);
 } // get_DevSyncOffset
 
 
@@ -967,10 +490,7 @@ STDMETHODIMP CBaseVideoRenderer2::get_Jitter(__out int *piJitter)
     // First frames have invalid stamps, so we get no stats for them
     // So second frame gives invalid inter-frame time
     // So we need 3 frames to get 1 datum, so N is cFramesDrawn-2
-    return GetStdDev(m_cFramesDrawn - 2,
-                     piJitter,
-                     m_iSumSqFrameTime,
-                     m_iSumFrameTime);
+    return GetStdDev(m_Scheduler.GetFrameTimeStats(), piJitter);
 } // get_Jitter
 
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "FrameStats.h"
+#include "FrameScheduler.h"
 
 // based on CBaseVideoRenderer from DirectShow base classes
 
@@ -30,116 +31,13 @@ protected:
     //     tFoo is the time Foo in mSec (beware m_tStart from filter.h)
     //     trBar is the time Bar by the reference clock
 
-    //******************************************************************
-    // State variables to control synchronisation
-    //******************************************************************
-
-    // Control of sending Quality messages.  We need to know whether
-    // we are in trouble (e.g. frames being dropped) and where the time
-    // is being spent.
-
-    // When we drop a frame we play the next one early.
-    // The frame after that is likely to wait before drawing and counting this
-    // wait as spare time is unfair, so we count it as a zero wait.
-    // We therefore need to know whether we are playing frames early or not.
-
-    int m_nNormal;                  // The number of consecutive frames
-                                    // drawn at their normal time (not early)
-                                    // -1 means we just dropped a frame.
-
-    BOOL m_bSupplierHandlingQuality;// The response to Quality messages says
-                                    // our supplier is handling things.
-                                    // We will allow things to go extra late
-                                    // before dropping frames.  We will play
-                                    // very early after he has dropped one.
-
-    // Control of scheduling, frame dropping etc.
-    // We need to know where the time is being spent so as to tell whether
-    // we should be taking action here, signalling supplier or what.
-    // The variables are initialised to a mode of NOT dropping frames.
-    // They will tell the truth after a few frames.
-    // We typically record a start time for an event, later we get the time
-    // again and subtract to get the elapsed time, and we average this over
-    // a few frames.  The average is used to tell what mode we are in.
-
-    // Although these are reference times (64 bit) they are all DIFFERENCES
-    // between times which are small.  An int will go up to 214 secs before
-    // overflow.  Avoiding 64 bit multiplications and divisions seems
-    // worth while.
-
-
-
-    // Audio-video throttling.  If the user has turned up audio quality
-    // very high (in principle it could be any other stream, not just audio)
-    // then we can receive cries for help via the graph manager.  In this case
-    // we put in a wait for some time after rendering each frame.
-    int m_trThrottle;
-
-    // The time taken to render (i.e. BitBlt) frames controls which component
-    // needs to degrade.  If the blt is expensive, the renderer degrades.
-    // If the blt is cheap it's done anyway and the supplier degrades.
-    int m_trRenderAvg;              // Time frames are taking to blt
-    int m_trRenderLast;             // Time for last frame blt
+    // The drop/draw decisions and the statistics for the property page
+    // are made by the scheduler core, it does not depend on the clock.
+    CFrameScheduler m_Scheduler;
+
     int m_tRenderStart;             // Just before we started drawing (mSec)
                                     // derived from timeGetTime.
 
-    // When frames are dropped we will play the next frame as early as we can.
-    // If it was a false alarm and the machine is fast we slide gently back to
-    // normal timing.  To do this, we record the offset showing just how early
-    // we really are.  This will normally be negative meaning early or zero.
-    int m_trEarliness;
-
-    // Target provides slow long-term feedback to try to reduce the
-    // average sync offset to zero.  Whenever a frame is actually rendered
-    // early we add a msec or two, whenever late we take off a few.
-    // We add or take off 1/32 of the error time.
-    // Eventually we should be hovering around zero.  For a really bad case
-    // where we were (say) 300mSec off, it might take 100 odd frames to
-    // settle down.  The rate of change of this is intended to be slower
-    // than any other mechanism in Quartz, thereby avoiding hunting.
-    int m_trTarget;
-
-    // The proportion of time spent waiting for the right moment to blt
-    // controls whether we bother to drop a frame or whether we reckon that
-    // we're doing well enough that we can stand a one-frame glitch.
-    int m_trWaitAvg;                // Average of last few wait times
-                                    // (actually we just average how early
-                                    // we were).  Negative here means LATE.
-
-    // The average inter-frame time.
-    // This is used to calculate the proportion of the time used by the
-    // three operations (supplying us, waiting, rendering)
-    int m_trFrameAvg;               // Average inter-frame time
-    int m_trDuration;               // duration of last frame.
-
-    REFERENCE_TIME m_trRememberStampForPerf;  // original time stamp of frame
-                                              // with no earliness fudges etc.
-
-    // PROPERTY PAGE
-    // This has edit fields that show the user what's happening
-    // These member variables hold these counts.
-
-    //int m_cFramesDropped;         // cumulative frames dropped IN THE RENDERER
-    int m_cFramesDrawn;             // Frames since streaming started seen BY THE
-                                    // RENDERER (some may be dropped upstream)
-
-    // Next two support average sync offset and standard deviation of sync offset.
-    LONGLONG m_iTotAcc;                  // Sum of accuracies in mSec
-    LONGLONG m_iSumSqAcc;           // Sum of squares of (accuracies in mSec)
-
-    // Next two allow jitter calculation.  Jitter is std deviation of frame time.
-    REFERENCE_TIME m_trLastDraw;    // Time of prev frame (for inter-frame times)
-    LONGLONG m_iSumSqFrameTime;     // Sum of squares of (inter-frame time in mSec)
-    LONGLONG m_iSumFrameTime;            // Sum of inter-frame times in mSec
-
-    // To get performance statistics on frame rate, jitter etc, we need
-    // to record the lateness and inter-frame time.  What we actually need are the
-    // data above (sum, sum of squares and number of entries for each) but the data
-    // is generated just ahead of time and only later do we discover whether the
-    // frame was actually drawn or not.  So we have to hang on to the data
-    int m_trLate;                   // hold onto frame lateness
-    int m_trFrame;                  // hold onto inter-frame time
-
     int m_tStreamingStart;          // if streaming then time streaming started
                                     // else time of last streaming session
                                     // used for property page statistics
@@ -172,8 +70,6 @@ public:
 
     // Handle the statistics gathering for our quality management
 
-    void PreparePerformanceData(int trLate, int trFrame);
-    virtual void RecordFrameLateness(int trLate, int trFrame);
     virtual void OnDirectRender(IMediaSample *pMediaSample);
     virtual HRESULT ResetStreamingTimes();
 	HRESULT ResetStreamingTimes2();
@@ -182,22 +78,18 @@ public:
                                 __inout REFERENCE_TIME *ptrStart,
                                 __inout REFERENCE_TIME *ptrEnd);
 
-    virtual HRESULT SendQuality(REFERENCE_TIME trLate, REFERENCE_TIME trRealStream);
+    virtual HRESULT SendQuality(const FrameQuality_t& fq);
     STDMETHODIMP JoinFilterGraph(__inout_opt IFilterGraph * pGraph, __in_opt LPCWSTR pName);
 
     //
     //  Do estimates for standard deviations for per-frame
     //  statistics
     //
-    //  *piResult = (llSumSq - iTot * iTot / m_cFramesDrawn - 1) /
-    //                            (m_cFramesDrawn - 2)
-    //  or 0 if m_cFramesDrawn <= 3
+    //  or 0 if there are less than two samples
     //
     HRESULT GetStdDev(
-        int nSamples,
-        __out int *piResult,
-        LONGLONG llSumSq,
-        LONGLONG iTot
+        const CRunningStats& stats,
+        __out int *piResult
     );
 public:
 
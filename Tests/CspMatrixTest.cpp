@@ -0,0 +1,69 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "stdafx.h"
+#include <cstdio>
+#include "Test.h"
+#include "csputils.h"
+
+// The matrices that mp_get_csp_matrix() takes from the table computed at compile time
+// must be identical to the matrices computed at run time.
+
+int main()
+{
+	unsigned count = 0;
+	for (int csp = 0; csp < MP_CSP_COUNT; csp++) {
+		for (int lin = 0; lin < MP_CSP_LEVELS_COUNT; lin++) {
+			for (int lout = 0; lout < MP_CSP_LEVELS_COUNT; lout++) {
+				for (int bits = 8; bits <= 16; bits++) {
+					mp_csp_params params;
+					params.color.space  = (mp_csp)csp;
+					params.color.levels = (mp_csp_levels)lin;
+					params.levels_out   = (mp_csp_levels)lout;
+					params.input_bits = params.texture_bits = bits;
+
+					mp_cmat table, runtime;
+					mp_get_csp_matrix(&params, &table);
+					mp_calc_csp_matrix(&params, &runtime);
+
+					const bool bEqual = memcmp(&table, &runtime, sizeof(mp_cmat)) == 0;
+					if (!bEqual) {
+						std::printf("csp %d, levels %d -> %d, %d bits: the table is different\n", csp, lin, lout, bits);
+					}
+					CHECK(bEqual);
+					count++;
+				}
+			}
+		}
+	}
+	std::printf("%u matrices compared\n", count);
+
+	// the ProcAmp values are not in the table
+	mp_csp_params params;
+	params.contrast = 1.5f;
+	mp_cmat contrast, def;
+	mp_get_csp_matrix(&params, &contrast);
+	params.contrast = 1.0f;
+	mp_get_csp_matrix(&params, &def);
+	CHECK_NEAR(contrast.m[0][0], def.m[0][0] * 1.5f, 1e-6);
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,292 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "stdafx.h"
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include "FrameSchedulerSim.h"
+
+void SimAddFrames(std::vector<SimFrame_t>& trace, const unsigned count, const double fps)
+{
+	const double start = trace.size() ? (double)trace.back().end : 0.0;
+	const double duration = UNITS / fps;
+
+	trace.reserve(trace.size() + count);
+	for (unsigned i = 0; i < count; i++) {
+		SimFrame_t frame;
+		frame.start = std::llround(start + duration * i);
+		frame.end   = std::llround(start + duration * (i + 1));
+		trace.emplace_back(frame);
+	}
+}
+
+void SimAddStall(std::vector<SimFrame_t>& trace, const unsigned frameIndex, const REFERENCE_TIME stall)
+{
+	if (frameIndex < trace.size()) {
+		trace[frameIndex].stall += stall;
+	}
+}
+
+bool SimLoadTrace(std::vector<SimFrame_t>& trace, const wchar_t* filename)
+{
+	std::ifstream file{ std::filesystem::path(filename) };
+	if (!file) {
+		return false;
+	}
+
+	std::vector<REFERENCE_TIME> timestamps;
+	long long timestamp;
+	while (file >> timestamp) {
+		timestamps.emplace_back(timestamp);
+	}
+	if (timestamps.size() < 2) {
+		return false;
+	}
+
+	for (size_t i = 0; i + 1 < timestamps.size(); i++) {
+		SimFrame_t frame;
+		frame.start = timestamps[i];
+		frame.end   = timestamps[i + 1];
+		trace.emplace_back(frame);
+	}
+
+	return true;
+}
+
+SchedulerSimResult_t SimulateFrameScheduling(const std::vector<SimFrame_t>& trace, const SchedulerSimConfig_t& config)
+{
+	SchedulerSimResult_t result;
+	result.frames = (unsigned)trace.size();
+
+	CFrameScheduler scheduler;
+	scheduler.Reset();
+
+	// the vsync period measured by the reference clock
+	const double vsyncPeriod = UNITS / config.refreshRate * (1.0 + config.clockDriftPpm * 1e-6);
+	auto VsyncTime = [&](const int64_t index) {
+		return config.vsyncPhase + vsyncPeriod * index;
+	};
+	auto FirstVsyncAfter = [&](const double time) {
+		return (int64_t)std::ceil((time - config.vsyncPhase) / vsyncPeriod);
+	};
+
+	struct Presented_t {
+		size_t frame;
+		int64_t vsync;
+	};
+	std::vector<Presented_t> presented;
+	presented.reserve(trace.size());
+
+	REFERENCE_TIME now = 0;
+	bool bSupplierDrop = false;
+	bool bDiscontinuity = false;
+
+	for (size_t i = 0; i < trace.size(); i++) {
+		const auto& frame = trace[i];
+		now += frame.stall;
+
+		if (bSupplierDrop) {
+			bSupplierDrop = false;
+			bDiscontinuity = true;
+			result.droppedUpstream++;
+			continue;
+		}
+
+		REFERENCE_TIME trStart = frame.start;
+		REFERENCE_TIME trEnd = frame.end;
+		const auto decision = scheduler.ShouldDrawSampleNow(now, bDiscontinuity, trStart, trEnd,
+			[&](const FrameQuality_t& q) {
+				if (config.bSupplierHandlesQuality && q.Late > frame.end - frame.start) {
+					bSupplierDrop = true;
+				}
+				return config.bSupplierHandlesQuality;
+			});
+		bDiscontinuity = false;
+
+		if (decision == CFrameScheduler::Drop) {
+			result.dropped++;
+			continue;
+		}
+		if (decision == CFrameScheduler::DrawAtTime) {
+			now = std::max(now, trStart); // the clock advise
+		}
+
+		scheduler.OnRenderStart();
+		const REFERENCE_TIME drawStart = now;
+		const double presentTime = (double)(now + config.renderTime);
+
+		int64_t vsync = FirstVsyncAfter(presentTime);
+		double presentEnd = presentTime;
+		if (presented.size()) {
+			// one queued frame, Present waits until the previous frame is on the screen
+			const int64_t prevVsync = presented.back().vsync;
+			vsync = std::max(vsync, prevVsync + 1);
+			presentEnd = std::max(presentEnd, VsyncTime(prevVsync));
+		}
+		presented.push_back({ i, vsync });
+
+		now = (REFERENCE_TIME)std::ceil(presentEnd);
+		scheduler.OnRenderEnd((int)(now - drawStart));
+	}
+
+	result.presented = (unsigned)presented.size();
+
+	double sumErr = 0, sumSqErr = 0;
+	double sumOffset = 0, sumSqOffset = 0;
+	unsigned countErr = 0;
+
+	for (size_t j = 0; j < presented.size(); j++) {
+		const auto& frame = trace[presented[j].frame];
+
+		const double offset = (VsyncTime(presented[j].vsync) - frame.start) / 10000.0;
+		sumOffset += offset;
+		sumSqOffset += offset * offset;
+		result.syncOffsetMaxMs = std::max(result.syncOffsetMaxMs, std::abs(offset));
+
+		if (j + 1 < presented.size()) {
+			const int64_t shown = presented[j + 1].vsync - presented[j].vsync;
+			const double ideal = (frame.end - frame.start) / vsyncPeriod;
+			const int64_t maxShown = (int64_t)std::ceil(ideal - 1e-3);
+			if (shown > maxShown) {
+				result.repeats += (unsigned)(shown - maxShown);
+			}
+
+			const double err = (shown * vsyncPeriod - (frame.end - frame.start)) / 10000.0;
+			sumErr += err;
+			sumSqErr += err * err;
+			countErr++;
+		}
+	}
+
+	if (countErr) {
+		const double avg = sumErr / countErr;
+		result.judderMs = std::sqrt(std::max(0.0, sumSqErr / countErr - avg * avg));
+	}
+	if (presented.size()) {
+		const double n = (double)presented.size();
+		result.syncOffsetAvgMs = sumOffset / n;
+		result.syncOffsetDevMs = std::sqrt(std::max(0.0, sumSqOffset / n - result.syncOffsetAvgMs * result.syncOffsetAvgMs));
+	}
+
+	return result;
+}
+
+void SimAddSeek(std::vector<SimFrame_t>& trace, const unsigned frameIndex, const REFERENCE_TIME gap)
+{
+	for (size_t i = frameIndex; i < trace.size(); i++) {
+		trace[i].start += gap;
+		trace[i].end   += gap;
+	}
+}
+
+CadenceSimResult_t SimulateCadencePlanning(const std::vector<SimFrame_t>& trace, const CadenceSimConfig_t& config)
+{
+	CadenceSimResult_t result;
+	result.frames = (unsigned)trace.size();
+	result.shown.reserve(trace.size());
+
+	CCadencePlanner planner;
+	planner.Reset();
+	const REFERENCE_TIME nominalPeriod = std::llround(UNITS / config.refreshRate);
+
+	// the vsyncs are counted on the reference clock, the stream time is the reference clock minus streamOffset
+	const double vsyncPeriod = UNITS / config.refreshRate * (1.0 + config.clockDriftPpm * 1e-6);
+	auto VsyncTime = [&](const int64_t index) {
+		return config.vsyncPhase + vsyncPeriod * index;
+	};
+	auto FirstVsyncAfter = [&](const double time) {
+		return (int64_t)std::ceil((time - config.vsyncPhase) / vsyncPeriod);
+	};
+
+	double clock = 0;
+	double streamOffset = 0;
+	int64_t reportedVsync = INT64_MIN;
+	int64_t shownVsync = INT64_MIN;
+
+	// the counters of the planner before the last Reset()
+	unsigned late = 0, repeats = 0, drops = 0;
+
+	for (size_t i = 0; i < trace.size(); i++) {
+		const auto& frame = trace[i];
+
+		if (i && frame.start != trace[i - 1].end) {
+			// the stream time restarts at the new timestamps
+			streamOffset = clock - frame.start;
+			if (config.bResetOnSeek) {
+				late += planner.GetLate();
+				repeats += planner.GetRepeats();
+				drops += planner.GetDrops();
+				planner.Reset();
+			}
+		}
+		clock += frame.stall;
+
+		const int64_t lastVsync = FirstVsyncAfter(clock) - 1;
+		if (lastVsync > reportedVsync) {
+			planner.AddVsync(std::llround(VsyncTime(lastVsync) - streamOffset));
+			reportedVsync = lastVsync;
+		}
+
+		const unsigned corrections = planner.GetRepeats() + planner.GetDrops();
+		planner.SetRates(nominalPeriod, frame.end - frame.start);
+
+		const double now = clock - streamOffset;
+		REFERENCE_TIME presentTime;
+		const auto plan = planner.PlanFrame(frame.start, std::llround(now), presentTime);
+
+		if (result.firstCorrection == SIZE_MAX && planner.GetRepeats() + planner.GetDrops() > corrections) {
+			result.firstCorrection = i;
+		}
+		if (plan == CCadencePlanner::Plan_Skip) {
+			result.skipped++;
+			continue;
+		}
+		if (plan == CCadencePlanner::Plan_None) {
+			// the renderer waits until half a vsync before the frame start
+			result.unplanned++;
+			presentTime = frame.start - nominalPeriod / 2;
+		}
+		clock = std::max(clock, presentTime + streamOffset);
+
+		const double presentEnd = clock + config.renderTime;
+		int64_t vsync = FirstVsyncAfter(presentEnd);
+		if (shownVsync != INT64_MIN) {
+			// one queued frame, Present waits until the previous frame is on the screen
+			vsync = std::max(vsync, shownVsync + 1);
+			clock = std::max(presentEnd, VsyncTime(shownVsync));
+		} else {
+			clock = presentEnd;
+		}
+		shownVsync = vsync;
+
+		const double syncOffset = (VsyncTime(vsync) - streamOffset - frame.start) / vsyncPeriod;
+		result.shown.push_back({ i, vsync, syncOffset, planner.GetPlannedVsyncs() });
+	}
+
+	result.presented = (unsigned)result.shown.size();
+	result.late    = late + planner.GetLate();
+	result.repeats = repeats + planner.GetRepeats();
+	result.drops   = drops + planner.GetDrops();
+	result.cadence = planner.GetCadenceString();
+	result.bLocked = planner.IsLocked();
+
+	return result;
+}
@@ -0,0 +1,113 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include "FrameScheduler.h"
+#include "CadencePlanner.h"
+
+//
+// Offline simulator of the frame scheduling. A timestamp trace is replayed through
+// CFrameScheduler against a virtual reference clock and a virtual vsync, without
+// any Windows API, so scheduling changes can be compared on any platform.
+//
+// The model: the decoder delivers the next frame as soon as the previous one is
+// scheduled (plus the stall of the frame), a frame is drawn now or at its corrected
+// start time, Present takes renderTime and blocks until the previously presented frame
+// is on the screen, a presented frame is shown from the first vsync after Present.
+//
+// The simulator is a part of FrameSchedulerSimTest, it is not built into the renderer.
+//
+// SimulateCadencePlanning() replays a trace through CCadencePlanner the same way:
+// the vsyncs that passed are reported with AddVsync(), a frame is presented at the planned
+// time or now if it is late, and it is shown from the first vsync after Present.
+//
+
+struct SimFrame_t {
+	REFERENCE_TIME start = 0;
+	REFERENCE_TIME end   = 0;
+	REFERENCE_TIME stall = 0; // decoder delay before this frame is delivered
+};
+
+struct SchedulerSimConfig_t {
+	double refreshRate   = 60.0;  // Hz
+	double clockDriftPpm = 0.0;   // positive - the display is slower than the reference clock
+	REFERENCE_TIME vsyncPhase = 0;       // time of the first vsync
+	REFERENCE_TIME renderTime = 30000;   // time of Process and Present
+	bool bSupplierHandlesQuality = false; // the decoder drops a frame when the quality message is late by more than a frame
+};
+
+struct SchedulerSimResult_t {
+	unsigned frames    = 0; // frames in the trace
+	unsigned presented = 0;
+	unsigned dropped   = 0; // dropped by the scheduler
+	unsigned droppedUpstream = 0; // dropped by the simulated decoder
+	unsigned repeats   = 0; // vsyncs a frame was shown longer than its duration rounded up to whole vsyncs
+	double judderMs    = 0; // standard deviation of the difference between display time and frame duration
+	double syncOffsetAvgMs = 0; // first vsync of a frame minus its timestamp
+	double syncOffsetDevMs = 0;
+	double syncOffsetMaxMs = 0; // max absolute value
+};
+
+// Trace generators, the frames are appended to the trace.
+// Frame timestamps are rounded to 100 ns like the timestamps from splitters.
+void SimAddFrames(std::vector<SimFrame_t>& trace, const unsigned count, const double fps);
+void SimAddStall(std::vector<SimFrame_t>& trace, const unsigned frameIndex, const REFERENCE_TIME stall);
+
+// Loads a recorded trace, a text file with one start time in 100 ns units per line.
+// The end time of a frame is the start time of the next frame.
+bool SimLoadTrace(std::vector<SimFrame_t>& trace, const wchar_t* filename);
+
+SchedulerSimResult_t SimulateFrameScheduling(const std::vector<SimFrame_t>& trace, const SchedulerSimConfig_t& config);
+
+struct CadenceSimConfig_t {
+	double refreshRate   = 60.0;  // Hz, the nominal rate passed to SetRates()
+	double clockDriftPpm = 0.0;   // positive - the display is slower than the reference clock
+	REFERENCE_TIME vsyncPhase = 0;       // time of the first vsync
+	REFERENCE_TIME renderTime = 30000;   // time of Process and Present
+	bool bResetOnSeek = true; // a jump of the timestamps is a seek, the renderer calls Reset() and the stream time restarts
+};
+
+struct CadenceSimFrame_t {
+	size_t frame;
+	int64_t vsync;          // the first vsync the frame is shown on
+	double syncOffset;      // time of that vsync minus the frame start in vsyncs
+	unsigned plannedVsyncs; // GetPlannedVsyncs() after the frame, 0 when the plan was (re)started
+};
+
+struct CadenceSimResult_t {
+	unsigned frames    = 0; // frames in the trace
+	unsigned presented = 0;
+	unsigned skipped   = 0; // Plan_Skip
+	unsigned unplanned = 0; // Plan_None
+	unsigned late      = 0; // counters of the planner, summed over the seeks
+	unsigned repeats   = 0;
+	unsigned drops     = 0;
+	size_t firstCorrection = SIZE_MAX; // index of the first frame with a repeat or a drop
+	std::wstring cadence;   // GetCadenceString() at the end
+	bool bLocked = false;   // IsLocked() at the end
+	std::vector<CadenceSimFrame_t> shown;
+};
+
+// A gap between the end of a frame and the start of the next one, the following frames are moved
+// by the gap, like after a seek.
+void SimAddSeek(std::vector<SimFrame_t>& trace, const unsigned frameIndex, const REFERENCE_TIME gap);
+
+CadenceSimResult_t SimulateCadencePlanning(const std::vector<SimFrame_t>& trace, const CadenceSimConfig_t& config);
@@ -0,0 +1,303 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "stdafx.h"
+#include "Test.h"
+#include "FrameSchedulerSim.h"
+
+// Replays the standard scenarios through CFrameScheduler and CCadencePlanner.
+// A recorded trace (one start time in 100 ns units per line) can be passed as the argument,
+// its result is printed for 23.976 and 60 Hz.
+
+static SchedulerSimResult_t Run(const char* name, const std::vector<SimFrame_t>& trace, const SchedulerSimConfig_t& config)
+{
+	const auto r = SimulateFrameScheduling(trace, config);
+	std::printf("%s: frames %u, presented %u, dropped %u + %u upstream, repeats %u, judder %.2f ms, sync offset %.2f ms (dev %.2f, max %.2f)\n",
+		name, r.frames, r.presented, r.dropped, r.droppedUpstream, r.repeats,
+		r.judderMs, r.syncOffsetAvgMs, r.syncOffsetDevMs, r.syncOffsetMaxMs);
+	return r;
+}
+
+static std::vector<SimFrame_t> Frames(const double fps, const double seconds = 60)
+{
+	std::vector<SimFrame_t> trace;
+	SimAddFrames(trace, (unsigned)(fps * seconds), fps);
+	return trace;
+}
+
+static CadenceSimResult_t RunCadence(const char* name, const std::vector<SimFrame_t>& trace, const CadenceSimConfig_t& config)
+{
+	const auto r = SimulateCadencePlanning(trace, config);
+	std::printf("%s: frames %u, presented %u, skipped %u, unplanned %u, late %u, cadence %ls +%u/-%u\n",
+		name, r.frames, r.presented, r.skipped, r.unplanned, r.late, r.cadence.c_str(), r.repeats, r.drops);
+	return r;
+}
+
+static CadenceSimConfig_t CadenceConfig(const double refreshRate, const double clockDriftPpm = 0)
+{
+	CadenceSimConfig_t config;
+	config.refreshRate = refreshRate;
+	config.clockDriftPpm = clockDriftPpm;
+	return config;
+}
+
+// vsyncs between the shown frames, the frames of the trace from firstFrame
+static std::vector<int64_t> ShownIntervals(const CadenceSimResult_t& r, const size_t firstFrame = 0)
+{
+	std::vector<int64_t> intervals;
+	for (size_t j = 1; j < r.shown.size(); j++) {
+		if (r.shown[j - 1].frame >= firstFrame) {
+			intervals.emplace_back(r.shown[j].vsync - r.shown[j - 1].vsync);
+		}
+	}
+	return intervals;
+}
+
+static double MaxSyncOffset(const CadenceSimResult_t& r, const size_t firstFrame = 0)
+{
+	double maxOffset = 0;
+	for (const auto& shown : r.shown) {
+		if (shown.frame >= firstFrame) {
+			maxOffset = std::max(maxOffset, std::abs(shown.syncOffset));
+		}
+	}
+	return maxOffset;
+}
+
+static SchedulerSimConfig_t Config(const double refreshRate)
+{
+	SchedulerSimConfig_t config;
+	config.refreshRate = refreshRate;
+	return config;
+}
+
+// every frame is presented, no vsync is repeated beyond the frame duration
+static void CheckSmooth(const SchedulerSimResult_t& r)
+{
+	CHECK(r.presented == r.frames);
+	CHECK(r.dropped == 0);
+	CHECK(r.droppedUpstream == 0);
+	CHECK(r.repeats == 0);
+}
+
+int main(int argc, char* argv[])
+{
+	const double fps23 = 24000.0 / 1001;
+
+	{
+		// 3:2 cadence, the display time alternates between 50 and 33.3 ms
+		const auto r = Run("23.976 fps on 60 Hz", Frames(fps23), Config(60.0));
+		CheckSmooth(r);
+		CHECK_NEAR(r.judderMs, 1000.0 / 120, 0.1);
+		CHECK(r.syncOffsetMaxMs <= 1000.0 / 60 + 0.01);
+	}
+	{
+		const auto r = Run("23.976 fps on 59.94 Hz", Frames(fps23), Config(60000.0 / 1001));
+		CheckSmooth(r);
+		CHECK_NEAR(r.judderMs, 1001.0 / 120, 0.1);
+		CHECK(r.syncOffsetMaxMs <= 1001.0 / 60 + 0.01);
+	}
+	{
+		const auto r = Run("25 fps on 50 Hz", Frames(25.0), Config(50.0));
+		CheckSmooth(r);
+		CHECK(r.judderMs < 1.0);
+	}
+	{
+		// the frame misses its own vsync by the render time and is shown one vsync later, constantly
+		const auto r = Run("24 fps on 24 Hz", Frames(24.0), Config(24.0));
+		CheckSmooth(r);
+		CHECK(r.judderMs < 0.01);
+		CHECK(r.syncOffsetDevMs < 0.01);
+		CHECK(r.syncOffsetMaxMs <= 1000.0 / 24 + 0.01);
+	}
+	for (const double drift : { 100.0, -100.0 }) {
+		// 6 ms in a minute, less than a vsync, so nothing is repeated or dropped yet
+		auto config = Config(24.0);
+		config.clockDriftPpm = drift;
+		const auto r = Run(drift > 0 ? "24 fps on 24 Hz, drift +100 ppm" : "24 fps on 24 Hz, drift -100 ppm", Frames(24.0), config);
+		CheckSmooth(r);
+		CHECK(r.judderMs < 0.01);
+		CHECK(r.syncOffsetDevMs < 2.0);
+	}
+	{
+		std::vector<SimFrame_t> trace;
+		for (int i = 0; i < 6; i++) {
+			SimAddFrames(trace, 240, 24.0);
+			SimAddFrames(trace, 300, 30.0);
+		}
+		const auto r = Run("VFR 24/30 fps on 60 Hz", trace, Config(60.0));
+		CheckSmooth(r);
+		CHECK(r.judderMs < 1000.0 / 120);
+		CHECK(r.syncOffsetMaxMs <= 1000.0 / 60 + 0.01);
+	}
+	{
+		// the last frame stays on the screen during a stall, the frames are not dropped to catch up
+		auto trace = Frames(fps23);
+		unsigned stalls = 0;
+		for (unsigned i = 240; i < trace.size(); i += 240) {
+			SimAddStall(trace, i, 2000000);
+			stalls++;
+		}
+		const auto r = Run("23.976 fps on 60 Hz, 200 ms stalls", trace, Config(60.0));
+		CHECK(r.presented == r.frames);
+		CHECK(r.dropped == 0);
+		CHECK(r.repeats > 0);
+		CHECK(r.repeats <= stalls * 12); // 200 ms is 12 vsyncs
+		CHECK(r.syncOffsetMaxMs < 200.0);
+	}
+	{
+		// rendering is slower than the vsync, frames are dropped so the video does not fall behind
+		auto config = Config(60.0);
+		config.renderTime = 200000;
+		const auto r = Run("60 fps on 60 Hz, 20 ms render", Frames(60.0), config);
+		CHECK(r.presented + r.dropped + r.droppedUpstream == r.frames);
+		CHECK(r.dropped > 0);
+		CHECK(r.droppedUpstream == 0);
+		CHECK(r.presented >= r.frames / 2);
+		CHECK(r.syncOffsetMaxMs <= 2000.0 / 60 + 0.01);
+
+		// the decoder drops the frames instead of the renderer
+		config.bSupplierHandlesQuality = true;
+		const auto r2 = Run("60 fps on 60 Hz, 20 ms render, supplier drops", Frames(60.0), config);
+		CHECK(r2.presented + r2.dropped + r2.droppedUpstream == r2.frames);
+		CHECK(r2.dropped == 0);
+		CHECK(r2.droppedUpstream > 0);
+		CHECK(r2.syncOffsetMaxMs <= 2000.0 / 60 + 0.01);
+	}
+
+	// CCadencePlanner, the first frames are not planned until a vsync is measured
+
+	{
+		// 2:3 without a correction, the rates are exact
+		const auto r = RunCadence("cadence 23.976 fps on 59.94 Hz", Frames(fps23), CadenceConfig(60000.0 / 1001));
+		CHECK(r.cadence == L"2:3");
+		CHECK(r.bLocked);
+		CHECK(r.presented == r.frames);
+		CHECK(r.unplanned == 1);
+		CHECK(r.skipped == 0 && r.late == 0);
+		CHECK(r.repeats == 0 && r.drops == 0);
+		const auto intervals = ShownIntervals(r, 1);
+		bool bCadence = true;
+		for (size_t j = 1; j < intervals.size(); j++) {
+			bCadence &= intervals[j] + intervals[j - 1] == 5 && (intervals[j] == 2 || intervals[j] == 3);
+		}
+		CHECK(bCadence);
+		CHECK(MaxSyncOffset(r, 1) < 1.0);
+	}
+	for (const double drift : { 1000.0, -1000.0 }) {
+		// 0.1% is a vsync every 1000 vsyncs, it is absorbed by single drops or repeats,
+		// the first one when the error of the cycle reaches kCorrectionThreshold
+		const double fps = 24000.0 / 1001, refreshRate = 60000.0 / 1001;
+		auto config = CadenceConfig(refreshRate, drift);
+		config.vsyncPhase = std::llround(UNITS / refreshRate * 3 / 4); // the error of the cycle is 0 after the lock
+		const auto r = RunCadence(drift > 0 ? "cadence 23.976 fps on 59.94 Hz, drift +1000 ppm" : "cadence 23.976 fps on 59.94 Hz, drift -1000 ppm",
+			Frames(fps, 120), config);
+		CHECK(r.cadence == L"2:3");
+		CHECK(r.presented == r.frames);
+		CHECK(r.skipped == 0 && r.late == 0);
+
+		const double vsyncs = 120 * refreshRate * 1e-3; // 7.2, the clock difference
+		const unsigned corrections = (unsigned)(vsyncs + 1 - CCadencePlanner::kCorrectionThreshold);
+		CHECK((drift > 0 ? r.drops : r.repeats) == corrections);
+		CHECK((drift > 0 ? r.repeats : r.drops) == 0);
+
+		const double correctionFrame = CCadencePlanner::kCorrectionThreshold / (std::abs(drift) * 1e-6) * fps / refreshRate;
+		CHECK_NEAR((double)r.firstCorrection, correctionFrame, correctionFrame * 0.1);
+
+		// a correction is one frame shown a vsync shorter or longer
+		unsigned changed = 0;
+		for (const auto interval : ShownIntervals(r, 1)) {
+			if (interval != 2 && interval != 3) {
+				CHECK(interval == (drift > 0 ? 1 : 4));
+				changed++;
+			}
+		}
+		CHECK(changed <= corrections);
+		CHECK(MaxSyncOffset(r, 1) <= 1.0);
+	}
+	{
+		// a 100 ms stall, the frame misses the planned vsync and is shown later,
+		// the planner stays locked and returns to the cadence
+		auto trace = Frames(fps23);
+		SimAddStall(trace, 240, 1000000);
+		const auto r = RunCadence("cadence 23.976 fps on 59.94 Hz, 100 ms stall", trace, CadenceConfig(60000.0 / 1001));
+		CHECK(r.presented == r.frames);
+		CHECK(r.skipped == 0);
+		CHECK(r.late >= 1);
+		CHECK(r.bLocked);
+		CHECK(r.cadence == L"2:3");
+		CHECK(r.repeats == 0 && r.drops <= 1); // a drop brings the cadence back to the timestamps
+		CHECK(MaxSyncOffset(r, 1) > 2.0);
+		CHECK(MaxSyncOffset(r, 480) < 1.0);
+	}
+	{
+		// one vsync per frame, a drop can only be made by not presenting a frame
+		const auto r = RunCadence("cadence 60 fps on 60 Hz, drift +1000 ppm", Frames(60.0, 120), CadenceConfig(60.0, 1000));
+		CHECK(r.cadence == L"1");
+		CHECK(r.skipped > 0);
+		CHECK(r.skipped == r.drops);
+		CHECK(r.presented + r.skipped == r.frames);
+		CHECK(r.repeats == 0);
+		// one vsync is the frame in the queue, the first frames were not planned and filled it
+		CHECK(MaxSyncOffset(r, 1) < 1.0 + CCadencePlanner::kCorrectionThreshold + 0.05);
+	}
+	for (const bool bReset : { true, false }) {
+		// a seek 10 minutes ahead, the stream time restarts at a new vsync phase
+		auto trace = Frames(fps23, 20);
+		SimAddSeek(trace, 240, 6000000000 + 12345);
+		auto config = CadenceConfig(60000.0 / 1001);
+		config.bResetOnSeek = bReset;
+		const auto r = RunCadence(bReset ? "cadence 23.976 fps on 59.94 Hz, seek" : "cadence 23.976 fps on 59.94 Hz, seek without Reset()", trace, config);
+		CHECK(r.bLocked);
+		CHECK(r.cadence == L"2:3");
+		CHECK(r.repeats == 0 && r.drops == 0);
+
+		// the plan is restarted after the seek and continues with the cadence
+		size_t relock = 0;
+		bool bCadence = true;
+		for (const auto& shown : r.shown) {
+			if (shown.frame >= 240) {
+				if (!shown.plannedVsyncs) {
+					relock = shown.frame;
+				} else {
+					bCadence &= shown.plannedVsyncs == 2 || shown.plannedVsyncs == 3;
+				}
+			}
+		}
+		CHECK(relock >= 240 && relock < 245);
+		CHECK(bCadence);
+		CHECK(r.unplanned == (bReset ? 3u : 1u)); // without a measured vsync after Reset()
+		CHECK(MaxSyncOffset(r, 250) < 1.0);
+	}
+
+	if (argc > 1) {
+		std::vector<SimFrame_t> trace;
+		const std::string filename(argv[1]);
+		if (!SimLoadTrace(trace, std::wstring(filename.begin(), filename.end()).c_str())) {
+			std::printf("Failed to load %s\n", argv[1]);
+			return 1;
+		}
+		Run("Trace on 60 Hz", trace, Config(60.0));
+		Run("Trace on 23.976 Hz", trace, Config(fps23));
+	}
+
+	return TEST_RESULT();
+}
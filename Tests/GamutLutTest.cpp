@@ -0,0 +1,217 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "stdafx.h"
+#include <cstdio>
+#include "Test.h"
+#include "GamutLut.h"
+
+// The LUT is compared with the exact gamut compression at points between the grid nodes,
+// the texture is sampled in the same way as the shader does it.
+
+static void SampleLut(float out[3], const std::vector<float>& lut, const float src[3])
+{
+	int i0[3];
+	float f[3];
+	for (int c = 0; c < 3; c++) {
+		const float pos = std::pow(std::clamp(src[c], 0.0f, 1.0f), 1.0f / GAMUT_LUT_GAMMA) * (GAMUT_LUT_SIZE - 1);
+		i0[c] = std::min((int)pos, GAMUT_LUT_SIZE - 2);
+		f[c] = pos - i0[c];
+	}
+
+	out[0] = out[1] = out[2] = 0.0f;
+	for (int corner = 0; corner < 8; corner++) {
+		float weight = 1.0f;
+		size_t index = 0;
+		size_t stride = 1;
+		for (int c = 0; c < 3; c++) {
+			const int bit = (corner >> c) & 1;
+			weight *= bit ? f[c] : 1.0f - f[c];
+			index += (i0[c] + bit) * stride;
+			stride *= GAMUT_LUT_SIZE;
+		}
+		for (int c = 0; c < 3; c++) {
+			out[c] += weight * lut[index * 3 + c];
+		}
+	}
+}
+
+static void Multiply(float out[3], const float (&m)[3][3], const float in[3])
+{
+	for (int i = 0; i < 3; i++) {
+		out[i] = m[i][0] * in[0] + m[i][1] * in[1] + m[i][2] * in[2];
+	}
+}
+
+static float MaxDiff(const float a[3], const float b[3])
+{
+	return std::max({ std::abs(a[0] - b[0]), std::abs(a[1] - b[1]), std::abs(a[2] - b[2]) });
+}
+
+// hue angle in degrees in the plane orthogonal to the achromatic axis of the target RGB,
+// false for nearly achromatic or black colors
+static bool Hue(float& angle, const float rgb[3])
+{
+	const float x = rgb[0] - 0.5f * (rgb[1] + rgb[2]);
+	const float y = 0.8660254f * (rgb[1] - rgb[2]);
+	const float peak = std::max({ rgb[0], rgb[1], rgb[2] });
+	if (peak < 0.01f || x * x + y * y < (0.05f * peak) * (0.05f * peak)) {
+		return false;
+	}
+	angle = std::atan2(y, x) * (180.0f / 3.14159265f);
+	return true;
+}
+
+static float HueDiff(const float a, const float b)
+{
+	const float d = std::abs(a - b);
+	return d > 180.0f ? 360.0f - d : d;
+}
+
+struct Result_t {
+	unsigned inGamut = 0;
+	unsigned protectedColors = 0;
+	unsigned outOfGamut = 0;
+	float maxProtectedChange = 0; // the exact compression of colors below the thresholds
+	float maxInGamutChange = 0;   // the exact compression of all in-gamut colors
+	float maxInGamutLutError = 0; // LUT against the exact compression
+	float maxProtectedLutError = 0;
+	float maxInteriorLutError = 0; // one grid cell away from the thresholds and the gamut boundary
+	double avgProtectedLutError = 0;
+	float maxOutOfGamutLutError = 0;
+	double avgOutOfGamutLutError = 0;
+	float maxOutOfRange = 0;
+	float maxHueShift = 0; // the exact compression against the unclipped color
+	float maxHueShiftLut = 0;
+};
+
+static Result_t Measure(const mp_csp_prim csp_in, const mp_csp_prim csp_out)
+{
+	const CGamutCompression compression(csp_in, csp_out);
+	const auto& lut = GetGamutCompressionLut(csp_in, csp_out);
+
+	Result_t result;
+	uint32_t seed = 12345;
+	auto Random = [&]() {
+		seed = seed * 1664525u + 1013904223u;
+		return (float)(seed >> 8) / (float)(1u << 24);
+	};
+
+	for (int n = 0; n < 200000; n++) {
+		// gamma encoded like the LUT address, so the dark colors are sampled as densely as the grid
+		const float src[3] = {
+			std::pow(Random(), GAMUT_LUT_GAMMA),
+			std::pow(Random(), GAMUT_LUT_GAMMA),
+			std::pow(Random(), GAMUT_LUT_GAMMA),
+		};
+
+		float linear[3], exact[3], sampled[3];
+		Multiply(linear, compression.GetMatrix(), src);
+		compression.Convert(exact, src);
+		SampleLut(sampled, lut, src);
+
+		const float lutError = MaxDiff(exact, sampled);
+		for (int c = 0; c < 3; c++) {
+			result.maxOutOfRange = std::max({ result.maxOutOfRange, -sampled[c], sampled[c] - 1.0f });
+		}
+
+		const float ach = std::max({ linear[0], linear[1], linear[2] });
+		const bool bInGamut = linear[0] >= 0.0f && linear[1] >= 0.0f && linear[2] >= 0.0f && ach <= 1.0f;
+		if (bInGamut) {
+			result.inGamut++;
+			result.maxInGamutChange = std::max(result.maxInGamutChange, MaxDiff(linear, exact));
+			result.maxInGamutLutError = std::max(result.maxInGamutLutError, lutError);
+
+			bool bProtected = ach > 0.0f;
+			bool bInterior = bProtected && ach < 0.9f;
+			for (int c = 0; c < 3 && bProtected; c++) {
+				const float dist = (ach - linear[c]) / ach;
+				bProtected = dist < compression.GetThreshold(c);
+				bInterior = bInterior && dist < compression.GetThreshold(c) - 0.1f;
+			}
+			if (bInterior) {
+				result.maxInteriorLutError = std::max(result.maxInteriorLutError, lutError);
+			}
+			if (bProtected) {
+				result.protectedColors++;
+				result.maxProtectedChange = std::max(result.maxProtectedChange, MaxDiff(linear, exact));
+				result.maxProtectedLutError = std::max(result.maxProtectedLutError, lutError);
+				result.avgProtectedLutError += lutError;
+			}
+		} else {
+			result.outOfGamut++;
+			result.maxOutOfGamutLutError = std::max(result.maxOutOfGamutLutError, lutError);
+			result.avgOutOfGamutLutError += lutError;
+
+			float hueSrc, hueExact, hueLut;
+			if (ach <= 1.0f && Hue(hueSrc, linear)) {
+				if (Hue(hueExact, exact)) {
+					result.maxHueShift = std::max(result.maxHueShift, HueDiff(hueSrc, hueExact));
+				}
+				if (Hue(hueLut, sampled)) {
+					result.maxHueShiftLut = std::max(result.maxHueShiftLut, HueDiff(hueSrc, hueLut));
+				}
+			}
+		}
+	}
+	if (result.outOfGamut) {
+		result.avgOutOfGamutLutError /= result.outOfGamut;
+	}
+	if (result.protectedColors) {
+		result.avgProtectedLutError /= result.protectedColors;
+	}
+
+	std::printf("primaries %d -> %d: thresholds %.3f %.3f %.3f\n", (int)csp_in, (int)csp_out,
+		compression.GetThreshold(0), compression.GetThreshold(1), compression.GetThreshold(2));
+	std::printf("  in gamut %u, max change %.6f, LUT max error %.5f\n",
+		result.inGamut, result.maxInGamutChange, result.maxInGamutLutError);
+	std::printf("  below the thresholds %u, max change %.6f, LUT error avg %.5f max %.5f (interior %.5f)\n",
+		result.protectedColors, result.maxProtectedChange, result.avgProtectedLutError, result.maxProtectedLutError, result.maxInteriorLutError);
+	std::printf("  out of gamut %u, LUT error avg %.5f max %.5f, max hue shift %.2f (LUT %.2f), out of range %.6f\n",
+		result.outOfGamut, result.avgOutOfGamutLutError, result.maxOutOfGamutLutError, result.maxHueShift, result.maxHueShiftLut, result.maxOutOfRange);
+
+	return result;
+}
+
+int main()
+{
+	for (const auto csp_in : { MP_CSP_PRIM_BT_2020, MP_CSP_PRIM_DCI_P3 }) {
+		const Result_t result = Measure(csp_in, MP_CSP_PRIM_BT_709);
+
+		CHECK(result.inGamut > 1000);
+		CHECK(result.protectedColors > 1000);
+		CHECK(result.outOfGamut > 1000);
+
+		// the colors below the thresholds are not touched, the LUT adds only the interpolation error
+		CHECK(result.maxProtectedChange < 1e-5f);
+		CHECK(result.avgProtectedLutError < 0.002);
+		CHECK(result.maxInteriorLutError < 0.002f);
+		// in the cells crossing the knee or the gamut boundary the error grows to a few percent
+		CHECK(result.maxInGamutLutError < 0.04f);
+		CHECK(result.avgOutOfGamutLutError < 0.003);
+		CHECK(result.maxOutOfGamutLutError < 0.04f);
+		CHECK(result.maxOutOfRange < 1e-5f);
+		// the compression moves the colors toward the achromatic axis, the hue is kept
+		CHECK(result.maxHueShift < 25.0f);
+		CHECK_NEAR(result.maxHueShiftLut, result.maxHueShift, 1.0f);
+	}
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,99 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "stdafx.h"
+#include <intrin.h>
+#include <chrono>
+#include <thread>
+#include "Test.h"
+#include "Times.h"
+
+// Measures the cost of a read of QueryPerformanceCounter, the TSC and GetPreciseTick(),
+// and the drift of the TSC from QueryPerformanceCounter after the calibration.
+// The timings are printed, only gross errors fail the test.
+
+static const int kReads = 1000000;
+
+template <typename F>
+static double NanosecondsPerRead(F read)
+{
+	uint64_t sum = 0;
+	const auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < kReads; i++) {
+		sum += read();
+	}
+	const auto end = std::chrono::steady_clock::now();
+	CHECK(sum != 0);
+	return std::chrono::duration<double, std::nano>(end - start).count() / kReads;
+}
+
+int main()
+{
+	const auto calibrationStart = std::chrono::steady_clock::now();
+	const double ticksPerSecond = GetPreciseTicksPerSecond();
+	const double calibrationMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - calibrationStart).count();
+	std::printf("tick source : %s, %.0f Hz, calibrated in %.1f ms\n", IsPreciseTickTSC() ? "TSC" : "QPC", ticksPerSecond, calibrationMs);
+
+	LARGE_INTEGER qpcFrequency;
+	QueryPerformanceFrequency(&qpcFrequency);
+	CHECK(ticksPerSecond >= (double)qpcFrequency.QuadPart);
+	CHECK_NEAR(GetPreciseSecondsPerTick() * ticksPerSecond, 1.0, 1e-9);
+	CHECK(GetPreciseTicksPerSecondI() == (uint64_t)ticksPerSecond);
+
+	const double qpcNs = NanosecondsPerRead([] {
+		LARGE_INTEGER li;
+		QueryPerformanceCounter(&li);
+		return (uint64_t)li.QuadPart;
+	});
+	const double tscNs = NanosecondsPerRead([] { return (uint64_t)__rdtsc(); });
+	const double preciseNs = NanosecondsPerRead([] { return GetPreciseTick(); });
+	std::printf("QueryPerformanceCounter : %.1f ns per read\n", qpcNs);
+	std::printf("__rdtsc                 : %.1f ns per read\n", tscNs);
+	std::printf("GetPreciseTick          : %.1f ns per read\n", preciseNs);
+
+	uint64_t last = GetPreciseTick();
+	bool monotonic = true;
+	for (int i = 0; i < kReads; i++) {
+		const uint64_t tick = GetPreciseTick();
+		monotonic &= tick >= last;
+		last = tick;
+	}
+	CHECK(monotonic);
+
+	// one second of sleep measured in ticks and on the steady clock
+	const uint64_t tick0 = GetPreciseTick();
+	const auto clock0 = std::chrono::steady_clock::now();
+	std::this_thread::sleep_for(std::chrono::seconds(1));
+	const uint64_t tick1 = GetPreciseTick();
+	const auto clock1 = std::chrono::steady_clock::now();
+	const double tickSeconds = (tick1 - tick0) * GetPreciseSecondsPerTick();
+	const double clockSeconds = std::chrono::duration<double>(clock1 - clock0).count();
+	CHECK_NEAR(tickSeconds, clockSeconds, 0.001);
+
+	const double drift = CheckPreciseTickSource();
+	std::printf("drift from QueryPerformanceCounter : %+.2f ppm\n", drift);
+	if (!IsPreciseTickTSC()) {
+		CHECK(drift == 0);
+	}
+	CHECK(std::abs(drift) < 1000);
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,139 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "stdafx.h"
+#include "Test.h"
+#include "RefreshRateEstimator.h"
+
+static const double kRate = 60000.0 / 1001; // 59.94 Hz
+
+// deterministic pseudo-random numbers in [-1, 1)
+static double Noise(uint32_t& seed)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return (double)(seed >> 8) / (1u << 23) - 1.0;
+}
+
+static void CheckRate(const CRefreshRateEstimator& estimator, const double tolerance, const double maxError)
+{
+	double rate, rateError;
+	CHECK(estimator.GetRate(rate, rateError));
+	CHECK_NEAR(rate, kRate, tolerance);
+	CHECK(rateError >= 0 && rateError < maxError);
+}
+
+static void TestJitter()
+{
+	// time stamps are taken by a thread that wakes up up to 0.5 ms late
+	CRefreshRateEstimator estimator;
+	estimator.SetNominalRate(60.0);
+	uint32_t seed = 1;
+	for (uint32_t i = 1; i <= 1000; i++) {
+		estimator.AddVsync(100.0 + i / kRate + 0.00025 * (Noise(seed) + 1.0), i);
+	}
+	CheckRate(estimator, 0.002, 0.001);
+}
+
+static void TestOutliers()
+{
+	// every 8th time stamp is 4 ms late, the Huber weights keep them from moving the rate,
+	// but they still widen the error
+	CRefreshRateEstimator estimator;
+	estimator.SetNominalRate(60.0);
+	uint32_t seed = 2;
+	for (uint32_t i = 1; i <= 1000; i++) {
+		double time = 100.0 + i / kRate + 0.00002 * Noise(seed);
+		if (i % 8 == 0) {
+			time += 0.004;
+		}
+		estimator.AddVsync(time, i);
+	}
+	CheckRate(estimator, 0.0002, 0.002);
+}
+
+static void TestMissedVsyncs()
+{
+	// the refresh counter shows the missed vsyncs
+	{
+		CRefreshRateEstimator estimator;
+		estimator.SetNominalRate(60.0);
+		for (uint32_t i = 1; i <= 1500; i++) {
+			if (i % 7 != 0 && i % 11 != 0) {
+				estimator.AddVsync(100.0 + i / kRate, i);
+			}
+		}
+		CheckRate(estimator, 1e-6, 1e-6);
+	}
+
+	// without the counter the vsyncs are numbered with the nominal rate, then with the estimate
+	{
+		CRefreshRateEstimator estimator;
+		estimator.SetNominalRate(60.0);
+		uint32_t seed = 3;
+		for (uint32_t i = 1; i <= 1500; i++) {
+			if (i % 7 != 0 && i % 11 != 0 && i % 13 != 0) {
+				estimator.AddVsync(100.0 + i / kRate + 0.0001 * Noise(seed), 0);
+			}
+		}
+		CheckRate(estimator, 0.0005, 0.0005);
+	}
+}
+
+static void TestRepeatsAndPauses()
+{
+	CRefreshRateEstimator estimator;
+	estimator.SetNominalRate(60.0);
+	double rate, rateError;
+
+	uint32_t count = 1;
+	for (; count < CRefreshRateEstimator::kMinSamples; count++) {
+		estimator.AddVsync(100.0 + count / kRate, count);
+		estimator.AddVsync(100.0 + count / kRate + 0.001, count); // the same vsync again
+	}
+	CHECK(!estimator.GetRate(rate, rateError)); // repeated time stamps are not counted
+
+	for (; count <= 300; count++) {
+		estimator.AddVsync(100.0 + count / kRate, count);
+	}
+	CheckRate(estimator, 1e-6, 1e-6);
+
+	// a long pause starts a new estimate
+	estimator.AddVsync(200.0, count + 100);
+	CHECK(!estimator.GetRate(rate, rateError));
+
+	// a different display mode
+	for (uint32_t i = 1; i <= 300; i++) {
+		estimator.AddVsync(300.0 + i / kRate, i);
+	}
+	CheckRate(estimator, 1e-6, 1e-6);
+	estimator.SetNominalRate(50.0);
+	CHECK(!estimator.GetRate(rate, rateError));
+}
+
+int main()
+{
+	TestJitter();
+	TestOutliers();
+	TestMissedVsyncs();
+	TestRepeatsAndPauses();
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,221 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "stdafx.h"
+#include "Test.h"
+#include "RenderGraph.h"
+
+static const RenderTexDesc_t kWindow = { 10, 1920, 1080, 8 }; // format, width, height, bytes per pixel
+static const RenderTexDesc_t kResize = { 10, 1920, 720, 8 };
+
+// does any pass write the physical texture of tex while tex is still read later
+static bool IsOverwrittenWhileAlive(const CRenderGraph& graph, const int tex)
+{
+	const auto& passes = graph.GetActivePasses();
+	const int physical = graph.GetPhysicalIndex(tex);
+
+	int first = -1;
+	int last = -1;
+	for (int i = 0; i < (int)passes.size(); i++) {
+		if (passes[i].output == tex) {
+			first = i;
+		}
+		if (passes[i].input == tex) {
+			last = i;
+		}
+	}
+	for (int i = first + 1; i <= last; i++) {
+		const int output = passes[i].output;
+		if (output != tex && output != CRenderGraph::External && graph.GetPhysicalIndex(output) == physical) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void TestChain()
+{
+	// post-scale steps, two textures are enough for any number of them
+	CRenderGraph graph;
+	int input = CRenderGraph::External;
+	std::vector<int> texs;
+	for (int i = 0; i < 5; i++) {
+		const int tex = graph.AddTexture(kWindow);
+		graph.AddPass(L"step", i, input, tex);
+		texs.push_back(tex);
+		input = tex;
+	}
+	graph.AddPass(L"final", 5, input, CRenderGraph::External);
+
+	CHECK(graph.Compile());
+	CHECK(graph.GetActivePasses().size() == 6);
+	CHECK(graph.GetPhysicalCount() == 2);
+	CHECK(graph.GetPhysicalCount(kWindow) == 2);
+	CHECK(graph.GetAllocatedBytes() == 2 * kWindow.Bytes());
+	CHECK(graph.GetUnaliasedBytes() == 5 * kWindow.Bytes());
+	CHECK(graph.GetPeakBytes() == 2 * kWindow.Bytes());
+
+	for (size_t i = 0; i < texs.size(); i++) {
+		CHECK(graph.GetPhysicalIndex(texs[i]) != CRenderGraph::External);
+		CHECK(!IsOverwrittenWhileAlive(graph, texs[i]));
+		if (i > 0) {
+			// a pass never reads and writes the same texture
+			CHECK(graph.GetPhysicalIndex(texs[i]) != graph.GetPhysicalIndex(texs[i - 1]));
+		}
+	}
+
+	// the operations are kept in order
+	for (int i = 0; i < 6; i++) {
+		CHECK(graph.GetActivePasses()[i].op == i);
+	}
+}
+
+static void TestNoOp()
+{
+	CRenderGraph graph;
+	const int convert = graph.AddTexture(kWindow);
+	const int resized = graph.AddTexture(kWindow);
+	const int corrected = graph.AddTexture(kWindow);
+	graph.AddPass(L"convert", 0, CRenderGraph::External, convert);
+	graph.AddPass(L"resize", 1, convert, resized, true);
+	graph.AddPass(L"correction", 2, resized, corrected);
+	graph.AddPass(L"final", 3, corrected, CRenderGraph::External);
+
+	CHECK(graph.Compile());
+	const auto& passes = graph.GetActivePasses();
+	CHECK(passes.size() == 3);
+	// the pass after the removed one reads its input
+	CHECK(passes[1].op == 2 && passes[1].input == convert);
+	CHECK(graph.GetPhysicalIndex(resized) == CRenderGraph::External);
+	CHECK(graph.GetPhysicalCount() == 2);
+
+	// a no-op pass to the render target must copy
+	CRenderGraph copy;
+	const int tex = copy.AddTexture(kWindow);
+	copy.AddPass(L"convert", 0, CRenderGraph::External, tex);
+	copy.AddPass(L"resize", 1, tex, CRenderGraph::External, true);
+	CHECK(copy.Compile());
+	CHECK(copy.GetActivePasses().size() == 2);
+}
+
+static void TestLifetimes()
+{
+	// textures of different sizes are never aliased
+	{
+		CRenderGraph graph;
+		const int a0 = graph.AddTexture(kWindow);
+		const int b0 = graph.AddTexture(kResize);
+		const int a1 = graph.AddTexture(kWindow);
+		const int b1 = graph.AddTexture(kResize);
+		graph.AddPass(L"0", 0, CRenderGraph::External, a0);
+		graph.AddPass(L"1", 1, a0, b0);
+		graph.AddPass(L"2", 2, b0, a1);
+		graph.AddPass(L"3", 3, a1, b1);
+		graph.AddPass(L"4", 4, b1, CRenderGraph::External);
+
+		CHECK(graph.Compile());
+		CHECK(graph.GetPhysicalCount() == 2);
+		CHECK(graph.GetPhysicalIndex(a0) == graph.GetPhysicalIndex(a1));
+		CHECK(graph.GetPhysicalIndex(b0) == graph.GetPhysicalIndex(b1));
+		CHECK(graph.GetPhysicalDesc(graph.GetPhysicalIndex(a0)) == kWindow);
+		CHECK(graph.GetPhysicalDesc(graph.GetPhysicalIndex(b0)) == kResize);
+	}
+
+	// a texture that is read again later keeps its physical texture until then
+	{
+		CRenderGraph graph;
+		const int t0 = graph.AddTexture(kWindow);
+		const int t1 = graph.AddTexture(kWindow);
+		const int t2 = graph.AddTexture(kWindow);
+		const int t3 = graph.AddTexture(kWindow);
+		graph.AddPass(L"0", 0, CRenderGraph::External, t0);
+		graph.AddPass(L"1", 1, t0, t1);
+		graph.AddPass(L"2", 2, t1, t2);
+		graph.AddPass(L"3", 3, t0, t3);
+		graph.AddPass(L"4", 4, t3, CRenderGraph::External);
+
+		CHECK(graph.Compile());
+		for (const int tex : { t0, t1, t2, t3 }) {
+			CHECK(!IsOverwrittenWhileAlive(graph, tex));
+		}
+		CHECK(graph.GetPhysicalIndex(t2) != graph.GetPhysicalIndex(t0));
+		CHECK(graph.GetPhysicalIndex(t3) == graph.GetPhysicalIndex(t1));
+		CHECK(graph.GetPhysicalCount() == 3);
+		CHECK(graph.GetPeakBytes() == 3 * kWindow.Bytes());
+	}
+}
+
+static void TestImported()
+{
+	// an imported texture has no physical texture and is not reused for the intermediates
+	CRenderGraph graph;
+	const int imported = graph.ImportTexture(kWindow);
+	const int t0 = graph.AddTexture(kWindow);
+	const int t1 = graph.AddTexture(kWindow);
+	const int t2 = graph.AddTexture(kWindow);
+	graph.AddPass(L"convert", 0, CRenderGraph::External, imported);
+	graph.AddPass(L"1", 1, imported, t0);
+	graph.AddPass(L"2", 2, t0, t1);
+	graph.AddPass(L"3", 3, t1, t2);
+	graph.AddPass(L"4", 4, t2, CRenderGraph::External);
+
+	CHECK(graph.Compile());
+	CHECK(graph.IsImported(imported));
+	CHECK(!graph.IsImported(t0));
+	CHECK(graph.GetPhysicalIndex(imported) == CRenderGraph::External);
+	CHECK(graph.GetPhysicalCount() == 2);
+	CHECK(graph.GetPhysicalIndex(t2) == graph.GetPhysicalIndex(t0));
+
+	// a no-op pass to an imported texture is kept
+	CRenderGraph noop;
+	const int tex = noop.ImportTexture(kWindow);
+	noop.AddPass(L"convert", 0, CRenderGraph::External, tex, true);
+	noop.AddPass(L"resize", 1, tex, CRenderGraph::External);
+	CHECK(noop.Compile());
+	CHECK(noop.GetActivePasses().size() == 2);
+}
+
+static void TestErrors()
+{
+	CRenderGraph graph;
+	const int t0 = graph.AddTexture(kWindow);
+	const int t1 = graph.AddTexture(kWindow);
+	graph.AddPass(L"read before write", 0, t1, t0);
+	graph.AddPass(L"write", 1, CRenderGraph::External, t1);
+	CHECK(!graph.Compile());
+
+	graph.Reset();
+	const int t2 = graph.AddTexture(kWindow);
+	graph.AddPass(L"write", 0, CRenderGraph::External, t2);
+	graph.AddPass(L"write again", 1, CRenderGraph::External, t2);
+	CHECK(!graph.Compile());
+}
+
+int main()
+{
+	TestChain();
+	TestNoOp();
+	TestLifetimes();
+	TestImported();
+	TestErrors();
+
+	return TEST_RESULT();
+}
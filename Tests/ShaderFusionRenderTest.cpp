@@ -0,0 +1,338 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "stdafx.h"
+#include <d3d11.h>
+#include <d3dcompiler.h>
+#include <wrl/client.h>
+#include "Test.h"
+#include "ShaderFusion.h"
+
+// The shaders are rendered one after another and as one fused shader on the WARP device,
+// the results must be the same.
+
+using Microsoft::WRL::ComPtr;
+
+static const UINT kSize = 16;
+
+static const char kVertexShader[] = R"(
+struct VS_OUTPUT { float4 pos : SV_POSITION; float2 coord : TEXCOORD; };
+VS_OUTPUT main(uint id : SV_VertexID)
+{
+	VS_OUTPUT output;
+	output.coord = float2((id << 1) & 2, id & 2);
+	output.pos = float4(output.coord * float2(2, -2) + float2(-1, 1), 0, 1);
+	return output;
+}
+)";
+
+// the standard declarations of the post-scale shaders
+static const char kDeclarations[] = R"(
+Texture2D tex : register(t0);
+SamplerState samp : register(s0);
+cbuffer PS_CONSTANTS : register(b0)
+{
+	float2 pxy;
+	float2 wh;
+	uint counter;
+	float clock;
+};
+)";
+
+struct Constants_t {
+	float pxy[2];
+	float wh[2];
+	UINT counter;
+	float clock;
+	float padding[2];
+};
+
+struct TestShader_t {
+	const char* code;
+	std::vector<std::string> args;
+};
+
+// macros with the names of the other shaders
+static const TestShader_t kShaderA = { R"(
+#define width (wh.x)
+#define Adjust(c) (1.0 - (c))
+float4 main(float4 pos : SV_POSITION, float2 coord : TEXCOORD) : SV_Target
+{
+	float4 c = tex.Sample(samp, coord);
+	c.rgb = Adjust(c.rgb) * (width / 16.0);
+	return c;
+}
+)", { "pos", "coord" } };
+
+// a local variable, a function and a global constant
+static const TestShader_t kShaderB = { R"(
+static const float3 luma = { 0.299, 0.587, 0.114 };
+float3 Adjust(float3 c) { return dot(c, luma); }
+float4 main(float2 coord : TEXCOORD) : SV_Target
+{
+	float width = pxy.x * 16.0;
+	float4 c = tex.Sample(samp, coord);
+	return float4(Adjust(c.rgb) * 0.5 + c.rgb * 0.5, c.a * width);
+}
+)", { "coord" } };
+
+// the position and the integer constants
+static const TestShader_t kShaderC = { R"(
+float4 main(float4 pos : SV_POSITION, float2 coord : TEXCOORD) : SV_Target
+{
+	float4 c = tex.Sample(samp, coord);
+	c.r += frac(pos.x / 4.0) * 0.1 + counter * 0.01 + clock * 0.001;
+	c.g *= coord.y;
+	return c;
+}
+)", { "pos", "coord" } };
+
+// the result is out of [0, 1], a UNORM texture clamps it
+static const TestShader_t kShaderD = { R"(
+float4 main(float2 coord : TEXCOORD) : SV_Target
+{
+	float4 c = tex.Sample(samp, coord);
+	c.rgb = c.rgb * 3.0 - 1.0;
+	return c;
+}
+)", { "coord" } };
+
+struct Device_t {
+	ComPtr<ID3D11Device> device;
+	ComPtr<ID3D11DeviceContext> context;
+	ComPtr<ID3D11VertexShader> vertexShader;
+	ComPtr<ID3D11SamplerState> sampler;
+	ComPtr<ID3D11Buffer> constants;
+};
+
+struct Texture_t {
+	ComPtr<ID3D11Texture2D> texture;
+	ComPtr<ID3D11ShaderResourceView> srv;
+	ComPtr<ID3D11RenderTargetView> rtv;
+};
+
+static ComPtr<ID3DBlob> Compile(const std::string& code, const char* target)
+{
+	ComPtr<ID3DBlob> pShaderCode;
+	ComPtr<ID3DBlob> pErrors;
+	if (FAILED(D3DCompile(code.data(), code.size(), nullptr, nullptr, nullptr, "main", target, 0, 0, &pShaderCode, &pErrors))) {
+		std::printf("%s\n", pErrors ? (const char*)pErrors->GetBufferPointer() : "D3DCompile() failed");
+		return nullptr;
+	}
+	return pShaderCode;
+}
+
+static ComPtr<ID3D11PixelShader> CreatePixelShader(Device_t& dev, const std::string& code)
+{
+	ComPtr<ID3D11PixelShader> pShader;
+	ComPtr<ID3DBlob> pShaderCode = Compile(code, "ps_4_0");
+	if (pShaderCode) {
+		dev.device->CreatePixelShader(pShaderCode->GetBufferPointer(), pShaderCode->GetBufferSize(), nullptr, &pShader);
+	}
+	return pShader;
+}
+
+// the description that GetPointwisePixelShader() gets from the reflection of these shaders
+static PointwiseShader_t GetPointwiseShader(const TestShader_t& test)
+{
+	const std::string srcCode = std::string(kDeclarations) + test.code;
+
+	PointwiseShader_t shader;
+	ComPtr<ID3DBlob> pCode;
+	if (SUCCEEDED(D3DPreprocess(srcCode.data(), srcCode.size(), nullptr, nullptr, nullptr, &pCode, nullptr))) {
+		shader.code.assign((const char*)pCode->GetBufferPointer(), pCode->GetBufferSize());
+		while (shader.code.size() && shader.code.back() == '\0') {
+			shader.code.pop_back();
+		}
+	}
+	shader.texName = "tex";
+	shader.args = test.args;
+	shader.constants = {
+		{ "pxy",     "fused_cb[0].xy" },
+		{ "wh",      "fused_cb[0].zw" },
+		{ "counter", "asuint(fused_cb[1].x)" },
+		{ "clock",   "fused_cb[1].y" },
+	};
+	shader.cbufferSize = sizeof(Constants_t);
+	return shader;
+}
+
+static bool CreateTexture(Device_t& dev, Texture_t& tex, const float* pData, const DXGI_FORMAT format = DXGI_FORMAT_R32G32B32A32_FLOAT)
+{
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = kSize;
+	desc.Height = kSize;
+	desc.MipLevels = 1;
+	desc.ArraySize = 1;
+	desc.Format = format;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
+
+	D3D11_SUBRESOURCE_DATA data = { pData, kSize * 4 * sizeof(float), 0 };
+	return SUCCEEDED(dev.device->CreateTexture2D(&desc, pData ? &data : nullptr, &tex.texture))
+		&& SUCCEEDED(dev.device->CreateShaderResourceView(tex.texture.Get(), nullptr, &tex.srv))
+		&& SUCCEEDED(dev.device->CreateRenderTargetView(tex.texture.Get(), nullptr, &tex.rtv));
+}
+
+static void Draw(Device_t& dev, ID3D11PixelShader* pShader, Texture_t& src, Texture_t& dst)
+{
+	const D3D11_VIEWPORT viewport = { 0, 0, (float)kSize, (float)kSize, 0, 1 };
+	ID3D11ShaderResourceView* pNullSRV = nullptr;
+
+	dev.context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	dev.context->IASetInputLayout(nullptr);
+	dev.context->VSSetShader(dev.vertexShader.Get(), nullptr, 0);
+	dev.context->PSSetShader(pShader, nullptr, 0);
+	dev.context->PSSetSamplers(0, 1, dev.sampler.GetAddressOf());
+	dev.context->PSSetConstantBuffers(0, 1, dev.constants.GetAddressOf());
+	dev.context->RSSetViewports(1, &viewport);
+	dev.context->OMSetRenderTargets(1, dst.rtv.GetAddressOf(), nullptr);
+	dev.context->PSSetShaderResources(0, 1, src.srv.GetAddressOf());
+	dev.context->Draw(3, 0);
+	dev.context->PSSetShaderResources(0, 1, &pNullSRV);
+	dev.context->OMSetRenderTargets(0, nullptr, nullptr);
+}
+
+static std::vector<float> ReadBack(Device_t& dev, Texture_t& tex)
+{
+	std::vector<float> pixels;
+
+	D3D11_TEXTURE2D_DESC desc;
+	tex.texture->GetDesc(&desc);
+	desc.Usage = D3D11_USAGE_STAGING;
+	desc.BindFlags = 0;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+	ComPtr<ID3D11Texture2D> pStaging;
+	if (FAILED(dev.device->CreateTexture2D(&desc, nullptr, &pStaging))) {
+		return pixels;
+	}
+	dev.context->CopyResource(pStaging.Get(), tex.texture.Get());
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (SUCCEEDED(dev.context->Map(pStaging.Get(), 0, D3D11_MAP_READ, 0, &mapped))) {
+		for (UINT y = 0; y < kSize; y++) {
+			const float* row = (const float*)((const BYTE*)mapped.pData + y * mapped.RowPitch);
+			pixels.insert(pixels.end(), row, row + kSize * 4);
+		}
+		dev.context->Unmap(pStaging.Get(), 0);
+	}
+
+	return pixels;
+}
+
+// The separate passes write to textures of intermediateFmt, the last pass and the fused pass to a float texture.
+static void TestFusedOutput(Device_t& dev, Texture_t& input, const std::vector<const TestShader_t*>& tests,
+	const DXGI_FORMAT intermediateFmt = DXGI_FORMAT_R32G32B32A32_FLOAT, const bool bClamp = false)
+{
+	std::vector<PointwiseShader_t> pointwise;
+	for (const auto& test : tests) {
+		pointwise.emplace_back(GetPointwiseShader(*test));
+	}
+	std::vector<const PointwiseShader_t*> shaders;
+	for (const auto& shader : pointwise) {
+		shaders.emplace_back(&shader);
+	}
+
+	const std::string fusedCode = GetFusedPointwiseCode(shaders, bClamp);
+	CHECK(fusedCode.size());
+	ComPtr<ID3D11PixelShader> pFused = CreatePixelShader(dev, fusedCode);
+	CHECK(pFused);
+
+	// the separate passes
+	Texture_t texs[2];
+	Texture_t output;
+	CHECK(CreateTexture(dev, texs[0], nullptr, intermediateFmt));
+	CHECK(CreateTexture(dev, texs[1], nullptr, intermediateFmt));
+	CHECK(CreateTexture(dev, output, nullptr));
+	Texture_t* pSrc = &input;
+	for (size_t k = 0; k < tests.size(); k++) {
+		ComPtr<ID3D11PixelShader> pShader = CreatePixelShader(dev, std::string(kDeclarations) + tests[k]->code);
+		CHECK(pShader);
+		Texture_t* pDst = (k + 1 < tests.size()) ? &texs[k & 1] : &output;
+		Draw(dev, pShader.Get(), *pSrc, *pDst);
+		pSrc = pDst;
+	}
+	const std::vector<float> expected = ReadBack(dev, output);
+
+	Texture_t fused;
+	CHECK(CreateTexture(dev, fused, nullptr));
+	Draw(dev, pFused.Get(), input, fused);
+	const std::vector<float> result = ReadBack(dev, fused);
+
+	CHECK(expected.size() == kSize * kSize * 4);
+	CHECK(result.size() == expected.size());
+	float maxDiff = 0;
+	for (size_t i = 0; i < std::min(result.size(), expected.size()); i++) {
+		maxDiff = std::max(maxDiff, std::abs(result[i] - expected[i]));
+	}
+	// 16-bit UNORM intermediates are rounded to 1/65535
+	CHECK_NEAR(maxDiff, 0.0, intermediateFmt == DXGI_FORMAT_R32G32B32A32_FLOAT ? 1e-5 : 1e-3);
+}
+
+int main()
+{
+	Device_t dev;
+	if (FAILED(D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_WARP, nullptr, 0, nullptr, 0, D3D11_SDK_VERSION, &dev.device, nullptr, &dev.context))) {
+		std::printf("the WARP device is not available, skipped\n");
+		return 0;
+	}
+
+	ComPtr<ID3DBlob> pVertexShaderCode = Compile(kVertexShader, "vs_4_0");
+	CHECK(pVertexShaderCode);
+	if (!pVertexShaderCode) {
+		return TEST_RESULT();
+	}
+	dev.device->CreateVertexShader(pVertexShaderCode->GetBufferPointer(), pVertexShaderCode->GetBufferSize(), nullptr, &dev.vertexShader);
+
+	D3D11_SAMPLER_DESC samplerDesc = {};
+	samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_POINT;
+	samplerDesc.AddressU = samplerDesc.AddressV = samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+	samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+	dev.device->CreateSamplerState(&samplerDesc, &dev.sampler);
+
+	const Constants_t constants = { { 1.0f / kSize, 1.0f / kSize }, { (float)kSize, (float)kSize }, 3, 0.5f };
+	D3D11_BUFFER_DESC bufferDesc = { sizeof(constants), D3D11_USAGE_DEFAULT, D3D11_BIND_CONSTANT_BUFFER };
+	D3D11_SUBRESOURCE_DATA bufferData = { &constants };
+	dev.device->CreateBuffer(&bufferDesc, &bufferData, &dev.constants);
+
+	std::vector<float> pixels;
+	for (UINT y = 0; y < kSize; y++) {
+		for (UINT x = 0; x < kSize; x++) {
+			pixels.insert(pixels.end(), { x / (kSize - 1.0f), y / (kSize - 1.0f), (x + y) / (2.0f * kSize), 1.0f });
+		}
+	}
+	Texture_t input;
+	CHECK(CreateTexture(dev, input, pixels.data()));
+
+	TestFusedOutput(dev, input, { &kShaderA, &kShaderB });
+	TestFusedOutput(dev, input, { &kShaderB, &kShaderA });
+	TestFusedOutput(dev, input, { &kShaderA, &kShaderB, &kShaderC });
+	TestFusedOutput(dev, input, { &kShaderC, &kShaderC, &kShaderA });
+
+	// the intermediate results out of [0, 1] are clamped like in a UNORM texture of the renderer
+	TestFusedOutput(dev, input, { &kShaderD, &kShaderA }, DXGI_FORMAT_R16G16B16A16_UNORM, true);
+	TestFusedOutput(dev, input, { &kShaderD, &kShaderD, &kShaderB }, DXGI_FORMAT_R16G16B16A16_UNORM, true);
+	TestFusedOutput(dev, input, { &kShaderD, &kShaderA }, DXGI_FORMAT_R32G32B32A32_FLOAT, false);
+
+	return TEST_RESULT();
+}
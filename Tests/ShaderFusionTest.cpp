@@ -0,0 +1,199 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "stdafx.h"
+#include "Test.h"
+#include "ShaderFusion.h"
+
+// The sources are given after the preprocessor, as D3DPreprocess() returns them.
+
+static const char kInvert[] = R"(
+#line 1 "invert.hlsl"
+Texture2D tex : register(t0);
+SamplerState samp : register(s0);
+
+cbuffer PS_CONSTANTS : register(b0)
+{
+	float2 pxy;
+	float2 wh;
+	uint counter;
+	float clock;
+};
+
+static const float strength = 1.0;
+
+float3 Adjust(float3 c) // the same name as in the second shader
+{
+	return lerp(c, 1.0 - c, strength);
+}
+
+float4 main(float4 pos : SV_POSITION, float2 coord : TEXCOORD) : SV_Target
+{
+	float4 c0 = tex.Sample(samp, coord);
+	c0.rgb = Adjust(c0.rgb) * (wh.x / 1920.0);
+	return c0;
+}
+)";
+
+static const char kGrayscale[] = R"(
+Texture2D image : register(t0);
+SamplerState samp : register(s0);
+
+cbuffer PS_CONSTANTS : register(b0)
+{
+	float2 pxy;
+	float2 wh;
+	uint counter;
+	float clock;
+};
+
+static const float3 strength = { 0.299, 0.587, 0.114 };
+
+struct Pixel { float4 color; };
+
+float3 Adjust(float3 c)
+{
+	return dot(c, strength);
+}
+
+float4 main(float2 coord : TEXCOORD) : SV_Target
+{
+	/* a local variable with a name that the first shader used for a macro */
+	float width = pxy.x;
+	Pixel p;
+	p.color = image.Sample(samp, coord);
+	return float4(Adjust(p.color.rgb) + width * 0.0, p.color.a);
+}
+)";
+
+static PointwiseShader_t MakeShader(const char* code, const char* texName, std::vector<std::string> args)
+{
+	PointwiseShader_t shader;
+	shader.code = code;
+	shader.texName = texName;
+	shader.args = std::move(args);
+	shader.constants = {
+		{ "pxy",     "fused_cb[0].xy" },
+		{ "wh",      "fused_cb[0].zw" },
+		{ "counter", "asuint(fused_cb[1].x)" },
+		{ "clock",   "fused_cb[1].y" },
+	};
+	shader.cbufferSize = 32;
+	return shader;
+}
+
+static size_t Count(const std::string& str, const std::string& what)
+{
+	size_t count = 0;
+	for (size_t pos = str.find(what); pos != str.npos; pos = str.find(what, pos + what.size())) {
+		count++;
+	}
+	return count;
+}
+
+static void TestFusion()
+{
+	const PointwiseShader_t invert = MakeShader(kInvert, "tex", { "pos", "coord" });
+	const PointwiseShader_t grayscale = MakeShader(kGrayscale, "image", { "coord" });
+
+	const std::string code = GetFusedPointwiseCode({ &invert, &grayscale, &invert });
+	CHECK(code.size());
+
+	// no macros and no preprocessor lines
+	CHECK(Count(code, "#") == 0);
+
+	// every shader has its own names
+	for (const char* name : { "fused0_main(", "fused1_main(", "fused2_main(", "fused0_Adjust(", "fused1_Adjust(", "fused2_Adjust(",
+			"fused0_strength", "fused1_strength", "fused1_Pixel p;" }) {
+		CHECK(Count(code, name) > 0);
+	}
+	CHECK(Count(code, " Adjust(") == 0);
+	CHECK(Count(code, " main(") == 1);
+
+	// the entry points are called with the arguments of their signatures
+	CHECK(Count(code, "fused_color = fused0_main(pos, coord);") == 1);
+	CHECK(Count(code, "fused_color = fused1_main(coord);") == 1);
+	CHECK(Count(code, "fused_color = fused2_main(pos, coord);") == 1);
+
+	// only the first shader samples the texture, the others get the previous result
+	CHECK(Count(code, "fused0_tex.Sample(fused0_samp, coord)") == 1);
+	CHECK(Count(code, "p.color = FusedSample(fused1_samp, coord);") == 1);
+	CHECK(Count(code, "FusedSample(fused2_samp, coord)") == 1);
+	CHECK(Count(code, "Texture2D") == 1);
+	CHECK(Count(code, "register(t0)") == 1);
+	CHECK(Count(code, "register(s0)") == 1);
+
+	// the constants are taken from the shared constant buffer, members and swizzles are kept
+	CHECK(Count(code, "cbuffer") == 1);
+	CHECK(Count(code, "float4 fused_cb[2];") == 1);
+	CHECK(Count(code, "(fused_cb[0].zw).x / 1920.0") == 2);
+	CHECK(Count(code, "float width = (fused_cb[0].xy).x;") == 1);
+	CHECK(Count(code, "c0.rgb = fused0_Adjust(c0.rgb)") == 1);
+	CHECK(Count(code, "p.color.rgb") == 1);
+
+	// the float intermediates are not clamped
+	CHECK(Count(code, "saturate(fused_color)") == 0);
+}
+
+static void TestClamp()
+{
+	const PointwiseShader_t invert = MakeShader(kInvert, "tex", { "pos", "coord" });
+	const PointwiseShader_t grayscale = MakeShader(kGrayscale, "image", { "coord" });
+
+	// the UNORM intermediates of the separate passes are clamped, the result of the last shader is not
+	const std::string code = GetFusedPointwiseCode({ &invert, &grayscale, &invert }, true);
+	CHECK(Count(code, "fused_color = saturate(fused_color);") == 2);
+	const size_t first = code.find("fused_color = fused0_main(pos, coord);\nfused_color = saturate(fused_color);\nfused_color = fused1_main(coord);\n");
+	CHECK(first != code.npos);
+	CHECK(code.find("fused_color = fused2_main(pos, coord);\nreturn fused_color;") != code.npos);
+}
+
+static void TestRejected()
+{
+	const PointwiseShader_t invert = MakeShader(kInvert, "tex", { "pos", "coord" });
+
+	// one shader is not fused
+	CHECK(GetFusedPointwiseCode({ &invert }).empty());
+
+	// a macro that was not expanded could change the code of the following shaders
+	PointwiseShader_t macro = invert;
+	macro.code = "#define width 1920\n" + macro.code;
+	CHECK(GetFusedPointwiseCode({ &invert, &macro }).empty());
+
+	// a local variable with the name of a constant hides the constant
+	PointwiseShader_t shadow = invert;
+	shadow.code.replace(shadow.code.find("float4 c0 ="), 11, "float clock = 0; float4 c0 =");
+	CHECK(GetFusedPointwiseCode({ &invert, &shadow }).empty());
+
+	// no entry point
+	PointwiseShader_t noMain = invert;
+	noMain.code.replace(noMain.code.find("main("), 5, "other(");
+	CHECK(GetFusedPointwiseCode({ &invert, &noMain }).empty());
+}
+
+int main()
+{
+	TestFusion();
+	TestClamp();
+	TestRejected();
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,331 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "stdafx.h"
+#include <cstdio>
+#include "Test.h"
+#include "Utils/CPUInfo.h"
+#include "SubtitleBlend.h"
+
+// The frames blended with the C, SSE2 and AVX2 code must be identical and match a blend computed
+// in double precision from the subtitle pixels. The subtitle pixels are premultiplied by their opacity.
+
+#ifndef _WIN32
+// Utils/CPUInfo.cpp uses the MSVC intrinsics
+namespace CPUInfo {
+	const bool HaveAVX2() { return __builtin_cpu_supports("avx2"); }
+}
+#endif
+
+constexpr int kWidth  = 72;
+constexpr int kHeight = 40;
+
+struct Plane_t {
+	UINT pitch; // in bytes
+	UINT lines;
+	std::vector<BYTE> data;
+};
+
+static uint32_t g_seed = 12345;
+
+static uint32_t Random(const uint32_t max) // 0 - max
+{
+	g_seed = g_seed * 1664525u + 1013904223u;
+	return (uint32_t)(((uint64_t)(g_seed >> 8) * (max + 1)) >> 24);
+}
+
+static std::vector<Plane_t> CreateFrame(const ColorFormat_t cformat, const bool bBlack)
+{
+	std::vector<Plane_t> planes;
+	switch (cformat) {
+	case CF_NV12:
+		planes = { { kWidth, kHeight }, { kWidth, kHeight / 2 } };
+		break;
+	case CF_P010:
+		planes = { { kWidth * 2, kHeight }, { kWidth * 2, kHeight / 2 } };
+		break;
+	case CF_YV12:
+		planes = { { kWidth, kHeight }, { kWidth / 2, kHeight / 2 }, { kWidth / 2, kHeight / 2 } };
+		break;
+	case CF_XRGB32:
+		planes = { { kWidth * 4, kHeight } };
+		break;
+	}
+
+	for (auto& plane : planes) {
+		plane.data.resize((size_t)plane.pitch * plane.lines);
+		if (bBlack) {
+			continue;
+		}
+		if (cformat == CF_P010) {
+			for (size_t i = 0; i < plane.data.size() / 2; i++) {
+				// the 10-bit range with the extremes
+				const uint16_t v = (uint16_t)(Random(7) == 0 ? Random(1) * 0xFFC0 : Random(1023) << 6);
+				memcpy(&plane.data[i * 2], &v, 2);
+			}
+		} else {
+			for (auto& v : plane.data) {
+				v = (BYTE)(Random(7) == 0 ? Random(1) * 255 : Random(255));
+			}
+		}
+	}
+	return planes;
+}
+
+struct Subtitle_t {
+	RECT rect;
+	bool bInvAlpha;
+	std::vector<uint32_t> pixels; // BGRA of rect
+	UINT pitch;                   // in pixels
+
+	double Opacity(const int x, const int y) const
+	{
+		const uint32_t a = pixels[(size_t)pitch * (y - rect.top) + (x - rect.left)] >> 24;
+		return (bInvAlpha ? a : 255 - a) / 255.0;
+	}
+	// B, G, R from 0 to 1
+	double Color(const int x, const int y, const int c) const
+	{
+		return ((pixels[(size_t)pitch * (y - rect.top) + (x - rect.left)] >> (c * 8)) & 0xFF) / 255.0;
+	}
+	bool Contains(const int x, const int y) const
+	{
+		return x >= rect.left && x < rect.right && y >= rect.top && y < rect.bottom;
+	}
+};
+
+static Subtitle_t CreateSubtitle(const RECT& rect, const bool bInvAlpha)
+{
+	Subtitle_t sub = { rect, bInvAlpha };
+	sub.pitch = rect.right - rect.left + 3; // the picture is wider than rect
+	sub.pixels.resize((size_t)sub.pitch * (rect.bottom - rect.top));
+	for (auto& p : sub.pixels) {
+		const uint32_t rnd = Random(3);
+		const uint32_t opacity = (rnd == 0) ? 0 : (rnd == 1) ? 255 : Random(255);
+		const uint32_t a = bInvAlpha ? opacity : 255 - opacity;
+		p = (a << 24) | (Random(opacity) << 16) | (Random(opacity) << 8) | Random(opacity);
+	}
+	return sub;
+}
+
+struct Matrix_t {
+	UINT matrix;
+	double kr, kb;
+};
+
+// the expected value of an element of the plane in its units, false if it is not changed
+static bool Reference(double& out, const double in, const ColorFormat_t cformat, const UINT plane, const int xe, const int y,
+	const Subtitle_t& sub, const Matrix_t& m, const bool bFullRange)
+{
+	if (cformat == CF_XRGB32) {
+		const int x = xe / 4;
+		const int c = xe % 4;
+		if (!sub.Contains(x, y) || c == 3) {
+			return false;
+		}
+		out = std::min(255.0 * sub.Color(x, y, c) + in * (1.0 - sub.Opacity(x, y)), 255.0);
+		return true;
+	}
+
+	const double unit = (cformat == CF_P010) ? 256.0 : 1.0;
+	const double maxValue = (cformat == CF_P010) ? 65535.0 : 255.0;
+	const double fullScale = (cformat == CF_P010) ? 65535.0 : 255.0;
+	const double kg = 1.0 - m.kr - m.kb;
+	auto Luma = [&](const int x, const int y) {
+		return m.kr * sub.Color(x, y, 2) + kg * sub.Color(x, y, 1) + m.kb * sub.Color(x, y, 0);
+	};
+
+	if (plane == 0) {
+		if (!sub.Contains(xe, y)) {
+			return false;
+		}
+		const double a = sub.Opacity(xe, y);
+		const double value = bFullRange ? fullScale * Luma(xe, y) : unit * (219.0 * Luma(xe, y) + 16.0 * a);
+		out = std::min(value + in * (1.0 - a), maxValue);
+		return true;
+	}
+
+	int cx;
+	bool bU;
+	if (cformat == CF_YV12) {
+		cx = xe;
+		bU = plane == 2;
+	} else {
+		cx = xe / 2;
+		bU = (xe % 2) == 0;
+	}
+	const int cy = y;
+	if (cx < sub.rect.left / 2 || cx >= (sub.rect.right + 1) / 2 || cy < sub.rect.top / 2 || cy >= (sub.rect.bottom + 1) / 2) {
+		return false;
+	}
+
+	// the average of the 2x2 block, the pixels outside of rect are transparent
+	double sumValue = 0.0;
+	double sumA = 0.0;
+	for (int j = 0; j < 2; j++) {
+		for (int i = 0; i < 2; i++) {
+			const int x = cx * 2 + i;
+			const int y = cy * 2 + j;
+			if (!sub.Contains(x, y)) {
+				continue;
+			}
+			const double a = sub.Opacity(x, y);
+			const double color = sub.Color(x, y, bU ? 0 : 2);
+			const double k = bU ? m.kb : m.kr;
+			const double c = (color - Luma(x, y)) / (2.0 * (1.0 - k));
+			sumValue += (bFullRange ? fullScale : unit * 224.0) * c + unit * 128.0 * a;
+			sumA += a;
+		}
+	}
+	out = std::clamp(sumValue / 4.0 + in * (1.0 - sumA / 4.0), 0.0, maxValue);
+	return true;
+}
+
+static UINT GetElement(const Plane_t& plane, const bool b16, const int xe, const int y)
+{
+	if (b16) {
+		uint16_t v;
+		memcpy(&v, &plane.data[(size_t)plane.pitch * y + xe * 2], 2);
+		return v;
+	}
+	return plane.data[(size_t)plane.pitch * y + xe];
+}
+
+static void TestBlend(const ColorFormat_t cformat, const char* name, const RECT& rect, const Matrix_t& m, const bool bFullRange,
+	const bool bInvAlpha, const bool bBlack)
+{
+	static const bool bAVX2 = CPUInfo::HaveAVX2();
+
+	const auto src = CreateFrame(cformat, bBlack);
+	const Subtitle_t sub = CreateSubtitle(rect, bInvAlpha);
+
+	DXVA2_ExtendedFormat exFmt = {};
+	exFmt.VideoTransferMatrix = m.matrix;
+	exFmt.NominalRange = bFullRange ? DXVA2_NominalRange_0_255 : DXVA2_NominalRange_16_235;
+
+	const bool b16 = cformat == CF_P010;
+	// the rounding to the integer output, the 16-bit math adds a few units of the 16-bit scale
+	const double tolerance = b16 ? (bBlack ? 0.51 : 3.0) : 0.5 + 3.0 / 256;
+
+	double maxError = 0.0;
+	unsigned blended = 0;
+	std::vector<Plane_t> results[3];
+
+	const CSubtitleBlender::Simd_t simds[] = { CSubtitleBlender::SIMD_NONE, CSubtitleBlender::SIMD_SSE2, CSubtitleBlender::SIMD_AVX2 };
+	for (const auto simd : simds) {
+		if (simd == CSubtitleBlender::SIMD_AVX2 && !bAVX2) {
+			continue;
+		}
+		CSubtitleBlender blender;
+		blender.SetSimd(simd);
+		blender.Prepare(&sub, 1, cformat, exFmt, bInvAlpha, sub.pixels.data(), sub.pitch, rect);
+		CHECK(blender.IsPrepared(&sub, 1, cformat, exFmt, bInvAlpha, rect));
+
+		auto dst = src;
+		for (UINT n = 0; n < dst.size(); n++) {
+			blender.BlendPlane(n, dst[n].data.data(), dst[n].pitch, src[n].data.data(), src[n].pitch);
+		}
+		results[simd] = dst;
+
+		// the source lines are written back
+		auto restored = dst;
+		for (UINT n = 0; n < restored.size(); n++) {
+			blender.RestorePlane(n, restored[n].data.data(), restored[n].pitch);
+			CHECK(restored[n].data == src[n].data);
+		}
+	}
+
+	// the SIMD code gives the same result as the C code
+	CHECK(results[CSubtitleBlender::SIMD_SSE2].size() == src.size());
+	for (UINT n = 0; n < src.size(); n++) {
+		CHECK(results[CSubtitleBlender::SIMD_SSE2][n].data == results[CSubtitleBlender::SIMD_NONE][n].data);
+		if (bAVX2) {
+			CHECK(results[CSubtitleBlender::SIMD_AVX2][n].data == results[CSubtitleBlender::SIMD_NONE][n].data);
+		}
+	}
+
+	const auto& dst = results[CSubtitleBlender::SIMD_NONE];
+	for (UINT n = 0; n < src.size(); n++) {
+		const int elements = src[n].pitch / (b16 ? 2 : 1);
+		for (int y = 0; y < (int)src[n].lines; y++) {
+			for (int xe = 0; xe < elements; xe++) {
+				const UINT in = GetElement(src[n], b16, xe, y);
+				const UINT out = GetElement(dst[n], b16, xe, y);
+				double expected;
+				if (Reference(expected, in, cformat, n, xe, y, sub, m, bFullRange)) {
+					maxError = std::max(maxError, std::abs(out - expected));
+					blended++;
+				} else {
+					CHECK(out == in);
+				}
+			}
+		}
+	}
+
+	std::printf("%-6s rect %2ld,%2ld,%2ld,%2ld matrix %u %s range%s%s: %4u elements, max error %.4f\n",
+		name, (long)rect.left, (long)rect.top, (long)rect.right, (long)rect.bottom, m.matrix, bFullRange ? "full   " : "limited",
+		bInvAlpha ? ", inverted alpha" : "", bBlack ? ", black frame" : "", blended, maxError);
+	CHECK(blended > 0);
+	CHECK(maxError <= tolerance);
+}
+
+int main()
+{
+	if (!CPUInfo::HaveAVX2()) {
+		std::printf("AVX2 is not supported, only the C and SSE2 code is tested\n");
+	}
+
+	const struct {
+		ColorFormat_t cformat;
+		const char* name;
+	} formats[] = {
+		{ CF_NV12,    "NV12" },
+		{ CF_P010,    "P010" },
+		{ CF_YV12,    "YV12" },
+		{ CF_XRGB32,  "RGB32" },
+	};
+	const Matrix_t matrices[] = {
+		{ DXVA2_VideoTransferMatrix_BT709, 0.2126, 0.0722 },
+		{ DXVA2_VideoTransferMatrix_BT601, 0.299,  0.114 },
+	};
+	const RECT rects[] = {
+		{ 0, 0, kWidth, kHeight },
+		{ 13, 7, 58, 28 }, // odd origin and size
+		{ 6, 4, 40, 20 },
+		{ 1, 1, 2, 2 },
+	};
+
+	for (const auto& format : formats) {
+		for (const auto& rect : rects) {
+			for (const auto& m : matrices) {
+				for (const bool bFullRange : { false, true }) {
+					TestBlend(format.cformat, format.name, rect, m, bFullRange, bFullRange, false);
+				}
+			}
+		}
+	}
+
+	// the output of a black frame is the prepared value itself
+	TestBlend(CF_P010, "P010", { 13, 7, 58, 28 }, matrices[0], false, false, true);
+	TestBlend(CF_P010, "P010", { 13, 7, 58, 28 }, matrices[1], true, false, true);
+
+	return TEST_RESULT();
+}
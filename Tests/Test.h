@@ -0,0 +1,47 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <cstdio>
+#include <cmath>
+
+// Each test is a program, it returns 1 if a check failed.
+
+inline int g_testFailures = 0;
+
+#define CHECK(expr) \
+	do { \
+		if (!(expr)) { \
+			std::printf("%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #expr); \
+			g_testFailures++; \
+		} \
+	} while (0)
+
+#define CHECK_NEAR(a, b, tolerance) \
+	do { \
+		const double a_ = (double)(a), b_ = (double)(b); \
+		if (!(std::abs(a_ - b_) <= (double)(tolerance))) { \
+			std::printf("%s(%d): CHECK_NEAR(%s, %s, %s) failed, %g and %g\n", __FILE__, __LINE__, #a, #b, #tolerance, a_, b_); \
+			g_testFailures++; \
+		} \
+	} while (0)
+
+#define TEST_RESULT() (g_testFailures ? (std::printf("%d checks failed\n", g_testFailures), 1) : 0)
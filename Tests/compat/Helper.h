@@ -0,0 +1,96 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+// Replaces Source/Helper.h for the tests, only the color formats and DXVA2_ExtendedFormat are declared.
+
+#pragma once
+
+#ifdef _WIN32
+#include <dxva2api.h>
+#else
+enum DXVA2_VideoTransferMatrix {
+	DXVA2_VideoTransferMatrix_Unknown   = 0,
+	DXVA2_VideoTransferMatrix_BT709     = 1,
+	DXVA2_VideoTransferMatrix_BT601     = 2,
+	DXVA2_VideoTransferMatrix_SMPTE240M = 3,
+};
+
+enum DXVA2_NominalRange {
+	DXVA2_NominalRange_Unknown = 0,
+	DXVA2_NominalRange_Normal  = 1,
+	DXVA2_NominalRange_Wide    = 2,
+	DXVA2_NominalRange_0_255   = 1,
+	DXVA2_NominalRange_16_235  = 2,
+};
+
+struct DXVA2_ExtendedFormat {
+	UINT SampleFormat;
+	UINT VideoChromaSubsampling;
+	UINT NominalRange;
+	UINT VideoTransferMatrix;
+	UINT VideoLighting;
+	UINT VideoPrimaries;
+	UINT VideoTransferFunction;
+};
+#endif
+
+enum ColorFormat_t {
+	CF_NONE = 0,
+	CF_NV12,
+	CF_P010,
+	CF_P016,
+	CF_YUY2,
+	CF_UYVY,
+	CF_P210,
+	CF_P216,
+	CF_Y210,
+	CF_Y216,
+	CF_V210,
+	CF_AYUV,
+	CF_Y410,
+	CF_Y416,
+	CF_YV12,
+	CF_YV16,
+	CF_YV24,
+	CF_YUV420P8,
+	CF_YUV422P8,
+	CF_YUV444P8,
+	CF_YUV420P10,
+	CF_YUV420P16,
+	CF_YUV422P10,
+	CF_YUV422P16,
+	CF_YUV444P10,
+	CF_YUV444P16,
+	CF_GBRP8,
+	CF_GBRP10,
+	CF_GBRP16,
+	CF_RGB24,
+	CF_XRGB32,
+	CF_ARGB32,
+	CF_r210,
+	CF_RGB48,
+	CF_BGR48,
+	CF_BGRA64,
+	CF_B64A,
+	CF_Y8,
+	CF_Y10,
+	CF_Y16,
+};
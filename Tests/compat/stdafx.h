@@ -0,0 +1,99 @@
+/*
+ * (C) 2026 see Authors.txt
+ *
+ * This file is part of MPC-BE.
+ *
+ * MPC-BE is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MPC-BE is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Replaces Source/stdafx.h for the tests, only the platform independent code is tested.
+
+#pragma once
+
+#include <cstdint>
+#include <climits>
+#include <cstring>
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+#include <numeric>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <deque>
+
+#if __has_include(<format>)
+#include <format>
+#else
+// older standard libraries, {fmt} has the same syntax
+#define FMT_HEADER_ONLY
+#include <fmt/format.h>
+namespace std { using fmt::format; }
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#include <mfobjects.h>
+#else
+typedef int32_t  BOOL;
+typedef uint8_t  BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+typedef uint32_t UINT;
+typedef int32_t  LONG;
+typedef int64_t  LONGLONG;
+typedef uint64_t UINT64;
+typedef int32_t  HRESULT;
+
+#define S_OK         ((HRESULT)0)
+#define S_FALSE      ((HRESULT)1)
+#define E_FAIL       ((HRESULT)0x80004005)
+#define E_INVALIDARG ((HRESULT)0x80070057)
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr)    (((HRESULT)(hr)) < 0)
+
+struct RECT {
+	LONG left;
+	LONG top;
+	LONG right;
+	LONG bottom;
+};
+
+inline BOOL IsRectEmpty(const RECT* r)
+{
+	return r->right <= r->left || r->bottom <= r->top;
+}
+
+inline BOOL EqualRect(const RECT* a, const RECT* b)
+{
+	return a->left == b->left && a->top == b->top && a->right == b->right && a->bottom == b->bottom;
+}
+
+#define UNREFERENCED_PARAMETER(P) (void)(P)
+
+enum {
+	MFVideoPrimaries_BT709  = 2,
+	MFVideoPrimaries_BT2020 = 9,
+	MFVideoPrimaries_DCI_P3 = 11,
+};
+#endif
+
+typedef LONGLONG REFERENCE_TIME;
+#ifndef UNITS
+#define UNITS 10000000LL
+#endif
+
+#define ASSERT assert